@@ -0,0 +1,91 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/12/04.
+
+#include "polarphp/basic/SourceMgr.h"
+#include "polarphp/kernel/LangOptions.h"
+#include "polarphp/parser/Lexer.h"
+#include "polarphp/parser/Token.h"
+#include "llvm/Support/Allocator.h"
+#include "benchmark/benchmark.h"
+
+#include <string>
+
+using polar::kernel::LangOptions;
+using polar::basic::SourceManager;
+using polar::parser::Lexer;
+using polar::parser::Token;
+using polar::syntax::TokenKindType;
+
+namespace {
+
+/// Mostly docblocks, line comments and indentation, like large template
+/// files. Most of the time goes to the trivia scanning kernels.
+std::string make_trivia_heavy_source(size_t blockCount)
+{
+   std::string source;
+   for (size_t i = 0; i < blockCount; ++i) {
+      source += "      /**\n"
+                "       * Render the given template block and return the generated markup.\n"
+                "       * @param array $context the variables exposed to the template\n"
+                "       */\n"
+                "      // keep the output buffer small, flush after every block\n"
+                "\t\t$block = 1;\n";
+   }
+   return source;
+}
+
+/// Dense code with little trivia, the baseline the trivia heavy source is
+/// compared against.
+std::string make_code_heavy_source(size_t blockCount)
+{
+   std::string source;
+   for (size_t i = 0; i < blockCount; ++i) {
+      source += "$a=$b+$c*($d-1);if($a>2){$e=[$a,$b,'text'];}else{$e=f($a);}\n";
+   }
+   return source;
+}
+
+void lex_source(benchmark::State &state, const std::string &source)
+{
+   LangOptions langOpts;
+   SourceManager sourceMgr;
+   unsigned bufferId = sourceMgr.addMemBufferCopy(source);
+   size_t tokenCount = 0;
+   for (auto _ : state) {
+      llvm::BumpPtrAllocator valueAllocator;
+      Lexer lexer(langOpts, sourceMgr, bufferId, /*Diags=*/nullptr);
+      lexer.setTokenValueAllocator(valueAllocator);
+      Token token;
+      do {
+         lexer.lex(token);
+         ++tokenCount;
+      } while (token.isNot(TokenKindType::END));
+      benchmark::DoNotOptimize(token);
+   }
+   state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * source.size());
+   state.counters["tokens"] = benchmark::Counter(static_cast<double>(tokenCount),
+                                                 benchmark::Counter::kIsRate);
+}
+
+void BM_LexTriviaHeavySource(benchmark::State &state)
+{
+   lex_source(state, make_trivia_heavy_source(state.range(0)));
+}
+
+void BM_LexCodeHeavySource(benchmark::State &state)
+{
+   lex_source(state, make_code_heavy_source(state.range(0)));
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_LexTriviaHeavySource)->Arg(1000)->Arg(20000);
+BENCHMARK(BM_LexCodeHeavySource)->Arg(3000)->Arg(60000);
@@ -0,0 +1,94 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/12/04.
+
+#include "polarphp/parser/SyntaxParsingCache.h"
+#include "polarphp/syntax/RawSyntax.h"
+#include "polarphp/syntax/SyntaxNodes.h"
+#include "polarphp/syntax/TokenKinds.h"
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+using polar::parser::SyntaxParsingCache;
+using polar::syntax::RawSyntax;
+using polar::syntax::RefCountPtr;
+using polar::syntax::SyntaxKind;
+using polar::syntax::SourceFileSyntax;
+using polar::syntax::TokenKindType;
+using polar::syntax::TriviaPiece;
+using polar::syntax::SourcePresence;
+using polar::basic::OwnedString;
+
+namespace {
+
+/// Every statement is `$a = 1;\n`, 8 bytes long
+constexpr size_t sg_stmtLength = 8;
+
+RefCountPtr<RawSyntax> make_token(TokenKindType kind, const char *text,
+                                  llvm::ArrayRef<TriviaPiece> trailingTrivia = {})
+{
+   return RawSyntax::make(kind, OwnedString(text), {}, trailingTrivia, SourcePresence::Present);
+}
+
+SourceFileSyntax make_source_file(size_t stmtCount)
+{
+   std::vector<RefCountPtr<RawSyntax>> stmts;
+   stmts.reserve(stmtCount);
+   for (size_t i = 0; i < stmtCount; ++i) {
+      stmts.push_back(RawSyntax::make(SyntaxKind::TopStmt, {
+                                         make_token(TokenKindType::T_VARIABLE, "$a", {TriviaPiece::getSpaces(1)}),
+                                         make_token(TokenKindType::T_EQUAL, "=", {TriviaPiece::getSpaces(1)}),
+                                         make_token(TokenKindType::T_LNUMBER, "1"),
+                                         make_token(TokenKindType::T_SEMICOLON, ";", {TriviaPiece::getNewlines(1)})
+                                      }, SourcePresence::Present));
+   }
+   auto stmtList = RawSyntax::make(SyntaxKind::TopStmtList, stmts, SourcePresence::Present);
+   auto root = RawSyntax::make(SyntaxKind::SourceFile, {stmtList, make_token(TokenKindType::END, "")},
+                               SourcePresence::Present);
+   return polar::syntax::make<SourceFileSyntax>(root);
+}
+
+/// What an incremental reparse asks the cache for: the old tree gets one
+/// edit every range(1) statements, then every statement start of the new
+/// source is looked up in order.
+void BM_IncrementalReparseLookUp(benchmark::State &state)
+{
+   const size_t stmtCount = state.range(0);
+   const size_t editInterval = state.range(1);
+   SourceFileSyntax sourceFile = make_source_file(stmtCount);
+   size_t reused = 0;
+   for (auto _ : state) {
+      SyntaxParsingCache cache(sourceFile);
+      for (size_t i = 0; i < stmtCount; i += editInterval) {
+         // `$a = 1;` -> `$a = 22;`, every later statement moves by one byte
+         cache.addEdit(i * sg_stmtLength + 5, i * sg_stmtLength + 6, 2);
+      }
+      size_t shift = 0;
+      for (size_t i = 0; i < stmtCount; ++i) {
+         if (cache.lookUp(i * sg_stmtLength + shift, SyntaxKind::TopStmt).has_value()) {
+            ++reused;
+         }
+         if (i % editInterval == 0) {
+            ++shift;
+         }
+      }
+   }
+   state.counters["lookups"] = benchmark::Counter(static_cast<double>(stmtCount * state.iterations()),
+                                                  benchmark::Counter::kIsRate);
+   state.counters["reused"] = static_cast<double>(reused / state.iterations());
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_IncrementalReparseLookUp)
+   ->Args({2000, 20})
+   ->Args({20000, 20})
+   ->Args({20000, 1000});
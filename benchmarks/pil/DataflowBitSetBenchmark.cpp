@@ -0,0 +1,136 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/12/06.
+
+#include "polarphp/pil/optimizer/utils/DataflowBitSet.h"
+#include "llvm/ADT/SmallBitVector.h"
+#include "benchmark/benchmark.h"
+
+#include <random>
+#include <vector>
+
+using polar::DataflowBitSet;
+using polar::solveDataflow;
+
+namespace {
+
+/// A block of a synthetic function, with the locations it stores to and the
+/// ones its calls may clobber.
+struct Block
+{
+   std::vector<Block *> preds;
+   std::vector<Block *> succs;
+   std::vector<unsigned> gens;
+   std::vector<unsigned> kills;
+};
+
+/// A function shaped like a large generated one: a chain of diamonds with a
+/// loop back edge every few blocks. Every block touches a few of the
+/// locations.
+std::vector<Block> make_function(unsigned blockCount, unsigned locationCount)
+{
+   std::vector<Block> blocks(blockCount);
+   std::mt19937 random(20191206);
+   auto add_edge = [&](unsigned from, unsigned to) {
+      blocks[from].succs.push_back(&blocks[to]);
+      blocks[to].preds.push_back(&blocks[from]);
+   };
+   for (unsigned i = 0; i + 3 < blockCount; i += 3) {
+      add_edge(i, i + 1);
+      add_edge(i, i + 2);
+      add_edge(i + 1, i + 3);
+      add_edge(i + 2, i + 3);
+      if (i % 30 == 27) {
+         add_edge(i + 3, i - 24);
+      }
+   }
+   for (Block &block : blocks) {
+      for (unsigned i = 0; i < 4; ++i) {
+         block.gens.push_back(random() % locationCount);
+      }
+      if (random() % 4 == 0) {
+         block.kills.push_back(random() % locationCount);
+      }
+   }
+   return blocks;
+}
+
+/// Solve forward availability of the stored locations, like redundant load
+/// elimination does, with \p SetTy as the per-block sets.
+template <typename SetTy>
+void solve_availability(benchmark::State &state)
+{
+   unsigned blockCount = state.range(0);
+   unsigned locationCount = state.range(1);
+   std::vector<Block> blocks = make_function(blockCount, locationCount);
+   std::vector<Block *> postOrder;
+   for (auto iter = blocks.rbegin(); iter != blocks.rend(); ++iter) {
+      postOrder.push_back(&*iter);
+   }
+   size_t transfers = 0;
+   for (auto _ : state) {
+      std::vector<SetTy> gens;
+      std::vector<SetTy> kills;
+      std::vector<SetTy> outs;
+      for (Block &block : blocks) {
+         gens.emplace_back(locationCount, false);
+         kills.emplace_back(locationCount, false);
+         // Optimistically everything is available.
+         outs.emplace_back(locationCount, true);
+         for (unsigned location : block.gens) {
+            gens.back().set(location);
+         }
+         for (unsigned location : block.kills) {
+            kills.back().set(location);
+         }
+      }
+      auto index_of = [&](Block *block) {
+         return static_cast<unsigned>(block - blocks.data());
+      };
+      solveDataflow<Block>(
+         postOrder,
+         [&](Block *block) {
+            ++transfers;
+            unsigned idx = index_of(block);
+            SetTy in(locationCount, !block->preds.empty());
+            for (Block *pred : block->preds) {
+               in &= outs[index_of(pred)];
+            }
+            in.reset(kills[idx]);
+            in |= gens[idx];
+            if (in == outs[idx]) {
+               return false;
+            }
+            outs[idx] = std::move(in);
+            return true;
+         },
+         [](Block *block) -> const std::vector<Block *> & {
+            return block->succs;
+         });
+      benchmark::DoNotOptimize(outs.data());
+   }
+   state.counters["transfers"] = benchmark::Counter(static_cast<double>(transfers),
+                                                    benchmark::Counter::kAvgIterations);
+}
+
+void BM_AvailabilitySparse(benchmark::State &state)
+{
+   solve_availability<DataflowBitSet>(state);
+}
+
+void BM_AvailabilityDense(benchmark::State &state)
+{
+   solve_availability<llvm::SmallBitVector>(state);
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_AvailabilitySparse)->Args({1000, 2000})->Args({5000, 10000});
+BENCHMARK(BM_AvailabilityDense)->Args({1000, 2000})->Args({5000, 10000});
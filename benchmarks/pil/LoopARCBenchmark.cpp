@@ -0,0 +1,204 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/12/06.
+
+#include "polarphp/ast/AstContext.h"
+#include "polarphp/ast/DiagnosticEngine.h"
+#include "polarphp/ast/Module.h"
+#include "polarphp/ast/PILOptions.h"
+#include "polarphp/ast/SearchPathOptions.h"
+#include "polarphp/basic/SourceMgr.h"
+#include "polarphp/kernel/LangOptions.h"
+#include "polarphp/pil/lang/PILBuilder.h"
+#include "polarphp/pil/lang/PILModule.h"
+#include "polarphp/pil/lang/TypeLowering.h"
+#include "polarphp/pil/optimizer/passmgr/PassManager.h"
+#include "polarphp/pil/optimizer/passmgr/PassPipeline.h"
+#include "polarphp/pil/optimizer/passmgr/Transforms.h"
+#include "polarphp/pil/optimizer/utils/PILOptFunctionBuilder.h"
+#include "llvm/Support/Host.h"
+#include "benchmark/benchmark.h"
+
+#include <memory>
+#include <vector>
+
+using namespace polar;
+
+namespace {
+
+/// Creates a function with \p loopCount consecutive loops. Every loop body
+/// is a chain of \p bodyBlockCount blocks, each retaining and releasing the
+/// object argument, so that the loop ARC dataflow has many block regions to
+/// summarize and many pairs to match:
+///
+///   header: strong_retain %obj; cond_br %cond, body0, exit
+///   body<i>: strong_retain %obj; strong_release %obj; br body<i + 1>
+///   latch: strong_release %obj; br header
+class CreateLoopFunction : public PILModuleTransform {
+public:
+   CreateLoopFunction(unsigned loopCount, unsigned bodyBlockCount)
+      : m_loopCount(loopCount),
+        m_bodyBlockCount(bodyBlockCount)
+   {}
+
+   void run() override
+   {
+      PILModule &module = *getModule();
+      AstContext &context = module.getAstContext();
+      PILType int1Type = PILType::getBuiltinIntegerType(1, context);
+      PILType objectType = PILType::getPrimitiveObjectType(context.TheNativeObjectType);
+      PILParameterInfo params[] = {
+         PILParameterInfo(objectType.getAstType(), ParameterConvention::Direct_Guaranteed),
+         PILParameterInfo(int1Type.getAstType(), ParameterConvention::Direct_Unowned)
+      };
+      PILResultInfo results[] = {
+         PILResultInfo(int1Type.getAstType(), ResultConvention::Unowned)
+      };
+      PILFunctionType::ExtInfo extInfo;
+      extInfo = extInfo.withRepresentation(PILFunctionType::Representation::Thin);
+      CanPILFunctionType funcType =
+            PILFunctionType::get(nullptr, extInfo, PILCoroutineKind::None,
+                                 ParameterConvention::Direct_Unowned, params,
+                                 /*yields*/ {}, results, None, SubstitutionMap(),
+                                 false, context);
+
+      PILOptFunctionBuilder funcBuilder(*this);
+      RegularLocation loc = RegularLocation::getAutoGeneratedLocation();
+      PILFunction *func = funcBuilder.getOrCreateFunction(
+               loc, "loops", PILLinkage::Public, funcType, IsBare,
+               IsNotTransparent, IsNotSerialized, IsNotDynamic);
+      func->setOwnershipEliminated();
+
+      PILBasicBlock *entry = func->createBasicBlock();
+      PILValue object = entry->createFunctionArgument(objectType);
+      PILValue cond = entry->createFunctionArgument(int1Type);
+      PILBuilder builder(entry);
+      builder.setCurrentDebugScope(func->getDebugScope());
+      for (unsigned i = 0; i < m_loopCount; ++i) {
+         PILBasicBlock *header = func->createBasicBlock();
+         PILBasicBlock *exit = func->createBasicBlock();
+         builder.createBranch(loc, header);
+
+         std::vector<PILBasicBlock *> body;
+         for (unsigned j = 0; j < m_bodyBlockCount; ++j) {
+            body.push_back(func->createBasicBlock());
+         }
+         PILBasicBlock *latch = func->createBasicBlock();
+         body.push_back(latch);
+
+         builder.setInsertionPoint(header);
+         builder.createStrongRetain(loc, object, builder.getDefaultAtomicity());
+         builder.createCondBranch(loc, cond, body.front(), exit);
+         for (unsigned j = 0; j < m_bodyBlockCount; ++j) {
+            builder.setInsertionPoint(body[j]);
+            builder.createStrongRetain(loc, object, builder.getDefaultAtomicity());
+            builder.createStrongRelease(loc, object, builder.getDefaultAtomicity());
+            builder.createBranch(loc, body[j + 1]);
+         }
+         builder.setInsertionPoint(latch);
+         builder.createStrongRelease(loc, object, builder.getDefaultAtomicity());
+         builder.createBranch(loc, header);
+         builder.setInsertionPoint(exit);
+      }
+      builder.createReturn(loc, cond);
+   }
+
+private:
+   unsigned m_loopCount;
+   unsigned m_bodyBlockCount;
+};
+
+class LoopARCFixture
+{
+public:
+   LoopARCFixture()
+      : m_diags(m_sourceMgr)
+   {
+      m_langOpts.Target = llvm::Triple(llvm::sys::getProcessTriple());
+      m_context = AstContext::get(m_langOpts, m_typeCheckerOpts, m_searchPathOpts,
+                                  m_sourceMgr, m_diags);
+      m_module = ModuleDecl::create(m_context->getIdentifier("loop_arc_benchmark"),
+                                    *m_context);
+      m_pilOpts.OptMode = OptimizationMode::ForSpeed;
+   }
+
+   ~LoopARCFixture()
+   {
+      delete m_context;
+   }
+
+   ModuleDecl &getModule()
+   {
+      return *m_module;
+   }
+
+   const PILOptions &getPILOptions() const
+   {
+      return m_pilOpts;
+   }
+
+private:
+   SourceManager m_sourceMgr;
+   DiagnosticEngine m_diags;
+   LangOptions m_langOpts;
+   TypeCheckerOptions m_typeCheckerOpts;
+   SearchPathOptions m_searchPathOpts;
+   PILOptions m_pilOpts;
+   AstContext *m_context;
+   ModuleDecl *m_module;
+};
+
+LoopARCFixture &get_fixture()
+{
+   static LoopARCFixture fixture;
+   return fixture;
+}
+
+/// Runs the loop ARC optimizer on a new function with state.range(0) loops
+/// of state.range(1) body blocks each. Creating the function isn't timed.
+void BM_ARCLoopOpts(benchmark::State &state)
+{
+   LoopARCFixture &fixture = get_fixture();
+   unsigned loopCount = state.range(0);
+   unsigned bodyBlockCount = state.range(1);
+   lowering::TypeConverter typeConverter(fixture.getModule());
+   for (auto _ : state) {
+      state.PauseTiming();
+      std::unique_ptr<PILModule> pilModule =
+            PILModule::createEmptyModule(&fixture.getModule(), typeConverter,
+                                         fixture.getPILOptions());
+      {
+         PILPassManager passManager(pilModule.get());
+         CreateLoopFunction createFunction(loopCount, bodyBlockCount);
+         createFunction.injectPassManager(&passManager);
+         createFunction.injectModule(pilModule.get());
+         createFunction.run();
+         state.ResumeTiming();
+
+         passManager.executePassPipelinePlan(
+                  PILPassPipelinePlan::getPassPipelineForKinds(
+                     fixture.getPILOptions(), {PassKind::ARCLoopOpts}));
+         state.PauseTiming();
+      }
+      pilModule.reset();
+      state.ResumeTiming();
+   }
+   state.counters["blocks"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * loopCount * (bodyBlockCount + 3)),
+            benchmark::Counter::kIsRate);
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_ARCLoopOpts)
+      ->Args({16, 4})
+      ->Args({256, 4})
+      ->Args({16, 256})
+      ->Unit(benchmark::kMillisecond);
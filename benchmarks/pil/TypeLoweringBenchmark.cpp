@@ -0,0 +1,156 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/12/06.
+
+#include "polarphp/ast/AstContext.h"
+#include "polarphp/ast/DiagnosticEngine.h"
+#include "polarphp/ast/Module.h"
+#include "polarphp/ast/PILOptions.h"
+#include "polarphp/ast/SearchPathOptions.h"
+#include "polarphp/basic/SourceMgr.h"
+#include "polarphp/kernel/LangOptions.h"
+#include "polarphp/pil/lang/PILModule.h"
+#include "polarphp/pil/lang/TypeLowering.h"
+#include "llvm/Support/Host.h"
+#include "benchmark/benchmark.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace polar;
+
+namespace {
+
+/// An AST context and the types of a large module: the builtin integers
+/// and the tuples of up to four of them, about 3000 types in all.
+class TypeLoweringFixture
+{
+public:
+   TypeLoweringFixture()
+      : m_diags(m_sourceMgr)
+   {
+      m_langOpts.Target = llvm::Triple(llvm::sys::getProcessTriple());
+      m_context = AstContext::get(m_langOpts, m_typeCheckerOpts, m_searchPathOpts,
+                                  m_sourceMgr, m_diags);
+      m_module = ModuleDecl::create(m_context->getIdentifier("type_lowering_benchmark"),
+                                    *m_context);
+      std::vector<CanType> intTypes;
+      for (unsigned width : {1, 8, 16, 32, 64, 128}) {
+         intTypes.push_back(PILType::getBuiltinIntegerType(width, *m_context).getAstType());
+      }
+      intTypes.push_back(m_context->TheRawPointerType);
+      for (CanType first : intTypes) {
+         m_types.push_back(first);
+         for (CanType second : intTypes) {
+            m_types.push_back(CanType(TupleType::get({first, second}, *m_context)));
+            for (CanType third : intTypes) {
+               CanType pair = CanType(TupleType::get({first, second}, *m_context));
+               m_types.push_back(CanType(TupleType::get({pair, third}, *m_context)));
+               m_types.push_back(CanType(TupleType::get({first, second, third}, *m_context)));
+               for (CanType fourth : intTypes) {
+                  m_types.push_back(CanType(TupleType::get({first, second, third, fourth},
+                                                           *m_context)));
+               }
+            }
+         }
+      }
+   }
+
+   ~TypeLoweringFixture()
+   {
+      delete m_context;
+   }
+
+   ModuleDecl &getModule()
+   {
+      return *m_module;
+   }
+
+   const std::vector<CanType> &getTypes() const
+   {
+      return m_types;
+   }
+
+private:
+   SourceManager m_sourceMgr;
+   DiagnosticEngine m_diags;
+   LangOptions m_langOpts;
+   TypeCheckerOptions m_typeCheckerOpts;
+   SearchPathOptions m_searchPathOpts;
+   AstContext *m_context;
+   ModuleDecl *m_module;
+   std::vector<CanType> m_types;
+};
+
+TypeLoweringFixture &get_fixture()
+{
+   static TypeLoweringFixture fixture;
+   return fixture;
+}
+
+void lower_all_types(lowering::TypeConverter &typeConverter,
+                     const std::vector<CanType> &types)
+{
+   for (CanType type : types) {
+      benchmark::DoNotOptimize(&typeConverter.getTypeLowering(
+                                  type, TypeExpansionContext::minimal()));
+   }
+}
+
+/// Lowers every type once with a new converter, all lookups miss.
+void BM_LowerTypesCold(benchmark::State &state)
+{
+   TypeLoweringFixture &fixture = get_fixture();
+   for (auto _ : state) {
+      lowering::TypeConverter typeConverter(fixture.getModule());
+      lower_all_types(typeConverter, fixture.getTypes());
+   }
+   state.counters["types"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * fixture.getTypes().size()),
+            benchmark::Counter::kIsRate);
+}
+
+/// Lowers the already lowered types again on state.range(0) threads, like
+/// function passes running concurrently do. There are more types than
+/// per-thread cache entries, so most lookups go to the shared cache.
+void BM_LowerTypesWarm(benchmark::State &state)
+{
+   TypeLoweringFixture &fixture = get_fixture();
+   lowering::TypeConverter typeConverter(fixture.getModule());
+   PILOptions pilOpts;
+   std::unique_ptr<PILModule> pilModule =
+         PILModule::createEmptyModule(&fixture.getModule(), typeConverter, pilOpts);
+   lower_all_types(typeConverter, fixture.getTypes());
+
+   unsigned threadCount = state.range(0);
+   pilModule->setConcurrentFunctionPasses(threadCount > 1);
+   for (auto _ : state) {
+      std::vector<std::thread> workers;
+      for (unsigned i = 0; i < threadCount; ++i) {
+         workers.emplace_back([&]() {
+            lower_all_types(typeConverter, fixture.getTypes());
+         });
+      }
+      for (std::thread &worker : workers) {
+         worker.join();
+      }
+   }
+   pilModule->setConcurrentFunctionPasses(false);
+   state.counters["types"] = benchmark::Counter(
+            static_cast<double>(state.iterations() * threadCount *
+                                fixture.getTypes().size()),
+            benchmark::Counter::kIsRate);
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_LowerTypesCold)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LowerTypesWarm)->Arg(1)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -611,6 +611,26 @@ if(NOT CYGWIN AND NOT WIN32)
    endif()
 endif()
 
+if(POLAR_USE_SANITIZER)
+   if(MSVC)
+      message(FATAL_ERROR "POLAR_USE_SANITIZER is not supported with MSVC")
+   endif()
+   if(POLAR_USE_SANITIZER STREQUAL "Address")
+      set(POLAR_SANITIZER_FLAGS "-fsanitize=address")
+   elseif(POLAR_USE_SANITIZER STREQUAL "Thread")
+      set(POLAR_SANITIZER_FLAGS "-fsanitize=thread")
+   elseif(POLAR_USE_SANITIZER STREQUAL "Undefined")
+      set(POLAR_SANITIZER_FLAGS "-fsanitize=undefined -fno-sanitize-recover=all")
+   else()
+      message(FATAL_ERROR "Unsupported value of POLAR_USE_SANITIZER: ${POLAR_USE_SANITIZER}")
+   endif()
+   polar_append_flag("${POLAR_SANITIZER_FLAGS}" CMAKE_C_FLAGS CMAKE_CXX_FLAGS
+      CMAKE_EXE_LINKER_FLAGS CMAKE_SHARED_LINKER_FLAGS CMAKE_MODULE_LINKER_FLAGS)
+   # Keep the frames and lines in the reports.
+   polar_append_flag("-fno-omit-frame-pointer" CMAKE_C_FLAGS CMAKE_CXX_FLAGS)
+   polar_add_flag_if_supported("-gline-tables-only" GLINE_TABLES_ONLY)
+endif()
+
 if(MSVC)
    # Remove flags here, for exceptions and RTTI.
    # Each target property or source property should be responsible to control
@@ -175,16 +175,16 @@ return array(
    ['class' => 'Misc', 'name' => 'DNumber', 'kind' => 'T_DNUMBER', 'text' => 'floating-point number', 'valueType' => 'double',
       'serializationCode' => 459],
    ['class' => 'Misc', 'name' => 'IdentifierString', 'kind' => 'T_IDENTIFIER_STRING', 'text' => 'identifier',
-      'valueType' => 'std::string', 'serializationCode' => 460],
-   ['class' => 'Misc', 'name' => 'Variable', 'kind' => 'T_VARIABLE', 'text' => 'variable', 'valueType' => 'std::string',
+      'valueType' => 'StringRef', 'serializationCode' => 460],
+   ['class' => 'Misc', 'name' => 'Variable', 'kind' => 'T_VARIABLE', 'text' => 'variable', 'valueType' => 'StringRef',
       'serializationCode' => 461],
    ['class' => 'Misc', 'name' => 'EncapsedAndWhitespace', 'kind' => 'T_ENCAPSED_AND_WHITESPACE',
-      'text' => 'quoted-string and whitespace', 'valueType' => 'std::string', 'serializationCode' => 462],
+      'text' => 'quoted-string and whitespace', 'valueType' => 'StringRef', 'serializationCode' => 462],
    ['class' => 'Misc', 'name' => 'ConstantEncapsedString', 'kind' => 'T_CONSTANT_ENCAPSED_STRING', 'text' => 'quoted-string',
-      'valueType' => 'std::string', 'serializationCode' => 463],
+      'valueType' => 'StringRef', 'serializationCode' => 463],
    ['class' => 'Misc', 'name' => 'StringVarName', 'kind' => 'T_STRING_VARNAME', 'text' => 'variable name',
-      'valueType' => 'std::string', 'serializationCode' => 464],
-   ['class' => 'Misc', 'name' => 'NumString', 'kind' => 'T_NUM_STRING', 'text' => 'number', 'valueType' => 'std::string',
+      'valueType' => 'StringRef', 'serializationCode' => 464],
+   ['class' => 'Misc', 'name' => 'NumString', 'kind' => 'T_NUM_STRING', 'text' => 'number', 'valueType' => 'StringRef',
       'serializationCode' => 465],
    ['class' => 'Misc', 'name' => 'WhiteSpace', 'kind' => 'T_WHITESPACE', 'text' => 'whitespace', 'serializationCode' => 466],
    ['class' => 'Misc', 'name' => 'PrefixOperator', 'kind' => 'T_PREFIX_OPERATOR', 'text' => 'prefix operator', 'serializationCode' => 467],
@@ -200,7 +200,7 @@ return array(
       'serializationCode' => 475],
    ['class' => 'Misc', 'name' => 'EndHereDoc', 'kind' => 'T_END_HEREDOC', 'text' => 'heredoc end',
       'serializationCode' => 476],
-   ['class' => 'Misc', 'name' => 'Error', 'kind' => 'T_ERROR', 'text' => 'error', 'valueType' => 'std::string',
+   ['class' => 'Misc', 'name' => 'Error', 'kind' => 'T_ERROR', 'text' => 'error', 'valueType' => 'StringRef',
       'serializationCode' => 477],
    ['class' => 'Misc', 'name' => 'Unknown', 'kind' => 'T_UNKNOWN_MARK', 'text' => 'unknown token',
       'serializationCode' => 478]
@@ -371,6 +371,9 @@ NOTE(constexpr_too_many_instructions,none,
      "at compile time", (unsigned))
 NOTE(constexpr_limit_exceeding_instruction,none, "limit exceeded "
      "%select{here|during this call}0", (bool))
+NOTE(constexpr_too_much_memory,none,
+     "exceeded memory limit: %0 bytes when evaluating the expression "
+     "at compile time", (unsigned))
 
 NOTE(constexpr_loop_found_note,none,
     "control-flow loop found during evaluation ", ())
@@ -161,6 +161,16 @@ public:
   /// records.
   std::string OptRecordFile;
 
+  /// The name of the file in which interprocedural analyses keep function
+  /// summaries between compilations, usually placed next to the module output.
+  /// Empty if summaries are not persisted.
+  std::string SummaryCacheFile;
+
+  /// The name of the file which records the public prespecializations built
+  /// by earlier compilations, shared by all modules of a build. Empty if
+  /// prespecializations are not recorded.
+  std::string PrespecializationCacheFile;
+
   PILOptions() {}
 
   /// Return a hash code of any components from these options that should
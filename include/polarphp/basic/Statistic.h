@@ -18,6 +18,8 @@
 #include "polarphp/basic/LLVM.h"
 #include "polarphp/basic/Timer.h"
 
+#include <chrono>
+#include <mutex>
 #include <thread>
 #include <tuple>
 
@@ -123,6 +125,24 @@ public:
       const TraceFormatter *Formatter;
    };
 
+   // Phases which run on several threads, like the PIL function passes,
+   // cannot use FrontendStatsTracers, which assume the main thread. They
+   // record finished intervals instead, which are written as "complete"
+   // events of the Chrome trace-event format (see chrome://tracing) when the
+   // user passed -trace-stats-events.
+   struct ChromeTraceEvent
+   {
+      std::string Name;
+      std::string Category;
+      uint64_t StartUSec;
+      uint64_t DurationUSec;
+      unsigned ThreadIndex;
+      // Written as the "entity" argument if not empty.
+      std::string EntityName;
+      // The keys are expected to be string literals.
+      SmallVector<std::pair<StringRef, int64_t>, 4> Args;
+   };
+
    // We only write fine-grained trace entries when the user passed
    // -trace-stats-events, but we recycle the same FrontendStatsTracers to give
    // us some free recursion-save phase timings whenever -trace-stats-dir is
@@ -144,7 +164,12 @@ private:
    SmallString<128> StatsFilename;
    SmallString<128> TraceFilename;
    SmallString<128> ProfileDirname;
+   SmallString<128> ChromeTraceFilename;
+   SmallString<128> OutputDirname;
+   std::string ProgramName;
+   std::string AuxName;
    llvm::TimeRecord StartedTime;
+   std::chrono::steady_clock::time_point StartedSteadyTime;
    std::thread::id MainThreadID;
 
    // This is unique_ptr because NamedRegionTimer is non-copy-constructable.
@@ -156,6 +181,8 @@ private:
    Optional<AlwaysOnFrontendCounters> FrontendCounters;
    Optional<AlwaysOnFrontendCounters> LastTracedFrontendCounters;
    Optional<std::vector<FrontendStatsEvent>> FrontendStatsEvents;
+   Optional<std::vector<ChromeTraceEvent>> ChromeTraceEvents;
+   std::mutex ChromeTraceEventsMutex;
 
    // These are unique_ptr so we can use incomplete types here.
    std::unique_ptr<RecursionSafeTimers> RecursiveTimers;
@@ -164,6 +191,7 @@ private:
 
    void publishAlwaysOnStatsToLLVM();
    void printAlwaysOnStatsAndTimers(raw_ostream &OS);
+   void flushChromeTraceEvents();
 
    UnifiedStatsReporter(StringRef ProgramName,
                         StringRef AuxName,
@@ -195,6 +223,20 @@ public:
    void saveAnyFrontendStatsEvents(FrontendStatsTracer const &T, bool IsEntry);
    void recordJobMaxRSS(long rss);
    int64_t getChildrenMaxResidentSetSize();
+
+   // Returns true if ChromeTraceEvents are collected.
+   bool isTracingEvents() const { return ChromeTraceEvents.hasValue(); }
+   // The time base of ChromeTraceEvent::StartUSec: microseconds since the
+   // reporter was created.
+   uint64_t getTraceTimeUSec() const;
+   // Safe to call from any thread.
+   void recordChromeTraceEvent(ChromeTraceEvent E);
+   // Returns a path in the stats directory, named like the stats file but
+   // with the given prefix and suffix, for outputs of other components.
+   std::string makeOutputFileName(StringRef Prefix, StringRef Suffix) const;
+
+   static void printChromeTraceEvents(ArrayRef<ChromeTraceEvent> Events,
+                                      raw_ostream &OS);
 };
 
 // This is a non-nested type just to make it less work to write at call sites.
@@ -297,6 +297,14 @@ FRONTEND_STATISTIC(PILModule, NumPILOptWitnessTables)
 FRONTEND_STATISTIC(PILModule, NumPILOptDefaultWitnessTables)
 FRONTEND_STATISTIC(PILModule, NumPILOptGlobalVariables)
 
+/// Number of type lowerings answered by the per-thread cache of the
+/// TypeConverter, by its lock-free shared cache, by its locked table, and
+/// computed anew.
+FRONTEND_STATISTIC(PILModule, NumTypeLoweringThreadCacheHits)
+FRONTEND_STATISTIC(PILModule, NumTypeLoweringSharedCacheHits)
+FRONTEND_STATISTIC(PILModule, NumTypeLoweringCacheHits)
+FRONTEND_STATISTIC(PILModule, NumTypeLoweringCacheMisses)
+
 /// The next 9 statistics count kinds of LLVM entities produced
 /// during the IRGen phase: globals, functions, aliases, ifuncs,
 /// named metadata, value and comdat symbols, basic blocks,
@@ -20,6 +20,7 @@
 #include "polarphp/parser/ParsedTrivia.h"
 #include "polarphp/parser/LexerState.h"
 #include "llvm/Support/SaveAndRestore.h"
+#include "llvm/Support/Allocator.h"
 #include "polarphp/parser/internal/YYLexerDefs.h"
 #include "polarphp/parser/LexerFlags.h"
 #include "polarphp/kernel/LangOptions.h"
@@ -47,6 +48,8 @@ using polar::SourceRange;
 
 class Parser;
 
+/// A Lexer is confined to the thread that uses it, distinct lexers over
+/// distinct SourceManagers can run concurrently (see Parser).
 class Lexer final
 {
 private:
@@ -424,6 +427,26 @@ public:
       return m_currentExceptionMsg;
    }
 
+   /// Copy \p value into the token value arena and return the copy.
+   ///
+   /// Token string values which are not a verbatim slice of the source buffer
+   /// (escape processed literals, heredoc bodies with stripped indentation,
+   /// error messages) live in this arena, the token only references them.
+   StringRef saveTokenValue(StringRef value);
+
+   /// Keep token values in \p allocator instead of the lexer owned arena, so
+   /// tokens stay valid after the lexer is destroyed.
+   Lexer &setTokenValueAllocator(llvm::BumpPtrAllocator &allocator)
+   {
+      m_valueAllocator = &allocator;
+      return *this;
+   }
+
+   llvm::BumpPtrAllocator &getTokenValueAllocator()
+   {
+      return *m_valueAllocator;
+   }
+
 private:
    Lexer(const Lexer&) = delete;
    void operator=(const Lexer&) = delete;
@@ -610,6 +633,11 @@ private:
    /// `TriviaRetentionMode::WithTrivia`.
    ParsedTrivia m_trailingTrivia;
    std::string m_currentExceptionMsg;
+
+   /// The default arena of token string values, see saveTokenValue.
+   llvm::BumpPtrAllocator m_ownedValueAllocator;
+   llvm::BumpPtrAllocator *m_valueAllocator = &m_ownedValueAllocator;
+
    std::stack<YYLexerCondType> m_yyConditionStack;
    std::stack<std::shared_ptr<HereDocLabel>> m_heredocLabelStack;
    std::stack<LexerState> m_yyStateStack;
@@ -644,9 +672,11 @@ void tokenize(const LangOptions &langOpts, const SourceManager &sourceMgr,
    } while (token.getKind() != TokenKindType::END);
 }
 
-/// Lex and return a vector of tokens for the given buffer.
+/// Lex and return a vector of tokens for the given buffer, string values
+/// of the tokens which need to be materialized are kept in \p valueAllocator.
 std::vector<Token> tokenize(const LangOptions &langOpts,
                             const SourceManager &sourceMgr, unsigned bufferId,
+                            llvm::BumpPtrAllocator &valueAllocator,
                             unsigned offset = 0, unsigned endOffset = 0,
                             DiagnosticEngine *diags = nullptr,
                             bool keepComments = true);
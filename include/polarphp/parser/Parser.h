@@ -20,6 +20,7 @@
 #include "polarphp/parser/CommonDefs.h"
 #include "polarphp/parser/Token.h"
 #include "polarphp/parser/ParsedTrivia.h"
+#include "polarphp/syntax/SyntaxArena.h"
 
 namespace polar {
 class SourceManager;
@@ -50,12 +51,26 @@ using polar::StringRef;
 using polar::ast::DiagnosticEngine;
 using polar::kernel::LangOptions;
 using polar::syntax::Syntax;
+using polar::syntax::SyntaxArena;
 using polar::SourceManager;
 
 class Lexer;
 
 void parse_error(StringRef msg);
 
+/// Parser builds the RawSyntax tree of one source buffer.
+///
+/// Thread-safety contract:
+/// - a Parser and the Lexer it owns are confined to one thread, they keep
+///   per-buffer state and are never synchronized.
+/// - SourceManager is not synchronized either, concurrent parsers must not
+///   share one, give every thread (or every file) its own SourceManager.
+/// - distinct Parser instances can run concurrently. The only process wide
+///   state they touch is the RawSyntax node id counter, which is atomic, and
+///   the immutable empty trivia.
+/// - RawSyntax trees are immutable and their reference counts are atomic, so a
+///   finished tree can be handed to another thread. Nodes allocated in a
+///   SyntaxArena keep that arena alive.
 class Parser
 {
 public:
@@ -72,6 +87,19 @@ public:
    bool parse();
    RefCountPtr<RawSyntax> getSyntaxTree();
 
+   /// Allocate the syntax nodes built by this parser in \p arena, by default
+   /// every node is allocated on its own.
+   Parser &setSyntaxArena(RefCountPtr<SyntaxArena> arena)
+   {
+      m_arena = std::move(arena);
+      return *this;
+   }
+
+   const RefCountPtr<SyntaxArena> &getSyntaxArena() const
+   {
+      return m_arena;
+   }
+
    ///
    /// TODO
    /// state manage methods
@@ -112,6 +140,7 @@ private:
 
    std::string m_docComment;
    RefCountPtr<RawSyntax> m_ast;
+   RefCountPtr<SyntaxArena> m_arena;
    std::shared_ptr<DiagnosticEngine> m_diags;
    std::list<std::string> m_openFiles;
 
@@ -14,6 +14,7 @@
 #define POLARPHP_PARSER_SYNTAX_PARSING_CACHE_H
 
 #include "polarphp/syntax/SyntaxNodes.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 #include <unordered_set>
@@ -25,6 +26,7 @@ using polar::syntax::Syntax;
 using polar::syntax::SyntaxKind;
 using polar::syntax::SourceFileSyntax;
 using polar::syntax::SyntaxNodeId;
+using polar::syntax::RawSyntax;
 using polar::SmallVector;
 using polar::ArrayRef;
 
@@ -88,6 +90,10 @@ public:
 
    /// Check if a syntax node of the given kind at the given position can be
    /// reused for a new syntax tree.
+   ///
+   /// Edits are kept sorted, so both the position translation and the reuse
+   /// check of a node cost O(log edits), and children are located by binary
+   /// search over cached start offsets.
    std::optional<Syntax> lookUp(size_t newPosition, SyntaxKind kind);
 
    const std::unordered_set<SyntaxNodeId> &getReusedNodeIds() const
@@ -113,8 +119,20 @@ private:
    std::optional<Syntax> lookUpFrom(const Syntax &node, size_t nodeStart,
                                     size_t position, SyntaxKind kind);
 
-   bool nodeCanBeReused(const Syntax &node, size_t position, size_t nodeStart,
+   bool nodeCanBeReused(const Syntax &node, size_t nodeStart, size_t position,
                         SyntaxKind kind) const;
+
+   /// Same as the static translateToPreEditPosition but uses the start
+   /// positions and shifts recorded by addEdit to binary search the edit
+   /// that precedes \p postEditPosition.
+   std::optional<size_t> translateToPreEditPosition(size_t postEditPosition) const;
+
+   /// Start offsets of the children of \p node relative to the start of
+   /// \p node, followed by the text length of \p node. Missing children
+   /// occupy no text. The old tree is immutable so the offsets are computed
+   /// once per node and cached.
+   ArrayRef<size_t> getChildStartOffsets(const RawSyntax *node);
+
 private:
    /// The syntax tree prior to the edit
    SourceFileSyntax m_oldSyntaxTree;
@@ -123,6 +141,16 @@ private:
    /// the source file that is now parsed incrementally
    SmallVector<SourceEdit, 4> m_edits;
 
+   /// The start of every edit in m_edits in the coordinates of the new file.
+   SmallVector<size_t, 4> m_postEditStarts;
+
+   /// The sum of (replacementLength - originalLength) of m_edits[0...i],
+   /// i.e. how far positions after edit i moved in the new file.
+   SmallVector<std::ptrdiff_t, 4> m_editShifts;
+
+   /// Cache for getChildStartOffsets, keyed by nodes of m_oldSyntaxTree.
+   llvm::DenseMap<const RawSyntax *, SmallVector<size_t, 8>> m_childStartOffsets;
+
    /// The IDs of all syntax nodes that got reused are collected in this vector.
    std::unordered_set<SyntaxNodeId> m_reusedNodeIds;
 };
@@ -24,7 +24,7 @@
 #include "polarphp/syntax/TokenKinds.h"
 #include "polarphp/parser/internal/YYParserDefs.h"
 
-#include <any>
+#include <type_traits>
 
 /// forward declare class with namespace
 namespace llvm {
@@ -73,6 +73,11 @@ public:
 /// information as possible about each returned token.  This is expected to be
 /// compressed into a smaller form if memory footprint is important.
 ///
+/// Token is trivially copyable, string values are not owned by the token.
+/// They either point into the source buffer or into the token value arena of
+/// the lexer that formed the token (see Lexer::saveTokenValue), so they stay
+/// valid as long as the SourceManager and that arena are alive.
+///
 class Token
 {
 public:
@@ -90,7 +95,8 @@ public:
         m_kind(kind),
         m_commentLength(commentLength),
         m_valueType(ValueType::Unknown),
-        m_lexicalText(text)
+        m_lexicalText(text),
+        m_intValue(0)
    {}
 
    Token(TokenKindType kind, unsigned commentLength = 0)
@@ -262,7 +268,7 @@ public:
 
    bool hasValue() const
    {
-      return !isInvalidLexValue() && m_value.has_value();
+      return !isInvalidLexValue() && m_hasValue;
    }
 
    /// getLoc - Return a source location identifier for the specified
@@ -341,37 +347,60 @@ public:
       return *this;
    }
 
+   /// Set a string value, the token only references \p value, it must be a
+   /// slice of the source buffer or be saved with Lexer::saveTokenValue.
    Token &setValue(StringRef value)
    {
       m_valueType = ValueType::String;
-      m_value.emplace<std::string>(value.data(), value.size());
+      m_stringValue = value;
+      m_hasValue = true;
       return *this;
    }
 
+   /// Temporary strings would dangle, see setValue(StringRef).
+   Token &setValue(const std::string &value) = delete;
+
    template <typename T,
              typename std::enable_if<std::is_integral<T>::value, void *>::type = nullptr>
    Token &setValue(T value)
    {
       m_valueType = ValueType::LongLong;
-      m_value.emplace<std::int64_t>(static_cast<std::int64_t>(value));
+      m_intValue = static_cast<std::int64_t>(value);
+      m_hasValue = true;
       return *this;
    }
 
    Token &setValue(double value)
    {
       m_valueType = ValueType::Double;
-      m_value.emplace<double>(value);
+      m_doubleValue = value;
+      m_hasValue = true;
       return *this;
    }
 
+   /// Get the token value, getValue<StringRef>() returns the string value
+   /// without copying it, getValue<std::string>() materializes a copy.
    template <typename T,
              typename std::enable_if<std::is_same<T, std::string>::value ||
+                                     std::is_same<T, StringRef>::value ||
                                      std::is_same<T, double>::value ||
                                      std::is_same<T, std::int64_t>::value, void *>::type = nullptr>
-   const T &getValue() const
-   {
-      assert(m_value.has_value());
-      return std::any_cast<const T &>(m_value);
+   T getValue() const
+   {
+      assert(m_hasValue);
+      if constexpr (std::is_same<T, std::int64_t>::value) {
+         assert(m_valueType == ValueType::LongLong && "token value is not an integer");
+         return m_intValue;
+      } else if constexpr (std::is_same<T, double>::value) {
+         assert(m_valueType == ValueType::Double && "token value is not a double");
+         return m_doubleValue;
+      } else if constexpr (std::is_same<T, StringRef>::value) {
+         assert(m_valueType == ValueType::String && "token value is not a string");
+         return m_stringValue;
+      } else {
+         assert(m_valueType == ValueType::String && "token value is not a string");
+         return m_stringValue.str();
+      }
    }
 
    ValueType getValueType() const
@@ -382,14 +411,14 @@ public:
    Token &setValueType(ValueType type)
    {
       m_valueType = type;
-      m_value.reset();
+      m_hasValue = false;
       return *this;
    }
 
    Token &resetValueType()
    {
       m_valueType = ValueType::Unknown;
-      m_value.reset();
+      m_hasValue = false;
       return *this;
    }
 
@@ -427,13 +456,23 @@ private:
 
    ValueType m_valueType;
 
+   /// Whether one of the value fields below is set.
+   bool m_hasValue = false;
+
    /// Text - The actual string covered by the token in the source buffer.
    StringRef m_lexicalText;
 
-   /// The token value
-   std::any m_value;
+   /// The token value, which field is active depends on m_valueType.
+   union {
+      std::int64_t m_intValue;
+      double m_doubleValue;
+   };
+   StringRef m_stringValue;
 };
 
+static_assert(std::is_trivially_copyable<Token>::value,
+              "Token is copied on every parser shift, keep it trivially copyable");
+
 } // polar::syntax
 
 #endif // POLAR_PARSER_TOKEN_H
@@ -66,6 +66,27 @@ bool skip_to_end_of_slash_star_comment(const unsigned char *&m_yyCursor,
                                        DiagnosticEngine *diags = nullptr);
 
 const char *next_newline(const char *str, const char *end, size_t &newlineLen);
+
+/// Bulk scanning kernels used by the trivia and comment paths of the lexer.
+/// They process the buffer 32 (AVX2) or 16 (SSE2) bytes at a time and fall
+/// back to a scalar loop on other targets and for the tail of the buffer.
+/// None of them reads at or past \p end.
+
+/// Return the first byte in [ptr, end) which is '\n', '\r', NUL, or, when
+/// \p stopAtHighBytes is set, a non-ASCII byte. Return \p end if there is
+/// no such byte.
+const unsigned char *scan_to_line_end_candidate(const unsigned char *ptr, const unsigned char *end,
+                                                bool stopAtHighBytes);
+/// Return the first byte in [ptr, end) which is '*', '/', NUL, or, when
+/// \p stopAtHighBytes is set, a non-ASCII byte. \p sawNewline is set to true
+/// if a newline character was skipped on the way, it is never reset.
+const unsigned char *scan_to_block_comment_candidate(const unsigned char *ptr, const unsigned char *end,
+                                                     bool stopAtHighBytes, bool &sawNewline);
+/// Return the first '\r' or '\n' in [str, end), or \p end.
+const char *scan_to_newline_candidate(const char *str, const char *end);
+/// Return how many bytes at the front of [ptr, end) are equal to \p c.
+size_t count_leading_byte(const unsigned char *ptr, const unsigned char *end, unsigned char c);
+
 bool strip_multiline_string_indentation(Lexer &lexer, std::string &str, int indentation, bool usingSpaces,
                                         bool newlineAtStart, bool newlineAtEnd);
 void strip_underscores(std::string &str, size_t &len);
@@ -13,14 +13,18 @@
 #define POLARPHP_PARSER_INTERNAL_YYPARSER_EXTRAS_DEFS_H
 
 #define empty_triva() parser->getEmptyTrivia()
-#define make_token(name) SyntaxNodeFactory::make##name(parser->getEmptyTrivia(), parser->getEmptyTrivia())
+#define make_token(name) SyntaxNodeFactory::make##name(parser->getEmptyTrivia(), parser->getEmptyTrivia(), \
+   parser->getSyntaxArena())
 #define make_token_with_text(name, text) \
-   SyntaxNodeFactory::make##name(OwnedString::makeRefCounted(text), parser->getEmptyTrivia(), parser->getEmptyTrivia())
-#define make_lnumber_token(value) SyntaxNodeFactory::makeLNumberToken(value, parser->getEmptyTrivia(), parser->getEmptyTrivia())
-#define make_dnumber_token(value) SyntaxNodeFactory::makeDNumberToken(value, parser->getEmptyTrivia(), parser->getEmptyTrivia())
+   SyntaxNodeFactory::make##name(OwnedString::makeRefCounted(text), parser->getEmptyTrivia(), parser->getEmptyTrivia(), \
+   parser->getSyntaxArena())
+#define make_lnumber_token(value) SyntaxNodeFactory::makeLNumberToken(value, parser->getEmptyTrivia(), parser->getEmptyTrivia(), \
+   parser->getSyntaxArena())
+#define make_dnumber_token(value) SyntaxNodeFactory::makeDNumberToken(value, parser->getEmptyTrivia(), parser->getEmptyTrivia(), \
+   parser->getSyntaxArena())
 
-#define make_syntax_node(name, ...) SyntaxNodeFactory::make##name(__VA_ARGS__)
-#define make_blank_syntax_node(name) SyntaxNodeFactory::makeBlank##name()
+#define make_syntax_node(name, ...) SyntaxNodeFactory::make##name(__VA_ARGS__, parser->getSyntaxArena())
+#define make_blank_syntax_node(name) SyntaxNodeFactory::makeBlank##name(parser->getSyntaxArena())
 
 #define make_reserved_keyword(name) make_token(name##Keyword).getRaw()
 
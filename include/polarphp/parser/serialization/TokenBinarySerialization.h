@@ -0,0 +1,121 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/11/13.
+
+#ifndef POLARPHP_PARSER_SERIALIZATION_TOKEN_BINARY_SERIALIZATION_H
+#define POLARPHP_PARSER_SERIALIZATION_TOKEN_BINARY_SERIALIZATION_H
+
+#include "llvm/ADT/StringRef.h"
+#include "polarphp/syntax/internal/TokenEnumDefs.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace polar::parser {
+
+using llvm::StringRef;
+using polar::syntax::internal::TokenKindType;
+class Token;
+
+/// Compact token stream format, all integers are little endian.
+///
+/// The stream starts with a header: the magic bytes "PTOK", a uint16 format
+/// version and a uint16 reserved field. Every token then follows as:
+///
+///   uint16 kind       get_token_serialization_code of the token kind
+///   uint32 offset     byte offset of the token text in the source buffer
+///   uint32 length     byte length of the token text
+///   uint8  flags      TokenFlags bits
+///   uint8  valueTag   TokenValueTag
+///   payload           int64 / double bits / uint32 length + bytes, by tag
+///
+/// Records are self delimiting so a consumer can read tokens one by one
+/// while the producer is still lexing.
+enum class TokenValueTag : std::uint8_t
+{
+   None,
+   Int,
+   Double,
+   String
+};
+
+struct TokenRecord
+{
+   TokenKindType kind = TokenKindType::T_UNKNOWN_MARK;
+   std::uint32_t offset = 0;
+   std::uint32_t length = 0;
+   std::uint8_t flags = 0;
+   TokenValueTag valueTag = TokenValueTag::None;
+   std::int64_t intValue = 0;
+   double doubleValue = 0;
+   std::string stringValue;
+};
+
+class TokenBinaryWriter
+{
+public:
+   static constexpr std::uint16_t FormatVersion = 1;
+
+   explicit TokenBinaryWriter(std::ostream &output)
+      : m_output(output)
+   {}
+
+   void writeHeader();
+   /// Write one token, \p offset is the position of the token text in its
+   /// source buffer.
+   void write(const Token &token, std::uint32_t offset);
+
+   /// Number of bytes written so far, header included.
+   std::size_t getBytesWritten() const
+   {
+      return m_bytesWritten;
+   }
+
+private:
+   void writeBytes(const void *data, std::size_t size);
+   void writeU8(std::uint8_t value);
+   void writeU16(std::uint16_t value);
+   void writeU32(std::uint32_t value);
+   void writeU64(std::uint64_t value);
+
+private:
+   std::ostream &m_output;
+   std::size_t m_bytesWritten = 0;
+};
+
+class TokenBinaryReader
+{
+public:
+   explicit TokenBinaryReader(std::istream &input)
+      : m_input(input)
+   {}
+
+   /// Read and check the stream header, returns false if the stream is not a
+   /// token stream or has an unsupported version.
+   bool readHeader();
+   /// Read the next token record, returns false at end of stream or when
+   /// the record is truncated or has an unknown token kind code.
+   bool read(TokenRecord &record);
+
+private:
+   bool readBytes(void *data, std::size_t size);
+   bool readU8(std::uint8_t &value);
+   bool readU16(std::uint16_t &value);
+   bool readU32(std::uint32_t &value);
+   bool readU64(std::uint64_t &value);
+
+private:
+   std::istream &m_input;
+};
+
+} // polar::parser
+
+#endif // POLARPHP_PARSER_SERIALIZATION_TOKEN_BINARY_SERIALIZATION_H
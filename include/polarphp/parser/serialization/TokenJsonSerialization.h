@@ -13,6 +13,7 @@
 #define POLARPHP_PARSER_SERIALIZATION_TOKEN_JSON_SERIALIZATION_H
 
 #include "nlohmann/json.hpp"
+#include "llvm/Support/Allocator.h"
 
 namespace polar::parser {
 
@@ -23,7 +24,9 @@ class Token;
 void to_json(json &jsonObject, const TokenFlags &flags);
 void from_json(const json &jsonObject, TokenFlags &flags);
 void to_json(json &jsonObject, const Token &token);
-void from_json(const json &jsonObject, Token &token);
+/// Token does not own its string value, so a string value read back is copied
+/// into \p valueAllocator, which must outlive the token.
+void from_json(const json &jsonObject, Token &token, llvm::BumpPtrAllocator &valueAllocator);
 
 } // polar::parser
 
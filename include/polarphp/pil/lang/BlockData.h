@@ -0,0 +1,74 @@
+//===--- BlockData.h - Side tables indexed by block -------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2019 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+///
+/// This file defines BlockData, which stores a value per block of a function
+/// in a flat vector indexed by the dense indices of
+/// PILFunction::numberBlocks().
+///
+/// Lookups are a plain vector access, compared to hashing the pointer for a
+/// DenseMap. A table may only be used while the function keeps its
+/// numbering, i.e. as long as no block is added to the function. Block
+/// arguments don't have their own numbering: per-argument state can be
+/// indexed by the block and PILArgument::getIndex().
+///
+/// Redundant load elimination and dead store elimination keep their
+/// per-block states in BlockData.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef POLARPHP_PIL_BLOCKDATA_H
+#define POLARPHP_PIL_BLOCKDATA_H
+
+#include "polarphp/pil/lang/PILBasicBlock.h"
+#include "polarphp/pil/lang/PILFunction.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace polar {
+
+/// A value of type \p T for each block of a function.
+template <typename T>
+class BlockData {
+   PILFunction *F;
+   unsigned Epoch;
+   llvm::SmallVector<T, 0> Data;
+
+public:
+   /// Numbers the blocks of \p Function, if needed, and initializes the value
+   /// of each block with \p InitialValue.
+   explicit BlockData(PILFunction *Function, const T &InitialValue = T())
+      : F(Function) {
+      Data.assign(F->getNumBlockIndices(), InitialValue);
+      Epoch = F->getBlockNumberingEpoch();
+   }
+
+   /// Returns true if no block was added to the function since the table was
+   /// created.
+   bool isValid() const {
+      return F->hasBlockNumbering() && F->getBlockNumberingEpoch() == Epoch;
+   }
+
+   T &operator[](const PILBasicBlock *BB) {
+      assert(isValid() && "block added after the table was created");
+      assert(BB->getParent() == F && "block of another function");
+      return Data[BB->getIndex()];
+   }
+
+   const T &operator[](const PILBasicBlock *BB) const {
+      return const_cast<BlockData *>(this)->operator[](BB);
+   }
+
+   unsigned size() const { return Data.size(); }
+};
+
+} // end namespace polar
+
+#endif // POLARPHP_PIL_BLOCKDATA_H
@@ -61,6 +61,19 @@ public:
 
    void verify() const;
 
+   /// Update the tree after \p origBB was split into itself and \p newBB,
+   /// with origBB branching to newBB.
+   void updateForSplitBlock(PILBasicBlock *origBB, PILBasicBlock *newBB);
+
+   /// Update the tree after \p edgeBB was inserted on the edge from \p srcBB
+   /// to \p destBB.
+   void updateForSplitEdge(PILBasicBlock *srcBB, PILBasicBlock *edgeBB,
+                           PILBasicBlock *destBB);
+
+   /// Update the tree before \p succBB, whose single predecessor is \p bb, is
+   /// merged into \p bb.
+   void updateForMergeBlocks(PILBasicBlock *bb, PILBasicBlock *succBB);
+
    /// Return true if the other dominator tree does not match this dominator
    /// tree.
    inline bool errorOccurredOnComparison(const DominanceInfo &Other) const {
@@ -0,0 +1,99 @@
+//===--- FunctionSummaryCache.h - Persistent function summaries -*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2018 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+///
+/// This file defines a cache of interprocedural function summaries which
+/// survives the compilation, so that a later build can reload the summaries of
+/// functions which did not change instead of re-analyzing them.
+///
+/// The caches of a compilation are owned by its PILModule, see
+/// PILModule::getSummaryCache(). A cache file is therefore loaded and saved
+/// once per compilation, no matter how many pass managers use it.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef POLARPHP_PIL_FUNCTIONSUMMARYCACHE_H
+#define POLARPHP_PIL_FUNCTIONSUMMARYCACHE_H
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+
+namespace polar {
+
+/// A persistent map from (summary kind, key) to a serialized summary.
+///
+/// The on-disk format is a text file with a header line and one entry per
+/// line:
+///
+///   polarphp-pil-summaries <version>
+///   <kind> <key> <age> <payload>
+///
+/// The age counts how many loads an entry survived without being used. Entries
+/// older than the limit given to save() are dropped, which keeps the file from
+/// growing without bounds.
+class FunctionSummaryCache {
+   static constexpr unsigned FormatVersion = 1;
+
+   struct Entry {
+      std::string Payload;
+      unsigned Age = 0;
+   };
+
+   /// Maps "<kind> <key>" to the entry.
+   llvm::StringMap<Entry> Entries;
+
+   unsigned NumHits = 0;
+   unsigned NumMisses = 0;
+
+   /// Add the entries of the file at \p Path to \p Result, with their ages
+   /// increased by \p AgeIncrement. Returns false if the file is missing or
+   /// malformed.
+   static bool readEntries(llvm::StringRef Path, unsigned AgeIncrement,
+                           llvm::StringMap<Entry> &Result);
+
+   /// Merge the entries of the file at \p Path into ours and write the result
+   /// to it. The caller holds the lock of the file.
+   bool mergeAndWrite(llvm::StringRef Path, unsigned MaxAge) const;
+
+public:
+   /// Load the entries of the file at \p Path. A missing or malformed file
+   /// leaves the cache empty and returns false.
+   bool load(llvm::StringRef Path);
+
+   /// Write all entries which are not older than \p MaxAge to \p Path. Entries
+   /// other compilations wrote to the file in the meantime are kept. The file
+   /// is locked while it is merged and replaced atomically. Returns false on
+   /// I/O errors.
+   bool save(llvm::StringRef Path, unsigned MaxAge) const;
+
+   /// Returns the payload stored for \p Kind and \p Key. The entry keeps its
+   /// age until the caller accepts the payload with markUsed().
+   llvm::Optional<llvm::StringRef> lookup(llvm::StringRef Kind,
+                                          llvm::StringRef Key);
+
+   /// Mark the entry for \p Kind and \p Key as used by this compilation, so
+   /// that it is not dropped.
+   void markUsed(llvm::StringRef Kind, llvm::StringRef Key);
+
+   /// Add or replace the payload for \p Kind and \p Key.
+   void insert(llvm::StringRef Kind, llvm::StringRef Key,
+               llvm::StringRef Payload);
+
+   unsigned size() const { return Entries.size(); }
+   unsigned getNumHits() const { return NumHits; }
+   unsigned getNumMisses() const { return NumMisses; }
+};
+
+} // end namespace polar
+
+#endif // POLARPHP_PIL_FUNCTIONSUMMARYCACHE_H
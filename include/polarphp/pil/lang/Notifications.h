@@ -22,6 +22,8 @@
 namespace polar {
 
 class PILNode;
+class PILBasicBlock;
+class DominanceInfo;
 class ModuleDecl;
 class PILFunction;
 class PILWitnessTable;
@@ -240,6 +242,40 @@ public:
                       PILDefaultWitnessTable *wtable) override;
 };
 
+/// A change of the control flow graph of a function, made by one of the CFG
+/// utilities. Analyses which cache per-function CFG information can apply the
+/// edit to their results instead of recomputing them.
+///
+/// Only edits which can be applied cheaply are reported. Other CFG changes
+/// still require invalidating the analyses.
+struct CFGEdit {
+  enum class Kind {
+    /// Block was split. NewBlock is the new tail of Block, Block ends in an
+    /// unconditional branch to NewBlock.
+    SplitBlock,
+
+    /// The edge from Block to Dest was split by inserting NewBlock.
+    SplitEdge,
+
+    /// Dest, whose single predecessor is Block, is about to be merged into
+    /// Block. This removes the edge between them and then Dest itself.
+    MergeBlocks,
+  };
+
+  Kind kind;
+  PILBasicBlock *block;
+  PILBasicBlock *dest;
+  PILBasicBlock *newBlock;
+
+  /// The dominator tree which the utility already updated, if any.
+  DominanceInfo *updatedDomInfo;
+
+  CFGEdit(Kind kind, PILBasicBlock *block, PILBasicBlock *dest,
+          PILBasicBlock *newBlock, DominanceInfo *updatedDomInfo)
+      : kind(kind), block(block), dest(dest), newBlock(newBlock),
+        updatedDomInfo(updatedDomInfo) {}
+};
+
 /// A protocol (or interface) for handling value deletion notifications.
 ///
 /// This class is used as a base class for any class that need to accept
@@ -253,6 +289,9 @@ struct DeleteNotificationHandler {
   /// Handle the invalidation message for the value \p Value.
   virtual void handleDeleteNotification(PILNode *value) { }
 
+  /// Handle the notification that the CFG of a function was changed.
+  virtual void handleCFGEditNotification(const CFGEdit &edit) { }
+
   /// Returns True if the pass, analysis or other entity wants to receive
   /// notifications. This callback is called once when the class is being
   /// registered, and not once per notification. Entities that implement
@@ -52,6 +52,10 @@ private:
    /// The ordered set of instructions in the PILBasicBlock.
    InstListType InstList;
 
+   /// The dense index of the block in its function, assigned by
+   /// PILFunction::numberBlocks().
+   unsigned Index = 0;
+
    friend struct llvm::ilist_traits<PILBasicBlock>;
    PILBasicBlock() : Parent(nullptr) {}
    void operator=(const PILBasicBlock &) = delete;
@@ -70,6 +74,10 @@ public:
    ///          debug output.
    int getDebugID() const;
 
+   /// Returns the dense index of the block in its function. Only meaningful
+   /// while PILFunction::hasBlockNumbering() is true.
+   unsigned getIndex() const { return Index; }
+
    PILFunction *getParent() { return Parent; }
    const PILFunction *getParent() const { return Parent; }
 
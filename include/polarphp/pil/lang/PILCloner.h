@@ -530,12 +530,11 @@ PILCloner<ImplClass>::getMappedValue(PILValue Value) {
    if (VI != ValueMap.end())
       return VI->second;
 
-   // If we have undef, just remap the type.
+   // If we have undef, just remap the type. Undef values belong to their
+   // function, so the clone always uses the one of the new function.
    if (auto *U = dyn_cast<PILUndef>(Value)) {
       auto type = getOpType(U->getType());
-      ValueBase *undef =
-         (type == U->getType() ? U : PILUndef::get(type, Builder.getFunction()));
-      return PILValue(undef);
+      return PILValue(PILUndef::get(type, Builder.getFunction()));
    }
 
    llvm_unreachable("Unmapped value while cloning?");
@@ -38,6 +38,7 @@ struct UnknownSymbolicValue;
 struct SymbolicClosure;
 
 extern llvm::cl::opt<unsigned> ConstExprLimit;
+extern llvm::cl::opt<unsigned> ConstExprMemoryLimit;
 
 /// An abstract class that exposes functions for allocating symbolic values.
 /// The implementors of this class have to determine where to allocate them and
@@ -51,6 +52,10 @@ public:
    /// \param alignment alignment for the allocated bytes.
    virtual void *allocate(unsigned long byteSize, unsigned alignment) = 0;
 
+   /// Returns the number of bytes allocated so far, or 0 if the allocator
+   /// does not keep track. Used to bound the memory of an evaluation.
+   virtual size_t getBytesAllocated() const { return 0; }
+
    /// Allocate storage for a given number of elements of a specific type
    /// provided as a template parameter. Precondition: \c T must have an
    /// accesible zero argument constructor.
@@ -76,6 +81,10 @@ public:
    void *allocate(unsigned long byteSize, unsigned alignment) {
       return bumpAllocator.Allocate(byteSize, alignment);
    }
+
+   size_t getBytesAllocated() const {
+      return bumpAllocator.getBytesAllocated();
+   }
 };
 
 /// When we fail to constant fold a value, this captures a reason why,
@@ -93,6 +102,11 @@ public:
       /// instruction within the constexpr that triggered the issue.
          TooManyInstructions,
 
+      /// The constant expression allocated too much memory.  Like
+      /// TooManyInstructions, this is reported on the instruction at which the
+      /// limit was hit.
+         TooMuchMemory,
+
       /// A control flow loop was found.
          Loop,
 
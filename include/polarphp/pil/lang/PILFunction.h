@@ -32,6 +32,7 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/ADT/ilist_node.h"
+#include <atomic>
 
 /// The symbol name used for the program entry point function.
 #define POLAR_ENTRY_POINT_FUNCTION "main"
@@ -142,6 +143,7 @@ private:
    friend class PILBasicBlock;
    friend class PILModule;
    friend class PILFunctionBuilder;
+   friend class PILUndef;
 
    /// Module - The PIL module that the function belongs to.
    PILModule &Module;
@@ -204,8 +206,27 @@ private:
    AvailabilityContext Availability;
 
    /// This is the number of uses of this PILFunction inside the PIL.
-   /// It does not include references from debug scopes.
-   unsigned RefCount = 0;
+   /// It does not include references from debug scopes. Function passes on
+   /// other threads may create or erase function_refs to this function.
+   std::atomic<unsigned> RefCount{0};
+
+   /// This is the set of undef values used in this function, for uniquing
+   /// purposes. Undef values are per function, so that function passes on
+   /// different threads never share their use lists. Instructions spliced in
+   /// from another function are switched over by PILUndef::adoptOperands().
+   mutable llvm::DenseMap<std::pair<PILType, unsigned>, PILUndef *>
+      UndefValues;
+
+   /// The upper bound of the block indices assigned by numberBlocks().
+   unsigned NumBlockIndices = 0;
+
+   /// Incremented whenever the blocks are renumbered, so that side tables
+   /// can tell whether they were built for the current indices.
+   unsigned BlockNumberingEpoch = 0;
+
+   /// True while the block indices are valid, i.e. no block was added to the
+   /// function since numberBlocks().
+   bool BlocksNumbered = false;
 
    /// The function's bare attribute. Bare means that the function is PIL-only
    /// and does not require debug info.
@@ -442,14 +463,17 @@ public:
 
    /// Increment the reference count.
    void incrementRefCount() {
-      RefCount++;
-      assert(RefCount != 0 && "Overflow of reference count!");
+      unsigned OldRefCount = RefCount.fetch_add(1, std::memory_order_relaxed);
+      (void)OldRefCount;
+      assert(OldRefCount + 1 != 0 && "Overflow of reference count!");
    }
 
    /// Decrement the reference count.
    void decrementRefCount() {
-      assert(RefCount != 0 && "Expected non-zero reference count on decrement!");
-      RefCount--;
+      unsigned OldRefCount = RefCount.fetch_sub(1, std::memory_order_relaxed);
+      (void)OldRefCount;
+      assert(OldRefCount != 0 &&
+             "Expected non-zero reference count on decrement!");
    }
 
    /// Drops all uses belonging to instructions in this function. The only valid
@@ -997,6 +1021,31 @@ public:
       }
    }
 
+   //===--------------------------------------------------------------------===//
+   // Block Numbering
+   //===--------------------------------------------------------------------===//
+
+   /// Assigns the dense indices 0..N-1 to the blocks of the function and
+   /// returns N, see PILBasicBlock::getIndex() and BlockData.
+   ///
+   /// The indices are valid until a block is added to the function, either
+   /// newly created or moved in from another function. Erasing blocks or
+   /// moving them within the function keeps the indices of the other blocks,
+   /// so the indices stay unique.
+   unsigned numberBlocks();
+
+   /// Returns the number of block indices, numbering the blocks first if the
+   /// current indices are not valid.
+   unsigned getNumBlockIndices() { return numberBlocks(); }
+
+   /// Returns true if the block indices are valid.
+   bool hasBlockNumbering() const { return BlocksNumbered; }
+
+   unsigned getBlockNumberingEpoch() const { return BlockNumberingEpoch; }
+
+   /// Called when a block is added to the function.
+   void invalidateBlockNumbering() { BlocksNumbered = false; }
+
    //===--------------------------------------------------------------------===//
    // Argument Helper Methods
    //===--------------------------------------------------------------------===//
@@ -1048,6 +1097,15 @@ public:
    /// invariants.
    void verify(bool SingleFunction = true) const;
 
+   /// Run the structural checks of the verifier, and the ownership and memory
+   /// lifetime checks only if the function is in the sample selected for
+   /// \p SampleKey.
+   ///
+   /// The sample is controlled by -sil-verify-full-sample-percent and
+   /// -sil-verify-sample-seed, and only depends on the seed, the key and the
+   /// function name. So a failure can be reproduced with the same options.
+   void verifySampled(unsigned SampleKey, bool SingleFunction = true) const;
+
    /// Verify that all non-cond-br critical edges have been split.
    ///
    /// This is a fast subset of the checks performed in the PILVerifier.
@@ -130,6 +130,9 @@ public:
       }
    }
 
+   /// Drop the instructions which are still waiting for a visit.
+   void clear() { worklist.clear(); }
+
    /// Check that the worklist is empty and nuke the backing store if it is
    /// large.
    void resetChecked() {
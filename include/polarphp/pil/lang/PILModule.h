@@ -24,6 +24,7 @@
 #include "polarphp/kernel/LangOptions.h"
 #include "polarphp/basic/ProfileCounter.h"
 #include "polarphp/basic/Range.h"
+#include "polarphp/pil/lang/FunctionSummaryCache.h"
 #include "polarphp/pil/lang/Notifications.h"
 #include "polarphp/pil/lang/PILCoverageMap.h"
 #include "polarphp/pil/lang/PILDeclRef.h"
@@ -47,6 +48,9 @@
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/raw_ostream.h"
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace llvm {
 namespace yaml {
@@ -62,6 +66,7 @@ class FileUnit;
 class FuncDecl;
 class KeyPathPattern;
 class ModuleDecl;
+class PILPassProfiler;
 class PILUndef;
 class SourceFile;
 class SerializedPILLoader;
@@ -224,13 +229,28 @@ private:
   std::unique_ptr<llvm::yaml::Output> OptRecordStream;
 
   /// This is a cache of intrinsic Function declarations to numeric ID mappings.
-  llvm::DenseMap<Identifier, IntrinsicInfo> IntrinsicIDCache;
+  ///
+  /// The entries are boxed so that the references handed out stay valid when
+  /// another thread grows the map.
+  llvm::DenseMap<Identifier, std::unique_ptr<IntrinsicInfo>> IntrinsicIDCache;
 
   /// This is a cache of builtin Function declarations to numeric ID mappings.
-  llvm::DenseMap<Identifier, BuiltinInfo> BuiltinIDCache;
+  llvm::DenseMap<Identifier, std::unique_ptr<BuiltinInfo>> BuiltinIDCache;
+
+  /// A summary cache file used by this compilation.
+  struct PersistentSummaryCache {
+    FunctionSummaryCache Cache;
+    unsigned MaxAge;
+  };
 
-  /// This is the set of undef values we've created, for uniquing purposes.
-  llvm::DenseMap<std::pair<PILType, unsigned>, PILUndef *> UndefValues;
+  /// The summary caches of this compilation by file name. They are saved by
+  /// saveSummaryCaches().
+  llvm::StringMap<std::unique_ptr<PersistentSummaryCache>> SummaryCaches;
+
+  /// The profile of the passes run on this module, if one is requested. It
+  /// is written when the module is destroyed.
+  std::unique_ptr<PILPassProfiler> PassProfiler;
+  bool PassProfilerCreated = false;
 
   /// The stage of processing this module is at.
   PILStage Stage;
@@ -267,6 +287,26 @@ private:
   /// invalidation message is sent.
   llvm::SetVector<DeleteNotificationHandler*> NotificationHandlers;
 
+  /// True while the pass manager runs function passes on several functions
+  /// at once.
+  bool concurrentFunctionPasses = false;
+
+  /// Guards the allocator, the builtin and intrinsic caches, the delete
+  /// notification handlers and the type converter's caches while
+  /// concurrentFunctionPasses is set.
+  mutable std::recursive_mutex tableLock;
+
+  /// Allocators handed to the threads running function passes, so that they
+  /// don't contend on tableLock for every allocation. Like BPA they keep
+  /// their memory until the module is destroyed; an allocator which is not
+  /// used by a thread sits in IdleWorkerAllocators for the next run.
+  std::vector<std::unique_ptr<llvm::BumpPtrAllocator>> WorkerAllocators;
+  std::vector<llvm::BumpPtrAllocator *> IdleWorkerAllocators;
+
+  /// Returns a held lock on tableLock if function passes run concurrently,
+  /// an empty lock otherwise.
+  std::unique_lock<std::recursive_mutex> lockTables() const;
+
   // Intentionally marked private so that we need to use 'constructPIL()'
   // to construct a PILModule.
   PILModule(ModuleDecl *M, lowering::TypeConverter &TC,
@@ -279,6 +319,10 @@ private:
   /// Folding set for key path patterns.
   llvm::FoldingSet<KeyPathPattern> KeyPathPatterns;
 
+  /// Implements verify() and verifySampled(). Without \p SampleKey all
+  /// functions are fully verified.
+  void verifyModule(llvm::Optional<unsigned> SampleKey) const;
+
 public:
   ~PILModule();
 
@@ -311,6 +355,25 @@ public:
   /// registered handlers. The order of handlers is deterministic but arbitrary.
   void notifyDeleteHandlers(PILNode *node);
 
+  /// Send the notification about a CFG change to all registered handlers.
+  void notifyCFGEditHandlers(const CFGEdit &edit);
+
+  /// Tell the module that function passes are about to run on several
+  /// functions at once, or that they are done. While set, the tables which
+  /// are filled on demand are locked and functions must not be created or
+  /// erased. Must not be changed while passes are running.
+  void setConcurrentFunctionPasses(bool value);
+
+  bool hasConcurrentFunctionPasses() const { return concurrentFunctionPasses; }
+
+  /// Called on a thread which starts running function passes concurrently.
+  /// Until leaveConcurrentWorker() the thread allocates from its own
+  /// allocator instead of the shared, locked one.
+  void enterConcurrentWorker();
+
+  /// Called on the thread before it stops running function passes.
+  void leaveConcurrentWorker();
+
   /// Set a serialization action.
   void setSerializePILAction(ActionCallback SerializePILAction);
   ActionCallback getSerializePILAction() const;
@@ -488,6 +551,22 @@ public:
     return coverageMaps;
   }
 
+  /// Returns the summary cache stored in the file \p Path. The file is loaded
+  /// on the first request and written by saveSummaryCaches(), so that its
+  /// entries age once per compilation however many pass managers use it.
+  /// Entries which were not used by \p MaxAge compilations are dropped.
+  FunctionSummaryCache &getSummaryCache(StringRef Path, unsigned MaxAge);
+
+  /// Write the summary caches used by this compilation back to their files.
+  /// Called once the optimization pipeline is done. Saving may wait for
+  /// other compilations which write the same file.
+  void saveSummaryCaches();
+
+  /// Returns the profiler of the passes run on this module, or null if no
+  /// pass profile is requested. Allocations are only counted while there is
+  /// a profiler.
+  PILPassProfiler *getPassProfiler();
+
   llvm::yaml::Output *getOptRecordStream() { return OptRecordStream.get(); }
   void setOptRecordStream(std::unique_ptr<llvm::yaml::Output> &&Stream,
                           std::unique_ptr<llvm::raw_ostream> &&RawStream);
@@ -628,6 +707,11 @@ public:
   /// invariants.
   void verify() const;
 
+  /// Like verify(), but only the functions which are sampled for
+  /// \p SampleKey get the ownership and memory lifetime checks, see
+  /// PILFunction::verifySampled().
+  void verifySampled(unsigned SampleKey) const;
+
   /// Pretty-print the module.
   void dump(bool Verbose = false) const;
 
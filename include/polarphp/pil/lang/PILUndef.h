@@ -31,9 +31,15 @@ public:
   void operator=(const PILArgument &) = delete;
   void operator delete(void *, size_t) POLAR_DELETE_OPERATOR_DELETED;
 
-  static PILUndef *get(PILType ty, PILModule &m, ValueOwnershipKind ownershipKind);
+  static PILUndef *get(PILType ty, const PILFunction &f,
+                       ValueOwnershipKind ownershipKind);
   static PILUndef *get(PILType ty, const PILFunction &f);
 
+  /// Undefs are uniqued per function. Replace the operands of \p inst which
+  /// use another function's undef with the undef of \p f. Called for
+  /// instructions which are moved into \p f without PILCloner.
+  static void adoptOperands(PILInstruction &inst, const PILFunction &f);
+
   template <class OwnerTy>
   static PILUndef *getSentinelValue(PILType type, OwnerTy owner) {
     // Ownership kind isn't used here, the value just needs to have a unique
@@ -0,0 +1,138 @@
+//===--- PassProfiler.h - Per-pass profile of the PIL pipeline --*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2017 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+///
+/// This file defines PILPassProfiler, which records for every run of a PIL
+/// pass on a function (or on the module, for module passes) the wall time,
+/// the change of the instruction count, the allocations made through the
+/// PILModule and the number of analysis invalidations the pass caused.
+///
+/// The records are written as an aggregated JSON report, with totals per pass
+/// and per function, and as a Chrome trace-event file. Both are requested
+/// with -sil-pass-profile=<file> and -sil-pass-profile-trace=<file>. If the
+/// compilation has a UnifiedStatsReporter with -trace-stats-events, the
+/// trace events go to the reporter and the report into its stats directory.
+///
+/// The profiler is owned by the PILModule, see PILModule::getPassProfiler().
+/// It writes its files when the module is destroyed.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef POLARPHP_PIL_PASSPROFILER_H
+#define POLARPHP_PIL_PASSPROFILER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace polar {
+
+class PILFunction;
+class PILModule;
+class UnifiedStatsReporter;
+
+/// Collects the profile of all pass managers running on a module.
+///
+/// begin() and end() may be called from parallel function pass workers.
+class PILPassProfiler {
+public:
+   /// Counts the allocations made through PILModule::allocate() and
+   /// PILModule::allocateInst() while a profiler exists for the module.
+   struct AllocationCounters {
+      uint64_t NumAllocations = 0;
+      uint64_t NumBytes = 0;
+   };
+
+   /// Returns the allocation counters of the calling thread, summed over all
+   /// profiled modules. Function passes may run on several threads, so the
+   /// counters are kept per thread to attribute allocations to the pass which
+   /// made them.
+   static AllocationCounters &getThreadAllocationCounters();
+
+   /// The state taken before a pass runs, which end() compares against.
+   struct Sample {
+      std::chrono::steady_clock::time_point StartTime;
+      AllocationCounters Allocations;
+      int64_t NumInstructions = 0;
+      unsigned NumInvalidations = 0;
+   };
+
+private:
+   /// One run of a pass. The names are uniqued in Names, so records stay
+   /// valid after the function is deleted.
+   struct Record {
+      llvm::StringRef Stage;
+      llvm::StringRef Pass;
+      /// Empty for module passes.
+      llvm::StringRef Function;
+      uint64_t StartUSec;
+      uint64_t DurationUSec;
+      unsigned ThreadIndex;
+      int64_t InstructionDelta;
+      uint64_t NumAllocations;
+      uint64_t NumAllocatedBytes;
+      unsigned NumInvalidations;
+   };
+
+   /// Guards Names and Records.
+   mutable std::mutex Mutex;
+
+   llvm::StringSet<> Names;
+
+   std::vector<Record> Records;
+
+   std::chrono::steady_clock::time_point StartedTime;
+
+   /// Receives the trace events if it is tracing, may be null.
+   UnifiedStatsReporter *Reporter;
+
+   /// Where flush() writes the report and the trace. Either may be empty.
+   std::string ReportFilename;
+   std::string TraceFilename;
+
+   PILPassProfiler(UnifiedStatsReporter *Reporter, std::string ReportFilename,
+                   std::string TraceFilename);
+
+   llvm::StringRef uniqueName(llvm::StringRef Name);
+
+public:
+   /// Returns a profiler for \p M, or null if no profile is requested.
+   static std::unique_ptr<PILPassProfiler> create(PILModule &M);
+
+   /// Take the sample before running a pass on \p F, or on the module \p M if
+   /// \p F is null. \p NumInvalidations is the invalidation counter of the
+   /// pipeline running the pass.
+   Sample begin(PILModule &M, PILFunction *F, unsigned NumInvalidations);
+
+   /// Record the run of the pass \p PassID which started with \p S.
+   void end(const Sample &S, llvm::StringRef Stage, llvm::StringRef PassID,
+            PILModule &M, PILFunction *F, unsigned NumInvalidations);
+
+   /// Write the totals per pass and per function, and the pass runs on
+   /// functions which took the most time.
+   void printReport(llvm::raw_ostream &OS) const;
+
+   /// Write all records in the Chrome trace-event format.
+   void printTrace(llvm::raw_ostream &OS) const;
+
+   /// Write the report and trace files.
+   void flush() const;
+};
+
+} // end namespace polar
+
+#endif
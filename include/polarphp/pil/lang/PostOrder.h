@@ -18,17 +18,33 @@
 #include "polarphp/pil/lang/PILFunctionCFG.h"
 #include "polarphp/pil/lang/PILBasicBlock.h"
 #include "polarphp/pil/lang/PILFunction.h"
-#include "polarphp/pil/optimizer/Analysis/analysis.h"
+#include "polarphp/pil/optimizer/analysis/Analysis.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/iterator_range.h"
 #include <vector>
 
 namespace polar {
 
 class PostOrderFunctionInfo {
-   std::vector<PILBasicBlock *> PostOrder;
-   llvm::DenseMap<PILBasicBlock *, unsigned> BBToPOMap;
+   mutable std::vector<PILBasicBlock *> PostOrder;
+   mutable llvm::DenseMap<PILBasicBlock *, unsigned> BBToPOMap;
+
+   /// The edits made by insertBefore() and erase() which are not yet applied
+   /// to PostOrder and BBToPOMap. Renumbering the blocks is linear in the size
+   /// of the function, so all pending edits are applied at once by the next
+   /// query.
+   ///
+   /// Maps a block to the blocks inserted right before it, in the order of
+   /// insertion.
+   mutable llvm::DenseMap<PILBasicBlock *,
+                          llvm::SmallVector<PILBasicBlock *, 1>>
+      PendingInserts;
+   /// All blocks in PendingInserts.
+   mutable llvm::SmallPtrSet<PILBasicBlock *, 4> PendingBlocks;
+   mutable llvm::SmallPtrSet<PILBasicBlock *, 4> PendingErases;
 
 public:
    PostOrderFunctionInfo(PILFunction *F) {
@@ -49,15 +65,19 @@ public:
    using const_reverse_range = iterator_range<const_reverse_iterator>;
 
    range getPostOrder() {
+      applyPendingEdits();
       return make_range(PostOrder.begin(), PostOrder.end());
    }
    const_range getPostOrder() const {
+      applyPendingEdits();
       return make_range(PostOrder.begin(), PostOrder.end());
    }
    reverse_range getReversePostOrder() {
+      applyPendingEdits();
       return make_range(PostOrder.rbegin(), PostOrder.rend());
    }
    const_reverse_range getReversePostOrder() const {
+      applyPendingEdits();
       return make_range(PostOrder.rbegin(), PostOrder.rend());
    }
 
@@ -67,13 +87,18 @@ public:
    }
 
    const_reverse_range getReversePostOrder(unsigned RPONumber) const {
+      applyPendingEdits();
       return make_range(std::next(PostOrder.rbegin(), RPONumber),
                         PostOrder.rend());
    }
 
-   unsigned size() const { return PostOrder.size(); }
+   unsigned size() const {
+      applyPendingEdits();
+      return PostOrder.size();
+   }
 
    Optional<unsigned> getPONumber(PILBasicBlock *BB) const {
+      applyPendingEdits();
       auto Iter = BBToPOMap.find(BB);
       if (Iter != BBToPOMap.end())
          return Iter->second;
@@ -81,11 +106,73 @@ public:
    }
 
    Optional<unsigned> getRPONumber(PILBasicBlock *BB) const {
+      applyPendingEdits();
       auto Iter = BBToPOMap.find(BB);
       if (Iter != BBToPOMap.end())
          return PostOrder.size() - Iter->second - 1;
       return None;
    }
+
+   /// Insert \p NewBB into the post order right before \p BB. This keeps a
+   /// valid post order if NewBB was split off an edge starting at BB, or if
+   /// BB was split and NewBB is its new tail. Returns false if BB is not in
+   /// the post order, e.g. because it is unreachable.
+   ///
+   /// The block numbers are updated lazily by the next query.
+   bool insertBefore(PILBasicBlock *NewBB, PILBasicBlock *BB) {
+      // A deleted block's memory may be reused for NewBB. Drop the deleted
+      // block first, so that it is not confused with the new one.
+      if (PendingErases.count(NewBB))
+         applyPendingEdits();
+      if (!contains(BB))
+         return false;
+      PendingInserts[BB].push_back(NewBB);
+      PendingBlocks.insert(NewBB);
+      return true;
+   }
+
+   /// Remove \p BB from the post order. This keeps a valid post order if BB
+   /// is merged into its single predecessor.
+   ///
+   /// The block numbers are updated lazily by the next query.
+   void erase(PILBasicBlock *BB) {
+      if (contains(BB))
+         PendingErases.insert(BB);
+   }
+
+private:
+   bool contains(PILBasicBlock *BB) const {
+      return (BBToPOMap.count(BB) || PendingBlocks.count(BB)) &&
+             !PendingErases.count(BB);
+   }
+
+   /// Append \p BB to PostOrder, preceded by the blocks inserted before it.
+   void appendWithPendingInserts(PILBasicBlock *BB) const {
+      auto Iter = PendingInserts.find(BB);
+      if (Iter != PendingInserts.end()) {
+         for (PILBasicBlock *NewBB : Iter->second)
+            appendWithPendingInserts(NewBB);
+      }
+      if (PendingErases.count(BB))
+         return;
+      BBToPOMap[BB] = PostOrder.size();
+      PostOrder.push_back(BB);
+   }
+
+   /// Renumber the blocks once for all edits since the last query.
+   void applyPendingEdits() const {
+      if (PendingInserts.empty() && PendingErases.empty())
+         return;
+      std::vector<PILBasicBlock *> OldPostOrder;
+      std::swap(OldPostOrder, PostOrder);
+      PostOrder.reserve(OldPostOrder.size() + PendingBlocks.size());
+      BBToPOMap.clear();
+      for (PILBasicBlock *BB : OldPostOrder)
+         appendWithPendingInserts(BB);
+      PendingInserts.clear();
+      PendingBlocks.clear();
+      PendingErases.clear();
+   }
 };
 
 } // end polar namespace
@@ -25,6 +25,8 @@
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Allocator.h"
+#include <atomic>
+#include <mutex>
 
 namespace clang {
 class Type;
@@ -663,6 +665,87 @@ class TypeConverter {
    /// Mapping for types independent on contextual generic parameters.
    llvm::DenseMap<CachingTypeKey, const TypeLowering *> LoweredTypes;
 
+   /// The lock of the PILModule whose function passes run on several
+   /// threads, or null while only one thread uses the converter. Lowering
+   /// creates AST types and fills the caches below, so it happens under the
+   /// same lock which guards the module's own tables.
+   std::recursive_mutex *ConcurrencyLock = nullptr;
+
+   /// Returns a held lock on ConcurrencyLock if there is one, an empty lock
+   /// otherwise. Recursive because lowering a type lowers its elements.
+   std::unique_lock<std::recursive_mutex> lockCaches() const {
+      if (!ConcurrencyLock)
+         return std::unique_lock<std::recursive_mutex>();
+      return std::unique_lock<std::recursive_mutex>(*ConcurrencyLock);
+   }
+
+   /// An entry of the per-thread cache in front of LoweredTypes. The cache
+   /// holds the lowerings a thread got last from getTypeLowering(), so that
+   /// repeated lookups of the same type don't take the lock.
+   struct ThreadCacheEntry {
+      uint64_t ConverterID = 0;
+      CachingTypeKey Key;
+      const TypeLowering *Lowering = nullptr;
+   };
+
+   /// The number of entries of the per-thread cache, a power of two.
+   static constexpr unsigned NumThreadCacheEntries = 256;
+
+   /// Identifies the converter in the per-thread caches, which outlive it.
+   /// IDs are not reused, so a new converter at the address of a destroyed
+   /// one doesn't see its entries.
+   const uint64_t ThreadCacheID;
+
+   /// The lookups answered by the per-thread cache, by LoweredTypes and by
+   /// lowering the type. The latter two are guarded by lockCaches(). They
+   /// and the hits of the shared cache are added to the stats reporter when
+   /// the converter is destroyed.
+   std::atomic<uint64_t> NumThreadCacheHits{0};
+   uint64_t NumLoweringCacheHits = 0;
+   uint64_t NumLoweringCacheMisses = 0;
+
+   /// Returns the current thread's cache entries.
+   static ThreadCacheEntry *getThreadCache();
+
+   /// Returns the lowering the current thread cached for \p key, or null.
+   const TypeLowering *findInThreadCache(const CachingTypeKey &key);
+
+   /// Caches \p lowering for \p key in the current thread.
+   void insertInThreadCache(const CachingTypeKey &key,
+                            const TypeLowering *lowering);
+
+   /// A lowering published in the shared cache. Entries are never changed
+   /// or removed once published.
+   struct SharedCacheEntry {
+      CachingTypeKey Key;
+      const TypeLowering *Lowering;
+   };
+
+   /// An open addressing table of published entries. A slot is written once,
+   /// under lockCaches(), and read without a lock. When the table fills up
+   /// it is replaced by a larger copy; the old table stays valid for the
+   /// threads which are still reading it.
+   struct SharedCacheTable {
+      unsigned NumSlots;
+      std::atomic<const SharedCacheEntry *> *Slots;
+   };
+
+   /// The shared cache of lowerings of canonical, non-generic types, which
+   /// is the same for all threads and read without a lock. It sits between
+   /// the per-thread caches and LoweredTypes. Tables and entries live in
+   /// TypeLoweringBPA.
+   std::atomic<SharedCacheTable *> SharedCache{nullptr};
+   unsigned NumSharedCacheEntries = 0;
+   std::atomic<uint64_t> NumSharedCacheHits{0};
+
+   /// Returns the lowering published for \p key, or null.
+   const TypeLowering *findInSharedCache(const CachingTypeKey &key,
+                                         unsigned hash);
+
+   /// Publishes \p lowering for \p key. Must be called under lockCaches().
+   void insertInSharedCache(const CachingTypeKey &key, unsigned hash,
+                            const TypeLowering *lowering);
+
    llvm::DenseMap<std::pair<TypeExpansionContext, PILDeclRef>, PILConstantInfo *>
       ConstantTypes;
 
@@ -701,6 +784,12 @@ public:
    AstContext &Context;
 
    TypeConverter(ModuleDecl &m);
+
+   /// Called by PILModule when its function passes start or stop running on
+   /// several threads. \p lock is the module's table lock, or null.
+   void setConcurrencyLock(std::recursive_mutex *lock) {
+      ConcurrencyLock = lock;
+   }
    ~TypeConverter();
    TypeConverter(TypeConverter const &) = delete;
    TypeConverter &operator=(TypeConverter const &) = delete;
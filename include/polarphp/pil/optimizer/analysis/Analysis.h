@@ -20,6 +20,7 @@
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
+#include <mutex>
 #include <vector>
 
 namespace polar {
@@ -149,8 +150,18 @@ public:
    /// errors when compiling the stdlib/overlays.
    virtual void verifyFull() const {}
 
+   /// Called by the pass manager when it is done, before any analysis is
+   /// deleted. Analyses which keep state beyond the compilation write it out
+   /// here, while the analyses they depend on are still alive.
+   virtual void finish() {}
+
    /// Verify that the function \p F can be used by the analysis.
    static void verifyFunction(PILFunction *F);
+
+   /// Return true if passes may query this analysis for different functions
+   /// at the same time. Only such analyses can be used by function passes
+   /// which run concurrently, see PILFunctionTransform::isParallelSafe().
+   virtual bool isThreadSafe() const { return false; }
 };
 
 /// RAII helper for locking analyses. Locks the analysis upon construction and
@@ -192,6 +203,10 @@ class FunctionAnalysisBase : public PILAnalysis {
    /// Maps functions to their analysis provider.
    StorageTy storage;
 
+   /// Guards storage, the function infos themselves are only used by the
+   /// thread which runs passes on their function.
+   mutable std::mutex storageLock;
+
 protected:
    /// Construct a new empty function info for a specific function \p F.
    virtual std::unique_ptr<FunctionInfoTy>
@@ -206,17 +221,22 @@ protected:
    virtual void verify(FunctionInfoTy *funcInfo) const {}
 
    void deleteAllAnalysisProviders() {
+      std::lock_guard<std::mutex> lock(storageLock);
       storage.clear();
    }
 
 public:
    /// Returns true if we have data for a specific function \p F without actually
    /// attempting to construct the function info.
-   bool hasFunctionInfo(PILFunction *f) const { return storage.count(f); }
+   bool hasFunctionInfo(PILFunction *f) const {
+      std::lock_guard<std::mutex> lock(storageLock);
+      return storage.count(f);
+   }
 
    /// Attempt to lookup up the information that the analysis has for the given
    /// function. Returns nullptr upon failure.
    NullablePtr<FunctionInfoTy> maybeGet(PILFunction *f) {
+      std::lock_guard<std::mutex> lock(storageLock);
       auto iter = storage.find(f);
       if (iter == storage.end())
          return nullptr;
@@ -228,9 +248,18 @@ public:
       // Check that the analysis can handle this function.
       verifyFunction(f);
 
+      if (auto existing = maybeGet(f))
+         return existing.get();
+
+      // Build the info without holding storageLock, so that other workers are
+      // not blocked and the analysis may query other analyses. Only the thread
+      // which runs passes on f builds its info, but keep the first info if one
+      // was added in the meantime.
+      std::unique_ptr<FunctionInfoTy> info = newFunctionAnalysis(f);
+      std::lock_guard<std::mutex> lock(storageLock);
       auto &it = storage.FindAndConstruct(f);
       if (!it.second)
-         it.second = newFunctionAnalysis(f);
+         it.second = std::move(info);
       return it.second.get();
    }
 
@@ -241,6 +270,7 @@ public:
 
    /// Helper function to remove the function info for a specific function.
    void invalidateFunction(PILFunction *f) {
+      std::lock_guard<std::mutex> lock(storageLock);
       storage.erase(f);
    }
 
@@ -263,6 +293,9 @@ public:
    /// Notify the analysis about changed witness or vtables.
    virtual void invalidateFunctionTables() override {}
 
+   /// Function infos are created and dropped under storageLock.
+   virtual bool isThreadSafe() const override { return true; }
+
    FunctionAnalysisBase() {}
    virtual ~FunctionAnalysisBase() {
       deleteAllAnalysisProviders();
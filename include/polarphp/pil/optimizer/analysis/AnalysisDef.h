@@ -35,11 +35,13 @@ ANALYSIS(Dominance)
 ANALYSIS(EpilogueARC)
 ANALYSIS(Escape)
 ANALYSIS(InductionVariable)
+ANALYSIS(InlineCost)
 ANALYSIS(Loop)
 ANALYSIS(LoopRegion)
 ANALYSIS(OptimizerStats)
 ANALYSIS(PostDominance)
 ANALYSIS(PostOrder)
+ANALYSIS(Prespecialization)
 ANALYSIS(InterfaceConformance)
 ANALYSIS(RCIdentity)
 ANALYSIS(SideEffect)
@@ -49,6 +49,33 @@ public:
   virtual bool shouldInvalidate(PILAnalysis::InvalidationKind K) override {
     return K & InvalidationKind::Branches;
   }
+
+  virtual bool needsNotifications() override { return true; }
+
+  /// A locked analysis must be kept up to date by the pass which locked it.
+  /// Apply the CFG edits which the pass makes through the CFG utilities, so
+  /// that the pass doesn't need to thread the dominator tree through them.
+  virtual void handleCFGEditNotification(const CFGEdit &edit) override {
+    if (!isLocked())
+      return;
+    auto info = maybeGet(edit.block->getParent());
+    // The utility may have updated our tree already.
+    if (info.isNull() || info.get() == edit.updatedDomInfo)
+      return;
+
+    DominanceInfo *DI = info.get();
+    switch (edit.kind) {
+    case CFGEdit::Kind::SplitBlock:
+      DI->updateForSplitBlock(edit.block, edit.newBlock);
+      return;
+    case CFGEdit::Kind::SplitEdge:
+      DI->updateForSplitEdge(edit.block, edit.newBlock, edit.dest);
+      return;
+    case CFGEdit::Kind::MergeBlocks:
+      DI->updateForMergeBlocks(edit.block, edit.dest);
+      return;
+    }
+  }
 };
 
 class PostDominanceAnalysis : public FunctionAnalysisBase<PostDominanceInfo> {
@@ -294,6 +294,9 @@ public:
 
   virtual bool needsNotifications() override { return true; }
 
+  /// The function infos query the module wide alias analysis.
+  virtual bool isThreadSafe() const override { return false; }
+
   static bool classof(const PILAnalysis *S) {
     return S->getKind() == PILAnalysisKind::EpilogueARC;
   }
@@ -290,13 +290,14 @@ public:
       CGNode *pointsTo = nullptr;
 
       /// The outgoing defer edges.
-      llvm::SmallVector<CGNode *, 8> defersTo;
+      llvm::SmallVector<CGNode *, 4> defersTo;
 
       /// The predecessor edges (points-to and defer).
-      llvm::SmallVector<Predecessor, 8> Preds;
+      llvm::SmallVector<Predecessor, 4> Preds;
 
       /// If this Content node is merged with another Content node, mergeTo is
-      /// the merge destination.
+      /// the merge destination. getMergeTarget() shortens chains of mergeTo
+      /// links, so mergeTo may directly point to the final merge target.
       CGNode *mergeTo = nullptr;
 
       /// Information where the node's value is used in its function.
@@ -418,6 +419,14 @@ public:
             Target = Target->mergeTo;
             assert(Target->Type == NodeType::Content);
          }
+         // Path compression: let all nodes on the chain directly refer to the
+         // final target, so that repeated lookups don't walk the chain again.
+         CGNode *Node = this;
+         while (Node->mergeTo && Node->mergeTo != Target) {
+            CGNode *Next = Node->mergeTo;
+            Node->mergeTo = Target;
+            Node = Next;
+         }
          return Target;
       }
 
@@ -575,9 +584,16 @@ public:
       /// Multiple values can map to the same node. See setNode().
       llvm::DenseMap<ValueBase *, CGNode *> Values2Nodes;
 
-      /// All nodes.
+      /// All nodes. Merged nodes are removed lazily, see compactNodes().
       llvm::SmallVector<CGNode *, 16> Nodes;
 
+      /// The number of merged nodes which are still contained in Nodes.
+      unsigned NumMergedNodes = 0;
+
+      /// False if the graph exceeded the size limit. An invalid graph has no
+      /// nodes and all queries on it give conservative answers.
+      bool Valid = true;
+
       /// A to-do list of nodes to merge.
       llvm::SmallVector<CGNode *, 8> ToMerge;
 
@@ -609,15 +625,39 @@ public:
          return Values2Nodes.empty() && Nodes.empty() && UsePoints.empty();
       }
 
-      /// Removes all nodes from the graph.
+      /// Removes all nodes from the graph and makes it valid again.
       void clear();
 
+      /// Returns false if the graph was dropped because it exceeded the size
+      /// limit.
+      bool isValid() const { return Valid; }
+
+      /// Removes all nodes from the graph and marks it as invalid.
+      void invalidate() {
+         clear();
+         Valid = false;
+      }
+
+      /// Returns the number of nodes which are not merged into other nodes.
+      unsigned getNumLiveNodes() const { return Nodes.size() - NumMergedNodes; }
+
+      /// Removes merged nodes from Nodes. The nodes themselves stay allocated,
+      /// because mapped values and mergeTo links may still refer to them.
+      void compactNodes();
+
+      /// Invalidates the graph if it has more nodes than the size limit.
+      /// Returns true if the graph is invalid.
+      ///
+      /// This must not be called while the caller holds pointers to nodes.
+      bool checkSizeLimit();
+
       /// Allocates a node of a given type.
       ///
       /// hasRC is set for Content nodes based on the type and origin of
       /// the pointer.
       CGNode *allocNode(ValueBase *V, NodeType Type, bool hasRC = false) {
          assert(Type == NodeType::Content || !hasRC);
+         assert(Valid && "cannot add nodes to an invalid graph");
          CGNode *Node = new (NodeAllocator.Allocate()) CGNode(V, Type, hasRC);
          Nodes.push_back(Node);
          return Node;
@@ -0,0 +1,111 @@
+//===--- FunctionContentHasher.h - Keys of persistent summaries -*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2018 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+///
+/// This file defines the content hash which keys the summaries in a
+/// FunctionSummaryCache.
+///
+/// A summary is keyed by the content hash of the function and of everything
+/// the summary can depend on: the bodies of all functions reachable through
+/// the callee lists of its apply sites, and whether those callee lists are
+/// complete. Any change in that closure yields a different key, so a stale
+/// summary is never found.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef POLARPHP_PIL_OPTIMIZER_ANALYSIS_FUNCTIONCONTENTHASHER_H
+#define POLARPHP_PIL_OPTIMIZER_ANALYSIS_FUNCTIONCONTENTHASHER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MD5.h"
+#include <string>
+
+namespace polar {
+
+class BasicCalleeAnalysis;
+class PILFunction;
+class PILType;
+
+/// Computes the content hashes used as keys of the FunctionSummaryCache.
+///
+/// The hash of a single function is memoized and must be dropped with
+/// invalidate() whenever the function body changes. The hashes of the
+/// closures are memoized until the next invalidation of any function.
+class FunctionContentHasher {
+public:
+   /// A hex encoded MD5 digest.
+   using Digest = llvm::SmallString<32>;
+
+private:
+   /// The hash of a function on its own, and the functions its apply sites
+   /// may call.
+   struct LocalInfo {
+      /// The digest of the function body and attributes, combined with the
+      /// callee lists of its apply sites.
+      Digest LocalDigest;
+
+      /// The callees of all apply sites with a complete callee list.
+      llvm::SmallVector<PILFunction *, 4> Callees;
+   };
+
+   BasicCalleeAnalysis *BCA;
+
+   llvm::DenseMap<PILFunction *, LocalInfo> LocalInfos;
+
+   /// The closure digests computed since the last invalidation.
+   llvm::DenseMap<PILFunction *, Digest> ClosureDigests;
+
+   /// The printed form of the types hashed so far. Type pointers differ
+   /// between compilations, so types are hashed by their spelling, and most
+   /// functions use the same few types.
+   llvm::DenseMap<void *, std::string> TypeStrings;
+
+   const LocalInfo &getLocalInfo(PILFunction *F);
+
+   llvm::StringRef getTypeString(PILType Ty);
+
+   /// Hash the attributes and the body of \p F instruction by instruction.
+   /// Returns false if \p F contains an instruction whose state is not
+   /// encoded here, then the function is hashed by its printed form.
+   bool hashStructurally(llvm::MD5 &Hash, PILFunction *F);
+
+   /// Compute the closure digests of the functions of a strongly connected
+   /// component of the call graph, whose callees outside of the component
+   /// already have their closure digests.
+   void computeComponentDigests(llvm::ArrayRef<PILFunction *> Component);
+
+public:
+   explicit FunctionContentHasher(BasicCalleeAnalysis *BCA) : BCA(BCA) {}
+
+   /// Returns the hash of \p F and all functions reachable from it.
+   Digest getClosureDigest(PILFunction *F);
+
+   /// Drop the memoized hash of \p F. The closure of any function might
+   /// contain F, so all closure digests are dropped.
+   void invalidate(PILFunction *F) {
+      LocalInfos.erase(F);
+      ClosureDigests.clear();
+   }
+
+   /// Drop all memoized hashes, e.g. when the callee lists changed.
+   void invalidate() {
+      LocalInfos.clear();
+      ClosureDigests.clear();
+   }
+};
+
+} // end namespace polar
+
+#endif // POLARPHP_PIL_OPTIMIZER_ANALYSIS_FUNCTIONCONTENTHASHER_H
@@ -0,0 +1,97 @@
+//===--- InlineCostAnalysis.h - Inlining cost summaries ---------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2017 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+///
+/// This file defines an analysis which caches the parts of the inlining cost
+/// of a function which do not depend on the call site: the summed up
+/// instruction cost and the shortest paths through the function's blocks.
+///
+/// The performance inliner needs these for every call site of a callee, and
+/// for every caller. Without the cache they are recomputed once per caller.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef POLARPHP_PIL_OPTIMIZER_ANALYSIS_INLINECOSTANALYSIS_H
+#define POLARPHP_PIL_OPTIMIZER_ANALYSIS_INLINECOSTANALYSIS_H
+
+#include "polarphp/pil/optimizer/analysis/Analysis.h"
+#include "polarphp/pil/optimizer/utils/PerformanceInlinerUtils.h"
+#include <memory>
+
+namespace polar {
+
+class DominanceAnalysis;
+class PILLoopAnalysis;
+
+/// The call site independent inlining cost of a function.
+class InlineCostSummary {
+   PILFunction *F;
+   DominanceAnalysis *DA;
+   PILLoopAnalysis *LA;
+
+   /// The sum of the instructionInlineCost of all instructions.
+   int Cost = 0;
+
+   /// Computed on the first request. Calls in the function are assumed to
+   /// take ShortestPathAnalysis::DefaultApplyLength.
+   std::unique_ptr<ShortestPathAnalysis> SPA;
+
+public:
+   InlineCostSummary(PILFunction *F, DominanceAnalysis *DA,
+                     PILLoopAnalysis *LA);
+
+   /// Returns the inlining cost of the whole function body.
+   int getCost() const { return Cost; }
+
+   /// Returns the shortest-path analysis of the function.
+   ShortestPathAnalysis *getShortestPaths();
+
+   /// Returns the length of the shortest path through the function, or
+   /// ShortestPathAnalysis::InitialDist if the function does not return.
+   int getLength() {
+      return getShortestPaths()->getScopeLength(&F->front(), 0);
+   }
+};
+
+/// Caches an InlineCostSummary for each function.
+///
+/// A summary is dropped with any change of the function body. Summaries don't
+/// depend on other functions, as calls are accounted with a fixed length.
+class InlineCostAnalysis : public FunctionAnalysisBase<InlineCostSummary> {
+   DominanceAnalysis *DA = nullptr;
+   PILLoopAnalysis *LA = nullptr;
+
+protected:
+   virtual std::unique_ptr<InlineCostSummary>
+   newFunctionAnalysis(PILFunction *F) override;
+
+   virtual bool shouldInvalidate(PILAnalysis::InvalidationKind K) override {
+      return K & InvalidationKind::FunctionBody;
+   }
+
+public:
+   InlineCostAnalysis(PILModule *)
+      : FunctionAnalysisBase<InlineCostSummary>(PILAnalysisKind::InlineCost) {}
+
+   static bool classof(const PILAnalysis *S) {
+      return S->getKind() == PILAnalysisKind::InlineCost;
+   }
+
+   virtual void initialize(PILPassManager *PM) override;
+
+   /// The summaries are queried for callees, i.e. for other functions than the
+   /// one a pass runs on, and are computed lazily.
+   virtual bool isThreadSafe() const override { return false; }
+};
+
+} // end namespace polar
+
+#endif // POLARPHP_PIL_OPTIMIZER_ANALYSIS_INLINECOSTANALYSIS_H
@@ -55,6 +55,29 @@ public:
    static bool classof(const PILAnalysis *S) {
       return S->getKind() == PILAnalysisKind::PostOrder;
    }
+
+   virtual bool needsNotifications() override { return true; }
+
+   /// A locked analysis must be kept up to date by the pass which locked it.
+   /// Apply the CFG edits which the pass makes through the CFG utilities.
+   virtual void handleCFGEditNotification(const CFGEdit &edit) override {
+      if (!isLocked())
+         return;
+      auto info = maybeGet(edit.block->getParent());
+      if (info.isNull())
+         return;
+
+      PostOrderFunctionInfo *PO = info.get();
+      switch (edit.kind) {
+         case CFGEdit::Kind::SplitBlock:
+         case CFGEdit::Kind::SplitEdge:
+            PO->insertBefore(edit.newBlock, edit.block);
+            return;
+         case CFGEdit::Kind::MergeBlocks:
+            PO->erase(edit.dest);
+            return;
+      }
+   }
 };
 
 } // end namespace polar
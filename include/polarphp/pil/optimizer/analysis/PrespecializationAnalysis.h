@@ -0,0 +1,82 @@
+//===--- PrespecializationAnalysis.h - Prespecialization cache --*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2018 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+///
+/// This file defines an analysis which records the public generic
+/// specializations a module defines, keyed by their mangled names, in a file
+/// which is shared between the compilations of a build.
+///
+/// A later compilation of a module which imports the defining module can then
+/// link such a specialization instead of cloning and optimizing its own copy,
+/// like it is done for the fixed list of OnoneSupport prespecializations.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef POLARPHP_PIL_OPTIMIZER_ANALYSIS_PRESPECIALIZATIONANALYSIS_H
+#define POLARPHP_PIL_OPTIMIZER_ANALYSIS_PRESPECIALIZATIONANALYSIS_H
+
+#include "polarphp/pil/optimizer/analysis/Analysis.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace polar {
+
+class FunctionSummaryCache;
+class PILFunction;
+class PILModule;
+
+/// Knows which public specializations other modules of the build define.
+class PrespecializationAnalysis : public PILAnalysis {
+   PILModule *Mod;
+
+   /// Maps the mangled name of a specialization to the name of the module
+   /// defining it. Owned by the module, null if no cache file is set.
+   FunctionSummaryCache *Cache = nullptr;
+
+public:
+   PrespecializationAnalysis(PILModule *M)
+      : PILAnalysis(PILAnalysisKind::Prespecialization), Mod(M) {}
+
+   static bool classof(const PILAnalysis *S) {
+      return S->getKind() == PILAnalysisKind::Prespecialization;
+   }
+
+   virtual void initialize(PILPassManager *PM) override;
+
+   /// Records the public specializations of the module.
+   virtual void finish() override;
+
+   /// Returns the declaration of the public specialization named \p SpecName,
+   /// if a module imported by the current module was recorded to define it
+   /// and a loaded module still exports it. Returns null otherwise.
+   PILFunction *findPrespecialization(llvm::StringRef SpecName);
+
+   /// No invalidation is needed.
+   virtual void invalidate() override {
+      // The recorded names refer to other modules, which don't change.
+   }
+
+   /// No invalidation is needed.
+   virtual void invalidate(PILFunction *F, InvalidationKind K) override {}
+
+   /// Notify the analysis about a newly created function.
+   virtual void notifyAddedOrModifiedFunction(PILFunction *F) override {}
+
+   /// Notify the analysis about a function which will be deleted from the
+   /// module.
+   virtual void notifyWillDeleteFunction(PILFunction *F) override {}
+
+   /// Notify the analysis about changed witness or vtables.
+   virtual void invalidateFunctionTables() override {}
+};
+
+} // end namespace polar
+
+#endif // POLARPHP_PIL_OPTIMIZER_ANALYSIS_PRESPECIALIZATIONANALYSIS_H
@@ -18,13 +18,16 @@
 #include "polarphp/pil/lang/PILFunction.h"
 #include "polarphp/pil/optimizer/analysis/BottomUpIPAnalysis.h"
 #include "polarphp/pil/optimizer/analysis/ArraySemantic.h"
+#include "polarphp/pil/optimizer/analysis/FunctionContentHasher.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallVector.h"
+#include <memory>
 
 namespace polar {
 
 class BasicCalleeAnalysis;
+class FunctionSummaryCache;
 
 
 /// An enum to represent the kind of scan we perform when we calculate
@@ -86,9 +89,28 @@ class GenericFunctionEffectAnalysis : public BottomUpIPAnalysis {
    /// The allocator for the map of values in FunctionInfoMap.
    llvm::SpecificBumpPtrAllocator<FunctionInfo> allocator;
 
+protected:
    /// Callee analysis, used for determining the callees at call sites.
    BasicCalleeAnalysis *BCA;
 
+   /// Seed \p effects of \p F, which needs its body analyzed, from a summary
+   /// of an earlier compilation. Returns true if the function does not need to
+   /// be analyzed.
+   virtual bool loadPersistentEffects(PILFunction *F,
+                                      FunctionEffects &effects) {
+      return false;
+   }
+
+   /// Call \p fn with each function whose effects are computed and
+   /// up-to-date.
+   template <typename FnTy>
+   void forEachValidEffects(FnTy fn) {
+      for (auto &entry : functionInfoMap) {
+         if (entry.second->isValid())
+            fn(entry.first, entry.second->functionEffects);
+      }
+   }
+
 public:
    GenericFunctionEffectAnalysis(PILAnalysisKind kind)
       : BottomUpIPAnalysis(kind) {}
@@ -154,6 +176,10 @@ private:
    void analyzeCall(FunctionInfo *functionInfo, FullApplySite fullApply,
                     FunctionOrder &bottomUpOrder, int recursionDepth);
 
+   /// Registers \p functionInfo as caller of the callees of \p fullApply
+   /// without analyzing them, for functions with reloaded effects.
+   void addCallerEdges(FunctionInfo *functionInfo, FullApplySite fullApply);
+
    /// Recomputes the side-effect information for the function \p Initial and
    /// all called functions, up to a recursion depth of MaxRecursionDepth.
    void recompute(FunctionInfo *initialInfo);
@@ -180,6 +206,27 @@ class FunctionSideEffectFlags {
    bool Retains = false;
    bool Releases = false;
 
+   enum : unsigned {
+      ReadsBit = 1 << 0,
+      WritesBit = 1 << 1,
+      RetainsBit = 1 << 2,
+      ReleasesBit = 1 << 3,
+      AllBits = (1 << 4) - 1
+   };
+
+   /// Pack the flags for the persistent summary cache.
+   unsigned getBits() const {
+      return (Reads ? ReadsBit : 0) | (Writes ? WritesBit : 0) |
+             (Retains ? RetainsBit : 0) | (Releases ? ReleasesBit : 0);
+   }
+
+   void setBits(unsigned bits) {
+      Reads = bits & ReadsBit;
+      Writes = bits & WritesBit;
+      Retains = bits & RetainsBit;
+      Releases = bits & ReleasesBit;
+   }
+
    /// Sets the most conservative effects.
    void setWorstEffects() {
       Reads = true;
@@ -374,6 +421,14 @@ public:
    /// Print the function effects.
    void dump() const;
 
+   /// Encode the effects as a payload of the FunctionSummaryCache.
+   void writeSummary(raw_ostream &os) const;
+
+   /// Decode a payload written by writeSummary for a function with
+   /// \p numParams parameters. Returns false and leaves the effects unchanged
+   /// if the payload is malformed or does not match the parameter count.
+   bool readSummary(StringRef payload, unsigned numParams);
+
    /// Does the function allocate objects, boxes, etc., i.e. everything which
    /// has a reference count.
    bool mayAllocObjects() const { return AllocsObjects; }
@@ -438,8 +493,21 @@ protected:
 /// Does the function read or write memory? Does the function retain or release
 /// objects? etc.
 /// For details see FunctionSideEffects.
+///
+/// If a summary cache file is configured, the summaries of functions whose
+/// body and callees did not change since an earlier compilation are reloaded
+/// from it instead of being recomputed. The summaries computed by a pass
+/// manager are added to the cache when it finishes, and the module writes the
+/// cache once at the end of the compilation.
 class SideEffectAnalysis
    : public GenericFunctionEffectAnalysis<FunctionSideEffects> {
+   /// The summaries of earlier compilations, owned by the module. Null if
+   /// summaries are not persisted.
+   FunctionSummaryCache *summaryCache = nullptr;
+
+   /// Computes the keys of the summary cache.
+   std::unique_ptr<FunctionContentHasher> hasher;
+
 public:
    SideEffectAnalysis()
       : GenericFunctionEffectAnalysis<FunctionSideEffects>(
@@ -448,6 +516,25 @@ public:
    static bool classof(const PILAnalysis *S) {
       return S->getKind() == PILAnalysisKind::SideEffect;
    }
+
+   virtual void initialize(PILPassManager *PM) override;
+
+   virtual void invalidate() override;
+
+   virtual void invalidate(PILFunction *F, InvalidationKind K) override;
+
+   virtual void notifyAddedOrModifiedFunction(PILFunction *F) override;
+
+   virtual void notifyWillDeleteFunction(PILFunction *F) override;
+
+   virtual void invalidateFunctionTables() override;
+
+   /// Add the summaries computed by this pass manager to the cache.
+   virtual void finish() override;
+
+protected:
+   virtual bool loadPersistentEffects(PILFunction *F,
+                                      FunctionSideEffects &effects) override;
 };
 
 } // end namespace polar::pilSimplifyInstruction.h
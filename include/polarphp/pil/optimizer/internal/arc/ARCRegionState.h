@@ -189,7 +189,7 @@ public:
       AliasAnalysis *AA, RCIdentityFunctionInfo *RCIA,
       LoopRegionFunctionInfo *LRFI,
       BlotMapVector<PILInstruction *, TopDownRefCountState> &DecToIncStateMap,
-      llvm::DenseMap<const LoopRegion *, ARCRegionState *> &LoopRegionState,
+      ARCRegionStateMap &LoopRegionState,
       ImmutablePointerSetFactory<PILInstruction> &SetFactory);
 
    /// If this region is a block, process all instructions bottom up. Otherwise,
@@ -201,14 +201,14 @@ public:
       EpilogueARCFunctionInfo *EAFI, LoopRegionFunctionInfo *LRFI,
       bool FreezeOwnedArgEpilogueReleases,
       BlotMapVector<PILInstruction *, BottomUpRefCountState> &IncToDecStateMap,
-      llvm::DenseMap<const LoopRegion *, ARCRegionState *> &RegionStateInfo,
+      ARCRegionStateMap &RegionStateInfo,
       ImmutablePointerSetFactory<PILInstruction> &SetFactory);
 
    void summarizeBlock(PILBasicBlock *BB);
 
    void summarize(
       LoopRegionFunctionInfo *LRFI,
-      llvm::DenseMap<const LoopRegion *, ARCRegionState *> &RegionStateInfo);
+      ARCRegionStateMap &RegionStateInfo);
 
    /// Add \p I to the interesting instruction list of this region if it is a
    /// block. We assume that I is an instruction in the block.
@@ -230,7 +230,7 @@ private:
       ImmutablePointerSetFactory<PILInstruction> &SetFactory);
    bool processLoopBottomUp(
       const LoopRegion *R, AliasAnalysis *AA, LoopRegionFunctionInfo *LRFI,
-      llvm::DenseMap<const LoopRegion *, ARCRegionState *> &RegionStateInfo,
+      ARCRegionStateMap &RegionStateInfo,
       ImmutablePointerSetFactory<PILInstruction> &SetFactory);
 
    bool processBlockTopDown(
@@ -244,7 +244,7 @@ private:
 
    void summarizeLoop(
       const LoopRegion *R, LoopRegionFunctionInfo *LRFI,
-      llvm::DenseMap<const LoopRegion *, ARCRegionState *> &RegionStateInfo);
+      ARCRegionStateMap &RegionStateInfo);
 };
 
 } // end polar namespace
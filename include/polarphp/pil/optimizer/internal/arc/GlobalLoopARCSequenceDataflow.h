@@ -21,6 +21,7 @@
 #include "polarphp/basic/ImmutablePointerSet.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/Optional.h"
+#include <vector>
 
 namespace polar {
 
@@ -34,6 +35,29 @@ namespace polar {
 // Forward declaration of private classes that are opaque in this header.
 class ARCRegionState;
 
+/// The ARCRegionState of each region of a function.
+///
+/// Loop regions are numbered densely by LoopRegionFunctionInfo, so the states
+/// are stored in a flat array indexed by the region ID instead of hashing the
+/// region pointer on each lookup.
+class ARCRegionStateMap {
+   std::vector<ARCRegionState *> States;
+
+public:
+   explicit ARCRegionStateMap(unsigned NumRegions)
+      : States(NumRegions, nullptr) {}
+
+   ARCRegionState *&operator[](const LoopRegion *R) {
+      assert(R->getID() < States.size() && "region of another function");
+      return States[R->getID()];
+   }
+
+   using iterator = std::vector<ARCRegionState *>::iterator;
+   iterator begin() { return States.begin(); }
+   iterator end() { return States.end(); }
+   unsigned size() const { return States.size(); }
+};
+
 /// A class that implements the ARC sequence data flow.
 class LoopARCSequenceDataflowEvaluator {
    /// The bump ptr allocator that is used to allocate memory in the allocator.
@@ -70,7 +94,7 @@ class LoopARCSequenceDataflowEvaluator {
    BlotMapVector<PILInstruction *, BottomUpRefCountState> &IncToDecStateMap;
 
    /// Stashed information for each region.
-   llvm::DenseMap<const LoopRegion *, ARCRegionState *> RegionStateInfo;
+   ARCRegionStateMap RegionStateInfo;
 
 public:
    LoopARCSequenceDataflowEvaluator(
@@ -125,10 +149,9 @@ private:
    void computePostDominatingConsumedArgMap();
 
    ARCRegionState &getARCState(const LoopRegion *L) {
-      auto Iter = RegionStateInfo.find(L);
-      assert(Iter != RegionStateInfo.end() && "Should have created state for "
-                                              "each region");
-      return *Iter->second;
+      ARCRegionState *State = RegionStateInfo[L];
+      assert(State && "Should have created state for each region");
+      return *State;
    }
 
    bool processLoopTopDown(const LoopRegion *R);
@@ -68,6 +68,10 @@ class PILCombiner :
    /// The current iteration of the PILCombine.
    unsigned Iteration;
 
+   /// Set if an iteration stopped because it visited too many instructions.
+   /// No further iterations are done then.
+   bool ReachedVisitLimit = false;
+
    /// Builder used to insert instructions.
    PILBuilder &Builder;
 
@@ -99,6 +103,7 @@ public:
       Iteration = 0;
       Worklist.resetChecked();
       MadeChange = false;
+      ReachedVisitLimit = false;
    }
 
    // Insert the instruction New before instruction Old in Old's parent BB. Add
@@ -301,8 +306,8 @@ private:
    bool doOneIteration(PILFunction &F, unsigned Iteration);
 
    /// Add reachable code to the worklist. Meant to be used when starting to
-   /// process a new function.
-   void addReachableCodeToWorklist(PILBasicBlock *BB);
+   /// process a new function. Returns the number of instructions added.
+   unsigned addReachableCodeToWorklist(PILFunction *F);
 
    typedef SmallVector<PILInstruction*, 4> UserListTy;
 
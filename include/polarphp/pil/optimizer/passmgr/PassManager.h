@@ -19,6 +19,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/ErrorHandling.h"
+#include <mutex>
 #include <vector>
 
 #ifndef POLARPHP_PIL_OPTIMIZER_PASSMANAGER_PASSMANAGER_H
@@ -31,6 +32,7 @@ class PILFunctionTransform;
 class PILModule;
 class PILModuleTransform;
 class PILOptions;
+class PILPassProfiler;
 class PILTransform;
 
 namespace irgen {
@@ -88,12 +90,42 @@ class PILPassManager {
    /// worklist (e.g. caused by a bug in a specializing optimization).
    llvm::DenseMap<PILFunction *, int> DerivationLevels;
 
-   /// Set to true when a pass invalidates an analysis.
-   bool CurrentPassHasInvalidated = false;
+   /// The state of the function pass pipeline on the function which is
+   /// currently processed.
+   struct PipelineState {
+      /// Set to true when a pass invalidates an analysis.
+      bool CurrentPassHasInvalidated = false;
 
-   /// True if we need to stop running passes and restart again on the
-   /// same function.
-   bool RestartPipeline = false;
+      /// The number of analysis invalidations broadcast by this pipeline.
+      unsigned NumInvalidations = 0;
+
+      /// True if we need to stop running passes and restart again on the
+      /// same function.
+      bool RestartPipeline = false;
+
+      /// The number of passes a parallel worker has run so far.
+      unsigned NumPassesRun = 0;
+
+      /// A parallel worker's own instances of the passes in its group, the
+      /// first one replaces Transformations[FirstPassIdx].
+      std::vector<PILFunctionTransform *> Passes;
+      unsigned FirstPassIdx = 0;
+   };
+
+   /// The pipeline state used outside of parallel function pass groups.
+   PipelineState SerialPipelineState;
+
+   /// The pipeline state of the parallel worker on this thread, null if the
+   /// thread is not a worker.
+   static thread_local PipelineState *WorkerPipelineState;
+
+   /// Serializes the invalidation of analyses while function passes run on
+   /// several threads.
+   std::mutex InvalidationMutex;
+
+   /// Records the cost of each pass run, null unless a pass profile is
+   /// requested. Owned by the module.
+   PILPassProfiler *Profiler = nullptr;
 
    /// If true, passes are also run for functions which have
    /// OptimizationMode::NoOptimization.
@@ -131,8 +163,11 @@ public:
    template<typename T>
    T *getAnalysis() {
       for (PILAnalysis *A : Analyses)
-         if (auto *R = llvm::dyn_cast<T>(A))
+         if (auto *R = llvm::dyn_cast<T>(A)) {
+            assert((!WorkerPipelineState || R->isThreadSafe()) &&
+                   "parallel safe passes must only use thread safe analyses");
             return R;
+         }
 
       llvm_unreachable("Unable to find analysis for requested type.");
    }
@@ -147,17 +182,19 @@ public:
    /// Restart the function pass pipeline on the same function
    /// that is currently being processed.
    void restartWithCurrentFunction(PILTransform *T);
-   void clearRestartPipeline() { RestartPipeline = false; }
-   bool shouldRestartPipeline() { return RestartPipeline; }
+   void clearRestartPipeline() { getPipelineState().RestartPipeline = false; }
+   bool shouldRestartPipeline() { return getPipelineState().RestartPipeline; }
 
    /// Iterate over all analysis and invalidate them.
    void invalidateAllAnalysis() {
+      assert(!WorkerPipelineState && "module passes do not run in parallel");
       // Invalidate the analysis (unless they are locked)
       for (auto AP : Analyses)
          if (!AP->isLocked())
             AP->invalidate();
 
-      CurrentPassHasInvalidated = true;
+      getPipelineState().CurrentPassHasInvalidated = true;
+      ++getPipelineState().NumInvalidations;
 
       // Assume that all functions have changed. Clear all masks of all functions.
       CompletedPassesMap.clear();
@@ -186,12 +223,20 @@ public:
    /// Broadcast the invalidation of the function to all analysis.
    void invalidateAnalysis(PILFunction *F,
                            PILAnalysis::InvalidationKind K) {
+      // The analyses are shared by all workers of a parallel pipeline. The
+      // completed-passes mask of F already exists, so looking it up does not
+      // modify the map.
+      std::unique_lock<std::mutex> Lock;
+      if (WorkerPipelineState)
+         Lock = std::unique_lock<std::mutex>(InvalidationMutex);
+
       // Invalidate the analysis (unless they are locked)
       for (auto AP : Analyses)
          if (!AP->isLocked())
             AP->invalidate(F, K);
 
-      CurrentPassHasInvalidated = true;
+      getPipelineState().CurrentPassHasInvalidated = true;
+      ++getPipelineState().NumInvalidations;
       // Any change let all passes run again.
       CompletedPassesMap[F].reset();
    }
@@ -199,12 +244,14 @@ public:
    /// Iterate over all analysis and notify them of a change in witness-
    /// or vtables.
    void invalidateFunctionTables() {
+      assert(!WorkerPipelineState && "module passes do not run in parallel");
       // Invalidate the analysis (unless they are locked)
       for (auto AP : Analyses)
          if (!AP->isLocked())
             AP->invalidateFunctionTables();
 
-      CurrentPassHasInvalidated = true;
+      getPipelineState().CurrentPassHasInvalidated = true;
+      ++getPipelineState().NumInvalidations;
 
       // Assume that all functions have changed. Clear all masks of all functions.
       CompletedPassesMap.clear();
@@ -212,12 +259,14 @@ public:
 
    /// Iterate over all analysis and notify them of a deleted function.
    void notifyWillDeleteFunction(PILFunction *F) {
+      assert(!WorkerPipelineState && "module passes do not run in parallel");
       // Invalidate the analysis (unless they are locked)
       for (auto AP : Analyses)
          if (!AP->isLocked())
             AP->notifyWillDeleteFunction(F);
 
-      CurrentPassHasInvalidated = true;
+      getPipelineState().CurrentPassHasInvalidated = true;
+      ++getPipelineState().NumInvalidations;
       // Any change let all passes run again.
       CompletedPassesMap[F].reset();
    }
@@ -281,6 +330,10 @@ public:
 private:
    void execute();
 
+   /// Create a new instance of the pass \p Kind. IRGen passes are registered
+   /// by IRGen and cannot be created here.
+   static PILTransform *createTransform(PassKind Kind);
+
    /// Add a pass of a specific kind.
    void addPass(PassKind Kind);
 
@@ -297,6 +350,25 @@ private:
    /// Run the passes in Transform from \p FromTransIdx to \p ToTransIdx.
    void runFunctionPasses(unsigned FromTransIdx, unsigned ToTransIdx);
 
+   /// Run the passes in Transform from \p FromTransIdx to \p ToTransIdx on
+   /// one function after the other, following the function worklist.
+   void runFunctionPassesSerially(unsigned FromTransIdx, unsigned ToTransIdx);
+
+   /// Run the parallel safe passes in Transform from \p FromTransIdx to
+   /// \p ToTransIdx on \p NumThreads threads. Each worker runs the whole group
+   /// on the next function which is not taken yet.
+   void runFunctionPassesInParallel(unsigned FromTransIdx, unsigned ToTransIdx,
+                                    unsigned NumThreads);
+
+   /// Returns the number of threads function passes should run on, 1 if
+   /// they must run serially, e.g. because debugging options are set.
+   unsigned getNumFunctionPassThreads() const;
+
+   /// Returns the pipeline state of the current thread.
+   PipelineState &getPipelineState() {
+      return WorkerPipelineState ? *WorkerPipelineState : SerialPipelineState;
+   }
+
    /// A helper function that returns (based on PIL stage and debug
    /// options) whether we should continue running passes.
    bool continueTransforming();
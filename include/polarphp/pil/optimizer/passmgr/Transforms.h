@@ -101,6 +101,15 @@ public:
    /// The entry point to the transformation.
    virtual void run() = 0;
 
+   /// Return true if the pass may run on several functions at the same time,
+   /// see the -sil-function-pass-threads option of the pass manager.
+   ///
+   /// A parallel safe pass only reads and changes the function it runs on.
+   /// It does not create or erase functions, does not add functions to the
+   /// worklist, does not need delete notifications and only uses analyses
+   /// which are thread safe (see PILAnalysis::isThreadSafe()).
+   virtual bool isParallelSafe() const { return false; }
+
    static bool classof(const PILTransform *S) {
       return S->getKind() == TransformKind::Function;
    }
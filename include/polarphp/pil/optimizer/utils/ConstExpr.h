@@ -28,14 +28,17 @@
 #include "polarphp/basic/SourceLoc.h"
 #include "polarphp/pil/lang/PILBasicBlock.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include <memory>
 
 namespace polar {
 
 class AstContext;
+class ConstExprCallMemo;
 class Operand;
 class PILFunction;
 class PILModule;
 class PILNode;
+class SubstitutionMap;
 class SymbolicValue;
 class SymbolicValueAllocator;
 class ConstExprFunctionState;
@@ -59,6 +62,14 @@ class ConstExprEvaluator {
    /// provided to the clients.
    llvm::SmallPtrSet<PILFunction *, 2> calledFunctions;
 
+   /// The calls evaluated to a constant so far, see lookupMemoizedCall().
+   /// Created on the first memoized call.
+   std::unique_ptr<ConstExprCallMemo> callMemo;
+
+   /// The bytes the allocator had allocated when the current top-level
+   /// evaluation started. The allocator may be shared with other evaluations.
+   size_t evaluationStartBytes = 0;
+
    void operator=(const ConstExprEvaluator &) = delete;
 
 public:
@@ -70,6 +81,17 @@ public:
 
    SymbolicValueAllocator &getAllocator() { return allocator; }
 
+   /// Called when a top-level evaluation starts, which the memory limit is
+   /// applied to.
+   void startEvaluation() {
+      evaluationStartBytes = allocator.getBytesAllocated();
+   }
+
+   /// Returns the bytes allocated since startEvaluation().
+   size_t getBytesAllocatedByEvaluation() const {
+      return allocator.getBytesAllocated() - evaluationStartBytes;
+   }
+
    unsigned getAssertConfig() { return assertConfig; }
 
    void pushCallStack(SourceLoc loc) { callStack.push_back(loc); }
@@ -106,6 +128,20 @@ public:
       assert(trackCallees && "evaluator not configured to track callees");
       return calledFunctions;
    }
+
+   /// Returns the result of an earlier evaluation of a call to \p callee with
+   /// the same substitutions and arguments, or None.
+   ///
+   /// Only calls whose arguments and result are plain values, i.e. don't
+   /// contain addresses, arrays or closures, are memoized. The result of such a
+   /// call only depends on the arguments.
+   Optional<SymbolicValue> lookupMemoizedCall(PILFunction *callee,
+                                              SubstitutionMap substitutions,
+                                              ArrayRef<SymbolicValue> arguments);
+
+   /// Remembers that the call of \p callee evaluated to \p result.
+   void memoizeCall(PILFunction *callee, SubstitutionMap substitutions,
+                    ArrayRef<SymbolicValue> arguments, SymbolicValue result);
 };
 
 /// A constant-expression evaluator that can be used to step through a control
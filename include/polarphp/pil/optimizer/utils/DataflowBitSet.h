@@ -0,0 +1,290 @@
+//===--- DataflowBitSet.h - Sparse sets for bit vector dataflow -*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2017 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+///
+/// This file defines DataflowBitSet, a bit set over a fixed universe of
+/// indices that only pays for the bits that differ from its default, and
+/// solveDataflow, a worklist driver for the gen/kill style dataflow problems
+/// solved by the load store optimizations.
+///
+/// Passes like RLE and DSE keep several sets per basic block, each one sized to
+/// every LSLocation in the function. With dense bit vectors this costs
+/// O(blocks x locations) memory even though a block usually touches a handful
+/// of locations. DataflowBitSet stores its bits in a llvm::SparseBitVector and
+/// can additionally hold the complement of the stored bits, so both the empty
+/// set and the optimistic "all ones" starting state are free.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef POLARPHP_PIL_OPTIMIZER_UTILS_DATAFLOW_BITSET_H
+#define POLARPHP_PIL_OPTIMIZER_UTILS_DATAFLOW_BITSET_H
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cassert>
+
+namespace polar {
+
+/// A set of indices in [0, size()).
+///
+/// If Complemented is false the set is exactly the bits stored in Bits,
+/// otherwise it is every index in the universe except the stored bits. Bits
+/// never holds an index outside the universe.
+class DataflowBitSet {
+   using BitsTy = llvm::SparseBitVector<>;
+
+   /// The size of the universe.
+   unsigned Size = 0;
+
+   /// True if the set is the complement of Bits.
+   bool Complemented = false;
+
+   BitsTy Bits;
+
+   /// Intersect this set with \p RHS, or with the complement of \p RHS if
+   /// \p ComplementRHS is true.
+   void intersectWith(const DataflowBitSet &RHS, bool ComplementRHS) {
+      assert(Size == RHS.Size && "sets of different universes");
+      bool RHSComplemented = RHS.Complemented != ComplementRHS;
+      if (!Complemented && !RHSComplemented) {
+         Bits &= RHS.Bits;
+      } else if (!Complemented) {
+         Bits.intersectWithComplement(RHS.Bits);
+      } else if (!RHSComplemented) {
+         // ~A & B == B - A
+         BitsTy Result;
+         Result.intersectWithComplement(RHS.Bits, Bits);
+         Bits = std::move(Result);
+         Complemented = false;
+      } else {
+         // ~A & ~B == ~(A | B)
+         Bits |= RHS.Bits;
+      }
+   }
+
+public:
+   DataflowBitSet() = default;
+
+   DataflowBitSet(unsigned Size, bool Value)
+      : Size(Size), Complemented(Value) {}
+
+   /// Set the size of the universe and fill the set with \p Value. Unlike
+   /// SmallBitVector::resize, the previous content is discarded.
+   void resize(unsigned NewSize, bool Value = false) {
+      Size = NewSize;
+      Complemented = Value;
+      Bits.clear();
+   }
+
+   unsigned size() const { return Size; }
+
+   /// Returns true if the universe is empty.
+   bool empty() const { return Size == 0; }
+
+   bool test(unsigned Idx) const {
+      assert(Idx < Size && "index out of range");
+      return Bits.test(Idx) != Complemented;
+   }
+
+   bool operator[](unsigned Idx) const { return test(Idx); }
+
+   DataflowBitSet &set(unsigned Idx) {
+      assert(Idx < Size && "index out of range");
+      if (Complemented)
+         Bits.reset(Idx);
+      else
+         Bits.set(Idx);
+      return *this;
+   }
+
+   DataflowBitSet &reset(unsigned Idx) {
+      assert(Idx < Size && "index out of range");
+      if (Complemented)
+         Bits.set(Idx);
+      else
+         Bits.reset(Idx);
+      return *this;
+   }
+
+   /// Add every index of the universe to the set.
+   DataflowBitSet &set() {
+      Bits.clear();
+      Complemented = true;
+      return *this;
+   }
+
+   /// Remove every index from the set.
+   DataflowBitSet &reset() {
+      Bits.clear();
+      Complemented = false;
+      return *this;
+   }
+
+   /// Remove the indices in \p RHS from this set.
+   DataflowBitSet &reset(const DataflowBitSet &RHS) {
+      intersectWith(RHS, /*ComplementRHS*/ true);
+      return *this;
+   }
+
+   DataflowBitSet &operator&=(const DataflowBitSet &RHS) {
+      intersectWith(RHS, /*ComplementRHS*/ false);
+      return *this;
+   }
+
+   DataflowBitSet &operator|=(const DataflowBitSet &RHS) {
+      assert(Size == RHS.Size && "sets of different universes");
+      if (!Complemented && !RHS.Complemented) {
+         Bits |= RHS.Bits;
+      } else if (!Complemented) {
+         // A | ~B == ~(B - A)
+         BitsTy Result;
+         Result.intersectWithComplement(RHS.Bits, Bits);
+         Bits = std::move(Result);
+         Complemented = true;
+      } else if (!RHS.Complemented) {
+         // ~A | B == ~(A - B)
+         Bits.intersectWithComplement(RHS.Bits);
+      } else {
+         // ~A | ~B == ~(A & B)
+         Bits &= RHS.Bits;
+      }
+      return *this;
+   }
+
+   /// Returns the number of indices in the set.
+   unsigned count() const {
+      unsigned Stored = Bits.count();
+      return Complemented ? Size - Stored : Stored;
+   }
+
+   bool any() const { return Complemented ? Bits.count() != Size : !Bits.empty(); }
+
+   bool none() const { return !any(); }
+
+   bool operator==(const DataflowBitSet &RHS) const {
+      assert(Size == RHS.Size && "sets of different universes");
+      if (Complemented == RHS.Complemented)
+         return Bits == RHS.Bits;
+      // A == ~B iff A and B partition the universe.
+      return Bits.count() + RHS.Bits.count() == Size &&
+             !Bits.intersects(RHS.Bits);
+   }
+
+   bool operator!=(const DataflowBitSet &RHS) const { return !(*this == RHS); }
+
+   /// Call \p Fn with every index in the set, in increasing order. The set must
+   /// not be modified while it is walked.
+   template <typename FnTy>
+   void forEachSetBit(FnTy Fn) const {
+      if (!Complemented) {
+         for (unsigned Idx : Bits)
+            Fn(Idx);
+         return;
+      }
+      auto Skip = Bits.begin(), SkipEnd = Bits.end();
+      for (unsigned Idx = 0; Idx < Size; ++Idx) {
+         if (Skip != SkipEnd && *Skip == Idx) {
+            ++Skip;
+            continue;
+         }
+         Fn(Idx);
+      }
+   }
+
+   /// Returns true if \p Pred holds for some index in the set. The walk stops
+   /// at the first such index.
+   template <typename PredTy>
+   bool anySetBit(PredTy Pred) const {
+      if (!Complemented) {
+         for (unsigned Idx : Bits)
+            if (Pred(Idx))
+               return true;
+         return false;
+      }
+      auto Skip = Bits.begin(), SkipEnd = Bits.end();
+      for (unsigned Idx = 0; Idx < Size; ++Idx) {
+         if (Skip != SkipEnd && *Skip == Idx) {
+            ++Skip;
+            continue;
+         }
+         if (Pred(Idx))
+            return true;
+      }
+      return false;
+   }
+
+   /// Remove every index for which \p Pred returns true. \p Pred is called
+   /// exactly once for each index in the set, so it may update state kept
+   /// alongside the set.
+   template <typename PredTy>
+   void resetIf(PredTy Pred) {
+      llvm::SmallVector<unsigned, 16> ToReset;
+      forEachSetBit([&](unsigned Idx) {
+         if (Pred(Idx))
+            ToReset.push_back(Idx);
+      });
+      for (unsigned Idx : ToReset)
+         reset(Idx);
+   }
+
+   void print(llvm::raw_ostream &OS) const {
+      OS << '{';
+      bool First = true;
+      forEachSetBit([&](unsigned Idx) {
+         if (!First)
+            OS << ',';
+         OS << Idx;
+         First = false;
+      });
+      OS << '}';
+   }
+};
+
+inline llvm::raw_ostream &operator<<(llvm::raw_ostream &OS,
+                                     const DataflowBitSet &Set) {
+   Set.print(OS);
+   return OS;
+}
+
+/// Run a worklist dataflow to a fixed point.
+///
+/// Every block in \p InitialOrder is processed once; blocks are popped from
+/// the back, so a forward problem passes the post order and a backward problem
+/// the reverse post order. \p Transfer recomputes the state of a block and
+/// returns true if its result changed, in which case every block yielded by
+/// \p Dependents that is not already queued is processed again.
+template <typename BlockTy, typename RangeTy, typename TransferTy,
+          typename DependentsTy>
+void solveDataflow(RangeTy &&InitialOrder, TransferTy Transfer,
+                   DependentsTy Dependents) {
+   llvm::SmallVector<BlockTy *, 16> WorkList;
+   llvm::SmallPtrSet<BlockTy *, 16> InWorkList;
+   for (BlockTy *BB : InitialOrder) {
+      WorkList.push_back(BB);
+      InWorkList.insert(BB);
+   }
+   while (!WorkList.empty()) {
+      BlockTy *BB = WorkList.pop_back_val();
+      InWorkList.erase(BB);
+      if (!Transfer(BB))
+         continue;
+      for (BlockTy *Dep : Dependents(BB)) {
+         if (InWorkList.insert(Dep).second)
+            WorkList.push_back(Dep);
+      }
+   }
+}
+
+} // end namespace polar
+
+#endif // POLARPHP_PIL_OPTIMIZER_UTILS_DATAFLOW_BITSET_H
@@ -29,6 +29,7 @@ namespace polar {
 
 class FunctionSignaturePartialSpecializer;
 class PILOptFunctionBuilder;
+class PrespecializationAnalysis;
 
 namespace optremark {
 class Emitter;
@@ -342,7 +343,11 @@ ApplySite replaceWithSpecializedFunction(ApplySite AI, PILFunction *NewF,
 /// visible to the current PILModule. This is used to link call sites to
 /// externally defined specialization and should only be used when the function
 /// body is not required for further optimization or inlining (-Onone).
-PILFunction *lookupPrespecializedSymbol(PILModule &M, StringRef FunctionName);
+///
+/// Besides the OnoneSupport prespecializations, the public specializations
+/// which \p PSA recorded for imported modules are found, if \p PSA is given.
+PILFunction *lookupPrespecializedSymbol(PILModule &M, StringRef FunctionName,
+                                        PrespecializationAnalysis *PSA = nullptr);
 
 } // end namespace polar
 
@@ -24,6 +24,10 @@ class PILPassManager;
 /// \param M PILModule to be processed
 /// \param Transform the PIL transformation that was just executed
 /// \param PM the PassManager being used
+/// Returns true if the optimizer collects PIL module or function stats
+/// around each transform.
+bool isPILModuleStatsEnabled();
+
 void updatePILModuleStatsBeforeTransform(PILModule &M, PILTransform *Transform,
                                          PILPassManager &PM, int PassNumber);
 
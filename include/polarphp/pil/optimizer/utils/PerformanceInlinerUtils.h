@@ -224,6 +224,10 @@ public:
     /// The "weight" for the benefit which a single loop nest gives.
     SingleLoopWeight = 4,
 
+    /// The assumed execution length of a function call which is not analyzed
+    /// itself.
+    DefaultApplyLength = 10,
+
     /// Pretty large but small enough to add something without overflowing.
     InitialDist = (1 << 29)
   };
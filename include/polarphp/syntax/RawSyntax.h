@@ -40,6 +40,7 @@
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/PointerUnion.h"
+#include "llvm/ADT/iterator.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/TrailingObjects.h"
 #include "llvm/Support/raw_ostream.h"
@@ -58,7 +59,7 @@
 #ifndef NDEBUG
 #define syntax_assert_child_kind(raw, cursorName, expectedKind)              \
    do {                                                                      \
-      if (auto &__child = raw->getChild(cursorName)) {                       \                                                        \
+      if (auto __child = raw->getChild(cursorName)) {                       \                                                        \
          assert(__child->getKind() == expectedKind)                          \
       }                                                                      \
    } while (false)
@@ -71,7 +72,7 @@
    do {                                                                        \
       bool __found = false;                                                    \
       std::string errorMsg;                                                    \
-      if (auto &__token = raw->getChild(Cursor::cursorName)) {                 \
+      if (auto __token = raw->getChild(Cursor::cursorName)) {                 \
          assert(__token->isToken());                                           \
          if (__token->isPresent()) {                                           \
             for (auto tokenKind : {__VA_ARGS__}) {                             \
@@ -93,7 +94,7 @@
 #define syntax_assert_child_token_text(raw, cursorName, tokenKind, ...)          \
    do {                                                                          \
       bool __found = false;                                                      \
-      if (auto &__child = raw->getChild(cursor::cursorName)) {                   \
+      if (auto __child = raw->getChild(cursor::cursorName)) {                   \
          assert(__child->isToken());                                             \
          if (__child->isPresent()) {                                             \
             assert(__child->getTokenKind() == tokenKind);                        \
@@ -132,6 +133,7 @@ using llvm::FoldingSetNodeID;
 using polar::OwnedString;
 
 class SyntaxArena;
+class RawSyntax;
 using CursorIndex = size_t;
 
 /// Get a numeric index suitable for array/vector indexing
@@ -249,12 +251,129 @@ struct SyntaxPrintOptions
 
 using SyntaxNodeId = unsigned;
 
+/// A read only view of the children of a layout node.
+///
+/// Children are stored either as reference counted pointers or, for nodes of
+/// a compact arena, as 32-bit references into that arena (see
+/// SyntaxArena::setCompactLayoutEnabled). The view hides the difference and
+/// hands out plain pointers, which stay valid as long as the parent is alive.
+class RawSyntaxLayout
+{
+public:
+   class iterator
+         : public llvm::iterator_facade_base<iterator, std::random_access_iterator_tag,
+                                             RawSyntax *, std::ptrdiff_t, RawSyntax **, RawSyntax *>
+   {
+      using BaseType = llvm::iterator_facade_base<iterator, std::random_access_iterator_tag,
+                                                  RawSyntax *, std::ptrdiff_t, RawSyntax **, RawSyntax *>;
+   public:
+      iterator() = default;
+
+      iterator(const RawSyntax *node, size_t index)
+         : m_node(node),
+           m_index(index)
+      {}
+
+      using BaseType::operator-;
+
+      RawSyntax *operator*() const;
+
+      iterator &operator+=(std::ptrdiff_t delta)
+      {
+         m_index += delta;
+         return *this;
+      }
+
+      iterator &operator-=(std::ptrdiff_t delta)
+      {
+         m_index -= delta;
+         return *this;
+      }
+
+      std::ptrdiff_t operator-(const iterator &other) const
+      {
+         return static_cast<std::ptrdiff_t>(m_index) - static_cast<std::ptrdiff_t>(other.m_index);
+      }
+
+      bool operator==(const iterator &other) const
+      {
+         return m_node == other.m_node && m_index == other.m_index;
+      }
+
+      bool operator<(const iterator &other) const
+      {
+         return m_index < other.m_index;
+      }
+
+   private:
+      const RawSyntax *m_node = nullptr;
+      size_t m_index = 0;
+   };
+
+   RawSyntaxLayout() = default;
+
+   RawSyntaxLayout(const RawSyntax *node, size_t first, size_t last)
+      : m_node(node),
+        m_first(first),
+        m_last(last)
+   {}
+
+   iterator begin() const
+   {
+      return {m_node, m_first};
+   }
+
+   iterator end() const
+   {
+      return {m_node, m_last};
+   }
+
+   size_t size() const
+   {
+      return m_last - m_first;
+   }
+
+   bool empty() const
+   {
+      return m_first == m_last;
+   }
+
+   RawSyntax *operator[](size_t index) const
+   {
+      assert(index < size() && "child index out of range");
+      return *(begin() + index);
+   }
+
+   RawSyntaxLayout drop_front(size_t count = 1) const
+   {
+      assert(count <= size() && "dropping more children than the layout has");
+      return {m_node, m_first + count, m_last};
+   }
+
+   RawSyntaxLayout drop_back(size_t count = 1) const
+   {
+      assert(count <= size() && "dropping more children than the layout has");
+      return {m_node, m_first, m_last - count};
+   }
+
+   /// Copy the children into a new layout, suitable for RawSyntax::make.
+   std::vector<RefCountPtr<RawSyntax>> vec() const
+   {
+      return std::vector<RefCountPtr<RawSyntax>>(begin(), end());
+   }
+
+private:
+   const RawSyntax *m_node = nullptr;
+   size_t m_first = 0;
+   size_t m_last = 0;
+};
+
 /// RawSyntax - the strictly immutable, shared backing nodes for all syntax.
 ///
 /// This is implementation detail - do not expose it in public API.
 class RawSyntax final
       : private TrailingObjects<RawSyntax, RefCountPtr<RawSyntax>, OwnedString, std::int64_t, double,
-                                TriviaPiece>
+                                TriviaPiece, std::uint32_t>
 {
 public:
    ~RawSyntax();
@@ -262,8 +381,14 @@ public:
    // This is a copy-pased implementation of llvm::ThreadSafeRefCountedBase with
    // the difference that we do not delete the RawSyntax node's memory if the
    // node was allocated within a SyntaxArena and thus doesn't own its memory.
+   // Nodes owned by a compact arena live as long as the arena, so their
+   // references count on the arena instead.
    void retain() const
    {
+      if (isArenaOwned()) {
+         arena->Retain();
+         return;
+      }
       m_refCount.fetch_add(1, std::memory_order_relaxed);
    }
 
@@ -274,6 +399,14 @@ public:
 
    void release() const
    {
+      if (isArenaOwned()) {
+         // the arena destroys its nodes itself, references that are dropped
+         // on the way must not touch it again
+         if (!arena->m_destroying) {
+            arena->Release();
+         }
+         return;
+      }
       int newRefCount = m_refCount.fetch_sub(1, std::memory_order_acq_rel) - 1;
       assert(newRefCount >= 0 && "Reference count was already zero.");
       if (newRefCount == 0) {
@@ -284,7 +417,10 @@ public:
             // to the arena.
             this->~RawSyntax();
          } else {
-            delete this;
+            // the node was allocated with its trailing objects by a plain
+            // operator new, release exactly that block
+            this->~RawSyntax();
+            ::operator delete(const_cast<RawSyntax *>(this));
          }
       }
    }
@@ -294,6 +430,25 @@ public:
       release();
    }
 
+   /// Retain this node unless its reference count already dropped to zero,
+   /// which happens to interned nodes that are being destroyed while another
+   /// thread finds them in the interning cache.
+   bool tryRetain() const
+   {
+      if (isArenaOwned()) {
+         arena->Retain();
+         return true;
+      }
+      int refCount = m_refCount.load(std::memory_order_relaxed);
+      while (refCount != 0) {
+         if (m_refCount.compare_exchange_weak(refCount, refCount + 1, std::memory_order_acquire,
+                                              std::memory_order_relaxed)) {
+            return true;
+         }
+      }
+      return false;
+   }
+
    /// \name Factory methods.
    /// @{
 
@@ -398,6 +553,34 @@ public:
       return getPresence() == SourcePresence::Present;
    }
 
+   /// Returns true if this node is shared through the interning cache of its
+   /// arena, see SyntaxArena::setInterningEnabled.
+   bool isInterned() const
+   {
+      return m_bits.common.interned;
+   }
+
+   /// The arena this node was allocated in, \c nullptr for nodes that own
+   /// their memory.
+   const SyntaxArena *getArena() const
+   {
+      return arena;
+   }
+
+   /// Returns true if this node was allocated by a compact arena, it is not
+   /// reference counted itself and lives as long as its arena.
+   bool isArenaOwned() const
+   {
+      return m_bits.common.arenaOwned;
+   }
+
+   /// Returns true if the children of this layout node are stored as 32-bit
+   /// references into its arena rather than as pointers.
+   bool hasCompactLayout() const
+   {
+      return m_bits.common.compactLayout;
+   }
+
    /// Returns true if this raw syntax node is some kind of declaration.
    bool isDecl() const
    {
@@ -513,12 +696,9 @@ public:
    /// @{
 
    /// Get the child nodes.
-   ArrayRef<RefCountPtr<RawSyntax>> getLayout() const
+   RawSyntaxLayout getLayout() const
    {
-      if (isToken()) {
-         return {};
-      }
-      return {getTrailingObjects<RefCountPtr<RawSyntax>>(), m_bits.layout.numChildren};
+      return {this, 0, getNumChildren()};
    }
 
    size_t getNumChildren() const
@@ -531,10 +711,7 @@ public:
 
    /// Get a child based on a particular node's "Cursor", indicating
    /// the position of the terms in the production of the Swift grammar.
-   const RefCountPtr<RawSyntax> &getChild(CursorIndex index) const
-   {
-      return getLayout()[index];
-   }
+   RawSyntax *getChild(CursorIndex index) const;
 
    /// Return the number of bytes this node takes when spelled out in the source
    size_t getTextLength()
@@ -596,20 +773,44 @@ public:
    static void profile(FoldingSetNodeID &id, TokenKindType tokenKind, OwnedString text,
                        ArrayRef<TriviaPiece> leadingTrivia,
                        ArrayRef<TriviaPiece> trailingTrivia);
+
+   /// Number of node ids a thread reserves at once.
+   static constexpr SyntaxNodeId NodeIdBlockSize = 1024;
+
 private:
    friend class TrailingObjects;
+   friend class SyntaxArena;
+   friend struct InternedNodeInfo;
 
-   /// The id that shall be used for the next node that is created and does not
-   /// have a manually specified id
-   static SyntaxNodeId sm_nextFreeNodeId;
+   /// The first id of the next block of node ids handed out to a thread.
+   ///
+   /// Threads take \c NodeIdBlockSize ids at once and hand them out from a
+   /// thread local cursor, so creating a node does not touch this shared
+   /// cache line. Ids are unique process wide but nodes created by different
+   /// threads do not get ids in creation order.
+   static std::atomic<SyntaxNodeId> sm_nextFreeNodeId;
+
+   /// Return a fresh node id from the id block of the calling thread.
+   static SyntaxNodeId allocateNodeId();
+
+   /// Make sure the manually specified \p nodeId is not handed out by a
+   /// later allocateNodeId call on any thread. Only the thread whose block
+   /// contains the id drops it. An id which was handed out before still is
+   /// a duplicate, like with a single counter.
+   static void reserveNodeId(SyntaxNodeId nodeId);
 
    /// An id of this node that is stable across incremental parses
    SyntaxNodeId m_nodeId;
 
-   /// If this node was allocated using a \c SyntaxArena's bump allocator, a
-   /// reference to the arena to keep the underlying memory buffer of this node
-   /// alive. If this is a \c nullptr, the node owns its own memory buffer.
-   RefCountPtr<SyntaxArena> arena;
+   /// The reference of this node inside its compact arena, parents with a
+   /// compact layout store it instead of a pointer.
+   std::uint32_t m_arenaRef = SyntaxArena::NullCompactRef;
+
+   /// If this node was allocated using a \c SyntaxArena's bump allocator, the
+   /// arena that owns the underlying memory buffer of this node, retained by
+   /// the node unless it is arena owned. If this is a \c nullptr, the node
+   /// owns its own memory buffer.
+   SyntaxArena *arena = nullptr;
 
    union {
       uint64_t opaqueBits;
@@ -618,8 +819,14 @@ private:
          unsigned kind : polar::bitmax(NumSyntaxKindBits, 8);
          /// Whether this piece of syntax was actually present in the source.
          unsigned presence : 1;
+         /// Whether this node is registered in the interning cache of its arena.
+         unsigned interned : 1;
+         /// Whether this node lives as long as its compact arena.
+         unsigned arenaOwned : 1;
+         /// Whether the children are stored as compact arena references.
+         unsigned compactLayout : 1;
       } common;
-      enum { NumRawSyntaxBits = polar::bitmax(NumSyntaxKindBits, 8) + 1 };
+      enum { NumRawSyntaxBits = polar::bitmax(NumSyntaxKindBits, 8) + 4 };
 
       // For "layout" nodes.
       struct {
@@ -650,7 +857,7 @@ private:
 
    size_t getNumTrailingObjects(OverloadToken<RefCountPtr<RawSyntax>>) const
    {
-      return isToken() ? 0 : m_bits.layout.numChildren;
+      return isToken() || hasCompactLayout() ? 0 : m_bits.layout.numChildren;
    }
 
    size_t numTrailingObjects(OverloadToken<RefCountPtr<RawSyntax>> token) const
@@ -700,15 +907,31 @@ private:
       return getNumTrailingObjects(token);
    }
 
+   size_t getNumTrailingObjects(OverloadToken<std::uint32_t>) const
+   {
+      return !isToken() && hasCompactLayout() ? m_bits.layout.numChildren : 0;
+   }
+
+   size_t numTrailingObjects(OverloadToken<std::uint32_t> token) const
+   {
+      return getNumTrailingObjects(token);
+   }
+
+   /// Number of bytes allocated for this node and its trailing objects.
+   size_t getAllocationSize() const;
+
    /// Constructor for creating layout nodes.
    /// If the node has been allocated inside the bump allocator of a
    /// \c SyntaxArena, that arena must be passed as \p arena to retain the node's
    /// underlying storage.
-   /// If \p nodeId is \c None, the next free nodeId is used, if it is passed,
-   /// the caller needs to assure that the node id has not been used yet.
+   /// If \p nodeId is \c None, a fresh id is taken from allocateNodeId, if it
+   /// is passed, the caller needs to assure that the node id has not been used
+   /// yet (reusing the id of a node from a previous parse is fine).
+   /// If \p compactLayout is true, \p arena must be a compact arena that
+   /// owns all non null children.
    RawSyntax(SyntaxKind kind, ArrayRef<RefCountPtr<RawSyntax>> layout,
              SourcePresence presence, const RefCountPtr<SyntaxArena> &arena,
-             std::optional<SyntaxNodeId> nodeId);
+             bool compactLayout, std::optional<SyntaxNodeId> nodeId);
 
    /// Constructor for creating token nodes
    /// \c SyntaxArena, that arena must be passed as \p arena to retain the node's
@@ -719,20 +942,31 @@ private:
              ArrayRef<TriviaPiece> trailingTrivia, SourcePresence presence,
              const RefCountPtr<SyntaxArena> &arena, std::optional<SyntaxNodeId> nodeId);
 
-   RawSyntax(TokenKindType tokenKind, OwnedString text, std::int64_t value, ArrayRef<TriviaPiece> leadingTrivia,
-             ArrayRef<TriviaPiece> trailingTrivia, SourcePresence presence,
-             const RefCountPtr<SyntaxArena> &arena, std::optional<SyntaxNodeId> nodeId);
-
-   RawSyntax(TokenKindType tokenKind, OwnedString text, double value, ArrayRef<TriviaPiece> leadingTrivia,
-             ArrayRef<TriviaPiece> trailingTrivia, SourcePresence presence,
-             const RefCountPtr<SyntaxArena> &arena, std::optional<SyntaxNodeId> nodeId);
+   /// Shared implementation of the token factory methods, \p intValue and
+   /// \p doubleValue are zero for tokens without a value.
+   static RefCountPtr<RawSyntax> makeToken(TokenKindType tokenKind, OwnedString text,
+                                           std::int64_t intValue, double doubleValue,
+                                           ArrayRef<TriviaPiece> leadingTrivia,
+                                           ArrayRef<TriviaPiece> trailingTrivia,
+                                           SourcePresence presence,
+                                           const RefCountPtr<SyntaxArena> &arena,
+                                           std::optional<SyntaxNodeId> nodeId);
+
+   /// Allocate \p size bytes for a node made in \p arena, \p arenaRef is set
+   /// to the compact reference of the node if the arena is a compact one.
+   static void *allocate(size_t size, const RefCountPtr<SyntaxArena> &arena,
+                         std::uint32_t &arenaRef);
+
+   /// Remove this node from the interning cache of its arena, called when an
+   /// interned node is destroyed.
+   void forgetInterned();
 
    /// Compute the node's text length by summing up the length of its childern
    size_t computeTextLength()
    {
       size_t textLength = 0;
       for (size_t index = 0, numChildren = getNumChildren(); index < numChildren; ++index) {
-         auto &childNode = getChild(index);
+         RawSyntax *childNode = getChild(index);
          if (childNode && !childNode->isMissing()) {
             textLength += childNode->getTextLength();
          }
@@ -743,6 +977,20 @@ private:
    mutable std::atomic<int> m_refCount;
 };
 
+inline RawSyntax *RawSyntax::getChild(CursorIndex index) const
+{
+   assert(index < getNumChildren() && "child index out of range");
+   if (hasCompactLayout()) {
+      return arena->getCompactNode(getTrailingObjects<std::uint32_t>()[index]);
+   }
+   return getTrailingObjects<RefCountPtr<RawSyntax>>()[index].get();
+}
+
+inline RawSyntax *RawSyntaxLayout::iterator::operator*() const
+{
+   return m_node->getChild(m_index);
+}
+
 } // polar::syntax
 
 namespace polar::utils {
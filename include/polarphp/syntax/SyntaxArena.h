@@ -29,21 +29,139 @@
 #ifndef POLARPHP_SYNTAX_SYNTAXARENA_H
 #define POLARPHP_SYNTAX_SYNTAXARENA_H
 
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/Support/Allocator.h"
 
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
 namespace polar::syntax {
 
 using llvm::BumpPtrAllocator;
 using llvm::ThreadSafeRefCountedBase;
 
+class RawSyntax;
+struct InternedTokenKey;
+struct InternedLayoutKey;
+
+/// Hash and equality of the interning cache of SyntaxArena. The cache is
+/// keyed by the nodes themselves and hashes them by content, so no content
+/// hash can clash with the empty or tombstone key. New nodes are looked up
+/// with find_as by an InternedTokenKey or InternedLayoutKey describing the
+/// node before it is made, see RawSyntax.cpp.
+struct InternedNodeInfo
+{
+   static RawSyntax *getEmptyKey()
+   {
+      return llvm::DenseMapInfo<RawSyntax *>::getEmptyKey();
+   }
+
+   static RawSyntax *getTombstoneKey()
+   {
+      return llvm::DenseMapInfo<RawSyntax *>::getTombstoneKey();
+   }
+
+   static unsigned getHashValue(const RawSyntax *node);
+   static unsigned getHashValue(const InternedTokenKey &key);
+   static unsigned getHashValue(const InternedLayoutKey &key);
+
+   /// Nodes are compared by identity, so an identical node made while an
+   /// older one waits to be removed gets an entry of its own.
+   static bool isEqual(const RawSyntax *lhs, const RawSyntax *rhs)
+   {
+      return lhs == rhs;
+   }
+
+   static bool isEqual(const InternedTokenKey &key, const RawSyntax *node);
+   static bool isEqual(const InternedLayoutKey &key, const RawSyntax *node);
+};
+
 /// Memory manager for Syntax nodes.
 class SyntaxArena : public ThreadSafeRefCountedBase<SyntaxArena>
 {
 public:
+   /// Counters of the node interning cache, see setInterningEnabled.
+   struct InternStats
+   {
+      size_t tokenHits = 0;
+      size_t tokenMisses = 0;
+      size_t layoutHits = 0;
+      size_t layoutMisses = 0;
+      /// Bytes of node storage that were not allocated because an identical
+      /// node was shared instead.
+      size_t bytesSaved = 0;
+   };
+
+   /// A compact reference to a node owned by this arena: the slab index in
+   /// the high bits and the offset into the slab, in CompactUnit steps, in
+   /// the low bits.
+   static constexpr std::uint32_t NullCompactRef = UINT32_MAX;
+   static constexpr unsigned CompactOffsetBits = 15;
+   static constexpr size_t CompactUnit = 8;
+   static constexpr size_t CompactSlabSize = (size_t(1) << CompactOffsetBits) * CompactUnit;
+
    SyntaxArena()
    {}
 
+   /// Destroys the nodes owned by a compact arena.
+   ~SyntaxArena();
+
+   /// Make the arena own every node made in it: the nodes are not reference
+   /// counted themselves, a reference to one of them retains the arena, and
+   /// they are destroyed together with the arena. Layout nodes whose
+   /// children belong to the same arena store them as 32-bit references
+   /// instead of pointers, which halves the child arrays and saves the
+   /// atomic reference count updates when trees are built and copied.
+   ///
+   /// Memory of single nodes is never given back before the arena dies, so
+   /// this is meant for trees that are built once and dropped as a whole,
+   /// like a parse of a file. It must be chosen before the first node is
+   /// made in the arena. Like the allocator, the node slabs are not thread
+   /// safe, nodes of one arena must be made by one thread at a time.
+   void setCompactLayoutEnabled(bool enabled)
+   {
+      assert(m_compactSlabs.empty() && m_bytesUsed == 0 &&
+             "the layout must be chosen before nodes are made");
+      m_compactLayoutEnabled = enabled;
+   }
+
+   bool isCompactLayoutEnabled() const
+   {
+      return m_compactLayoutEnabled;
+   }
+
+   /// Bytes of node storage handed out by this arena.
+   size_t getBytesUsed() const
+   {
+      return m_bytesUsed;
+   }
+
+   /// Share identical immutable nodes made in this arena instead of
+   /// allocating them again: present tokens with the same kind, text and
+   /// trivia, and layout nodes whose children are all shared nodes.
+   ///
+   /// Shared nodes keep a single node id, so trees built this way must not be
+   /// fed to incremental parsing, which identifies reused nodes by id.
+   void setInterningEnabled(bool enabled)
+   {
+      m_interningEnabled = enabled;
+   }
+
+   bool isInterningEnabled() const
+   {
+      return m_interningEnabled;
+   }
+
+   InternStats getInternStats() const
+   {
+      std::lock_guard<std::mutex> lock(m_internMutex);
+      return m_internStats;
+   }
+
    BumpPtrAllocator &getAllocator()
    {
       return m_allocator;
@@ -51,13 +169,53 @@ public:
 
    void *allocate(size_t size, size_t alignment)
    {
+      m_bytesUsed += size;
       return m_allocator.Allocate(size, alignment);
    }
 
 private:
    SyntaxArena(const SyntaxArena &) = delete;
    void operator=(const SyntaxArena &) = delete;
+
+   struct CompactSlab
+   {
+      char *begin;
+      size_t used;
+      size_t size;
+   };
+
+   /// Allocate \p size bytes of node storage from the compact slabs and set
+   /// \p ref to the compact reference of the result.
+   void *allocateCompact(size_t size, std::uint32_t &ref);
+
+   RawSyntax *getCompactNode(std::uint32_t ref) const
+   {
+      if (ref == NullCompactRef) {
+         return nullptr;
+      }
+      const CompactSlab &slab = m_compactSlabs[ref >> CompactOffsetBits];
+      return reinterpret_cast<RawSyntax *>(
+               slab.begin + (ref & ((std::uint32_t(1) << CompactOffsetBits) - 1)) * CompactUnit);
+   }
+
    BumpPtrAllocator m_allocator;
+   size_t m_bytesUsed = 0;
+   bool m_compactLayoutEnabled = false;
+   /// Set while the arena destroys its own nodes.
+   bool m_destroying = false;
+   /// Compact slabs hold nothing but arena owned nodes, back to back, so the
+   /// arena can walk them when it dies. A node too large for a regular slab
+   /// gets a slab of its own.
+   std::vector<CompactSlab> m_compactSlabs;
+
+   /// RawSyntax looks up and registers interned nodes itself, the nodes are
+   /// not retained by the arena, a node removes itself when it is destroyed.
+   /// It also allocates and resolves the compact nodes.
+   friend class RawSyntax;
+   bool m_interningEnabled = false;
+   mutable std::mutex m_internMutex;
+   llvm::DenseSet<RawSyntax *, InternedNodeInfo> m_internedNodes;
+   InternStats m_internStats;
 };
 
 } // polar::syntax
@@ -153,7 +153,7 @@ public:
    SyntaxCollection<collectionKind, Element> removingLast() const
    {
       assert(!empty());
-      auto newLayout = getRaw()->getLayout().drop_back();
+      auto newLayout = getRaw()->getLayout().drop_back().vec();
       auto raw = RawSyntax::make(collectionKind, newLayout, getRaw()->getPresence());
       return m_data->replaceSelf<SyntaxCollection<collectionKind, Element>>(raw);
    }
@@ -176,7 +176,7 @@ public:
    SyntaxCollection<collectionKind, Element> removingFirst() const
    {
       assert(!empty());
-      auto newLayout = getRaw()->getLayout().drop_front();
+      auto newLayout = getRaw()->getLayout().drop_front().vec();
       auto raw = RawSyntax::make(collectionKind, newLayout, getRaw()->getPresence());
       return m_data->replaceSelf<SyntaxCollection<collectionKind, Element>>(raw);
    }
@@ -205,7 +205,7 @@ public:
    SyntaxCollection<collectionKind, Element> removing(size_t i) const
    {
       assert(i <= size());
-      std::vector<RefCountPtr<RawSyntax>> newLayout = getRaw()->getLayout();
+      std::vector<RefCountPtr<RawSyntax>> newLayout = getRaw()->getLayout().vec();
       auto iterator = newLayout.begin();
       std::advance(iterator, i);
       newLayout.erase(iterator);
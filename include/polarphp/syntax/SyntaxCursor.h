@@ -0,0 +1,122 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/11/20.
+
+#ifndef POLARPHP_SYNTAX_SYNTAX_CURSOR_H
+#define POLARPHP_SYNTAX_SYNTAX_CURSOR_H
+
+#include "polarphp/syntax/RawSyntax.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace polar::syntax {
+
+/// A cursor that walks a RawSyntax tree in source order.
+///
+/// Whole tree passes do not need the parented SyntaxData nodes, which cost
+/// an allocation and an atomic compare-and-swap for every child they
+/// realize. The cursor walks the shared raw nodes directly and keeps the
+/// absolute position up to date as it goes, so it can report positions
+/// without walking back up to the root.
+///
+/// Every present or missing node is reported twice: once when the cursor
+/// enters it and once when it leaves it, null children are skipped.
+///
+/// \code
+///   RawSyntaxCursor cursor(root);
+///   while (cursor.advance()) {
+///      if (cursor.isEntering()) {
+///         ...
+///      }
+///   }
+/// \endcode
+class RawSyntaxCursor
+{
+public:
+   /// Walk the tree under \p root, \p position is the absolute position
+   /// of \p root before its leading trivia.
+   explicit RawSyntaxCursor(const RawSyntax *root,
+                            AbsolutePosition position = AbsolutePosition())
+      : m_root(root),
+        m_position(position)
+   {}
+
+   /// Move to the next enter or leave event, returns false when the whole
+   /// tree was walked.
+   bool advance();
+
+   /// Do not descend into the node that was just entered, the next advance
+   /// leaves it. The position is still moved past its text.
+   void skipChildren();
+
+   /// Returns true if the cursor just entered the current node.
+   bool isEntering() const
+   {
+      return m_entering;
+   }
+
+   /// Returns true if the cursor is about to leave the current node.
+   bool isLeaving() const
+   {
+      return !m_entering;
+   }
+
+   const RawSyntax *getNode() const
+   {
+      assert(!m_stack.empty() && "cursor is not on a node");
+      return m_stack.back().node;
+   }
+
+   /// The parent of the current node, \c nullptr for the root.
+   const RawSyntax *getParent() const
+   {
+      assert(!m_stack.empty() && "cursor is not on a node");
+      return m_stack.size() > 1 ? m_stack[m_stack.size() - 2].node : nullptr;
+   }
+
+   /// The index of the current node in the layout of its parent, 0 for the
+   /// root.
+   CursorIndex getIndexInParent() const
+   {
+      assert(!m_stack.empty() && "cursor is not on a node");
+      return m_stack.size() > 1 ? m_stack[m_stack.size() - 2].nextChild - 1 : 0;
+   }
+
+   /// Number of ancestors of the current node inside the walked tree.
+   size_t getDepth() const
+   {
+      assert(!m_stack.empty() && "cursor is not on a node");
+      return m_stack.size() - 1;
+   }
+
+   /// When entering, the position of the current node before its leading
+   /// trivia. When leaving, the position after its trailing trivia.
+   const AbsolutePosition &getPosition() const
+   {
+      return m_position;
+   }
+
+private:
+   struct Frame
+   {
+      const RawSyntax *node;
+      /// Index of the next child to look at.
+      size_t nextChild;
+   };
+
+   const RawSyntax *m_root;
+   AbsolutePosition m_position;
+   llvm::SmallVector<Frame, 16> m_stack;
+   bool m_started = false;
+   bool m_entering = false;
+};
+
+} // polar::syntax
+
+#endif // POLARPHP_SYNTAX_SYNTAX_CURSOR_H
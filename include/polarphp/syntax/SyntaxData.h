@@ -292,7 +292,7 @@ private:
    /// DO NOT expose this as public API.
    RefCountPtr<SyntaxData> realizeSyntaxNode(CursorIndex index) const
    {
-      if (auto &rawChild = m_raw->getChild(index)) {
+      if (RawSyntax *rawChild = m_raw->getChild(index)) {
          return SyntaxData::make(rawChild, this, index);
       }
       return nullptr;
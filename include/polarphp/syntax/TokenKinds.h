@@ -15,6 +15,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "polarphp/syntax/internal/TokenEnumDefs.h"
 #include <map>
+#include <optional>
 
 namespace llvm {
 class raw_ostream;
@@ -58,6 +59,13 @@ bool is_expr_keyword_token(TokenKindType kind);
 bool is_punctuator_token(TokenKindType kind);
 bool is_misc_token(TokenKindType kind);
 
+/// The code of a token kind in serialized token streams. The codes are fixed
+/// by the token definitions, streams stay readable when the enumerators of
+/// TokenKindType change.
+unsigned get_token_serialization_code(TokenKindType kind);
+/// The token kind with serialization code \p code, if there is one.
+std::optional<TokenKindType> get_token_kind_for_serialization_code(unsigned code);
+
 } // polar::syntax
 
 #endif // POLAR_SYNTAX_TOKEN_KINDS_H
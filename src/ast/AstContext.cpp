@@ -59,6 +59,7 @@
 #include "llvm/Support/Compiler.h"
 #include <algorithm>
 #include <memory>
+#include <mutex>
 
 namespace polar {
 
@@ -176,6 +177,10 @@ struct AstContext::Implementation {
    llvm::StringMap<Identifier::Aligner, llvm::BumpPtrAllocator &>
       IdentifierTable;
 
+   /// Guards IdentifierTable, PIL function passes on several threads may
+   /// create identifiers at the same time.
+   std::mutex IdentifierTableLock;
+
    /// The declaration of Swift.AssignmentPrecedence.
    PrecedenceGroupDecl *AssignmentPrecedence = nullptr;
 
@@ -655,6 +660,7 @@ Identifier AstContext::getIdentifier(StringRef Str) const {
       return Identifier(nullptr);
 
    auto pair = std::make_pair(Str, Identifier::Aligner());
+   std::lock_guard<std::mutex> lock(getImpl().IdentifierTableLock);
    auto I = getImpl().IdentifierTable.insert(pair).first;
    return Identifier(I->getKeyData());
 }
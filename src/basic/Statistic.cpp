@@ -23,6 +23,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/YAMLParser.h"
 #include "llvm/Support/raw_ostream.h"
 #include <chrono>
 #include <limits>
@@ -98,6 +99,12 @@ makeProfileDirName(StringRef ProgramName,
    return makeFileName("profile", ProgramName, AuxName, "dir");
 }
 
+static std::string
+makeChromeTraceFileName(StringRef ProgramName,
+                        StringRef AuxName) {
+   return makeFileName("trace-events", ProgramName, AuxName, "json");
+}
+
 // LLVM's statistics-reporting machinery is sensitive to filenames containing
 // YAML-quote-requiring characters, which occur surprisingly often in the wild;
 // we only need a recognizable and likely-unique name for a target here, not an
@@ -385,7 +392,12 @@ UnifiedStatsReporter::UnifiedStatsReporter(StringRef ProgramName,
      StatsFilename(Directory),
      TraceFilename(Directory),
      ProfileDirname(Directory),
+     ChromeTraceFilename(Directory),
+     OutputDirname(Directory),
+     ProgramName(ProgramName),
+     AuxName(AuxName),
      StartedTime(llvm::TimeRecord::getCurrentTime()),
+     StartedSteadyTime(std::chrono::steady_clock::now()),
      MainThreadID(std::this_thread::get_id()),
      Timer(std::make_unique<NamedRegionTimer>(AuxName,
                                               "Building Target",
@@ -397,12 +409,16 @@ UnifiedStatsReporter::UnifiedStatsReporter(StringRef ProgramName,
    path::append(StatsFilename, makeStatsFileName(ProgramName, AuxName));
    path::append(TraceFilename, makeTraceFileName(ProgramName, AuxName));
    path::append(ProfileDirname, makeProfileDirName(ProgramName, AuxName));
+   path::append(ChromeTraceFilename,
+                makeChromeTraceFileName(ProgramName, AuxName));
    EnableStatistics(/*PrintOnExit=*/false);
    SharedTimer::enableCompilationTimers();
    if (TraceEvents || ProfileEvents || ProfileEntities)
       LastTracedFrontendCounters.emplace();
-   if (TraceEvents)
+   if (TraceEvents) {
       FrontendStatsEvents.emplace();
+      ChromeTraceEvents.emplace();
+   }
    if (ProfileEvents)
       EventProfilers = std::make_unique<StatsProfilers>();
    if (ProfileEntities)
@@ -433,6 +449,58 @@ int64_t UnifiedStatsReporter::getChildrenMaxResidentSetSize() {
 #endif
 }
 
+uint64_t UnifiedStatsReporter::getTraceTimeUSec() const {
+   auto Elapsed = std::chrono::steady_clock::now() - StartedSteadyTime;
+   return std::chrono::duration_cast<std::chrono::microseconds>(Elapsed)
+      .count();
+}
+
+void UnifiedStatsReporter::recordChromeTraceEvent(ChromeTraceEvent E) {
+   std::lock_guard<std::mutex> Lock(ChromeTraceEventsMutex);
+   if (ChromeTraceEvents)
+      ChromeTraceEvents->push_back(std::move(E));
+}
+
+std::string
+UnifiedStatsReporter::makeOutputFileName(StringRef Prefix,
+                                         StringRef Suffix) const {
+   SmallString<128> Path(OutputDirname);
+   path::append(Path, makeFileName(Prefix, ProgramName, AuxName, Suffix));
+   return Path.str().str();
+}
+
+void UnifiedStatsReporter::printChromeTraceEvents(
+   ArrayRef<ChromeTraceEvent> Events, raw_ostream &OS) {
+   OS << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+   bool First = true;
+   for (auto const &E : Events) {
+      OS << (First ? "\n" : ",\n");
+      First = false;
+      OS << "{\"name\": \"" << llvm::yaml::escape(E.Name) << "\", "
+         << "\"cat\": \"" << llvm::yaml::escape(E.Category) << "\", "
+         << "\"ph\": \"X\", \"pid\": 0, "
+         << "\"tid\": " << E.ThreadIndex << ", "
+         << "\"ts\": " << E.StartUSec << ", "
+         << "\"dur\": " << E.DurationUSec;
+      if (!E.EntityName.empty() || !E.Args.empty()) {
+         OS << ", \"args\": {";
+         bool FirstArg = true;
+         if (!E.EntityName.empty()) {
+            OS << "\"entity\": \"" << llvm::yaml::escape(E.EntityName) << '"';
+            FirstArg = false;
+         }
+         for (auto const &Arg : E.Args) {
+            OS << (FirstArg ? "" : ", ") << '"' << Arg.first << "\": "
+               << Arg.second;
+            FirstArg = false;
+         }
+         OS << '}';
+      }
+      OS << '}';
+   }
+   OS << "\n]}\n";
+}
+
 UnifiedStatsReporter::AlwaysOnDriverCounters &
 UnifiedStatsReporter::getDriverCounters()
 {
@@ -754,8 +822,27 @@ UnifiedStatsReporter::~UnifiedStatsReporter()
    flushTracesAndProfiles();
 }
 
+void
+UnifiedStatsReporter::flushChromeTraceEvents() {
+   std::lock_guard<std::mutex> Lock(ChromeTraceEventsMutex);
+   if (!ChromeTraceEvents)
+      return;
+   if (!ChromeTraceEvents->empty()) {
+      std::error_code EC;
+      raw_fd_ostream tstream(ChromeTraceFilename, EC, fs::F_Text);
+      if (EC) {
+         llvm::errs() << "Error opening -trace-stats-events file '"
+                      << ChromeTraceFilename << "' for writing\n";
+      } else {
+         printChromeTraceEvents(*ChromeTraceEvents, tstream);
+      }
+   }
+   ChromeTraceEvents.reset();
+}
+
 void
 UnifiedStatsReporter::flushTracesAndProfiles() {
+   flushChromeTraceEvents();
    if (FrontendStatsEvents && SourceMgr) {
       std::error_code EC;
       raw_fd_ostream tstream(TraceFilename, EC, fs::F_Append | fs::F_Text);
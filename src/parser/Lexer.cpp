@@ -25,6 +25,7 @@
 #include <set>
 #include <string>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 
 namespace polar::parser {
@@ -80,6 +81,8 @@ Lexer::Lexer(Lexer &parent, LexerState beginState, LexerState endState)
            parent.m_bufferId, parent.m_diags, parent.m_commentRetention,
            parent.m_triviaRetention)
 {
+   // tokens of the sub-lexer live as long as the tokens of the parent
+   m_valueAllocator = parent.m_valueAllocator;
    assert(m_bufferId == m_sourceMgr.findBufferContainingLoc(beginState.m_loc) &&
           "LexerState for the wrong buffer");
    assert(m_bufferId == m_sourceMgr.findBufferContainingLoc(endState.m_loc) &&
@@ -162,6 +165,7 @@ Token Lexer::getTokenAt(SourceLoc loc)
    Lexer lexer(m_langOpts, m_sourceMgr, m_bufferId, m_diags,
                CommentRetentionMode::None,
                TriviaRetentionMode::WithoutTrivia);
+   lexer.setTokenValueAllocator(*m_valueAllocator);
    lexer.restoreState(LexerState(loc));
    return lexer.peekNextToken();
 }
@@ -222,10 +226,18 @@ void Lexer::formErrorToken(const unsigned char *tokenStart)
 {
    formToken(TokenKindType::T_ERROR, tokenStart);
    if (!m_currentExceptionMsg.empty()) {
-      m_nextToken.setValue(m_currentExceptionMsg);
+      m_nextToken.setValue(saveTokenValue(m_currentExceptionMsg));
    }
 }
 
+StringRef Lexer::saveTokenValue(StringRef value)
+{
+   char *buffer = m_valueAllocator->Allocate<char>(value.size() + 1);
+   std::memcpy(buffer, value.data(), value.size());
+   buffer[value.size()] = '\0';
+   return StringRef(buffer, value.size());
+}
+
 void Lexer::lexTrivia(ParsedTrivia &trivia, bool isForTrailingTrivia)
 {
 restart:
@@ -251,11 +263,20 @@ restart:
       }
       goto restart;
    case ' ':
-      trivia.appendOrSquash(TriviaKind::Space, 1);
+   {
+      // indentation comes in runs, consume the whole run at once
+      size_t length = 1 + count_leading_byte(m_yyCursor, m_bufferEnd, ' ');
+      m_yyCursor = triviaStart + length;
+      trivia.appendOrSquash(TriviaKind::Space, length);
       goto restart;
+   }
    case '\t':
-      trivia.appendOrSquash(TriviaKind::Tab, 1);
+   {
+      size_t length = 1 + count_leading_byte(m_yyCursor, m_bufferEnd, '\t');
+      m_yyCursor = triviaStart + length;
+      trivia.appendOrSquash(TriviaKind::Tab, length);
       goto restart;
+   }
    case '\v':
       trivia.appendOrSquash(TriviaKind::VerticalTab, 1);
       goto restart;
@@ -736,20 +757,18 @@ void Lexer::lexSingleQuoteString()
          return;
       }
    }
-   std::string strValue;
    // '0b', '\'' and '\''
-   if (m_yyLength - bprefix - 2 <= 1) {
-      if (m_yyLength - bprefix - 2 == 1) {
-         unsigned char c = *(yytext + bprefix + 1);
-         strValue.push_back(c);
-      }
+   StringRef rawValue(reinterpret_cast<const char *>(m_yyText + bprefix + 1), m_yyLength - bprefix - 2);
+   formToken(TokenKindType::T_CONSTANT_ENCAPSED_STRING);
+   if (rawValue.size() <= 1 || rawValue.find('\\') == StringRef::npos) {
+      // nothing to unescape, reference the source buffer directly
+      m_nextToken.setValue(rawValue);
    } else {
-      strValue.append(reinterpret_cast<const char *>(m_yyText + bprefix + 1), m_yyLength - bprefix - 2);
+      std::string strValue(rawValue.data(), rawValue.size());
       long filteredLength = convert_single_quote_str_escape_sequences(strValue.begin(), strValue.end(), *this);
       strValue.resize(filteredLength);
+      m_nextToken.setValue(saveTokenValue(strValue));
    }
-   formToken(TokenKindType::T_CONSTANT_ENCAPSED_STRING);
-   m_nextToken.setValue(strValue);
    return;
 }
 
@@ -792,12 +811,19 @@ void Lexer::lexDoubleQuoteString()
       break;
    }
    m_yyLength = yycursor - yytext;
-   std::string filteredStr(reinterpret_cast<const char *>(yytext), m_yyLength);
+   StringRef rawValue(reinterpret_cast<const char *>(yytext), m_yyLength);
+   if (rawValue.find('\\') == StringRef::npos) {
+      // without escape sequences the value is a slice of the source buffer
+      formToken(TokenKindType::T_CONSTANT_ENCAPSED_STRING);
+      m_nextToken.setValue(rawValue);
+      return;
+   }
+   std::string filteredStr(rawValue.data(), rawValue.size());
    if (convert_double_quote_str_escape_sequences(filteredStr, '"', filteredStr.begin(),
                                                  filteredStr.end(), *this) ||
        !isInParseMode()) {
       formToken(TokenKindType::T_CONSTANT_ENCAPSED_STRING);
-      m_nextToken.setValue(filteredStr);
+      m_nextToken.setValue(saveTokenValue(filteredStr));
    } else {
       formToken(TokenKindType::T_ERROR);
    }
@@ -847,11 +873,17 @@ void Lexer::lexBackquote()
    }
 
    m_yyLength = yycursor - yytext;
-   std::string filteredStr(reinterpret_cast<const char *>(yytext), m_yyLength);
+   StringRef rawValue(reinterpret_cast<const char *>(yytext), m_yyLength);
+   if (rawValue.find('\\') == StringRef::npos) {
+      formToken(TokenKindType::T_ENCAPSED_AND_WHITESPACE, yytext);
+      m_nextToken.setValue(rawValue);
+      return;
+   }
+   std::string filteredStr(rawValue.data(), rawValue.size());
    if (convert_double_quote_str_escape_sequences(filteredStr, '`', filteredStr.begin(), filteredStr.end(), *this) ||
        !isInParseMode()) {
       formToken(TokenKindType::T_ENCAPSED_AND_WHITESPACE, yytext);
-      m_nextToken.setValue(filteredStr);
+      m_nextToken.setValue(saveTokenValue(filteredStr));
    } else {
       formToken(TokenKindType::T_ERROR, yytext);
    }
@@ -1132,7 +1164,7 @@ void Lexer::lexHeredocBody()
       }
    }
    formToken(TokenKindType::T_ENCAPSED_AND_WHITESPACE);
-   m_nextToken.setValue(filteredStr);
+   m_nextToken.setValue(saveTokenValue(filteredStr));
 }
 
 void Lexer::lexNowdocBody()
@@ -1219,7 +1251,7 @@ void Lexer::lexNowdocBody()
       }
    }
    formToken(TokenKindType::T_ENCAPSED_AND_WHITESPACE, yytext);
-   m_nextToken.setValue(filteredStr);
+   m_nextToken.setValue(saveTokenValue(filteredStr));
 }
 
 void Lexer::lexHereAndNowDocEnd()
@@ -1228,7 +1260,7 @@ void Lexer::lexHereAndNowDocEnd()
    if (m_nextToken.getKind() == TokenKindType::T_START_HEREDOC) {
       setYYLength(0);
       formToken(TokenKindType::T_ENCAPSED_AND_WHITESPACE, getYYText() - 1);
-      m_nextToken.setValue("");
+      m_nextToken.setValue(StringRef(""));
       setYYCursor(getYYText());
       return;
    }
@@ -1503,6 +1535,7 @@ SourceLoc Lexer::getLocForEndOfLine(SourceManager &sourceMgr, SourceLoc loc)
 
 std::vector<Token> tokenize(const LangOptions &langOpts,
                             const SourceManager &sourceMgr, unsigned bufferId,
+                            llvm::BumpPtrAllocator &valueAllocator,
                             unsigned offset, unsigned endOffset,
                             DiagnosticEngine *diags,
                             bool keepComments)
@@ -1514,7 +1547,8 @@ std::vector<Token> tokenize(const LangOptions &langOpts,
                          : CommentRetentionMode::AttachToNextToken,
             TriviaRetentionMode::WithoutTrivia,
             [&](const Lexer &lexer, const Token &token, const ParsedTrivia &leadingTrivia,
-            const ParsedTrivia &trailingTrivia) { tokens.push_back(token); });
+            const ParsedTrivia &trailingTrivia) { tokens.push_back(token); },
+            [&](Lexer &lexer) { lexer.setTokenValueAllocator(valueAllocator); });
    assert(tokens.back().is(TokenKindType::END));
    tokens.pop_back(); // Remove EOF.
    return tokens;
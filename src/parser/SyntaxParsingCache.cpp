@@ -23,8 +23,11 @@
 #include "polarphp/parser/SyntaxParsingCache.h"
 #include "polarphp/syntax/SyntaxNodeVisitor.h"
 
+#include <algorithm>
+
 namespace polar::parser {
 
+using polar::syntax::RawSyntaxCursor;
 using polar::syntax::SyntaxNodeVisitor;
 
 void SyntaxParsingCache::addEdit(size_t start, size_t end,
@@ -32,7 +35,11 @@ void SyntaxParsingCache::addEdit(size_t start, size_t end,
 {
    assert((m_edits.empty() || m_edits.back().end <= start) &&
           "'start' must be greater than or equal to 'end' of the previous edit");
+   std::ptrdiff_t shift = m_editShifts.empty() ? 0 : m_editShifts.back();
    m_edits.emplace_back(start, end, replacementLength);
+   m_postEditStarts.push_back(start + shift);
+   m_editShifts.push_back(shift + static_cast<std::ptrdiff_t>(replacementLength) -
+                          static_cast<std::ptrdiff_t>(end - start));
 }
 
 bool SyntaxParsingCache::nodeCanBeReused(const Syntax &node, size_t nodeStart,
@@ -67,17 +74,44 @@ bool SyntaxParsingCache::nodeCanBeReused(const Syntax &node, size_t nodeStart,
       }
    }
 
+   // Check if this node or the trivia of the next node has been edited. If it
+   // has, we cannot reuse it. m_edits are sorted and do not overlap, so both
+   // their starts and ends are ascending, the first edit that ends at or after
+   // the node is the only one that needs to be checked.
    auto nodeEnd = nodeStart + node.getTextLength();
-   for (auto edit : m_edits) {
-      // Check if this node or the trivia of the next node has been edited. If it
-      // has, we cannot reuse it.
-      if (edit.intersectsOrTouchesRange(nodeStart, nodeEnd + nextLeafNodeLength)) {
-         return false;
-      }
+   auto edit = std::lower_bound(m_edits.begin(), m_edits.end(), nodeStart,
+                                [](const SourceEdit &item, size_t rangeStart) {
+      return item.end < rangeStart;
+   });
+   if (edit != m_edits.end() &&
+       edit->intersectsOrTouchesRange(nodeStart, nodeEnd + nextLeafNodeLength)) {
+      return false;
    }
    return true;
 }
 
+ArrayRef<size_t> SyntaxParsingCache::getChildStartOffsets(const RawSyntax *node)
+{
+   auto &offsets = m_childStartOffsets[node];
+   if (!offsets.empty()) {
+      return offsets;
+   }
+   RawSyntax *rawNode = const_cast<RawSyntax *>(node);
+   size_t numChildren = rawNode->getNumChildren();
+   offsets.reserve(numChildren + 1);
+   size_t childStart = 0;
+   for (size_t index = 0; index < numChildren; ++index) {
+      offsets.push_back(childStart);
+      RawSyntax *child = rawNode->getChild(index);
+      if (child && !child->isMissing()) {
+         // The next child starts where the previous child ended
+         childStart += child->getTextLength();
+      }
+   }
+   offsets.push_back(childStart);
+   return offsets;
+}
+
 std::optional<Syntax> SyntaxParsingCache::lookUpFrom(const Syntax &node,
                                                      size_t nodeStart,
                                                      size_t position,
@@ -87,21 +121,23 @@ std::optional<Syntax> SyntaxParsingCache::lookUpFrom(const Syntax &node,
       return node;
    }
 
-   // Compute the child's position on the fly
-   size_t childStart = nodeStart;
-   for (size_t I = 0, E = node.getNumChildren(); I < E; ++I) {
-      std::optional<Syntax> child = node.getChild(I);
-      if (!child.has_value() || child->isMissing()) {
-         continue;
-      }
-      auto childEnd = childStart + child->getTextLength();
-      if (childStart <= position && position < childEnd) {
-         return lookUpFrom(child.value(), childStart, position, kind);
-      }
-      // The next child starts where the previous child ended
-      childStart = childEnd;
+   if (position < nodeStart) {
+      return std::nullopt;
    }
-   return std::nullopt;
+   // The child containing position is the last one that starts at or before
+   // it, children without text share their start with the next child and are
+   // never picked because the upper bound skips past them
+   ArrayRef<size_t> offsets = getChildStartOffsets(node.getRaw().get());
+   size_t relativePosition = position - nodeStart;
+   auto nextStart = std::upper_bound(offsets.begin(), offsets.end(), relativePosition);
+   if (nextStart == offsets.begin() || nextStart == offsets.end()) {
+      return std::nullopt;
+   }
+   size_t index = static_cast<size_t>(nextStart - offsets.begin()) - 1;
+   std::optional<Syntax> child = node.getChild(index);
+   assert(child.has_value() && !child->isMissing() &&
+          "a child that covers text must be present");
+   return lookUpFrom(child.value(), nodeStart + offsets[index], position, kind);
 }
 
 std::optional<size_t>
@@ -124,10 +160,29 @@ SyntaxParsingCache::translateToPreEditPosition(size_t postEditPosition,
    return position;
 }
 
+std::optional<size_t>
+SyntaxParsingCache::translateToPreEditPosition(size_t postEditPosition) const
+{
+   // m_postEditStarts is ascending, see translateToPreEditPosition above for
+   // the linear version of this walk
+   auto nextEdit = std::upper_bound(m_postEditStarts.begin(), m_postEditStarts.end(),
+                                    postEditPosition);
+   if (nextEdit == m_postEditStarts.begin()) {
+      return postEditPosition;
+   }
+   size_t index = static_cast<size_t>(nextEdit - m_postEditStarts.begin()) - 1;
+   if (m_postEditStarts[index] + m_edits[index].replacementLength > postEditPosition) {
+      // This is a position inserted by the edit, and thus doesn't exist in the
+      // pre-edit version of the file.
+      return std::nullopt;
+   }
+   return static_cast<size_t>(static_cast<std::ptrdiff_t>(postEditPosition) - m_editShifts[index]);
+}
+
 std::optional<Syntax> SyntaxParsingCache::lookUp(size_t newPosition,
                                                  SyntaxKind kind)
 {
-   std::optional<size_t> oldPosition = translateToPreEditPosition(newPosition, m_edits);
+   std::optional<size_t> oldPosition = translateToPreEditPosition(newPosition);
    if (!oldPosition.has_value()) {
       return std::nullopt;
    }
@@ -159,24 +214,25 @@ SyntaxParsingCache::getReusedRegions(const SourceFileSyntax &SyntaxTree) const
 
       const std::vector<SyntaxReuseRegion> &getReusedRegions()
       {
-         std::sort(m_reusedRegions.begin(), m_reusedRegions.end(),
-                   [](const SyntaxReuseRegion &lhs,
-                   const SyntaxReuseRegion &rhs) -> bool
-         {
-            return lhs.start.getOffset() < rhs.start.getOffset();
-         });
+         // the walk runs in source order, the regions are already sorted
          return m_reusedRegions;
       }
 
-      void visit(Syntax node) override
+      bool enter(const RawSyntaxCursor &cursor) override
+      {
+         if (!didReuseNode(cursor.getNode()->getId())) {
+            return true;
+         }
+         // node has been reused, add it to the list, the end position is
+         // known once the cursor leaves it
+         m_reusedRegions.push_back({cursor.getPosition(), cursor.getPosition()});
+         return false;
+      }
+
+      void leave(const RawSyntaxCursor &cursor) override
       {
-         if (didReuseNode(node.getId())) {
-            // node has been reused, add it to the list
-            auto start = node.getAbsolutePositionBeforeLeadingTrivia();
-            auto end = node.getAbsoluteEndPositionAfterTrailingTrivia();
-            m_reusedRegions.push_back({start, end});
-         } else {
-            SyntaxNodeVisitor::visit(node);
+         if (didReuseNode(cursor.getNode()->getId())) {
+            m_reusedRegions.back().end = cursor.getPosition();
          }
       }
 
@@ -184,7 +240,7 @@ SyntaxParsingCache::getReusedRegions(const SourceFileSyntax &SyntaxTree) const
       {
          assert(m_reusedRegions.empty() &&
                 "ReusedRegionsCollector cannot be reused");
-         node.accept(*this);
+         walk(node);
       }
    };
 
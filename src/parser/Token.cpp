@@ -41,7 +41,7 @@ void Token::dump(raw_ostream &outStream) const
          if (m_kind == TokenKindType::T_VARIABLE){
             outStream << '$';
          }
-         outStream << getValue<std::string>() << "\n";
+         outStream << getValue<StringRef>() << "\n";
       } else if (m_kind == TokenKindType::T_LNUMBER) {
          outStream << "value: ";
          outStream << getValue<std::int64_t>() << "\n";
@@ -50,12 +50,12 @@ void Token::dump(raw_ostream &outStream) const
          outStream << getValue<double>() << "\n";
       } else if (m_kind == TokenKindType::T_CONSTANT_ENCAPSED_STRING ||
                  m_kind == TokenKindType::T_ENCAPSED_AND_WHITESPACE) {
-         const std::string &text = getValue<std::string>();
+         StringRef text = getValue<StringRef>();
          outStream << "length: " << text.size() << "\n";
          outStream << "value: " << text << "\n";
       } else if (m_kind == TokenKindType::T_ERROR && hasValue()) {
          outStream << "error: ";
-         outStream << getValue<std::string>() << "\n";
+         outStream << getValue<StringRef>() << "\n";
       }
    } else {
       outStream << "value: invalid lex value" << "\n";
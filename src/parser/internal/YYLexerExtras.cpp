@@ -19,12 +19,199 @@
 
 #include <string>
 
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
 namespace polar::parser::internal {
 
 using namespace polar;
 
 #define POLAR_IS_OCT(c)  ((c)>='0' && (c)<='7')
 
+namespace {
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#define POLAR_LEXER_HAS_SIMD_SCAN 1
+#endif
+
+#if defined(__AVX2__)
+
+constexpr size_t SCAN_BLOCK_SIZE = 32;
+using ScanBlock = __m256i;
+
+inline ScanBlock scan_load(const unsigned char *ptr)
+{
+   return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+}
+
+inline ScanBlock scan_splat(unsigned char c)
+{
+   return _mm256_set1_epi8(static_cast<char>(c));
+}
+
+/// Return a bit mask with bit i set when byte i of \p block equals the
+/// corresponding byte of \p pattern.
+inline uint32_t scan_eq_mask(ScanBlock block, ScanBlock pattern)
+{
+   return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern)));
+}
+
+/// Return a bit mask with bit i set when byte i of \p block is >= 0x80.
+inline uint32_t scan_high_bit_mask(ScanBlock block)
+{
+   return static_cast<uint32_t>(_mm256_movemask_epi8(block));
+}
+
+#elif defined(__SSE2__)
+
+constexpr size_t SCAN_BLOCK_SIZE = 16;
+using ScanBlock = __m128i;
+
+inline ScanBlock scan_load(const unsigned char *ptr)
+{
+   return _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+}
+
+inline ScanBlock scan_splat(unsigned char c)
+{
+   return _mm_set1_epi8(static_cast<char>(c));
+}
+
+inline uint32_t scan_eq_mask(ScanBlock block, ScanBlock pattern)
+{
+   return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern)));
+}
+
+inline uint32_t scan_high_bit_mask(ScanBlock block)
+{
+   return static_cast<uint32_t>(_mm_movemask_epi8(block));
+}
+
+#endif
+
+inline bool is_line_end_candidate(unsigned char c, bool stopAtHighBytes)
+{
+   return c == '\n' || c == '\r' || c == 0 || (stopAtHighBytes && c >= 0x80);
+}
+
+inline bool is_block_comment_candidate(unsigned char c, bool stopAtHighBytes)
+{
+   return c == '*' || c == '/' || c == 0 || (stopAtHighBytes && c >= 0x80);
+}
+
+} // anonymous namespace
+
+const unsigned char *scan_to_line_end_candidate(const unsigned char *ptr, const unsigned char *end,
+                                                bool stopAtHighBytes)
+{
+#ifdef POLAR_LEXER_HAS_SIMD_SCAN
+   const ScanBlock newline = scan_splat('\n');
+   const ScanBlock carriageReturn = scan_splat('\r');
+   const ScanBlock nul = scan_splat(0);
+   while (end - ptr >= static_cast<std::ptrdiff_t>(SCAN_BLOCK_SIZE)) {
+      ScanBlock block = scan_load(ptr);
+      uint32_t mask = scan_eq_mask(block, newline) | scan_eq_mask(block, carriageReturn) |
+            scan_eq_mask(block, nul);
+      if (stopAtHighBytes) {
+         mask |= scan_high_bit_mask(block);
+      }
+      if (mask != 0) {
+         return ptr + polar::utils::count_trailing_zeros(mask);
+      }
+      ptr += SCAN_BLOCK_SIZE;
+   }
+#endif
+   while (ptr < end && !is_line_end_candidate(*ptr, stopAtHighBytes)) {
+      ++ptr;
+   }
+   return ptr;
+}
+
+const unsigned char *scan_to_block_comment_candidate(const unsigned char *ptr, const unsigned char *end,
+                                                     bool stopAtHighBytes, bool &sawNewline)
+{
+#ifdef POLAR_LEXER_HAS_SIMD_SCAN
+   const ScanBlock star = scan_splat('*');
+   const ScanBlock slash = scan_splat('/');
+   const ScanBlock nul = scan_splat(0);
+   const ScanBlock newline = scan_splat('\n');
+   const ScanBlock carriageReturn = scan_splat('\r');
+   while (end - ptr >= static_cast<std::ptrdiff_t>(SCAN_BLOCK_SIZE)) {
+      ScanBlock block = scan_load(ptr);
+      uint32_t mask = scan_eq_mask(block, star) | scan_eq_mask(block, slash) |
+            scan_eq_mask(block, nul);
+      if (stopAtHighBytes) {
+         mask |= scan_high_bit_mask(block);
+      }
+      uint32_t newlineMask = scan_eq_mask(block, newline) | scan_eq_mask(block, carriageReturn);
+      if (mask != 0) {
+         unsigned offset = polar::utils::count_trailing_zeros(mask);
+         // only the newlines in front of the stop byte have been skipped
+         if (newlineMask & ((uint32_t(1) << offset) - 1)) {
+            sawNewline = true;
+         }
+         return ptr + offset;
+      }
+      if (newlineMask != 0) {
+         sawNewline = true;
+      }
+      ptr += SCAN_BLOCK_SIZE;
+   }
+#endif
+   while (ptr < end && !is_block_comment_candidate(*ptr, stopAtHighBytes)) {
+      if (*ptr == '\n' || *ptr == '\r') {
+         sawNewline = true;
+      }
+      ++ptr;
+   }
+   return ptr;
+}
+
+const char *scan_to_newline_candidate(const char *str, const char *end)
+{
+   const unsigned char *ptr = reinterpret_cast<const unsigned char *>(str);
+   const unsigned char *uend = reinterpret_cast<const unsigned char *>(end);
+#ifdef POLAR_LEXER_HAS_SIMD_SCAN
+   const ScanBlock newline = scan_splat('\n');
+   const ScanBlock carriageReturn = scan_splat('\r');
+   while (uend - ptr >= static_cast<std::ptrdiff_t>(SCAN_BLOCK_SIZE)) {
+      ScanBlock block = scan_load(ptr);
+      uint32_t mask = scan_eq_mask(block, newline) | scan_eq_mask(block, carriageReturn);
+      if (mask != 0) {
+         return reinterpret_cast<const char *>(ptr + polar::utils::count_trailing_zeros(mask));
+      }
+      ptr += SCAN_BLOCK_SIZE;
+   }
+#endif
+   while (ptr < uend && *ptr != '\n' && *ptr != '\r') {
+      ++ptr;
+   }
+   return reinterpret_cast<const char *>(ptr);
+}
+
+size_t count_leading_byte(const unsigned char *ptr, const unsigned char *end, unsigned char c)
+{
+   const unsigned char *start = ptr;
+#ifdef POLAR_LEXER_HAS_SIMD_SCAN
+   const ScanBlock pattern = scan_splat(c);
+   constexpr uint32_t fullMask = SCAN_BLOCK_SIZE == 32 ? ~uint32_t(0) : ((uint32_t(1) << SCAN_BLOCK_SIZE) - 1);
+   while (end - ptr >= static_cast<std::ptrdiff_t>(SCAN_BLOCK_SIZE)) {
+      uint32_t mismatch = ~scan_eq_mask(scan_load(ptr), pattern) & fullMask;
+      if (mismatch != 0) {
+         return (ptr - start) + polar::utils::count_trailing_zeros(mismatch);
+      }
+      ptr += SCAN_BLOCK_SIZE;
+   }
+#endif
+   while (ptr < end && *ptr == c) {
+      ++ptr;
+   }
+   return ptr - start;
+}
+
 int token_lex_wrapper(ParserSemantic *value, YYLocation *loc, Lexer *lexer, Parser *parser)
 {
    Token token;
@@ -37,7 +224,9 @@ int token_lex_wrapper(ParserSemantic *value, YYLocation *loc, Lexer *lexer, Pars
    } else if (valueType == Token::ValueType::Double) {
       value->emplace<double>(token.getValue<double>());
    } else if (valueType == Token::ValueType::String) {
-      value->emplace<std::string>(token.getValue<std::string>());
+      // the text lives in the lexer's value arena, which outlives the parse,
+      // so the semantic value just refers to it
+      value->emplace<StringRef>(token.getValue<StringRef>());
    }
    parser->m_token = token;
    return token.getKind();
@@ -93,6 +282,8 @@ void diagnose_embedded_null(DiagnosticEngine *diags, const unsigned char *ptr)
 bool advance_to_end_of_line(const unsigned char *&m_yyCursor, const unsigned char *bufferEnd,
                             const unsigned char *codeCompletionPtr, DiagnosticEngine *diags) {
    while (1) {
+      // Bulk skip the bytes that the switch below would simply eat.
+      m_yyCursor = scan_to_line_end_candidate(m_yyCursor, bufferEnd, diags != nullptr);
       switch (*m_yyCursor++) {
       case '\n':
       case '\r':
@@ -140,6 +331,8 @@ bool skip_to_end_of_slash_star_comment(const unsigned char *&m_yyCursor, const u
    bool isMultiline = false;
 
    while (1) {
+      // Bulk skip plain comment text, newlines only update isMultiline.
+      m_yyCursor = scan_to_block_comment_candidate(m_yyCursor, bufferEnd, diags != nullptr, isMultiline);
       switch (*m_yyCursor++) {
       case '*':
          // Check for a '*/'
@@ -221,6 +414,10 @@ bool advance_if(const unsigned char *&ptr, const unsigned char *end,
 const char *next_newline(const char *str, const char *end, size_t &newlineLen)
 {
    for (; str < end; ++str) {
+      str = scan_to_newline_candidate(str, end);
+      if (str == end) {
+         break;
+      }
       if (*str == '\r') {
          newlineLen = str + 1 < end && *(str + 1) == '\n' ? 2 : 1;
       } else if (*str == '\n') {
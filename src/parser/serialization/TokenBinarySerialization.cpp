@@ -0,0 +1,229 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/11/13.
+
+#include "polarphp/parser/serialization/TokenBinarySerialization.h"
+#include "polarphp/parser/Token.h"
+#include "polarphp/syntax/TokenKinds.h"
+
+#include <cassert>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+
+namespace polar::parser {
+
+namespace {
+
+constexpr char sg_magic[4] = {'P', 'T', 'O', 'K'};
+
+// the record stores the flag bits in a single byte, widening TokenFlags
+// needs a new FormatVersion with a wider field
+static_assert(std::is_same<decltype(TokenFlags().getOpaqueValue()), std::uint8_t>::value,
+              "TokenFlags no longer fit the flags byte of a token record");
+static_assert(TokenFlags::InvalidLexValue < 8,
+              "TokenFlags no longer fit the flags byte of a token record");
+
+} // anonymous namespace
+
+void TokenBinaryWriter::writeHeader()
+{
+   writeBytes(sg_magic, sizeof(sg_magic));
+   writeU16(FormatVersion);
+   writeU16(0);
+}
+
+void TokenBinaryWriter::write(const Token &token, std::uint32_t offset)
+{
+   unsigned kindCode = polar::syntax::get_token_serialization_code(token.getKind());
+   assert(kindCode <= UINT16_MAX && "token kind does not fit the record");
+   writeU16(static_cast<std::uint16_t>(kindCode));
+   writeU32(offset);
+   writeU32(static_cast<std::uint32_t>(token.getLexicalLength()));
+   writeU8(token.getFlags().getOpaqueValue());
+   if (!token.hasValue()) {
+      writeU8(static_cast<std::uint8_t>(TokenValueTag::None));
+      return;
+   }
+   switch (token.getValueType()) {
+   case Token::ValueType::LongLong:
+      writeU8(static_cast<std::uint8_t>(TokenValueTag::Int));
+      writeU64(static_cast<std::uint64_t>(token.getValue<std::int64_t>()));
+      break;
+   case Token::ValueType::Double: {
+      writeU8(static_cast<std::uint8_t>(TokenValueTag::Double));
+      double value = token.getValue<double>();
+      std::uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      writeU64(bits);
+      break;
+   }
+   case Token::ValueType::String: {
+      writeU8(static_cast<std::uint8_t>(TokenValueTag::String));
+      StringRef value = token.getValue<StringRef>();
+      writeU32(static_cast<std::uint32_t>(value.size()));
+      writeBytes(value.data(), value.size());
+      break;
+   }
+   default:
+      writeU8(static_cast<std::uint8_t>(TokenValueTag::None));
+      break;
+   }
+}
+
+void TokenBinaryWriter::writeBytes(const void *data, std::size_t size)
+{
+   m_output.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+   m_bytesWritten += size;
+}
+
+void TokenBinaryWriter::writeU8(std::uint8_t value)
+{
+   writeBytes(&value, 1);
+}
+
+void TokenBinaryWriter::writeU16(std::uint16_t value)
+{
+   unsigned char buffer[2] = {
+      static_cast<unsigned char>(value),
+      static_cast<unsigned char>(value >> 8)
+   };
+   writeBytes(buffer, sizeof(buffer));
+}
+
+void TokenBinaryWriter::writeU32(std::uint32_t value)
+{
+   unsigned char buffer[4];
+   for (std::size_t i = 0; i < sizeof(buffer); ++i) {
+      buffer[i] = static_cast<unsigned char>(value >> (i * 8));
+   }
+   writeBytes(buffer, sizeof(buffer));
+}
+
+void TokenBinaryWriter::writeU64(std::uint64_t value)
+{
+   unsigned char buffer[8];
+   for (std::size_t i = 0; i < sizeof(buffer); ++i) {
+      buffer[i] = static_cast<unsigned char>(value >> (i * 8));
+   }
+   writeBytes(buffer, sizeof(buffer));
+}
+
+bool TokenBinaryReader::readHeader()
+{
+   char magic[sizeof(sg_magic)];
+   std::uint16_t version;
+   std::uint16_t reserved;
+   if (!readBytes(magic, sizeof(magic)) || std::memcmp(magic, sg_magic, sizeof(magic)) != 0) {
+      return false;
+   }
+   if (!readU16(version) || !readU16(reserved)) {
+      return false;
+   }
+   return version == TokenBinaryWriter::FormatVersion;
+}
+
+bool TokenBinaryReader::read(TokenRecord &record)
+{
+   std::uint16_t kind;
+   std::uint8_t valueTag;
+   if (!readU16(kind) || !readU32(record.offset) || !readU32(record.length) ||
+       !readU8(record.flags) || !readU8(valueTag)) {
+      return false;
+   }
+   std::optional<TokenKindType> tokenKind = polar::syntax::get_token_kind_for_serialization_code(kind);
+   if (!tokenKind) {
+      return false;
+   }
+   record.kind = *tokenKind;
+   record.valueTag = static_cast<TokenValueTag>(valueTag);
+   record.intValue = 0;
+   record.doubleValue = 0;
+   record.stringValue.clear();
+   switch (record.valueTag) {
+   case TokenValueTag::None:
+      return true;
+   case TokenValueTag::Int: {
+      std::uint64_t value;
+      if (!readU64(value)) {
+         return false;
+      }
+      record.intValue = static_cast<std::int64_t>(value);
+      return true;
+   }
+   case TokenValueTag::Double: {
+      std::uint64_t bits;
+      if (!readU64(bits)) {
+         return false;
+      }
+      std::memcpy(&record.doubleValue, &bits, sizeof(bits));
+      return true;
+   }
+   case TokenValueTag::String: {
+      std::uint32_t size;
+      if (!readU32(size)) {
+         return false;
+      }
+      record.stringValue.resize(size);
+      return size == 0 || readBytes(&record.stringValue[0], size);
+   }
+   }
+   return false;
+}
+
+bool TokenBinaryReader::readBytes(void *data, std::size_t size)
+{
+   m_input.read(static_cast<char *>(data), static_cast<std::streamsize>(size));
+   return static_cast<std::size_t>(m_input.gcount()) == size;
+}
+
+bool TokenBinaryReader::readU8(std::uint8_t &value)
+{
+   return readBytes(&value, 1);
+}
+
+bool TokenBinaryReader::readU16(std::uint16_t &value)
+{
+   unsigned char buffer[2];
+   if (!readBytes(buffer, sizeof(buffer))) {
+      return false;
+   }
+   value = static_cast<std::uint16_t>(buffer[0] | (buffer[1] << 8));
+   return true;
+}
+
+bool TokenBinaryReader::readU32(std::uint32_t &value)
+{
+   unsigned char buffer[4];
+   if (!readBytes(buffer, sizeof(buffer))) {
+      return false;
+   }
+   value = 0;
+   for (std::size_t i = 0; i < sizeof(buffer); ++i) {
+      value |= static_cast<std::uint32_t>(buffer[i]) << (i * 8);
+   }
+   return true;
+}
+
+bool TokenBinaryReader::readU64(std::uint64_t &value)
+{
+   unsigned char buffer[8];
+   if (!readBytes(buffer, sizeof(buffer))) {
+      return false;
+   }
+   value = 0;
+   for (std::size_t i = 0; i < sizeof(buffer); ++i) {
+      value |= static_cast<std::uint64_t>(buffer[i]) << (i * 8);
+   }
+   return true;
+}
+
+} // polar::parser
@@ -12,6 +12,7 @@
 #include "polarphp/parser/serialization/TokenJsonSerialization.h"
 #include "polarphp/syntax/serialization/TokenKindTypeSerialization.h"
 #include "polarphp/parser/Token.h"
+#include "llvm/Support/StringSaver.h"
 
 #include <set>
 
@@ -84,7 +85,7 @@ void to_json(json &jsonObject, const Token &token)
    jsonObject["definedText"] = token.getDefinedText();
 }
 
-void from_json(const json &jsonObject, Token &token)
+void from_json(const json &jsonObject, Token &token, llvm::BumpPtrAllocator &valueAllocator)
 {
    TokenKindType kind = jsonObject.at("token").get<TokenKindType>();
    token.setKind(kind);
@@ -96,7 +97,8 @@ void from_json(const json &jsonObject, Token &token)
    if (hasValue) {
       ValueType valueType = jsonObject.at("valueType").get<ValueType>();
       if (valueType == ValueType::String) {
-         token.setValue(jsonObject.at("value").get<std::string>());
+         llvm::StringSaver saver(valueAllocator);
+         token.setValue(saver.save(jsonObject.at("value").get<std::string>()));
       } else if (valueType == ValueType::Double) {
          token.setValue(jsonObject.at("value").get<double>());
       } else if (valueType == ValueType::LongLong) {
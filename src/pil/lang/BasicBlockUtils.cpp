@@ -17,6 +17,7 @@
 #include "polarphp/pil/lang/PILBasicBlock.h"
 #include "polarphp/pil/lang/PILBuilder.h"
 #include "polarphp/pil/lang/PILFunction.h"
+#include "polarphp/pil/lang/PILModule.h"
 
 namespace polar {
 
@@ -227,37 +228,12 @@ PILBasicBlock *splitEdge(TermInst *T, unsigned edgeIdx,
    // Strip the arguments and rewire the branch in the source block.
    changeBranchTarget(T, edgeIdx, edgeBB, /*PreserveArgs=*/false);
 
-   if (!DT && !LI)
-      return edgeBB;
-
    // Update the dominator tree.
-   if (DT) {
-      auto *srcBBNode = DT->getNode(srcBB);
-
-      // Unreachable code could result in a null return here.
-      if (srcBBNode) {
-         // The new block is dominated by the srcBB.
-         auto *edgeBBNode = DT->addNewBlock(edgeBB, srcBB);
-
-         // Are all predecessors of destBB dominated by destBB?
-         auto *destBBNode = DT->getNode(destBB);
-         bool oldSrcBBDominatesAllPreds = std::all_of(
-            destBB->pred_begin(), destBB->pred_end(), [=](PILBasicBlock *B) {
-               if (B == edgeBB)
-                  return true;
-               auto *PredNode = DT->getNode(B);
-               if (!PredNode)
-                  return true;
-               if (DT->dominates(destBBNode, PredNode))
-                  return true;
-               return false;
-            });
-
-         // If so, the new bb dominates destBB now.
-         if (oldSrcBBDominatesAllPreds)
-            DT->changeImmediateDominator(destBBNode, edgeBBNode);
-      }
-   }
+   if (DT)
+      DT->updateForSplitEdge(srcBB, edgeBB, destBB);
+
+   F->getModule().notifyCFGEditHandlers(
+      CFGEdit(CFGEdit::Kind::SplitEdge, srcBB, destBB, edgeBB, DT));
 
    if (!LI)
       return edgeBB;
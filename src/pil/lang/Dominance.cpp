@@ -86,6 +86,67 @@ void DominanceInfo::verify() const {
    }
 }
 
+void DominanceInfo::updateForSplitBlock(PILBasicBlock *origBB,
+                                        PILBasicBlock *newBB) {
+   auto *origBBNode = getNode(origBB);
+   // Unreachable code could result in a null return here.
+   if (!origBBNode)
+      return;
+
+   // The new block takes over the children of the block we split.
+   SmallVector<DominanceInfoNode *, 16> adoptees(origBBNode->begin(),
+                                                 origBBNode->end());
+   auto *newBBNode = addNewBlock(newBB, origBB);
+   for (auto *adoptee : adoptees)
+      changeImmediateDominator(adoptee, newBBNode);
+}
+
+void DominanceInfo::updateForSplitEdge(PILBasicBlock *srcBB,
+                                       PILBasicBlock *edgeBB,
+                                       PILBasicBlock *destBB) {
+   // Unreachable code could result in a null return here.
+   if (!getNode(srcBB))
+      return;
+
+   // The new block is dominated by the srcBB.
+   auto *edgeBBNode = addNewBlock(edgeBB, srcBB);
+
+   // Are all predecessors of destBB dominated by destBB?
+   auto *destBBNode = getNode(destBB);
+   bool oldSrcBBDominatesAllPreds = std::all_of(
+      destBB->pred_begin(), destBB->pred_end(), [=](PILBasicBlock *B) {
+         if (B == edgeBB)
+            return true;
+         auto *PredNode = getNode(B);
+         if (!PredNode)
+            return true;
+         if (dominates(destBBNode, PredNode))
+            return true;
+         return false;
+      });
+
+   // If so, the new bb dominates destBB now.
+   if (oldSrcBBDominatesAllPreds)
+      changeImmediateDominator(destBBNode, edgeBBNode);
+}
+
+void DominanceInfo::updateForMergeBlocks(PILBasicBlock *bb,
+                                         PILBasicBlock *succBB) {
+   auto *succBBNode = getNode(succBB);
+   if (!succBBNode)
+      return;
+
+   // Change the immediate dominator for children of the successor to be the
+   // current block.
+   auto *bbNode = getNode(bb);
+   SmallVector<DominanceInfoNode *, 8> children(succBBNode->begin(),
+                                                succBBNode->end());
+   for (auto *childNode : children)
+      changeImmediateDominator(childNode, bbNode);
+
+   eraseNode(succBB);
+}
+
 /// Compute the immediate-post-dominators map.
 PostDominanceInfo::PostDominanceInfo(PILFunction *F)
    : PostDominatorTreeBase() {
@@ -0,0 +1,181 @@
+//===--- FunctionSummaryCache.cpp - Persistent function summaries ---------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2018 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "pil-summary-cache"
+
+#include "polarphp/pil/lang/FunctionSummaryCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+
+using namespace polar;
+
+static const char *const SummaryFileMagic = "polarphp-pil-summaries";
+
+bool FunctionSummaryCache::readEntries(llvm::StringRef Path,
+                                       unsigned AgeIncrement,
+                                       llvm::StringMap<Entry> &Result) {
+   auto BufferOrErr = llvm::MemoryBuffer::getFile(Path);
+   if (!BufferOrErr)
+      return false;
+
+   llvm::StringRef Rest = (*BufferOrErr)->getBuffer();
+   llvm::StringRef Header;
+   std::tie(Header, Rest) = Rest.split('\n');
+   llvm::StringRef Magic, Version;
+   std::tie(Magic, Version) = Header.split(' ');
+   unsigned VersionNumber;
+   if (Magic != SummaryFileMagic || Version.getAsInteger(10, VersionNumber) ||
+       VersionNumber != FormatVersion) {
+      LLVM_DEBUG(llvm::dbgs() << "ignoring summary file " << Path << '\n');
+      return false;
+   }
+
+   while (!Rest.empty()) {
+      llvm::StringRef Line;
+      std::tie(Line, Rest) = Rest.split('\n');
+      llvm::SmallVector<llvm::StringRef, 4> Fields;
+      Line.split(Fields, ' ');
+      unsigned Age;
+      if (Fields.size() != 4 || Fields[2].getAsInteger(10, Age)) {
+         Result.clear();
+         return false;
+      }
+      Entry &E = Result[(Fields[0] + " " + Fields[1]).str()];
+      E.Payload = Fields[3].str();
+      E.Age = Age + AgeIncrement;
+   }
+   return true;
+}
+
+bool FunctionSummaryCache::load(llvm::StringRef Path) {
+   Entries.clear();
+   // The entries survived one more compilation, they get younger again if
+   // they are used.
+   if (!readEntries(Path, /*AgeIncrement*/ 1, Entries))
+      return false;
+   LLVM_DEBUG(llvm::dbgs() << "loaded " << Entries.size()
+                           << " summaries from " << Path << '\n');
+   return true;
+}
+
+bool FunctionSummaryCache::save(llvm::StringRef Path, unsigned MaxAge) const {
+   // Other compilations of the build may share the file. Hold its lock while
+   // merging their entries into ours, so that none of them gets lost.
+   while (true) {
+      llvm::LockFileManager Lock(Path);
+      switch (Lock.getState()) {
+         case llvm::LockFileManager::LFS_Error:
+            // Locking is not possible, e.g. because the directory is read
+            // only. Writing the file would most likely fail as well.
+            return false;
+         case llvm::LockFileManager::LFS_Shared:
+            // Another compilation is writing the file. Wait for it and retry,
+            // taking the lock over if its owner got stuck.
+            if (Lock.waitForUnlock() == llvm::LockFileManager::Res_Timeout)
+               Lock.unsafeRemoveLockFile();
+            continue;
+         case llvm::LockFileManager::LFS_Owned:
+            return mergeAndWrite(Path, MaxAge);
+      }
+   }
+}
+
+bool FunctionSummaryCache::mergeAndWrite(llvm::StringRef Path,
+                                         unsigned MaxAge) const {
+   // Entries only the file has were added by other compilations since we
+   // loaded it, they keep their age. An entry both have survived this
+   // compilation as well, so the age in the file is increased before the
+   // younger one wins. Otherwise unused entries would never age.
+   llvm::StringMap<Entry> Merged;
+   readEntries(Path, /*AgeIncrement*/ 0, Merged);
+   for (auto &E : Entries) {
+      auto Inserted = Merged.insert({E.getKey(), E.second});
+      Entry &Existing = Inserted.first->second;
+      if (!Inserted.second && E.second.Age <= Existing.Age + 1)
+         Existing = E.second;
+      else if (!Inserted.second)
+         ++Existing.Age;
+   }
+
+   // Write the entries in a deterministic order.
+   std::vector<const llvm::StringMapEntry<Entry> *> Sorted;
+   for (auto &E : Merged) {
+      if (E.second.Age <= MaxAge)
+         Sorted.push_back(&E);
+   }
+   std::sort(Sorted.begin(), Sorted.end(),
+             [](const llvm::StringMapEntry<Entry> *LHS,
+                const llvm::StringMapEntry<Entry> *RHS) {
+                return LHS->getKey() < RHS->getKey();
+             });
+
+   // Write to a temporary file first, so that a reader never sees a partially
+   // written cache.
+   int FD;
+   llvm::SmallString<128> TmpPath;
+   if (llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%.tmp", FD, TmpPath))
+      return false;
+   {
+      llvm::raw_fd_ostream OS(FD, /*shouldClose*/ true);
+      OS << SummaryFileMagic << ' ' << FormatVersion << '\n';
+      for (auto *E : Sorted) {
+         OS << E->getKey() << ' ' << E->second.Age << ' ' << E->second.Payload
+            << '\n';
+      }
+      if (OS.has_error()) {
+         OS.clear_error();
+         llvm::sys::fs::remove(TmpPath);
+         return false;
+      }
+   }
+   if (llvm::sys::fs::rename(TmpPath, Path)) {
+      llvm::sys::fs::remove(TmpPath);
+      return false;
+   }
+   LLVM_DEBUG(llvm::dbgs() << "saved " << Sorted.size() << " summaries to "
+                           << Path << '\n');
+   return true;
+}
+
+llvm::Optional<llvm::StringRef>
+FunctionSummaryCache::lookup(llvm::StringRef Kind, llvm::StringRef Key) {
+   auto Iter = Entries.find((Kind + " " + Key).str());
+   if (Iter == Entries.end()) {
+      ++NumMisses;
+      return llvm::None;
+   }
+   ++NumHits;
+   return llvm::StringRef(Iter->second.Payload);
+}
+
+void FunctionSummaryCache::markUsed(llvm::StringRef Kind, llvm::StringRef Key) {
+   auto Iter = Entries.find((Kind + " " + Key).str());
+   if (Iter != Entries.end())
+      Iter->second.Age = 0;
+}
+
+void FunctionSummaryCache::insert(llvm::StringRef Kind, llvm::StringRef Key,
+                                  llvm::StringRef Payload) {
+   assert(Kind.find(' ') == llvm::StringRef::npos &&
+          Payload.find(' ') == llvm::StringRef::npos &&
+          Payload.find('\n') == llvm::StringRef::npos &&
+          "summary fields must not contain separators");
+   Entry &E = Entries[(Kind + " " + Key).str()];
+   E.Payload = Payload.str();
+   E.Age = 0;
+}
@@ -24,6 +24,7 @@
 #include "polarphp/pil/lang/PILFunction.h"
 //#include "polarphp/pil/lang/PILInstruction.h"
 #include "polarphp/pil/lang/PILModule.h"
+#include "polarphp/pil/lang/PILUndef.h"
 #include "polarphp/global/NameStrings.h"
 
 using namespace polar;
@@ -36,6 +37,8 @@ using namespace llvm;
 PILBasicBlock::PILBasicBlock(PILFunction *parent, PILBasicBlock *relativeToBB,
                              bool after)
    : Parent(parent), PredList(nullptr) {
+   // The new block has no index yet.
+   parent->invalidateBlockNumbering();
    if (!relativeToBB) {
       parent->getBlocks().push_back(this);
    } else if (after) {
@@ -305,13 +308,19 @@ transferNodesFromList(llvm::ilist_traits<PILBasicBlock> &SrcTraits,
    if (Parent == SrcTraits.Parent)
       return;
 
+   // The spliced blocks carry indices of the source function.
+   Parent->invalidateBlockNumbering();
+
    ScopeCloner ScopeCloner(*Parent);
 
    // If splicing blocks not in the same function, update the parent pointers.
+   // Undefs are uniqued per function, so the instructions switch to ours.
    for (; First != Last; ++First) {
       First->Parent = Parent;
-      for (auto &II : *First)
+      for (auto &II : *First) {
          II.setDebugScope(ScopeCloner.getOrCreateClonedScope(II.getDebugScope()));
+         PILUndef::adoptOperands(II, *Parent);
+      }
    }
 }
 
@@ -25,6 +25,11 @@ llvm::cl::opt<unsigned>
    ConstExprLimit("constexpr-limit", llvm::cl::init(2048),
                   llvm::cl::desc("Number of instructions interpreted in a"
                                  " constexpr function"));
+
+llvm::cl::opt<unsigned>
+   ConstExprMemoryLimit("constexpr-memory-limit", llvm::cl::init(64 << 20),
+                        llvm::cl::desc("Number of bytes of symbolic values a"
+                                       " constexpr evaluation may allocate"));
 }
 
 template <typename... T, typename... U>
@@ -912,6 +917,13 @@ void SymbolicValue::emitUnknownDiagnosticNotes(PILLocation fallbackLoc) {
             diagnose(ctx, triggerLoc, diag::constexpr_limit_exceeding_instruction,
                      triggerLocSkipsInternalLocs);
          return;
+      case UnknownReason::TooMuchMemory:
+         diagnose(ctx, diagLoc, diag::constexpr_too_much_memory,
+                  ConstExprMemoryLimit);
+         if (emitTriggerLocInDiag)
+            diagnose(ctx, triggerLoc, diag::constexpr_limit_exceeding_instruction,
+                     triggerLocSkipsInternalLocs);
+         return;
       case UnknownReason::Loop:
          diagnose(ctx, diagLoc, diag::constexpr_loop_found_note);
          if (emitTriggerLocInDiag)
@@ -62,6 +62,8 @@ PILFunction::create(PILModule &M, PILLinkage linkage, StringRef name,
                     SubclassScope classSubclassScope, Inline_t inlineStrategy,
                     EffectsKind E, PILFunction *insertBefore,
                     const PILDebugScope *debugScope) {
+   assert(!M.hasConcurrentFunctionPasses() &&
+          "functions cannot be created while function passes run concurrently");
    // Get a StringMapEntry for the function.  As a sop to error cases,
    // allow the name to have an empty string.
    llvm::StringMapEntry<PILFunction*> *entry = nullptr;
@@ -303,6 +305,20 @@ PILBasicBlock *PILFunction::createBasicBlockBefore(PILBasicBlock *beforeBB) {
    return new (getModule()) PILBasicBlock(this, beforeBB, /*after*/ false);
 }
 
+unsigned PILFunction::numberBlocks() {
+   if (BlocksNumbered)
+      return NumBlockIndices;
+
+   unsigned Index = 0;
+   for (PILBasicBlock &BB : *this) {
+      BB.Index = Index++;
+   }
+   NumBlockIndices = Index;
+   ++BlockNumberingEpoch;
+   BlocksNumbered = true;
+   return Index;
+}
+
 //===----------------------------------------------------------------------===//
 //                          View CFG Implementation
 //===----------------------------------------------------------------------===//
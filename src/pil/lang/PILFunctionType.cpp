@@ -235,6 +235,7 @@ static CanType getKnownType(Optional<CanType> &cacheSlot, AstContext &C,
 
 #define BRIDGING_KNOWN_TYPE(BridgedModule,BridgedType) \
   CanType TypeConverter::get##BridgedType##Type() {         \
+    auto lock = lockCaches();                               \
     return getKnownType(BridgedType##Ty, Context, \
                         #BridgedModule, #BridgedType);      \
   }
@@ -2345,6 +2346,7 @@ static llvm::cl::opt<bool>
 const PILConstantInfo &
 TypeConverter::getConstantInfo(TypeExpansionContext expansion,
                                PILDeclRef constant) {
+   auto lock = lockCaches();
    if (!DisableConstantInfoCache) {
       auto found = ConstantTypes.find(std::make_pair(expansion, constant));
       if (found != ConstantTypes.end())
@@ -2512,6 +2514,7 @@ TypeConverter::getConstantOverrideInfo(TypeExpansionContext context,
    if (derived.isForeign)
       return getConstantInfo(context, derived);
 
+   auto lock = lockCaches();
    auto found = ConstantOverrideTypes.find({derived, base});
    if (found != ConstantOverrideTypes.end())
       return *found->second;
@@ -25,6 +25,7 @@
 #include "polarphp/basic/AssertImplements.h"
 #include "polarphp/clangimporter/ClangModule.h"
 #include "polarphp/pil/lang/PILModule.h"
+#include "polarphp/pil/lang/PILUndef.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -84,12 +85,19 @@ transferNodesFromList(llvm::ilist_traits<PILInstruction> &L2,
    // If transferring instructions within the same basic block, no reason to
    // update their parent pointers.
    PILBasicBlock *ThisParent = getContainingBlock();
-   if (ThisParent == L2.getContainingBlock()) return;
+   PILBasicBlock *SrcParent = L2.getContainingBlock();
+   if (ThisParent == SrcParent) return;
 
-   // Update the parent fields in the instructions.
+   PILFunction *F = ThisParent->getParent();
+
+   // Update the parent fields in the instructions. Undefs are uniqued per
+   // function, so instructions from another function switch to ours.
+   bool OtherFunction = F && F != SrcParent->getParent();
    for (; first != last; ++first) {
       POLAR_FUNC_STAT_NAMED("sil");
       first->ParentBB = ThisParent;
+      if (OtherFunction)
+         PILUndef::adoptOperands(*first, *F);
    }
 }
 
@@ -19,6 +19,7 @@
 #include "polarphp/clangimporter/ClangModule.h"
 #include "polarphp/pil/lang/FormalLinkage.h"
 #include "polarphp/pil/lang/Notifications.h"
+#include "polarphp/pil/lang/PassProfiler.h"
 #include "polarphp/pil/lang/PILDebugScope.h"
 #include "polarphp/pil/lang/PILValue.h"
 #include "polarphp/pil/lang/PILVisitor.h"
@@ -105,6 +106,9 @@ PILModule::PILModule(ModuleDecl *polarphpModule, TypeConverter &TC,
 }
 
 PILModule::~PILModule() {
+   if (PassProfiler)
+      PassProfiler->flush();
+
    // Decrement ref count for each PILGlobalVariable with static initializers.
    for (PILGlobalVariable &v : silGlobals)
       v.dropAllReferences();
@@ -121,6 +125,34 @@ PILModule::~PILModule() {
    }
 }
 
+void PILModule::saveSummaryCaches() {
+   for (auto &Entry : SummaryCaches) {
+      if (!Entry.second->Cache.save(Entry.getKey(), Entry.second->MaxAge)) {
+         LLVM_DEBUG(llvm::dbgs() << "could not write summary cache "
+                                 << Entry.getKey() << '\n');
+      }
+   }
+}
+
+FunctionSummaryCache &PILModule::getSummaryCache(StringRef Path,
+                                                 unsigned MaxAge) {
+   std::unique_ptr<PersistentSummaryCache> &Entry = SummaryCaches[Path];
+   if (!Entry) {
+      Entry.reset(new PersistentSummaryCache());
+      Entry->Cache.load(Path);
+   }
+   Entry->MaxAge = MaxAge;
+   return Entry->Cache;
+}
+
+PILPassProfiler *PILModule::getPassProfiler() {
+   if (!PassProfilerCreated) {
+      PassProfiler = PILPassProfiler::create(*this);
+      PassProfilerCreated = true;
+   }
+   return PassProfiler.get();
+}
+
 std::unique_ptr<PILModule>
 PILModule::createEmptyModule(ModuleDecl *M, TypeConverter &TC, PILOptions &Options,
                              bool WholeModule) {
@@ -132,14 +164,73 @@ AstContext &PILModule::getAstContext() const {
    return ThePolarphpModule->getAstContext();
 }
 
+std::unique_lock<std::recursive_mutex> PILModule::lockTables() const {
+   if (!concurrentFunctionPasses)
+      return std::unique_lock<std::recursive_mutex>();
+   return std::unique_lock<std::recursive_mutex>(tableLock);
+}
+
+void PILModule::setConcurrentFunctionPasses(bool value) {
+   concurrentFunctionPasses = value;
+   Types.setConcurrencyLock(value ? &tableLock : nullptr);
+}
+
+namespace {
+/// The allocator of a thread which runs function passes concurrently, and
+/// the module it belongs to.
+struct WorkerAllocation {
+   const PILModule *Module = nullptr;
+   llvm::BumpPtrAllocator *Allocator = nullptr;
+};
+} // end anonymous namespace
+
+static thread_local WorkerAllocation CurrentWorkerAllocation;
+
+void PILModule::enterConcurrentWorker() {
+   assert(concurrentFunctionPasses && "not running function passes concurrently");
+   assert(!CurrentWorkerAllocation.Module && "thread is already a worker");
+   auto lock = lockTables();
+   llvm::BumpPtrAllocator *Allocator;
+   if (IdleWorkerAllocators.empty()) {
+      WorkerAllocators.push_back(std::make_unique<llvm::BumpPtrAllocator>());
+      Allocator = WorkerAllocators.back().get();
+   } else {
+      Allocator = IdleWorkerAllocators.back();
+      IdleWorkerAllocators.pop_back();
+   }
+   CurrentWorkerAllocation = {this, Allocator};
+}
+
+void PILModule::leaveConcurrentWorker() {
+   assert(CurrentWorkerAllocation.Module == this && "thread is not a worker");
+   auto lock = lockTables();
+   IdleWorkerAllocators.push_back(CurrentWorkerAllocation.Allocator);
+   CurrentWorkerAllocation = WorkerAllocation();
+}
+
+/// Count an allocation for the pass profile, if there is one.
+static void countAllocation(const PILPassProfiler *Profiler, unsigned Size) {
+   if (!Profiler)
+      return;
+   auto &Counters = PILPassProfiler::getThreadAllocationCounters();
+   ++Counters.NumAllocations;
+   Counters.NumBytes += Size;
+}
+
 void *PILModule::allocate(unsigned Size, unsigned Align) const {
+   countAllocation(PassProfiler.get(), Size);
    if (getAstContext().LangOpts.UseMalloc)
       return aligned_alloc(Size, Align);
 
+   if (CurrentWorkerAllocation.Module == this)
+      return CurrentWorkerAllocation.Allocator->Allocate(Size, Align);
+
+   auto lock = lockTables();
    return BPA.Allocate(Size, Align);
 }
 
 void *PILModule::allocateInst(unsigned Size, unsigned Align) const {
+   countAllocation(PassProfiler.get(), Size);
    return aligned_alloc(Size, Align);
 }
 
@@ -267,12 +358,15 @@ void PILModule::deleteWitnessTable(PILWitnessTable *Wt) {
 }
 
 const IntrinsicInfo &PILModule::getIntrinsicInfo(Identifier ID) {
-   unsigned OldSize = IntrinsicIDCache.size();
-   IntrinsicInfo &Info = IntrinsicIDCache[ID];
+   auto lock = lockTables();
+   std::unique_ptr<IntrinsicInfo> &Entry = IntrinsicIDCache[ID];
 
    // If the element was is in the cache, return it.
-   if (OldSize == IntrinsicIDCache.size())
-      return Info;
+   if (Entry)
+      return *Entry;
+
+   Entry.reset(new IntrinsicInfo());
+   IntrinsicInfo &Info = *Entry;
 
    // Otherwise, lookup the ID and Type and store them in the map.
    StringRef NameRef = getBuiltinBaseName(getAstContext(), ID.str(), Info.Types);
@@ -282,12 +376,15 @@ const IntrinsicInfo &PILModule::getIntrinsicInfo(Identifier ID) {
 }
 
 const BuiltinInfo &PILModule::getBuiltinInfo(Identifier ID) {
-   unsigned OldSize = BuiltinIDCache.size();
-   BuiltinInfo &Info = BuiltinIDCache[ID];
+   auto lock = lockTables();
+   std::unique_ptr<BuiltinInfo> &Entry = BuiltinIDCache[ID];
 
    // If the element was is in the cache, return it.
-   if (OldSize == BuiltinIDCache.size())
-      return Info;
+   if (Entry)
+      return *Entry;
+
+   Entry.reset(new BuiltinInfo());
+   BuiltinInfo &Info = *Entry;
 
    // Otherwise, lookup the ID and Type and store them in the map.
    // Find the matching ID.
@@ -426,6 +523,8 @@ void PILModule::removeFromZombieList(StringRef Name) {
 /// Erase a function from the module.
 void PILModule::eraseFunction(PILFunction *F) {
    assert(!F->isZombie() && "zombie function is in list of alive functions");
+   assert(!concurrentFunctionPasses &&
+          "functions cannot be erased while function passes run concurrently");
    // The owner of the function's Name is the FunctionTable key. As we remove
    // the function from the table we have to store the name string elsewhere:
    // in zombieFunctionNames.
@@ -588,21 +687,33 @@ void PILModule::registerDeleteNotificationHandler(
    // Ask the handler (that can be an analysis, a pass, or some other data
    // structure) if it wants to receive delete notifications.
    if (handler->needsNotifications()) {
+      auto lock = lockTables();
       NotificationHandlers.insert(handler);
    }
 }
 
 void PILModule::
 removeDeleteNotificationHandler(DeleteNotificationHandler* Handler) {
+   auto lock = lockTables();
    NotificationHandlers.remove(Handler);
 }
 
 void PILModule::notifyDeleteHandlers(PILNode *node) {
+   // The analyses are shared by all functions, so their handlers run one at a
+   // time.
+   auto lock = lockTables();
    for (auto *Handler : NotificationHandlers) {
       Handler->handleDeleteNotification(node);
    }
 }
 
+void PILModule::notifyCFGEditHandlers(const CFGEdit &edit) {
+   auto lock = lockTables();
+   for (auto *Handler : NotificationHandlers) {
+      Handler->handleCFGEditNotification(edit);
+   }
+}
+
 // TODO: We should have an "isNoReturn" bit on Swift's BuiltinInfo, but for
 // now, let's recognize noreturn intrinsics and builtins specially here.
 bool PILModule::isNoReturnBuiltinOrIntrinsic(Identifier Name) {
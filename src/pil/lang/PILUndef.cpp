@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "polarphp/pil/lang/PILUndef.h"
+#include "polarphp/pil/lang/PILInstruction.h"
 #include "polarphp/pil/lang/PILModule.h"
 
 using namespace polar;
@@ -25,14 +26,28 @@ PILUndef::PILUndef(PILType type, ValueOwnershipKind ownershipKind)
    : ValueBase(ValueKind::PILUndef, type, IsRepresentative::Yes),
      ownershipKind(ownershipKind) {}
 
-PILUndef *PILUndef::get(PILType ty, PILModule &m, ValueOwnershipKind ownershipKind) {
-   PILUndef *&entry = m.UndefValues[std::make_pair(ty, unsigned(ownershipKind))];
+PILUndef *PILUndef::get(PILType ty, const PILFunction &f,
+                        ValueOwnershipKind ownershipKind) {
+   PILUndef *&entry = f.UndefValues[std::make_pair(ty, unsigned(ownershipKind))];
    if (entry == nullptr)
-      entry = new (m) PILUndef(ty, ownershipKind);
+      entry = new (f.getModule()) PILUndef(ty, ownershipKind);
    return entry;
 }
 
 PILUndef *PILUndef::get(PILType ty, const PILFunction &f) {
    auto ownershipKind = getOwnershipKindForUndef(ty, f);
-   return PILUndef::get(ty, f.getModule(), ownershipKind);
+   return PILUndef::get(ty, f, ownershipKind);
+}
+
+void PILUndef::adoptOperands(PILInstruction &inst, const PILFunction &f) {
+   for (Operand &op : inst.getAllOperands()) {
+      auto *undef = dyn_cast<PILUndef>(op.get());
+      if (!undef)
+         continue;
+      auto key = std::make_pair(undef->getType(),
+                                unsigned(undef->getOwnershipKind()));
+      if (f.UndefValues.lookup(key) == undef)
+         continue;
+      op.set(PILUndef::get(undef->getType(), f, undef->getOwnershipKind()));
+   }
 }
@@ -44,6 +44,7 @@
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DJB.h"
 #include "llvm/Support/Debug.h"
 
 using namespace polar;
@@ -71,6 +72,19 @@ static llvm::cl::opt<bool> VerifyDIHoles(
 static llvm::cl::opt<bool> SkipConvertEscapeToNoescapeAttributes(
    "verify-skip-convert-escape-to-noescape-attributes", llvm::cl::init(false));
 
+// Verifying after every pass is dominated by the ownership and memory
+// lifetime checks. With a sample below 100 only the structural checks run on
+// the other functions.
+static llvm::cl::opt<unsigned> FullVerifySamplePercent(
+   "sil-verify-full-sample-percent", llvm::cl::init(100),
+   llvm::cl::desc("The percentage of functions which get the ownership and "
+                  "memory lifetime checks when verified after a pass"));
+
+static llvm::cl::opt<unsigned> VerifySampleSeed(
+   "sil-verify-sample-seed", llvm::cl::init(0),
+   llvm::cl::desc("The seed selecting the functions which are fully "
+                  "verified with -sil-verify-full-sample-percent"));
+
 // The verifier is basically all assertions, so don't compile it with NDEBUG to
 // prevent release builds from triggering spurious unused variable warnings.
 
@@ -646,6 +660,10 @@ class PILVerifier : public PILVerifierBase<PILVerifier> {
    DeadEndBlocks DEBlocks;
    bool SingleFunction = true;
 
+   /// If false, only the structural checks are done, without the ownership
+   /// and memory lifetime checks.
+   bool FullVerification = true;
+
    PILVerifier(const PILVerifier&) = delete;
    void operator=(const PILVerifier&) = delete;
 public:
@@ -830,12 +848,14 @@ public:
       return numInsts;
    }
 
-   PILVerifier(const PILFunction &F, bool SingleFunction = true)
+   PILVerifier(const PILFunction &F, bool SingleFunction = true,
+               bool FullVerification = true)
       : M(F.getModule().getPolarphpModule()), F(F),
         fnConv(F.getLoweredFunctionType(), F.getModule()),
         TC(F.getModule().Types), OpenedArchetypes(&F), Dominance(nullptr),
         InstNumbers(numInstsInFunction(F)),
-        DEBlocks(&F), SingleFunction(SingleFunction) {
+        DEBlocks(&F), SingleFunction(SingleFunction),
+        FullVerification(FullVerification) {
       if (F.isExternalDeclaration())
          return;
 
@@ -968,7 +988,7 @@ public:
 
    void checkValueBaseOwnership(ValueBase *V) {
       // If ownership is not enabled, bail.
-      if (!isPILOwnershipEnabled())
+      if (!FullVerification || !isPILOwnershipEnabled())
          return;
 
       PILFunction *F = V->getFunction();
@@ -5073,7 +5093,8 @@ public:
       // instructions.
       verifyOpenedArchetypes(F);
 
-      if (F->hasOwnership() && F->shouldVerifyOwnership() &&
+      if (FullVerification && F->hasOwnership() &&
+          F->shouldVerifyOwnership() &&
           !F->getModule().getAstContext().hadError()) {
          verifyMemoryLifetime(F);
       }
@@ -5105,6 +5126,35 @@ void PILFunction::verify(bool SingleFunction) const {
    PILVerifier(*this, SingleFunction).verify();
 }
 
+/// Returns true if \p F is in the sample of functions which are fully
+/// verified for \p SampleKey.
+static bool isSampledForFullVerification(const PILFunction &F,
+                                         unsigned SampleKey) {
+   if (FullVerifySamplePercent >= 100)
+      return true;
+   if (FullVerifySamplePercent == 0)
+      return false;
+
+   // Hash the name instead of the function's address, so the sample is the
+   // same in every run with the same seed.
+   uint32_t Hash =
+      llvm::djbHash(F.getName(), VerifySampleSeed * 0x9E3779B9U + SampleKey);
+   Hash ^= Hash >> 16;
+   Hash *= 0x85EBCA6BU;
+   Hash ^= Hash >> 13;
+   return Hash % 100 < FullVerifySamplePercent;
+}
+
+void PILFunction::verifySampled(unsigned SampleKey,
+                                bool SingleFunction) const {
+#ifdef NDEBUG
+   if (!getModule().getOptions().VerifyAll)
+      return;
+#endif
+   PILVerifier(*this, SingleFunction,
+               isSampledForFullVerification(*this, SampleKey)).verify();
+}
+
 void PILFunction::verifyCriticalEdges() const {
 #ifdef NDEBUG
    if (!getModule().getOptions().VerifyAll)
@@ -5302,9 +5352,17 @@ void PILGlobalVariable::verify() const {
 
 /// Verify the module.
 void PILModule::verify() const {
+   verifyModule(llvm::None);
+}
+
+void PILModule::verifySampled(unsigned SampleKey) const {
+   verifyModule(SampleKey);
+}
+
+void PILModule::verifyModule(llvm::Optional<unsigned> SampleKey) const {
 #ifdef NDEBUG
    if (!getOptions().VerifyAll)
-    return;
+      return;
 #endif
    // Uniquing set to catch symbol name collisions.
    llvm::DenseSet<StringRef> symbolNames;
@@ -5322,7 +5380,10 @@ void PILModule::verify() const {
          llvm::errs() << "Symbol redefined: " << f.getName() << "!\n";
          assert(false && "triggering standard assertion failure routine");
       }
-      f.verify(SingleFunction);
+      if (SampleKey)
+         f.verifySampled(*SampleKey, SingleFunction);
+      else
+         f.verify(SingleFunction);
    }
 
    // Check all globals.
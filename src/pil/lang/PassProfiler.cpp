@@ -0,0 +1,297 @@
+//===--- PassProfiler.cpp - Per-pass profile of the PIL pipeline ----------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2017 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "pil-pass-profiler"
+
+#include "polarphp/pil/lang/PassProfiler.h"
+#include "polarphp/ast/AstContext.h"
+#include "polarphp/basic/Statistic.h"
+#include "polarphp/pil/lang/PILFunction.h"
+#include "polarphp/pil/lang/PILModule.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/YAMLParser.h"
+#include <algorithm>
+#include <atomic>
+
+using namespace polar;
+
+llvm::cl::opt<std::string> PILPassProfileFile(
+   "sil-pass-profile", llvm::cl::init(""),
+   llvm::cl::desc("Write a JSON report of the time, instruction count "
+                  "change, allocations and invalidations per PIL pass and "
+                  "function to this file"));
+
+llvm::cl::opt<std::string> PILPassProfileTraceFile(
+   "sil-pass-profile-trace", llvm::cl::init(""),
+   llvm::cl::desc("Write every PIL pass run to this file in the Chrome "
+                  "trace-event format"));
+
+llvm::cl::opt<unsigned> PILPassProfileTop(
+   "sil-pass-profile-top", llvm::cl::init(50),
+   llvm::cl::desc("The number of functions and pass runs listed in the "
+                  "-sil-pass-profile report"));
+
+/// Returns a small number which identifies the calling thread in traces.
+static unsigned getThreadIndex() {
+   static std::atomic<unsigned> NextThreadIndex{0};
+   static thread_local unsigned ThreadIndex = NextThreadIndex++;
+   return ThreadIndex;
+}
+
+static int64_t getNumInstructions(PILFunction &F) {
+   int64_t Count = 0;
+   for (auto &BB : F)
+      Count += std::distance(BB.begin(), BB.end());
+   return Count;
+}
+
+static int64_t getNumInstructions(PILModule &M) {
+   int64_t Count = 0;
+   for (auto &F : M)
+      Count += getNumInstructions(F);
+   return Count;
+}
+
+static uint64_t getMicroseconds(std::chrono::steady_clock::duration D) {
+   return std::chrono::duration_cast<std::chrono::microseconds>(D).count();
+}
+
+PILPassProfiler::PILPassProfiler(UnifiedStatsReporter *Reporter,
+                                 std::string ReportFilename,
+                                 std::string TraceFilename)
+   : StartedTime(std::chrono::steady_clock::now()), Reporter(Reporter),
+     ReportFilename(std::move(ReportFilename)),
+     TraceFilename(std::move(TraceFilename)) {}
+
+static thread_local PILPassProfiler::AllocationCounters
+   ThreadAllocationCounters;
+
+PILPassProfiler::AllocationCounters &
+PILPassProfiler::getThreadAllocationCounters() {
+   return ThreadAllocationCounters;
+}
+
+std::unique_ptr<PILPassProfiler> PILPassProfiler::create(PILModule &M) {
+   UnifiedStatsReporter *Reporter = M.getAstContext().Stats;
+   if (Reporter && !Reporter->isTracingEvents())
+      Reporter = nullptr;
+   if (!Reporter && PILPassProfileFile.empty() &&
+       PILPassProfileTraceFile.empty())
+      return nullptr;
+
+   std::string ReportFilename = PILPassProfileFile;
+   if (ReportFilename.empty() && Reporter)
+      ReportFilename = Reporter->makeOutputFileName("pil-pass-profile", "json");
+   return std::unique_ptr<PILPassProfiler>(
+      new PILPassProfiler(Reporter, std::move(ReportFilename),
+                          PILPassProfileTraceFile));
+}
+
+llvm::StringRef PILPassProfiler::uniqueName(llvm::StringRef Name) {
+   return Names.insert(Name).first->getKey();
+}
+
+PILPassProfiler::Sample PILPassProfiler::begin(PILModule &M, PILFunction *F,
+                                               unsigned NumInvalidations) {
+   Sample S;
+   S.NumInstructions = F ? getNumInstructions(*F) : getNumInstructions(M);
+   S.NumInvalidations = NumInvalidations;
+   S.Allocations = getThreadAllocationCounters();
+   S.StartTime = std::chrono::steady_clock::now();
+   return S;
+}
+
+void PILPassProfiler::end(const Sample &S, llvm::StringRef Stage,
+                          llvm::StringRef PassID, PILModule &M,
+                          PILFunction *F, unsigned NumInvalidations) {
+   auto Now = std::chrono::steady_clock::now();
+   const AllocationCounters &Allocations = getThreadAllocationCounters();
+
+   Record R;
+   R.StartUSec = getMicroseconds(S.StartTime - StartedTime);
+   R.DurationUSec = getMicroseconds(Now - S.StartTime);
+   R.ThreadIndex = getThreadIndex();
+   R.InstructionDelta = (F ? getNumInstructions(*F) : getNumInstructions(M)) -
+                        S.NumInstructions;
+   R.NumAllocations = Allocations.NumAllocations -
+                      S.Allocations.NumAllocations;
+   R.NumAllocatedBytes = Allocations.NumBytes - S.Allocations.NumBytes;
+   R.NumInvalidations = NumInvalidations - S.NumInvalidations;
+
+   if (Reporter) {
+      UnifiedStatsReporter::ChromeTraceEvent E;
+      E.Name = PassID.str();
+      E.Category = Stage.str();
+      // The reporter has its own time base.
+      uint64_t NowUSec = Reporter->getTraceTimeUSec();
+      E.DurationUSec = R.DurationUSec;
+      E.StartUSec = NowUSec > R.DurationUSec ? NowUSec - R.DurationUSec : 0;
+      E.ThreadIndex = R.ThreadIndex;
+      if (F)
+         E.EntityName = F->getName().str();
+      E.Args.push_back({"instruction_delta", R.InstructionDelta});
+      E.Args.push_back({"allocations", int64_t(R.NumAllocations)});
+      E.Args.push_back({"allocated_bytes", int64_t(R.NumAllocatedBytes)});
+      E.Args.push_back({"invalidations", R.NumInvalidations});
+      Reporter->recordChromeTraceEvent(std::move(E));
+   }
+
+   std::lock_guard<std::mutex> Lock(Mutex);
+   R.Stage = uniqueName(Stage);
+   R.Pass = uniqueName(PassID);
+   R.Function = F ? uniqueName(F->getName()) : llvm::StringRef();
+   Records.push_back(R);
+}
+
+void PILPassProfiler::printReport(llvm::raw_ostream &OS) const {
+   struct Totals {
+      unsigned NumRuns = 0;
+      uint64_t DurationUSec = 0;
+      int64_t InstructionDelta = 0;
+      uint64_t NumAllocations = 0;
+      uint64_t NumAllocatedBytes = 0;
+      uint64_t NumInvalidations = 0;
+
+      void add(const Record &R) {
+         ++NumRuns;
+         DurationUSec += R.DurationUSec;
+         InstructionDelta += R.InstructionDelta;
+         NumAllocations += R.NumAllocations;
+         NumAllocatedBytes += R.NumAllocatedBytes;
+         NumInvalidations += R.NumInvalidations;
+      }
+
+      void print(llvm::raw_ostream &OS) const {
+         OS << "\"runs\": " << NumRuns
+            << ", \"usec\": " << DurationUSec
+            << ", \"instruction_delta\": " << InstructionDelta
+            << ", \"allocations\": " << NumAllocations
+            << ", \"allocated_bytes\": " << NumAllocatedBytes
+            << ", \"invalidations\": " << NumInvalidations;
+      }
+   };
+   using NamedTotals = std::pair<llvm::StringRef, Totals>;
+
+   std::lock_guard<std::mutex> Lock(Mutex);
+
+   Totals All;
+   llvm::MapVector<llvm::StringRef, Totals> PassTotals;
+   llvm::MapVector<llvm::StringRef, Totals> FunctionTotals;
+   for (const Record &R : Records) {
+      All.add(R);
+      PassTotals[R.Pass].add(R);
+      if (!R.Function.empty())
+         FunctionTotals[R.Function].add(R);
+   }
+
+   // Most expensive first; ties keep the order of the first run.
+   auto sortByTime = [](std::vector<NamedTotals> &Entries) {
+      std::stable_sort(Entries.begin(), Entries.end(),
+                       [](const NamedTotals &LHS, const NamedTotals &RHS) {
+                          return LHS.second.DurationUSec >
+                                 RHS.second.DurationUSec;
+                       });
+   };
+   std::vector<NamedTotals> Passes(PassTotals.begin(), PassTotals.end());
+   sortByTime(Passes);
+   std::vector<NamedTotals> Functions(FunctionTotals.begin(),
+                                      FunctionTotals.end());
+   sortByTime(Functions);
+   if (Functions.size() > PILPassProfileTop)
+      Functions.resize(PILPassProfileTop);
+
+   std::vector<const Record *> Runs;
+   for (const Record &R : Records) {
+      if (!R.Function.empty())
+         Runs.push_back(&R);
+   }
+   std::stable_sort(Runs.begin(), Runs.end(),
+                    [](const Record *LHS, const Record *RHS) {
+                       return LHS->DurationUSec > RHS->DurationUSec;
+                    });
+   if (Runs.size() > PILPassProfileTop)
+      Runs.resize(PILPassProfileTop);
+
+   OS << "{\n  \"total\": {";
+   All.print(OS);
+   OS << "},\n  \"passes\": [";
+   for (unsigned I = 0, N = Passes.size(); I != N; ++I) {
+      OS << (I ? ",\n" : "\n") << "    {\"pass\": \""
+         << llvm::yaml::escape(Passes[I].first) << "\", ";
+      Passes[I].second.print(OS);
+      OS << '}';
+   }
+   OS << "\n  ],\n  \"functions\": [";
+   for (unsigned I = 0, N = Functions.size(); I != N; ++I) {
+      OS << (I ? ",\n" : "\n") << "    {\"function\": \""
+         << llvm::yaml::escape(Functions[I].first) << "\", ";
+      Functions[I].second.print(OS);
+      OS << '}';
+   }
+   OS << "\n  ],\n  \"runs\": [";
+   for (unsigned I = 0, N = Runs.size(); I != N; ++I) {
+      const Record &R = *Runs[I];
+      OS << (I ? ",\n" : "\n")
+         << "    {\"stage\": \"" << llvm::yaml::escape(R.Stage) << '"'
+         << ", \"pass\": \"" << llvm::yaml::escape(R.Pass) << '"'
+         << ", \"function\": \"" << llvm::yaml::escape(R.Function) << '"'
+         << ", \"usec\": " << R.DurationUSec
+         << ", \"instruction_delta\": " << R.InstructionDelta
+         << ", \"allocations\": " << R.NumAllocations
+         << ", \"allocated_bytes\": " << R.NumAllocatedBytes
+         << ", \"invalidations\": " << R.NumInvalidations << '}';
+   }
+   OS << "\n  ]\n}\n";
+}
+
+void PILPassProfiler::printTrace(llvm::raw_ostream &OS) const {
+   std::vector<UnifiedStatsReporter::ChromeTraceEvent> Events;
+   {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      Events.reserve(Records.size());
+      for (const Record &R : Records) {
+         UnifiedStatsReporter::ChromeTraceEvent E;
+         E.Name = R.Pass.str();
+         E.Category = R.Stage.str();
+         E.StartUSec = R.StartUSec;
+         E.DurationUSec = R.DurationUSec;
+         E.ThreadIndex = R.ThreadIndex;
+         E.EntityName = R.Function.str();
+         E.Args.push_back({"instruction_delta", R.InstructionDelta});
+         E.Args.push_back({"allocations", int64_t(R.NumAllocations)});
+         E.Args.push_back({"allocated_bytes", int64_t(R.NumAllocatedBytes)});
+         E.Args.push_back({"invalidations", R.NumInvalidations});
+         Events.push_back(std::move(E));
+      }
+   }
+   UnifiedStatsReporter::printChromeTraceEvents(Events, OS);
+}
+
+void PILPassProfiler::flush() const {
+   auto writeFile = [](llvm::StringRef Filename,
+                       llvm::function_ref<void(llvm::raw_ostream &)> Print) {
+      if (Filename.empty())
+         return;
+      std::error_code EC;
+      llvm::raw_fd_ostream OS(Filename, EC, llvm::sys::fs::F_Text);
+      if (EC) {
+         llvm::errs() << Filename << " : " << EC.message() << "\n";
+         return;
+      }
+      Print(OS);
+   };
+   writeFile(ReportFilename, [&](llvm::raw_ostream &OS) { printReport(OS); });
+   writeFile(TraceFilename, [&](llvm::raw_ostream &OS) { printTrace(OS); });
+}
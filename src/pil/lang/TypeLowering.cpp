@@ -28,6 +28,7 @@
 #include "polarphp/ast/PrettyStackTrace.h"
 #include "polarphp/ast/PropertyWrappers.h"
 #include "polarphp/ast/Types.h"
+#include "polarphp/basic/Statistic.h"
 #include "polarphp/clangimporter/ClangModule.h"
 #include "polarphp/pil/lang/PrettyStackTrace.h"
 #include "polarphp/pil/lang/PILArgument.h"
@@ -1365,11 +1366,23 @@ public:
 };
 } // end anonymous namespace
 
+/// The ID of the next TypeConverter, 0 marks unused per-thread cache entries.
+static std::atomic<uint64_t> NextThreadCacheID{1};
+
 TypeConverter::TypeConverter(ModuleDecl &m)
-   : M(m), Context(m.getAstContext()) {
+   : ThreadCacheID(NextThreadCacheID.fetch_add(1)),
+     M(m), Context(m.getAstContext()) {
 }
 
 TypeConverter::~TypeConverter() {
+   if (auto *Stats = Context.Stats) {
+      auto &C = Stats->getFrontendCounters();
+      C.NumTypeLoweringThreadCacheHits += NumThreadCacheHits;
+      C.NumTypeLoweringSharedCacheHits += NumSharedCacheHits;
+      C.NumTypeLoweringCacheHits += NumLoweringCacheHits;
+      C.NumTypeLoweringCacheMisses += NumLoweringCacheMisses;
+   }
+
    // The bump pointer allocator destructor will deallocate but not destroy all
    // our independent TypeLowerings.
    for (auto &ti : LoweredTypes) {
@@ -1383,6 +1396,7 @@ TypeConverter::~TypeConverter() {
 }
 
 void *TypeLowering::operator new(size_t size, TypeConverter &tc) {
+   auto lock = tc.lockCaches();
    return tc.TypeLoweringBPA.Allocate(size, alignof(TypeLowering&));
 }
 
@@ -1420,6 +1434,94 @@ void TypeConverter::insert(TypeKey k, const TypeLowering *tl) {
    LoweredTypes[k.getCachingKey()] = tl;
 }
 
+TypeConverter::ThreadCacheEntry *TypeConverter::getThreadCache() {
+   static thread_local ThreadCacheEntry Entries[NumThreadCacheEntries];
+   return Entries;
+}
+
+const TypeLowering *
+TypeConverter::findInThreadCache(const CachingTypeKey &key) {
+   unsigned hash = llvm::DenseMapInfo<CachingTypeKey>::getHashValue(key);
+   ThreadCacheEntry &entry =
+      getThreadCache()[hash & (NumThreadCacheEntries - 1)];
+   if (entry.ConverterID != ThreadCacheID || entry.Key != key)
+      return nullptr;
+   return entry.Lowering;
+}
+
+void TypeConverter::insertInThreadCache(const CachingTypeKey &key,
+                                        const TypeLowering *lowering) {
+   unsigned hash = llvm::DenseMapInfo<CachingTypeKey>::getHashValue(key);
+   ThreadCacheEntry &entry =
+      getThreadCache()[hash & (NumThreadCacheEntries - 1)];
+   entry.ConverterID = ThreadCacheID;
+   entry.Key = key;
+   entry.Lowering = lowering;
+}
+
+const TypeLowering *
+TypeConverter::findInSharedCache(const CachingTypeKey &key, unsigned hash) {
+   SharedCacheTable *table = SharedCache.load(std::memory_order_acquire);
+   if (!table)
+      return nullptr;
+   unsigned mask = table->NumSlots - 1;
+   for (unsigned slot = hash & mask;; slot = (slot + 1) & mask) {
+      const SharedCacheEntry *entry =
+         table->Slots[slot].load(std::memory_order_acquire);
+      if (!entry)
+         return nullptr;
+      if (entry->Key == key)
+         return entry->Lowering;
+   }
+}
+
+void TypeConverter::insertInSharedCache(const CachingTypeKey &key,
+                                        unsigned hash,
+                                        const TypeLowering *lowering) {
+   // Another thread may have published the key while we waited for the lock.
+   if (findInSharedCache(key, hash))
+      return;
+
+   using SlotTy = std::atomic<const SharedCacheEntry *>;
+   // Puts the entry into the first free slot of its probe sequence.
+   auto placeEntry = [](SlotTy *slots, unsigned numSlots, unsigned hash,
+                        const SharedCacheEntry *entry) {
+      unsigned mask = numSlots - 1;
+      unsigned slot = hash & mask;
+      while (slots[slot].load(std::memory_order_relaxed))
+         slot = (slot + 1) & mask;
+      slots[slot].store(entry, std::memory_order_release);
+   };
+   SharedCacheTable *table = SharedCache.load(std::memory_order_relaxed);
+   // Keep the table at most half full, so that probe sequences stay short
+   // and every lookup ends at an empty slot.
+   if (!table || (NumSharedCacheEntries + 1) * 2 > table->NumSlots) {
+      unsigned numSlots = table ? table->NumSlots * 2 : 256;
+      auto *slots = static_cast<SlotTy *>(
+         TypeLoweringBPA.Allocate(sizeof(SlotTy) * numSlots, alignof(SlotTy)));
+      for (unsigned i = 0; i != numSlots; ++i)
+         new (&slots[i]) SlotTy(nullptr);
+      if (table) {
+         for (unsigned i = 0; i != table->NumSlots; ++i) {
+            if (auto *entry = table->Slots[i].load(std::memory_order_relaxed))
+               placeEntry(
+                  slots, numSlots,
+                  llvm::DenseMapInfo<CachingTypeKey>::getHashValue(entry->Key),
+                  entry);
+         }
+      }
+      auto *newTable = new (TypeLoweringBPA.Allocate<SharedCacheTable>())
+         SharedCacheTable{numSlots, slots};
+      // Readers see either the old table or the complete new one.
+      SharedCache.store(newTable, std::memory_order_release);
+      table = newTable;
+   }
+   auto *entry = new (TypeLoweringBPA.Allocate<SharedCacheEntry>())
+      SharedCacheEntry{key, lowering};
+   placeEntry(table->Slots, table->NumSlots, hash, entry);
+   ++NumSharedCacheEntries;
+}
+
 /// Lower each of the elements of the substituted type according to
 /// the abstraction pattern of the given original type.
 static CanTupleType computeLoweredTupleType(TypeConverter &tc,
@@ -1514,6 +1616,7 @@ bool TypeConverter::hasOpaqueArchetypeOrPropertiesOrCases(CanType ty) {
    if (ty->hasOpaqueArchetype())
       return true;
 
+   auto lock = lockCaches();
    auto it = opaqueArchetypeFields.find(ty);
    if (it == opaqueArchetypeFields.end()) {
       bool res = ty->hasOpaqueArchetypePropertiesOrCases();
@@ -1527,6 +1630,41 @@ const TypeLowering &
 TypeConverter::getTypeLowering(AbstractionPattern origType,
                                Type origSubstType,
                                TypeExpansionContext forExpansion) {
+   // The lowering of a type only depends on the key, so a lowering which was
+   // handed out once can be returned again without the lock. Only types
+   // which are already canonical qualify, as canonicalizing a type may
+   // modify it. Contextual types are left out, they are rarely looked up
+   // outside of one function.
+   bool useThreadCache = origSubstType->isCanonical() &&
+                         !origSubstType->hasArchetype() &&
+                         origType.hasCachingKey();
+   // Lowerings of types without generic parameters are also shared with
+   // the other threads.
+   bool useSharedCache = false;
+   unsigned sharedCacheHash = 0;
+   CachingTypeKey threadCacheKey;
+   if (useThreadCache) {
+      threadCacheKey = getTypeKey(origType, CanType(origSubstType),
+                                  forExpansion).getCachingKey();
+      if (auto *lowering = findInThreadCache(threadCacheKey)) {
+         NumThreadCacheHits.fetch_add(1, std::memory_order_relaxed);
+         return *lowering;
+      }
+      useSharedCache = !threadCacheKey.Sig &&
+                       !origSubstType->hasTypeParameter();
+      if (useSharedCache) {
+         sharedCacheHash =
+            llvm::DenseMapInfo<CachingTypeKey>::getHashValue(threadCacheKey);
+         if (auto *lowering = findInSharedCache(threadCacheKey,
+                                                sharedCacheHash)) {
+            NumSharedCacheHits.fetch_add(1, std::memory_order_relaxed);
+            insertInThreadCache(threadCacheKey, lowering);
+            return *lowering;
+         }
+      }
+   }
+
+   auto lock = lockCaches();
    CanType substType = origSubstType->getCanonicalType();
    auto origHadOpaqueTypeArchetype =
       hasOpaqueArchetypeOrPropertiesOrCases(origSubstType->getCanonicalType());
@@ -1536,8 +1674,15 @@ TypeConverter::getTypeLowering(AbstractionPattern origType,
    auto *candidateLowering = find(key.getKeyForMinimalExpansion());
    auto *lowering = getTypeLoweringForExpansion(
       key, forExpansion, candidateLowering, origHadOpaqueTypeArchetype);
-   if (lowering != nullptr)
+   if (lowering != nullptr) {
+      ++NumLoweringCacheHits;
+      if (useSharedCache)
+         insertInSharedCache(threadCacheKey, sharedCacheHash, lowering);
+      if (useThreadCache)
+         insertInThreadCache(threadCacheKey, lowering);
       return *lowering;
+   }
+   ++NumLoweringCacheMisses;
 
 #ifndef NDEBUG
    // Catch reentrancy bugs.
@@ -1574,6 +1719,10 @@ TypeConverter::getTypeLowering(AbstractionPattern origType,
       removeNullEntry(key.getKeyForMinimalExpansion());
 #endif
    }
+   if (useSharedCache)
+      insertInSharedCache(threadCacheKey, sharedCacheHash, lowering);
+   if (useThreadCache)
+      insertInThreadCache(threadCacheKey, lowering);
    return *lowering;
 }
 
@@ -1735,6 +1884,7 @@ TypeConverter::getTypeLoweringForLoweredType(AbstractionPattern origType,
                                              CanType loweredType,
                                              TypeExpansionContext forExpansion,
                                              bool origHadOpaqueTypeArchetype) {
+   auto lock = lockCaches();
    assert(loweredType->isLegalPILType() && "type is not lowered!");
    (void)loweredType;
 
@@ -2174,6 +2324,7 @@ CaptureInfo
 TypeConverter::getLoweredLocalCaptures(PILDeclRef fn) {
    PrettyStackTracePILLocation stack("getting lowered local captures",
                                      fn.getAsRegularLocation(), Context);
+   auto lock = lockCaches();
 
    fn.isForeign = 0;
    fn.isCurried = 0;
@@ -2811,6 +2962,7 @@ static void countNumberOfInnerFields(unsigned &fieldsCount, TypeConverter &TC,
 unsigned TypeConverter::countNumberOfFields(PILType Ty,
                                             TypeExpansionContext expansion) {
    auto key = std::make_pair(Ty, unsigned(expansion.getResilienceExpansion()));
+   auto lock = lockCaches();
    auto Iter = TypeFields.find(key);
    if (Iter != TypeFields.end()) {
       return std::max(Iter->second, 1U);
@@ -19,6 +19,7 @@
 #include "polarphp/pil/optimizer/analysis/BasicCalleeAnalysis.h"
 #include "polarphp/pil/optimizer/passmgr/PassManager.h"
 #include "polarphp/pil/optimizer/utils/InstOptUtils.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/raw_ostream.h"
@@ -32,6 +33,17 @@ static llvm::cl::opt<bool> EnableInternalVerify(
    llvm::cl::desc("Enable internal verification of escape analysis"),
    llvm::cl::init(false));
 
+// Building and merging connection graphs of huge functions can take very long.
+// Such graphs are dropped and the function is treated conservatively.
+static llvm::cl::opt<unsigned> MaxGraphSize(
+   "escapes-max-graph-size",
+   llvm::cl::desc("The maximum number of nodes in a connection graph "
+                  "(0 means no limit)"),
+   llvm::cl::init(20000));
+
+STATISTIC(NumGraphsOverSizeLimit,
+          "Number of connection graphs dropped because of their size");
+
 // Returns true if \p Ty recursively contains a reference.  If \p mustBeRef is
 // true, only return true if the type is guaranteed to hold a reference. If \p
 // mustBeRef is false, only return false if the type is guaranteed not to hold a
@@ -407,15 +419,49 @@ bool EscapeAnalysis::CGNode::visitDefers(Visitor &&visitor) const {
 void EscapeAnalysis::ConnectionGraph::clear() {
    Values2Nodes.clear();
    Nodes.clear();
+   NumMergedNodes = 0;
    ReturnNode = nullptr;
    UsePoints.clear();
    UsePointTable.clear();
    NodeAllocator.DestroyAll();
+   Valid = true;
    assert(ToMerge.empty());
 }
 
+void EscapeAnalysis::ConnectionGraph::compactNodes() {
+   if (NumMergedNodes == 0)
+      return;
+   Nodes.erase(std::remove_if(Nodes.begin(), Nodes.end(),
+                              [](CGNode *Node) { return Node->isMerged; }),
+               Nodes.end());
+   NumMergedNodes = 0;
+}
+
+bool EscapeAnalysis::ConnectionGraph::checkSizeLimit() {
+   if (!Valid)
+      return true;
+   // Compact only if it frees a good part of Nodes, which keeps the cost of
+   // compaction linear in the number of merges.
+   if (NumMergedNodes > Nodes.size() / 2)
+      compactNodes();
+   if (MaxGraphSize == 0 || getNumLiveNodes() <= MaxGraphSize)
+      return false;
+
+   LLVM_DEBUG(llvm::dbgs() << "  drop " << (isSummaryGraph ? "summary " : "")
+                           << "graph of " << F->getName() << " with "
+                           << getNumLiveNodes() << " nodes\n");
+   ++NumGraphsOverSizeLimit;
+   invalidate();
+   return true;
+}
+
 EscapeAnalysis::CGNode *
 EscapeAnalysis::ConnectionGraph::getNode(ValueBase *V, bool createIfNeeded) {
+   // An invalid graph has no nodes. Clients treat values without a node as
+   // escaping.
+   if (!Valid)
+      return nullptr;
+
    if (isa<FunctionRefInst>(V) || isa<DynamicFunctionRefInst>(V) ||
        isa<PreviousDynamicFunctionRefInst>(V))
       return nullptr;
@@ -729,6 +775,7 @@ void EscapeAnalysis::ConnectionGraph::mergeAllScheduledNodes() {
 
       // Cleanup the merged node.
       From->isMerged = true;
+      ++NumMergedNodes;
 
       if (From->mappedValue) {
          if (To->mappedValue)
@@ -1615,7 +1662,12 @@ void EscapeAnalysis::buildConnectionGraph(FunctionInfo *FInfo,
       // Create edges for the instructions.
       for (auto &I : *BB) {
          analyzeInstruction(&I, FInfo, BottomUpOrder, RecursionDepth);
+         if (ConGraph->checkSizeLimit())
+            break;
       }
+      if (!ConGraph->isValid())
+         break;
+
       for (auto &Succ : BB->getSuccessors()) {
          if (VisitedBlocks.insert(Succ.getBB()).second)
             WorkList.push_back(Succ.getBB());
@@ -1624,6 +1676,8 @@ void EscapeAnalysis::buildConnectionGraph(FunctionInfo *FInfo,
 
    // Second step: create defer-edges for block arguments.
    for (PILBasicBlock &BB : *ConGraph->F) {
+      if (!ConGraph->isValid())
+         break;
       if (!linkBBArgs(&BB))
          continue;
 
@@ -2261,6 +2315,16 @@ void EscapeAnalysis::recompute(FunctionInfo *Initial) {
 bool EscapeAnalysis::mergeCalleeGraph(PILInstruction *AS,
                                       ConnectionGraph *CallerGraph,
                                       ConnectionGraph *CalleeGraph) {
+   if (!CallerGraph->isValid())
+      return false;
+
+   if (!CalleeGraph->isValid()) {
+      // The callee's summary was dropped because of its size. Nothing is known
+      // about the callee.
+      setAllEscaping(AS, CallerGraph);
+      return true;
+   }
+
    // This CGNodeMap uses an intrusive worklist to keep track of Mapped nodes
    // from the CalleeGraph. Meanwhile, mergeFrom uses separate intrusive
    // worklists to update nodes in the CallerGraph.
@@ -2314,11 +2378,22 @@ bool EscapeAnalysis::mergeCalleeGraph(PILInstruction *AS,
       if (CallerRetNd)
          Callee2CallerMapping.add(RetNd, CallerRetNd);
    }
-   return CallerGraph->mergeFrom(CalleeGraph, Callee2CallerMapping);
+   bool Changed = CallerGraph->mergeFrom(CalleeGraph, Callee2CallerMapping);
+   if (CallerGraph->checkSizeLimit())
+      return true;
+   return Changed;
 }
 
 bool EscapeAnalysis::mergeSummaryGraph(ConnectionGraph *SummaryGraph,
                                        ConnectionGraph *Graph) {
+   if (!SummaryGraph->isValid())
+      return false;
+
+   if (!Graph->isValid()) {
+      // Callers treat an invalid summary graph conservatively.
+      SummaryGraph->invalidate();
+      return true;
+   }
 
    // Make a 1-to-1 mapping of all arguments and the return value. This CGNodeMap
    // node map uses an intrusive worklist to keep track of Mapped nodes from the
@@ -2334,7 +2409,10 @@ bool EscapeAnalysis::mergeSummaryGraph(ConnectionGraph *SummaryGraph,
       Mapping.add(RetNd, SummaryGraph->getReturnNode());
    }
    // Merging actually creates the summary graph.
-   return SummaryGraph->mergeFrom(Graph, Mapping);
+   bool Changed = SummaryGraph->mergeFrom(Graph, Mapping);
+   if (SummaryGraph->checkSizeLimit())
+      return true;
+   return Changed;
 }
 
 bool EscapeAnalysis::canEscapeToUsePoint(PILValue V, PILNode *UsePoint,
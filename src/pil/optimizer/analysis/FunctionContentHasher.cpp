@@ -0,0 +1,389 @@
+//===--- FunctionContentHasher.cpp - Keys of persistent summaries --------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2018 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "polarphp/pil/optimizer/analysis/FunctionContentHasher.h"
+#include "polarphp/pil/lang/ApplySite.h"
+#include "polarphp/pil/lang/PILFunction.h"
+#include "polarphp/pil/lang/PILInstruction.h"
+#include "polarphp/pil/lang/PILUndef.h"
+#include "polarphp/pil/optimizer/analysis/BasicCalleeAnalysis.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace polar;
+
+static FunctionContentHasher::Digest finalizeDigest(llvm::MD5 &Hash) {
+   llvm::MD5::MD5Result Result;
+   Hash.final(Result);
+   FunctionContentHasher::Digest Str;
+   llvm::MD5::stringifyResult(Result, Str);
+   return Str;
+}
+
+static void hashInt(llvm::MD5 &Hash, uint64_t Value) {
+   uint8_t Bytes[sizeof(Value)];
+   llvm::support::endian::write64le(Bytes, Value);
+   Hash.update(Bytes);
+}
+
+static void hashString(llvm::MD5 &Hash, llvm::StringRef Str) {
+   // The length keeps adjacent strings apart.
+   hashInt(Hash, Str.size());
+   Hash.update(Str);
+}
+
+/// Add the state of \p I which its kind, operands, results and successors
+/// don't cover. Returns false for the instructions which are not handled
+/// here.
+static bool hashInstructionState(llvm::MD5 &Hash, PILInstruction &I) {
+   switch (I.getKind()) {
+      case PILInstructionKind::StructInst:
+      case PILInstructionKind::TupleInst:
+      case PILInstructionKind::ReturnInst:
+      case PILInstructionKind::UnreachableInst:
+      case PILInstructionKind::BranchInst:
+      case PILInstructionKind::DeallocStackInst:
+      case PILInstructionKind::IndexAddrInst:
+      case PILInstructionKind::UpcastInst:
+      case PILInstructionKind::UncheckedRefCastInst:
+      case PILInstructionKind::AddressToPointerInst:
+      case PILInstructionKind::CopyValueInst:
+         return true;
+      case PILInstructionKind::CondBranchInst:
+         // The operands don't tell which successor an argument goes to.
+         hashInt(Hash, cast<CondBranchInst>(I).getNumTrueArgs());
+         return true;
+      case PILInstructionKind::StrongRetainInst:
+      case PILInstructionKind::StrongReleaseInst:
+      case PILInstructionKind::RetainValueInst:
+      case PILInstructionKind::ReleaseValueInst:
+         hashInt(Hash, cast<RefCountingInst>(I).isAtomic());
+         return true;
+      case PILInstructionKind::IntegerLiteralInst: {
+         llvm::SmallString<32> Value;
+         cast<IntegerLiteralInst>(I).getValue().toString(Value, 16,
+                                                         /*Signed*/ true);
+         hashString(Hash, Value);
+         return true;
+      }
+      case PILInstructionKind::FloatLiteralInst: {
+         llvm::SmallString<32> Bits;
+         cast<FloatLiteralInst>(I).getBits().toString(Bits, 16,
+                                                      /*Signed*/ false);
+         hashString(Hash, Bits);
+         return true;
+      }
+      case PILInstructionKind::StringLiteralInst: {
+         auto &SLI = cast<StringLiteralInst>(I);
+         hashInt(Hash, unsigned(SLI.getEncoding()));
+         hashString(Hash, SLI.getValue());
+         return true;
+      }
+      case PILInstructionKind::FunctionRefInst:
+      case PILInstructionKind::DynamicFunctionRefInst:
+      case PILInstructionKind::PreviousDynamicFunctionRefInst:
+         hashString(Hash, cast<FunctionRefBaseInst>(I)
+                             .getInitiallyReferencedFunction()->getName());
+         return true;
+      case PILInstructionKind::GlobalAddrInst:
+      case PILInstructionKind::GlobalValueInst:
+         hashString(Hash,
+                    cast<GlobalAccessInst>(I).getReferencedGlobal()->getName());
+         return true;
+      case PILInstructionKind::BuiltinInst: {
+         auto &BI = cast<BuiltinInst>(I);
+         if (BI.hasSubstitutions())
+            return false;
+         hashString(Hash, BI.getName().str());
+         return true;
+      }
+      case PILInstructionKind::TupleExtractInst:
+         hashInt(Hash, cast<TupleExtractInst>(I).getFieldNo());
+         return true;
+      case PILInstructionKind::TupleElementAddrInst:
+         hashInt(Hash, cast<TupleElementAddrInst>(I).getFieldNo());
+         return true;
+      case PILInstructionKind::StructExtractInst:
+         hashInt(Hash, cast<StructExtractInst>(I).getFieldNo());
+         return true;
+      case PILInstructionKind::StructElementAddrInst:
+         hashInt(Hash, cast<StructElementAddrInst>(I).getFieldNo());
+         return true;
+      case PILInstructionKind::RefElementAddrInst:
+         hashInt(Hash, cast<RefElementAddrInst>(I).getFieldNo());
+         return true;
+      case PILInstructionKind::LoadInst:
+         hashInt(Hash, unsigned(cast<LoadInst>(I).getOwnershipQualifier()));
+         return true;
+      case PILInstructionKind::StoreInst:
+         hashInt(Hash, unsigned(cast<StoreInst>(I).getOwnershipQualifier()));
+         return true;
+      case PILInstructionKind::ApplyInst: {
+         auto &AI = cast<ApplyInst>(I);
+         if (AI.hasSubstitutions() || AI.getSpecializationInfo())
+            return false;
+         hashInt(Hash, AI.isNonThrowing());
+         return true;
+      }
+      default:
+         return false;
+   }
+}
+
+// -----------------------------------------------------------------------------
+// FunctionContentHasher
+// -----------------------------------------------------------------------------
+
+llvm::StringRef FunctionContentHasher::getTypeString(PILType Ty) {
+   std::string &Str = TypeStrings[Ty.getOpaqueValue()];
+   if (Str.empty())
+      Str = Ty.getAsString();
+   return Str;
+}
+
+bool FunctionContentHasher::hashStructurally(llvm::MD5 &Hash, PILFunction *F) {
+   // The attributes which summaries depend on, like @_effects and semantics.
+   Hash.update("structural\n");
+   hashInt(Hash, unsigned(F->getLinkage()));
+   hashInt(Hash, unsigned(F->getEffectsKind()));
+   hashInt(Hash, unsigned(F->getInlineStrategy()));
+   hashInt(Hash, unsigned(F->isThunk()));
+   hashInt(Hash, unsigned(F->isTransparent()));
+   hashInt(Hash, unsigned(F->isSerialized()));
+   hashInt(Hash, unsigned(F->getOptimizationMode()));
+   hashInt(Hash, F->getSemanticsAttrs().size());
+   for (const std::string &Attr : F->getSemanticsAttrs())
+      hashString(Hash, Attr);
+   hashString(Hash, getTypeString(
+                       PILType::getPrimitiveObjectType(F->getLoweredFunctionType())));
+
+   // Values are hashed by their position, blocks by their order, so the
+   // numbering is the same in every compilation. A use may come before its
+   // definition in block order, so everything is numbered up front.
+   llvm::DenseMap<ValueBase *, unsigned> ValueIDs;
+   llvm::DenseMap<const PILBasicBlock *, unsigned> BlockIDs;
+   unsigned NextBlockID = 0;
+   unsigned NextValueID = 0;
+   for (auto &BB : *F) {
+      BlockIDs[&BB] = NextBlockID++;
+      for (PILArgument *Arg : BB.getArguments())
+         ValueIDs[Arg] = NextValueID++;
+      for (auto &I : BB) {
+         for (PILValue Result : I.getResults())
+            ValueIDs[Result] = NextValueID++;
+      }
+   }
+
+   for (auto &BB : *F) {
+      Hash.update("bb");
+      hashInt(Hash, BB.getNumArguments());
+      for (PILArgument *Arg : BB.getArguments()) {
+         hashString(Hash, getTypeString(Arg->getType()));
+         hashInt(Hash, unsigned(Arg->getOwnershipKind()));
+      }
+      for (auto &I : BB) {
+         hashInt(Hash, unsigned(I.getKind()));
+         if (!hashInstructionState(Hash, I))
+            return false;
+         auto Operands = I.getAllOperands();
+         hashInt(Hash, Operands.size());
+         for (const Operand &Op : Operands) {
+            PILValue V = Op.get();
+            auto Found = ValueIDs.find(V);
+            if (Found != ValueIDs.end()) {
+               hashInt(Hash, Found->second);
+            } else if (isa<PILUndef>(V)) {
+               Hash.update("undef");
+               hashString(Hash, getTypeString(V->getType()));
+            } else {
+               return false;
+            }
+         }
+         auto Results = I.getResults();
+         hashInt(Hash, Results.size());
+         for (PILValue Result : Results)
+            hashString(Hash, getTypeString(Result->getType()));
+         if (auto *TI = dyn_cast<TermInst>(&I)) {
+            for (const PILSuccessor &Succ : TI->getSuccessors())
+               hashInt(Hash, BlockIDs.lookup(Succ.getBB()));
+         }
+      }
+   }
+   return true;
+}
+
+const FunctionContentHasher::LocalInfo &
+FunctionContentHasher::getLocalInfo(PILFunction *F) {
+   auto Iter = LocalInfos.find(F);
+   if (Iter != LocalInfos.end())
+      return Iter->second;
+
+   LocalInfo Info;
+   llvm::MD5 Hash;
+
+   // Most functions are hashed instruction by instruction. The ones with
+   // instructions whose state isn't encoded structurally are printed, which
+   // covers everything but is much slower.
+   llvm::MD5 BodyHash;
+   if (!hashStructurally(BodyHash, F)) {
+      BodyHash = llvm::MD5();
+      BodyHash.update("printed\n");
+      std::string Text;
+      llvm::raw_string_ostream OS(Text);
+      F->print(OS);
+      OS.flush();
+      BodyHash.update(Text);
+   }
+   Hash.update(finalizeDigest(BodyHash));
+
+   // Which functions an apply site may call depends on the rest of the module,
+   // e.g. on the subclasses overriding a method, so it is part of the hash.
+   for (auto &BB : *F) {
+      for (auto &I : BB) {
+         auto FAS = FullApplySite::isa(&I);
+         if (!FAS)
+            continue;
+         CalleeList Callees = BCA->getCalleeList(FAS);
+         Hash.update(Callees.allCalleesVisible() ? "|v" : "|i");
+         for (PILFunction *Callee : Callees) {
+            Hash.update(";");
+            Hash.update(Callee->getName());
+            Info.Callees.push_back(Callee);
+         }
+      }
+   }
+   Info.LocalDigest = finalizeDigest(Hash);
+   return LocalInfos[F] = std::move(Info);
+}
+
+void FunctionContentHasher::computeComponentDigests(
+   llvm::ArrayRef<PILFunction *> Component) {
+   // Function names are unique in a module, which makes the order canonical.
+   llvm::SmallVector<PILFunction *, 4> Members(Component.begin(),
+                                               Component.end());
+   std::sort(Members.begin(), Members.end(),
+             [](PILFunction *LHS, PILFunction *RHS) {
+                return LHS->getName() < RHS->getName();
+             });
+   llvm::SmallPtrSet<PILFunction *, 4> InComponent(Members.begin(),
+                                                   Members.end());
+
+   // The component is covered by the local digests of its members and the
+   // closure digests of the callees outside of it.
+   llvm::MD5 Hash;
+   llvm::SmallVector<Digest, 8> CalleeDigests;
+   for (PILFunction *Member : Members) {
+      const LocalInfo &Info = getLocalInfo(Member);
+      Hash.update(Member->getName());
+      Hash.update(" ");
+      Hash.update(Info.LocalDigest);
+      Hash.update("\n");
+      for (PILFunction *Callee : Info.Callees) {
+         if (!InComponent.count(Callee))
+            CalleeDigests.push_back(ClosureDigests.find(Callee)->second);
+      }
+   }
+   std::sort(CalleeDigests.begin(), CalleeDigests.end());
+   CalleeDigests.erase(std::unique(CalleeDigests.begin(), CalleeDigests.end()),
+                       CalleeDigests.end());
+   for (const Digest &CalleeDigest : CalleeDigests) {
+      Hash.update(CalleeDigest);
+      Hash.update("\n");
+   }
+   Digest ComponentDigest = finalizeDigest(Hash);
+
+   // The function itself goes first, so that functions of a call cycle get
+   // distinct keys.
+   for (PILFunction *Member : Members) {
+      llvm::MD5 MemberHash;
+      MemberHash.update(Member->getName());
+      MemberHash.update(" ");
+      MemberHash.update(ComponentDigest);
+      ClosureDigests[Member] = finalizeDigest(MemberHash);
+   }
+}
+
+FunctionContentHasher::Digest
+FunctionContentHasher::getClosureDigest(PILFunction *F) {
+   auto Iter = ClosureDigests.find(F);
+   if (Iter != ClosureDigests.end())
+      return Iter->second;
+
+   // Find the strongly connected components reachable from F with Tarjan's
+   // algorithm, without recursion, and compute their digests bottom-up. Each
+   // function is hashed once, no matter how many closures contain it.
+   struct NodeInfo {
+      unsigned Index;
+      unsigned LowLink;
+      bool OnStack;
+   };
+   struct Frame {
+      PILFunction *Func;
+      unsigned NextCallee;
+   };
+   llvm::DenseMap<PILFunction *, NodeInfo> Nodes;
+   llvm::SmallVector<PILFunction *, 16> Stack;
+   llvm::SmallVector<Frame, 16> CallStack;
+
+   auto visit = [&](PILFunction *Func) {
+      unsigned Index = Nodes.size();
+      Nodes[Func] = {Index, Index, true};
+      Stack.push_back(Func);
+      CallStack.push_back({Func, 0});
+   };
+
+   visit(F);
+   while (!CallStack.empty()) {
+      PILFunction *Cur = CallStack.back().Func;
+      // References into LocalInfos are not kept across calls to getLocalInfo,
+      // which may grow the map.
+      const LocalInfo &Info = getLocalInfo(Cur);
+      unsigned CalleeIdx = CallStack.back().NextCallee;
+      if (CalleeIdx < Info.Callees.size()) {
+         PILFunction *Callee = Info.Callees[CalleeIdx];
+         ++CallStack.back().NextCallee;
+         if (ClosureDigests.count(Callee))
+            continue;
+         auto CalleeNode = Nodes.find(Callee);
+         if (CalleeNode == Nodes.end()) {
+            visit(Callee);
+         } else if (CalleeNode->second.OnStack) {
+            NodeInfo &CurNode = Nodes[Cur];
+            CurNode.LowLink =
+               std::min(CurNode.LowLink, CalleeNode->second.Index);
+         }
+         continue;
+      }
+
+      CallStack.pop_back();
+      NodeInfo CurNode = Nodes[Cur];
+      if (!CallStack.empty()) {
+         NodeInfo &ParentNode = Nodes[CallStack.back().Func];
+         ParentNode.LowLink = std::min(ParentNode.LowLink, CurNode.LowLink);
+      }
+      if (CurNode.LowLink != CurNode.Index)
+         continue;
+
+      // Cur is the root of a component, its members are on top of the stack.
+      llvm::SmallVector<PILFunction *, 4> Component;
+      PILFunction *Member;
+      do {
+         Member = Stack.pop_back_val();
+         Nodes[Member].OnStack = false;
+         Component.push_back(Member);
+      } while (Member != Cur);
+      computeComponentDigests(Component);
+   }
+   return ClosureDigests.find(F)->second;
+}
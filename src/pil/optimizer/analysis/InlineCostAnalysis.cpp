@@ -0,0 +1,71 @@
+//===--- InlineCostAnalysis.cpp - Inlining cost summaries -----------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2017 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "pil-inline-cost"
+
+#include "polarphp/pil/optimizer/analysis/InlineCostAnalysis.h"
+#include "polarphp/pil/optimizer/analysis/ColdBlockInfo.h"
+#include "polarphp/pil/optimizer/analysis/DominanceAnalysis.h"
+#include "polarphp/pil/optimizer/analysis/LoopAnalysis.h"
+#include "polarphp/pil/optimizer/passmgr/PassManager.h"
+#include "llvm/ADT/Statistic.h"
+
+using namespace polar;
+
+STATISTIC(NumCostSummaries, "Number of computed inline cost summaries");
+STATISTIC(NumShortestPaths, "Number of computed callee shortest paths");
+
+InlineCostSummary::InlineCostSummary(PILFunction *F, DominanceAnalysis *DA,
+                                     PILLoopAnalysis *LA)
+   : F(F), DA(DA), LA(LA) {
+   ++NumCostSummaries;
+   for (PILBasicBlock &Block : *F) {
+      for (PILInstruction &I : Block) {
+         Cost += int(instructionInlineCost(I));
+      }
+   }
+}
+
+ShortestPathAnalysis *InlineCostSummary::getShortestPaths() {
+   if (SPA)
+      return SPA.get();
+
+   ++NumShortestPaths;
+   // The loop info is invalidated with the function body, like the summary,
+   // so it outlives the analysis which refers to it.
+   SPA = std::make_unique<ShortestPathAnalysis>(F, LA->get(F));
+
+   // The cold block info only caches per-block results, it must not outlive
+   // the blocks.
+   ColdBlockInfo CBI(DA);
+   SPA->analyze(CBI, [](FullApplySite FAS) {
+      // We don't compute SPA for another call-level. Functions called from
+      // the callee are assumed to have DefaultApplyLength.
+      return int(ShortestPathAnalysis::DefaultApplyLength);
+   });
+   return SPA.get();
+}
+
+std::unique_ptr<InlineCostSummary>
+InlineCostAnalysis::newFunctionAnalysis(PILFunction *F) {
+   assert(DA && LA && "analysis is not initialized");
+   return std::make_unique<InlineCostSummary>(F, DA, LA);
+}
+
+void InlineCostAnalysis::initialize(PILPassManager *PM) {
+   DA = PM->getAnalysis<DominanceAnalysis>();
+   LA = PM->getAnalysis<PILLoopAnalysis>();
+}
+
+PILAnalysis *polar::createInlineCostAnalysis(PILModule *M) {
+   return new InlineCostAnalysis(M);
+}
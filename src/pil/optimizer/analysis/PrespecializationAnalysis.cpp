@@ -0,0 +1,112 @@
+//===--- PrespecializationAnalysis.cpp - Prespecialization cache ----------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2018 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://swift.org/LICENSE.txt for license information
+// See https://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "pil-prespecialization-cache"
+
+#include "polarphp/pil/optimizer/analysis/PrespecializationAnalysis.h"
+#include "polarphp/ast/AstContext.h"
+#include "polarphp/ast/Module.h"
+#include "polarphp/pil/lang/FunctionSummaryCache.h"
+#include "polarphp/pil/lang/PILModule.h"
+#include "polarphp/pil/optimizer/passmgr/PassManager.h"
+#include "polarphp/serialization/SerializedPILLoader.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/CommandLine.h"
+
+using namespace polar;
+
+STATISTIC(NumPrespecializationsRecorded,
+          "Number of public specializations recorded");
+STATISTIC(NumPrespecializationsFound,
+          "Number of recorded specializations of imported modules found");
+
+/// Overrides PILOptions::PrespecializationCacheFile.
+static llvm::cl::opt<std::string> PILPrespecializationCacheFile(
+   "sil-prespecialization-cache", llvm::cl::init(""),
+   llvm::cl::desc("The file recording the public specializations of the "
+                  "modules of a build"));
+
+static llvm::cl::opt<unsigned> PILPrespecializationCacheMaxAge(
+   "sil-prespecialization-cache-max-age", llvm::cl::init(8),
+   llvm::cl::desc("Drop recorded specializations which were not used by "
+                  "this number of compilations"));
+
+static const char *const PrespecializationKind = "prespec";
+
+/// Mangled names are stored as cache keys, which must not contain separators.
+static bool isStorableName(llvm::StringRef Name) {
+   return !Name.empty() && Name.find_first_of(" \n") == llvm::StringRef::npos;
+}
+
+void PrespecializationAnalysis::initialize(PILPassManager *PM) {
+   std::string CacheFile = PILPrespecializationCacheFile.empty()
+                           ? PM->getOptions().PrespecializationCacheFile
+                           : PILPrespecializationCacheFile;
+   if (CacheFile.empty())
+      return;
+
+   Cache = &Mod->getSummaryCache(CacheFile, PILPrespecializationCacheMaxAge);
+}
+
+PILFunction *
+PrespecializationAnalysis::findPrespecialization(llvm::StringRef SpecName) {
+   if (!Cache || !isStorableName(SpecName))
+      return nullptr;
+
+   auto ModuleName = Cache->lookup(PrespecializationKind, SpecName);
+   if (!ModuleName)
+      return nullptr;
+
+   // Only a module which is imported can provide the symbol. A specialization
+   // the current module defined in an earlier build is not reused, it is
+   // created again if still needed.
+   ModuleDecl *CurModule = Mod->getPolarphpModule();
+   if (CurModule->getName().str() == *ModuleName)
+      return nullptr;
+   AstContext &Ctx = Mod->getAstContext();
+   if (!Ctx.getLoadedModule(Ctx.getIdentifier(*ModuleName)))
+      return nullptr;
+
+   // The record may be stale, e.g. if the module was rebuilt without the
+   // specialization. Only link the symbol if a loaded module still exports it
+   // as a public function.
+   if (!Mod->getPILLoader()->hasPILFunction(SpecName, PILLinkage::Public))
+      return nullptr;
+   PILFunction *Specialization =
+      Mod->findFunction(SpecName, PILLinkage::PublicExternal);
+   if (!Specialization)
+      return nullptr;
+
+   // Only an entry which was actually used stays young.
+   Cache->markUsed(PrespecializationKind, SpecName);
+   ++NumPrespecializationsFound;
+   return Specialization;
+}
+
+void PrespecializationAnalysis::finish() {
+   if (!Cache)
+      return;
+
+   // The module saves the cache, so that it is written once per compilation.
+   llvm::StringRef ModuleName = Mod->getPolarphpModule()->getName().str();
+   for (PILFunction &F : *Mod) {
+      if (!F.isDefinition() || !F.isSpecialization() ||
+          F.getLinkage() != PILLinkage::Public || !isStorableName(F.getName()))
+         continue;
+      Cache->insert(PrespecializationKind, F.getName(), ModuleName);
+      ++NumPrespecializationsRecorded;
+   }
+}
+
+PILAnalysis *polar::createPrespecializationAnalysis(PILModule *M) {
+   return new PrespecializationAnalysis(M);
+}
@@ -13,14 +13,35 @@
 #define DEBUG_TYPE "pil-sea"
 
 #include "polarphp/pil/optimizer/analysis/SideEffectAnalysis.h"
+#include "polarphp/pil/lang/FunctionSummaryCache.h"
 #include "polarphp/pil/lang/PILArgument.h"
 #include "polarphp/pil/optimizer/analysis/AccessedStorageAnalysis.h"
 #include "polarphp/pil/optimizer/analysis/BasicCalleeAnalysis.h"
 #include "polarphp/pil/optimizer/analysis/FunctionOrder.h"
 #include "polarphp/pil/optimizer/passmgr/PassManager.h"
+#include "polarphp/ast/PILOptions.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CommandLine.h"
 
 using namespace polar;
 
+STATISTIC(NumSummariesReloaded,
+          "Number of function side-effects reloaded from the summary cache");
+STATISTIC(NumSummariesStored,
+          "Number of function side-effects stored in the summary cache");
+
+/// Overrides PILOptions::SummaryCacheFile.
+static llvm::cl::opt<std::string> PILSummaryCacheFile(
+   "sil-summary-cache", llvm::cl::init(""),
+   llvm::cl::desc("Reload and store function side-effect summaries in the "
+                  "given file"));
+
+static llvm::cl::opt<unsigned> PILSummaryCacheMaxAge(
+   "sil-summary-cache-max-age", llvm::cl::init(8),
+   llvm::cl::desc("Drop cached summaries which were not used by this many "
+                  "compilations"));
+
 // -----------------------------------------------------------------------------
 // GenericFunctionEffectAnalysis
 // -----------------------------------------------------------------------------
@@ -81,6 +102,22 @@ void GenericFunctionEffectAnalysis<FunctionEffects>::analyzeFunction(
    if (functionInfo->functionEffects.summarizeFunction(F))
       return;
 
+   // An earlier compilation might already have computed the effects of this
+   // function and everything it calls. The callees are not analyzed then, but
+   // they still need to know their caller: invalidating a callee must also
+   // invalidate the reloaded effects.
+   if (loadPersistentEffects(F, functionInfo->functionEffects)) {
+      LLVM_DEBUG(llvm::dbgs() << "  -- reloaded summary " << F->getName()
+                              << '\n');
+      for (auto &BB : *F) {
+         for (auto &I : BB) {
+            if (auto fullApply = FullApplySite::isa(&I))
+               addCallerEdges(functionInfo, fullApply);
+         }
+      }
+      return;
+   }
+
    LLVM_DEBUG(llvm::dbgs() << "  >> analyze " << F->getName() << '\n');
 
    // Check all instructions of the function
@@ -132,6 +169,24 @@ void GenericFunctionEffectAnalysis<FunctionEffects>::analyzeCall(
    }
 }
 
+template <typename FunctionEffects>
+void GenericFunctionEffectAnalysis<FunctionEffects>::addCallerEdges(
+   FunctionInfo *functionInfo, FullApplySite fullApply) {
+   // Calls which analyzeCall() summarizes or treats as worst case do not
+   // depend on the callees' effects.
+   FunctionEffects applyEffects;
+   if (applyEffects.summarizeCall(fullApply))
+      return;
+
+   CalleeList callees = BCA->getCalleeList(fullApply);
+   if (!callees.allCalleesVisible() ||
+       fullApply.getOrigCalleeType()->isCalleeConsumed())
+      return;
+
+   for (PILFunction *callee : callees)
+      getFunctionInfo(callee)->addCaller(functionInfo, fullApply);
+}
+
 template <typename FunctionEffects>
 void GenericFunctionEffectAnalysis<FunctionEffects>::recompute(
    FunctionInfo *initialInfo) {
@@ -259,6 +314,49 @@ bool FunctionSideEffects::mergeFromApply(
 
 void FunctionSideEffects::dump() const { llvm::errs() << *this << '\n'; }
 
+// The payload is "<global><local>/<param>.../<flags>", where each effect is a
+// single hex digit of FunctionSideEffectFlags bits and flags packs
+// AllocsObjects, Traps and ReadsRC.
+void FunctionSideEffects::writeSummary(raw_ostream &os) const {
+   os << llvm::hexdigit(GlobalEffects.getBits())
+      << llvm::hexdigit(LocalEffects.getBits()) << '/';
+   for (auto &E : ParamEffects)
+      os << llvm::hexdigit(E.getBits());
+   os << '/'
+      << llvm::hexdigit((AllocsObjects ? 1 : 0) | (Traps ? 2 : 0) |
+                        (ReadsRC ? 4 : 0));
+}
+
+bool FunctionSideEffects::readSummary(StringRef payload, unsigned numParams) {
+   SmallVector<StringRef, 3> fields;
+   payload.split(fields, '/');
+   if (fields.size() != 3 || fields[0].size() != 2 ||
+       fields[1].size() != numParams || fields[2].size() != 1)
+      return false;
+
+   SmallVector<unsigned, 8> bits;
+   for (StringRef field : fields) {
+      for (char c : field) {
+         unsigned value = llvm::hexDigitValue(c);
+         if (value > FunctionSideEffectFlags::AllBits)
+            return false;
+         bits.push_back(value);
+      }
+   }
+   if (bits.back() > 7)
+      return false;
+
+   GlobalEffects.setBits(bits[0]);
+   LocalEffects.setBits(bits[1]);
+   ParamEffects.resize(numParams);
+   for (unsigned idx = 0; idx < numParams; ++idx)
+      ParamEffects[idx].setBits(bits[2 + idx]);
+   AllocsObjects = bits.back() & 1;
+   Traps = bits.back() & 2;
+   ReadsRC = bits.back() & 4;
+   return true;
+}
+
 static PILValue skipAddrProjections(PILValue V) {
    for (;;) {
       switch (V->getKind()) {
@@ -593,6 +691,87 @@ void FunctionSideEffects::analyzeInstruction(PILInstruction *I) {
       Traps = true;
 }
 
+// -----------------------------------------------------------------------------
+// SideEffectAnalysis
+// -----------------------------------------------------------------------------
+
+/// The kind of the side-effect entries in the summary cache.
+static const char *const SideEffectSummaryKind = "side-effect";
+
+void SideEffectAnalysis::finish() {
+   if (!summaryCache)
+      return;
+
+   // Store the effects of every function whose body was analyzed. The module
+   // saves the cache, so that it is written once per compilation.
+   forEachValidEffects([&](PILFunction *F, const FunctionSideEffects &effects) {
+      if (!F->isDefinition() || F->isDynamicallyReplaceable())
+         return;
+      std::string payload;
+      llvm::raw_string_ostream os(payload);
+      effects.writeSummary(os);
+      os.flush();
+      summaryCache->insert(SideEffectSummaryKind,
+                           hasher->getClosureDigest(F), payload);
+      ++NumSummariesStored;
+   });
+}
+
+void SideEffectAnalysis::initialize(PILPassManager *PM) {
+   GenericFunctionEffectAnalysis<FunctionSideEffects>::initialize(PM);
+
+   std::string summaryCacheFile = PILSummaryCacheFile.empty()
+                                  ? PM->getOptions().SummaryCacheFile
+                                  : PILSummaryCacheFile;
+   if (summaryCacheFile.empty())
+      return;
+
+   summaryCache = &PM->getModule()->getSummaryCache(summaryCacheFile,
+                                                    PILSummaryCacheMaxAge);
+   hasher = std::make_unique<FunctionContentHasher>(BCA);
+}
+
+void SideEffectAnalysis::invalidate() {
+   if (hasher)
+      hasher->invalidate();
+   GenericFunctionEffectAnalysis<FunctionSideEffects>::invalidate();
+}
+
+void SideEffectAnalysis::invalidate(PILFunction *F, InvalidationKind K) {
+   if (hasher)
+      hasher->invalidate(F);
+   GenericFunctionEffectAnalysis<FunctionSideEffects>::invalidate(F, K);
+}
+
+void SideEffectAnalysis::notifyAddedOrModifiedFunction(PILFunction *F) {
+   if (hasher)
+      hasher->invalidate(F);
+}
+
+void SideEffectAnalysis::notifyWillDeleteFunction(PILFunction *F) {
+   invalidate(F, InvalidationKind::Nothing);
+}
+
+void SideEffectAnalysis::invalidateFunctionTables() {
+   // The callee lists of class and witness method calls may have changed.
+   if (hasher)
+      hasher->invalidate();
+}
+
+bool SideEffectAnalysis::loadPersistentEffects(PILFunction *F,
+                                               FunctionSideEffects &effects) {
+   if (!summaryCache)
+      return false;
+
+   FunctionContentHasher::Digest key = hasher->getClosureDigest(F);
+   auto payload = summaryCache->lookup(SideEffectSummaryKind, key);
+   if (!payload || !effects.readSummary(*payload, F->getArguments().size()))
+      return false;
+   summaryCache->markUsed(SideEffectSummaryKind, key);
+   ++NumSummariesReloaded;
+   return true;
+}
+
 PILAnalysis *polar::createSideEffectAnalysis(PILModule *M) {
    return new SideEffectAnalysis();
 }
@@ -320,7 +320,7 @@ bool ARCRegionState::processBlockBottomUp(
 // not handle early exits, but do handle trapping blocks.
 static bool getInsertionPtsForLoopRegionExits(
    const LoopRegion *R, LoopRegionFunctionInfo *LRFI,
-   llvm::DenseMap<const LoopRegion *, ARCRegionState *> &RegionStateInfo,
+   ARCRegionStateMap &RegionStateInfo,
    llvm::SmallVectorImpl<PILInstruction *> &InsertPts) {
    assert(R->isLoop() && "Expected a loop region that is representing a loop");
 
@@ -351,7 +351,7 @@ static bool getInsertionPtsForLoopRegionExits(
 
 bool ARCRegionState::processLoopBottomUp(
    const LoopRegion *R, AliasAnalysis *AA, LoopRegionFunctionInfo *LRFI,
-   llvm::DenseMap<const LoopRegion *, ARCRegionState *> &RegionStateInfo,
+   ARCRegionStateMap &RegionStateInfo,
    ImmutablePointerSetFactory<PILInstruction> &SetFactory) {
    ARCRegionState *State = RegionStateInfo[R];
 
@@ -382,7 +382,7 @@ bool ARCRegionState::processBottomUp(
    EpilogueARCFunctionInfo *EAFI, LoopRegionFunctionInfo *LRFI,
    bool FreezeOwnedArgEpilogueReleases,
    BlotMapVector<PILInstruction *, BottomUpRefCountState> &IncToDecStateMap,
-   llvm::DenseMap<const LoopRegion *, ARCRegionState *> &RegionStateInfo,
+   ARCRegionStateMap &RegionStateInfo,
    ImmutablePointerSetFactory<PILInstruction> &SetFactory) {
    const LoopRegion *R = getRegion();
 
@@ -500,7 +500,7 @@ bool ARCRegionState::processTopDown(
    AliasAnalysis *AA, RCIdentityFunctionInfo *RCIA,
    LoopRegionFunctionInfo *LRFI,
    BlotMapVector<PILInstruction *, TopDownRefCountState> &DecToIncStateMap,
-   llvm::DenseMap<const LoopRegion *, ARCRegionState *> &RegionStateInfo,
+   ARCRegionStateMap &RegionStateInfo,
    ImmutablePointerSetFactory<PILInstruction> &SetFactory) {
    const LoopRegion *R = getRegion();
 
@@ -541,7 +541,7 @@ void ARCRegionState::summarizeBlock(PILBasicBlock *BB) {
 
 void ARCRegionState::summarizeLoop(
    const LoopRegion *R, LoopRegionFunctionInfo *LRFI,
-   llvm::DenseMap<const LoopRegion *, ARCRegionState *> &RegionStateInfo) {
+   ARCRegionStateMap &RegionStateInfo) {
    SummarizedInterestingInsts.clear();
    for (unsigned SubregionID : R->getSubregions()) {
       LoopRegion *Subregion = LRFI->getRegion(SubregionID);
@@ -554,7 +554,7 @@ void ARCRegionState::summarizeLoop(
 
 void ARCRegionState::summarize(
    LoopRegionFunctionInfo *LRFI,
-   llvm::DenseMap<const LoopRegion *, ARCRegionState *> &RegionStateInfo) {
+   ARCRegionStateMap &RegionStateInfo) {
    const LoopRegion *R = getRegion();
 
    // We do not need to summarize a function since it is the outermost loop.
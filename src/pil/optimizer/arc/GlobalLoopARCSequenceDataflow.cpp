@@ -255,7 +255,7 @@ LoopARCSequenceDataflowEvaluator::LoopARCSequenceDataflowEvaluator(
    BlotMapVector<PILInstruction *, BottomUpRefCountState> &IncToDecStateMap)
    : Allocator(), SetFactory(Allocator), F(F), AA(AA), LRFI(LRFI), SLI(SLI),
      RCFI(RCFI), EAFI(EAFI), DecToIncStateMap(DecToIncStateMap),
-     IncToDecStateMap(IncToDecStateMap) {
+     IncToDecStateMap(IncToDecStateMap), RegionStateInfo(LRFI->size()) {
    for (auto *R : LRFI->getRegions()) {
       bool AllowsLeaks = false;
       if (R->isBlock())
@@ -265,8 +265,9 @@ LoopARCSequenceDataflowEvaluator::LoopARCSequenceDataflowEvaluator(
 }
 
 LoopARCSequenceDataflowEvaluator::~LoopARCSequenceDataflowEvaluator() {
-   for (auto P : RegionStateInfo) {
-      P.second->~ARCRegionState();
+   for (ARCRegionState *State : RegionStateInfo) {
+      if (State)
+         State->~ARCRegionState();
    }
 }
 
@@ -14,6 +14,7 @@
 
 #include "polarphp/pil/lang/PILFunction.h"
 #include "polarphp/pil/lang/PILInstruction.h"
+#include "polarphp/pil/optimizer/analysis/PrespecializationAnalysis.h"
 #include "polarphp/pil/optimizer/passmgr/Transforms.h"
 #include "polarphp/pil/optimizer/utils/Generics.h"
 #include "polarphp/pil/optimizer/utils/InstOptUtils.h"
@@ -37,10 +38,14 @@ static void collectApplyInst(PILFunction &F,
 /// of the corresponding pre-specialized function, if such a pre-specialization
 /// exists.
 class UsePrespecialized: public PILModuleTransform {
+   /// Knows the public specializations of imported modules.
+   PrespecializationAnalysis *PSA = nullptr;
+
    ~UsePrespecialized() override { }
 
    void run() override {
       auto &M = *getModule();
+      PSA = getAnalysis<PrespecializationAnalysis>();
       for (auto &F : M) {
          if (replaceByPrespecialized(F)) {
             invalidateAnalysis(&F, PILAnalysis::InvalidationKind::Everything);
@@ -122,7 +127,7 @@ bool UsePrespecialized::replaceByPrespecialized(PILFunction &F) {
       if (!PrevF || !NewF) {
          // Check for the existence of this function in another module without
          // loading the function body.
-         PrevF = lookupPrespecializedSymbol(M, ClonedName);
+         PrevF = lookupPrespecializedSymbol(M, ClonedName, PSA);
          LLVM_DEBUG(llvm::dbgs() << "Checked if there is a specialization in a "
                                     "different module: "
                                  << PrevF << "\n");
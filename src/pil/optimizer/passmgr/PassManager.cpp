@@ -17,12 +17,14 @@
 #include "polarphp/pil/lang/ApplySite.h"
 #include "polarphp/pil/lang/PILFunction.h"
 #include "polarphp/pil/lang/PILModule.h"
+#include "polarphp/pil/lang/PassProfiler.h"
 #include "polarphp/pil/optimizer/analysis/BasicCalleeAnalysis.h"
 #include "polarphp/pil/optimizer/analysis/FunctionOrder.h"
 #include "polarphp/pil/optimizer/passmgr/PrettyStackTrace.h"
 #include "polarphp/pil/optimizer/passmgr/Transforms.h"
 #include "polarphp/pil/optimizer/utils/OptimizerStatsUtils.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/CommandLine.h"
@@ -30,6 +32,8 @@
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Chrono.h"
+#include <atomic>
+#include <thread>
 
 using namespace polar;
 
@@ -110,6 +114,11 @@ llvm::cl::opt<bool> PILDisableSkippingPasses(
    "sil-disable-skipping-passes", llvm::cl::init(false),
    llvm::cl::desc("Do not skip passes even if nothing was changed"));
 
+llvm::cl::opt<unsigned> PILFunctionPassThreads(
+   "sil-function-pass-threads", llvm::cl::init(1),
+   llvm::cl::desc("Run consecutive parallel safe function passes on this "
+                  "many threads, 0 means one thread per core"));
+
 static llvm::ManagedStatic<std::vector<unsigned>> DebugPassNumbers;
 
 namespace {
@@ -272,6 +281,9 @@ public:
 
 } // end anonymous namespace
 
+thread_local PILPassManager::PipelineState *
+   PILPassManager::WorkerPipelineState = nullptr;
+
 PILPassManager::PILPassManager(PILModule *M, llvm::StringRef Stage,
                                bool isMandatory)
    : Mod(M), StageName(Stage), isMandatory(isMandatory),
@@ -285,6 +297,8 @@ PILPassManager::PILPassManager(PILModule *M, llvm::StringRef Stage,
       M->registerDeleteNotificationHandler(A);
    }
 
+   Profiler = M->getPassProfiler();
+
    std::unique_ptr<DeserializationNotificationHandler> handler(
       new PassManagerDeserializationNotificationHandler(this));
    deserializationNotificationHandler = handler.get();
@@ -354,12 +368,21 @@ void PILPassManager::runPassOnFunction(unsigned TransIdx, PILFunction *F) {
 
    assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
 
-   auto *SFT = cast<PILFunctionTransform>(Transformations[TransIdx]);
+   PILFunctionTransform *SFT;
+   if (WorkerPipelineState) {
+      SFT = WorkerPipelineState->Passes[TransIdx -
+                                        WorkerPipelineState->FirstPassIdx];
+   } else {
+      SFT = cast<PILFunctionTransform>(Transformations[TransIdx]);
+   }
    SFT->injectPassManager(this);
    SFT->injectFunction(F);
 
    PrettyStackTracePILFunctionTransform X(SFT, NumPassesRun);
-   DebugPrintEnabler DebugPrint(NumPassesRun);
+   // The debug flag is global, parallel workers never touch it.
+   llvm::Optional<DebugPrintEnabler> DebugPrint;
+   if (!WorkerPipelineState)
+      DebugPrint.emplace(NumPassesRun);
 
    // If nothing changed since the last run of this pass, we can skip this
    // pass.
@@ -379,7 +402,8 @@ void PILPassManager::runPassOnFunction(unsigned TransIdx, PILFunction *F) {
 
    updatePILModuleStatsBeforeTransform(F->getModule(), SFT, *this, NumPassesRun);
 
-   CurrentPassHasInvalidated = false;
+   PipelineState &State = getPipelineState();
+   State.CurrentPassHasInvalidated = false;
 
    auto MatchFun = [&](const std::string &Str) -> bool {
       return SFT->getTag().find(Str) != StringRef::npos ||
@@ -403,6 +427,9 @@ void PILPassManager::runPassOnFunction(unsigned TransIdx, PILFunction *F) {
       F->dump(getOptions().EmitVerbosePIL);
    }
 
+   llvm::Optional<PILPassProfiler::Sample> ProfileSample;
+   if (Profiler)
+      ProfileSample = Profiler->begin(*Mod, F, State.NumInvalidations);
    llvm::sys::TimePoint<> StartTime = std::chrono::system_clock::now();
    Mod->registerDeleteNotificationHandler(SFT);
    if (breakBeforeRunning(F->getName(), SFT))
@@ -412,13 +439,17 @@ void PILPassManager::runPassOnFunction(unsigned TransIdx, PILFunction *F) {
    Mod->removeDeleteNotificationHandler(SFT);
 
    auto Delta = (std::chrono::system_clock::now() - StartTime).count();
+   if (ProfileSample) {
+      Profiler->end(*ProfileSample, StageName, SFT->getID(), *Mod, F,
+                    State.NumInvalidations);
+   }
    if (PILPrintPassTime) {
       llvm::dbgs() << Delta << " (" << SFT->getID() << "," << F->getName()
                    << ")\n";
    }
 
    // If this pass invalidated anything, print and verify.
-   if (doPrintAfter(SFT, F, CurrentPassHasInvalidated && PILPrintAll)) {
+   if (doPrintAfter(SFT, F, State.CurrentPassHasInvalidated && PILPrintAll)) {
       dumpPassInfo("*** PIL function after ", TransIdx);
       F->dump(getOptions().EmitVerbosePIL);
    }
@@ -427,12 +458,14 @@ void PILPassManager::runPassOnFunction(unsigned TransIdx, PILFunction *F) {
                                       Delta);
 
    // Remember if this pass didn't change anything.
-   if (!CurrentPassHasInvalidated)
+   if (!State.CurrentPassHasInvalidated)
       completedPasses.set((size_t)SFT->getPassKind());
 
    if (getOptions().VerifyAll &&
-       (CurrentPassHasInvalidated || PILVerifyWithoutInvalidation)) {
-      F->verify();
+       (State.CurrentPassHasInvalidated || PILVerifyWithoutInvalidation)) {
+      // Verify-all forces the serial pipeline, so the pass number is a
+      // deterministic sample key.
+      F->verifySampled(NumPassesRun);
       verifyAnalyses(F);
    } else {
       if ((PILVerifyAfterPass.end() != std::find_if(PILVerifyAfterPass.begin(),
@@ -446,14 +479,72 @@ void PILPassManager::runPassOnFunction(unsigned TransIdx, PILFunction *F) {
       }
    }
 
-   ++NumPassesRun;
+   if (WorkerPipelineState)
+      ++WorkerPipelineState->NumPassesRun;
+   else
+      ++NumPassesRun;
+}
+
+unsigned PILPassManager::getNumFunctionPassThreads() const {
+   unsigned NumThreads = PILFunctionPassThreads;
+   if (NumThreads == 0)
+      NumThreads = std::max(1u, std::thread::hardware_concurrency());
+   if (NumThreads <= 1)
+      return 1;
+
+   // Options which print, verify, count or break per pass expect the passes
+   // to run one at a time and in a deterministic order.
+   if (PILPrintAll || PILPrintPassName || PILPrintPassTime ||
+       PILNumOptPassesToRun != UINT_MAX || !PILBreakOnFun.empty() ||
+       !PILBreakOnPass.empty() || !PILPrintBefore.empty() ||
+       !PILPrintAfter.empty() || !PILPrintAround.empty() ||
+       !PILVerifyBeforePass.empty() || !PILVerifyAroundPass.empty() ||
+       !PILVerifyAfterPass.empty() || !DebugPassNumbers->empty() ||
+       getOptions().VerifyAll || isPILModuleStatsEnabled())
+      return 1;
+
+   return NumThreads;
 }
 
+/// The maximum number of times the pass pipeline can be restarted for a
+/// function. This is used to ensure we are not going into an infinite loop in
+/// cases where (for example) we have recursive type-based specialization
+/// happening.
+static const unsigned MaxNumRestarts = 20;
+
 void PILPassManager::
 runFunctionPasses(unsigned FromTransIdx, unsigned ToTransIdx) {
    if (ToTransIdx <= FromTransIdx)
       return;
 
+   unsigned NumThreads = getNumFunctionPassThreads();
+   if (NumThreads <= 1) {
+      runFunctionPassesSerially(FromTransIdx, ToTransIdx);
+      return;
+   }
+
+   // Split the group into runs of parallel safe and other passes. A run goes
+   // over all functions before the next run starts, so a group without
+   // parallel safe passes behaves exactly like the serial pipeline.
+   unsigned Idx = FromTransIdx;
+   while (Idx < ToTransIdx && continueTransforming()) {
+      unsigned RunStart = Idx;
+      bool IsParallel =
+         cast<PILFunctionTransform>(Transformations[Idx])->isParallelSafe();
+      while (Idx < ToTransIdx &&
+             cast<PILFunctionTransform>(Transformations[Idx])->isParallelSafe() ==
+                IsParallel)
+         ++Idx;
+
+      if (IsParallel)
+         runFunctionPassesInParallel(RunStart, Idx, NumThreads);
+      else
+         runFunctionPassesSerially(RunStart, Idx);
+   }
+}
+
+void PILPassManager::
+runFunctionPassesSerially(unsigned FromTransIdx, unsigned ToTransIdx) {
    BasicCalleeAnalysis *BCA = getAnalysis<BasicCalleeAnalysis>();
    BottomUpFunctionOrder BottomUpOrder(*Mod, BCA);
    auto BottomUpFunctions = BottomUpOrder.getFunctions();
@@ -473,12 +564,6 @@ runFunctionPasses(unsigned FromTransIdx, unsigned ToTransIdx) {
 
    DerivationLevels.clear();
 
-   // The maximum number of times the pass pipeline can be restarted for a
-   // function. This is used to ensure we are not going into an infinite loop in
-   // cases where (for example) we have recursive type-based specialization
-   // happening.
-   const unsigned MaxNumRestarts = 20;
-
    if (PILPrintPassName)
       llvm::dbgs() << "Start function passes at stage: " << StageName << "\n";
 
@@ -512,6 +597,78 @@ runFunctionPasses(unsigned FromTransIdx, unsigned ToTransIdx) {
    }
 }
 
+void PILPassManager::
+runFunctionPassesInParallel(unsigned FromTransIdx, unsigned ToTransIdx,
+                            unsigned NumThreads) {
+   // Parallel safe passes do not look into other functions, so the bottom-up
+   // order does not matter and any worker can take any function.
+   std::vector<PILFunction *> Functions;
+   for (PILFunction &F : *Mod) {
+      if (F.isDefinition() && (isMandatory || F.shouldOptimize()))
+         Functions.push_back(&F);
+   }
+   if (Functions.empty())
+      return;
+
+   // Create the completed-passes masks up front, the workers then only look
+   // up existing entries and never grow the map.
+   for (PILFunction *F : Functions)
+      CompletedPassesMap.FindAndConstruct(F);
+
+   NumThreads = std::min<size_t>(NumThreads, Functions.size());
+
+   // Passes keep per-run state in their members, so every worker gets its
+   // own instances.
+   std::vector<PipelineState> States(NumThreads);
+   for (PipelineState &State : States) {
+      State.FirstPassIdx = FromTransIdx;
+      for (unsigned Idx = FromTransIdx; Idx != ToTransIdx; ++Idx) {
+         PILTransform *T = createTransform(Transformations[Idx]->getPassKind());
+         State.Passes.push_back(cast<PILFunctionTransform>(T));
+      }
+   }
+
+   Mod->setConcurrentFunctionPasses(true);
+   // Workers claim the next function nobody has taken yet, so a few huge
+   // functions do not leave the other threads idle.
+   std::atomic<size_t> NextFunction{0};
+   std::vector<std::thread> Workers;
+   Workers.reserve(NumThreads);
+   for (PipelineState &State : States) {
+      Workers.emplace_back([&, StatePtr = &State]() {
+         WorkerPipelineState = StatePtr;
+         Mod->enterConcurrentWorker();
+         for (size_t Index = NextFunction.fetch_add(1); Index < Functions.size();
+              Index = NextFunction.fetch_add(1)) {
+            PILFunction *F = Functions[Index];
+            unsigned PipelineIdx = 0;
+            unsigned NumRestarts = 0;
+            while (PipelineIdx < ToTransIdx - FromTransIdx) {
+               runPassOnFunction(FromTransIdx + PipelineIdx, F);
+               if (shouldRestartPipeline() && NumRestarts < MaxNumRestarts) {
+                  ++NumRestarts;
+                  PipelineIdx = 0;
+               } else {
+                  ++PipelineIdx;
+               }
+               clearRestartPipeline();
+            }
+         }
+         Mod->leaveConcurrentWorker();
+         WorkerPipelineState = nullptr;
+      });
+   }
+   for (std::thread &Worker : Workers)
+      Worker.join();
+   Mod->setConcurrentFunctionPasses(false);
+
+   for (PipelineState &State : States) {
+      NumPassesRun += State.NumPassesRun;
+      for (PILFunctionTransform *T : State.Passes)
+         delete T;
+   }
+}
+
 void PILPassManager::runModulePass(unsigned TransIdx) {
    auto *SMT = cast<PILModuleTransform>(Transformations[TransIdx]);
    if (isDisabled(SMT))
@@ -527,7 +684,8 @@ void PILPassManager::runModulePass(unsigned TransIdx) {
 
    updatePILModuleStatsBeforeTransform(*Mod, SMT, *this, NumPassesRun);
 
-   CurrentPassHasInvalidated = false;
+   PipelineState &State = getPipelineState();
+   State.CurrentPassHasInvalidated = false;
 
    if (PILPrintPassName)
       dumpPassInfo("Run module pass", TransIdx);
@@ -551,6 +709,9 @@ void PILPassManager::runModulePass(unsigned TransIdx) {
       verifyAnalyses();
    }
 
+   llvm::Optional<PILPassProfiler::Sample> ProfileSample;
+   if (Profiler)
+      ProfileSample = Profiler->begin(*Mod, nullptr, State.NumInvalidations);
    llvm::sys::TimePoint<> StartTime = std::chrono::system_clock::now();
    assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
    Mod->registerDeleteNotificationHandler(SMT);
@@ -559,13 +720,17 @@ void PILPassManager::runModulePass(unsigned TransIdx) {
    assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
 
    auto Delta = (std::chrono::system_clock::now() - StartTime).count();
+   if (ProfileSample) {
+      Profiler->end(*ProfileSample, StageName, SMT->getID(), *Mod, nullptr,
+                    State.NumInvalidations);
+   }
    if (PILPrintPassTime) {
       llvm::dbgs() << Delta << " (" << SMT->getID() << ",Module)\n";
    }
 
    // If this pass invalidated anything, print and verify.
    if (doPrintAfter(SMT, nullptr,
-                    CurrentPassHasInvalidated && PILPrintAll)) {
+                    State.CurrentPassHasInvalidated && PILPrintAll)) {
       dumpPassInfo("*** PIL module after", TransIdx);
       printModule(Mod, Options.EmitVerbosePIL);
    }
@@ -573,8 +738,8 @@ void PILPassManager::runModulePass(unsigned TransIdx) {
    updatePILModuleStatsAfterTransform(*Mod, SMT, *this, NumPassesRun, Delta);
 
    if (Options.VerifyAll &&
-       (CurrentPassHasInvalidated || !PILVerifyWithoutInvalidation)) {
-      Mod->verify();
+       (State.CurrentPassHasInvalidated || !PILVerifyWithoutInvalidation)) {
+      Mod->verifySampled(NumPassesRun);
       verifyAnalyses();
    } else {
       if ((PILVerifyAfterPass.end() != std::find_if(PILVerifyAfterPass.begin(),
@@ -649,6 +814,10 @@ PILPassManager::~PILPassManager() {
       A->verifyFull();
    }
 
+   // Let analyses persist their state while all of them are still alive.
+   for (auto *A : Analyses)
+      A->finish();
+
    // Remove our deserialization notification handler.
    Mod->removeDeserializationNotificationHandler(
       deserializationNotificationHandler);
@@ -675,6 +844,8 @@ void PILPassManager::notifyOfNewFunction(PILFunction *F, PILTransform *T) {
 
 void PILPassManager::addFunctionToWorklist(PILFunction *F,
                                            PILFunction *DerivedFrom) {
+   assert(!WorkerPipelineState &&
+          "parallel safe passes must not add functions to the worklist");
    assert(F && F->isDefinition() && (isMandatory || F->shouldOptimize()) &&
           "Expected optimizable function definition!");
 
@@ -722,7 +893,7 @@ void PILPassManager::addFunctionToWorklist(PILFunction *F,
 void PILPassManager::restartWithCurrentFunction(PILTransform *T) {
    assert(isa<PILFunctionTransform>(T) &&
           "Can only restart the pipeline from function passes");
-   RestartPipeline = true;
+   getPipelineState().RestartPipeline = true;
 }
 
 /// Reset the state of the pass manager and remove all transformation
@@ -746,15 +917,31 @@ const PILOptions &PILPassManager::getOptions() const {
    return Mod->getOptions();
 }
 
+PILTransform *PILPassManager::createTransform(PassKind Kind) {
+   switch (Kind) {
+#define PASS(ID, TAG, NAME)                                                    \
+  case PassKind::ID: {                                                         \
+    PILTransform *T = polar::create##ID();                                     \
+    T->setPassKind(PassKind::ID);                                              \
+    return T;                                                                  \
+  }
+#define IRGEN_PASS(ID, TAG, NAME)                                              \
+  case PassKind::ID:                                                           \
+    llvm_unreachable("IRGen passes are registered, not created");
+#include "polarphp/pil/optimizer/passmgr/PassesDef.h"
+      case PassKind::invalidPassKind:
+         llvm_unreachable("invalid pass kind");
+   }
+   llvm_unreachable("unhandled pass kind");
+}
+
 void PILPassManager::addPass(PassKind Kind) {
    assert(unsigned(PassKind::AllPasses_Last) >= unsigned(Kind) &&
              "Invalid pass kind");
    switch (Kind) {
 #define PASS(ID, TAG, NAME)                                                    \
   case PassKind::ID: {                                                         \
-    PILTransform *T = polar::create##ID();                                     \
-    T->setPassKind(PassKind::ID);                                              \
-    Transformations.push_back(T);                                              \
+    Transformations.push_back(createTransform(PassKind::ID));                  \
     break;                                                                     \
   }
 #define IRGEN_PASS(ID, TAG, NAME)                                              \
@@ -104,6 +104,9 @@ void polar::runPILOptimizationPasses(PILModule &Module) {
       PM.executePassPipelinePlan(
          PILPassPipelinePlan::getPerformancePassPipeline(Module.getOptions()));
    }
+   // The analyses which reuse summaries of earlier builds only run in the
+   // performance pipeline.
+   Module.saveSummaryCaches();
 
    // Check if we actually serialized our module. If we did not, serialize now.
    if (!Module.isSerialized()) {
@@ -148,6 +151,7 @@ void polar::runPILOptimizationPassesWithFileSpecification(PILModule &M,
    PILPassManager PM(&M);
    PM.executePassPipelinePlan(
       PILPassPipelinePlan::getPassPipelineFromFile(M.getOptions(), Filename));
+   M.saveSummaryCaches();
 }
 
 /// Get the Pass ID enum value from an ID string.
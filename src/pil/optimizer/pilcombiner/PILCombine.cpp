@@ -23,6 +23,7 @@
 #include "polarphp/pil/optimizer/internal/pilcombiner/PILCombiner.h"
 #include "polarphp/pil/lang/DebugUtils.h"
 #include "polarphp/pil/lang/PILBuilder.h"
+#include "polarphp/pil/lang/PILFunctionCFG.h"
 #include "polarphp/pil/lang/PILVisitor.h"
 #include "polarphp/pil/optimizer/analysis/AliasAnalysis.h"
 #include "polarphp/pil/optimizer/analysis/SimplifyInstruction.h"
@@ -31,39 +32,51 @@
 #include "polarphp/pil/optimizer/utils/CanonicalizeInstruction.h"
 #include "polarphp/pil/optimizer/utils/InstOptUtils.h"
 #include "polarphp/pil/optimizer/utils/PILOptFunctionBuilder.h"
-#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 
 using namespace polar;
 
 STATISTIC(NumCombined, "Number of instructions combined");
 STATISTIC(NumDeadInst, "Number of dead insts eliminated");
+STATISTIC(NumVisits, "Number of instructions visited");
+STATISTIC(NumRevisits, "Number of visits beyond one per reachable instruction");
+STATISTIC(NumLimitsReached,
+          "Number of functions on which an iteration or visit limit was hit");
+
+static llvm::cl::opt<unsigned> PILCombineMaxIterations(
+   "sil-combine-max-iterations", llvm::cl::init(64),
+   llvm::cl::desc("The maximum number of PILCombine iterations on a "
+                  "function"));
+
+static llvm::cl::opt<unsigned> PILCombineMaxVisitsPerInst(
+   "sil-combine-max-visits-per-inst", llvm::cl::init(32),
+   llvm::cl::desc("Stop a PILCombine iteration after it visited this number "
+                  "of instructions per reachable instruction"));
 
 //===----------------------------------------------------------------------===//
 //                              Utility Methods
 //===----------------------------------------------------------------------===//
 
-/// addReachableCodeToWorklist - Walk the function in depth-first order, adding
-/// all reachable code to the worklist.
+/// addReachableCodeToWorklist - Walk the function in reverse post order,
+/// adding all reachable code to the worklist.
 ///
 /// This has a couple of tricks to make the code faster and more powerful.  In
 /// particular, we DCE instructions as we go, to avoid adding them to the
 /// worklist (this significantly speeds up PILCombine on code where many
 /// instructions are dead or constant).
-void PILCombiner::addReachableCodeToWorklist(PILBasicBlock *BB) {
-   llvm::SmallVector<PILBasicBlock *, 256> Worklist;
+unsigned PILCombiner::addReachableCodeToWorklist(PILFunction *F) {
    llvm::SmallVector<PILInstruction *, 128> InstrsForPILCombineWorklist;
-   llvm::SmallPtrSet<PILBasicBlock *, 32> Visited;
-
-   Worklist.push_back(BB);
-   do {
-      BB = Worklist.pop_back_val();
-
-      // We have now visited this block!  If we've already been here, ignore it.
-      if (!Visited.insert(BB).second) continue;
 
+   // Visiting the blocks in reverse post order visits definitions before
+   // their uses, except for loop carried values. So most simplifications
+   // which expose other simplifications in the users are done before the
+   // users are visited the first time, instead of revisiting them.
+   llvm::ReversePostOrderTraversal<PILFunction *> RPOT(F);
+   for (PILBasicBlock *BB : RPOT) {
       for (PILBasicBlock::iterator BBI = BB->begin(), E = BB->end(); BBI != E; ) {
          PILInstruction *Inst = &*BBI;
          ++BBI;
@@ -88,11 +101,7 @@ void PILCombiner::addReachableCodeToWorklist(PILBasicBlock *BB) {
 
          InstrsForPILCombineWorklist.push_back(Inst);
       }
-
-      // Recursively visit successors.
-      for (auto SI = BB->succ_begin(), SE = BB->succ_end(); SI != SE; ++SI)
-         Worklist.push_back(*SI);
-   } while (!Worklist.empty());
+   }
 
    // Once we've found all of the instructions to add to the worklist, add them
    // in reverse order. This way PILCombine will visit from the top of the
@@ -100,6 +109,7 @@ void PILCombiner::addReachableCodeToWorklist(PILBasicBlock *BB) {
    // instructions to the worklist after doing a transformation, thus avoiding
    // some N^2 behavior in pathological cases.
    addInitialGroup(InstrsForPILCombineWorklist);
+   return InstrsForPILCombineWorklist.size();
 }
 
 //===----------------------------------------------------------------------===//
@@ -149,7 +159,13 @@ bool PILCombiner::doOneIteration(PILFunction &F, unsigned Iteration) {
                            << F.getName() << "\n");
 
    // Add reachable instructions to our worklist.
-   addReachableCodeToWorklist(&*F.begin());
+   unsigned NumReachable = addReachableCodeToWorklist(&F);
+
+   // Instructions are re-added when their operands change, which can cascade.
+   // Bound the visits, so that the time spent is linear in the function size.
+   uint64_t MaxVisits =
+      uint64_t(std::max(NumReachable, 1u)) * PILCombineMaxVisitsPerInst;
+   uint64_t NumIterationVisits = 0;
 
    PILCombineCanonicalize scCanonicalize(Worklist);
 
@@ -165,6 +181,18 @@ bool PILCombiner::doOneIteration(PILFunction &F, unsigned Iteration) {
       if (I == nullptr)
          continue;
 
+      if (NumIterationVisits == MaxVisits) {
+         LLVM_DEBUG(llvm::dbgs() << "SC: visit limit reached on "
+                                 << F.getName() << '\n');
+         Worklist.clear();
+         ReachedVisitLimit = true;
+         break;
+      }
+      ++NumIterationVisits;
+      ++NumVisits;
+      if (NumIterationVisits > NumReachable)
+         ++NumRevisits;
+
       // Check to see if we can DCE the instruction.
       if (isInstructionTriviallyDead(I)) {
          LLVM_DEBUG(llvm::dbgs() << "SC: DCE: " << *I << '\n');
@@ -224,10 +252,15 @@ bool PILCombiner::runOnFunction(PILFunction &F) {
    clear();
 
    bool Changed = false;
-   // Perform iterations until we do not make any changes.
+   // Perform iterations until we do not make any changes, or until we hit the
+   // iteration or visit limit.
    while (doOneIteration(F, Iteration)) {
       Changed = true;
       Iteration++;
+      if (ReachedVisitLimit || Iteration == PILCombineMaxIterations) {
+         ++NumLimitsReached;
+         break;
+      }
    }
 
    // Cleanup the builder and return whether or not we made any changes.
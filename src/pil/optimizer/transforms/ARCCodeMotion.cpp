@@ -75,6 +75,7 @@
 #include "polarphp/pil/lang/PILBuilder.h"
 #include "polarphp/pil/optimizer/analysis/ARCAnalysis.h"
 #include "polarphp/pil/optimizer/analysis/AliasAnalysis.h"
+#include "polarphp/pil/optimizer/analysis/DominanceAnalysis.h"
 #include "polarphp/pil/optimizer/analysis/EscapeAnalysis.h"
 #include "polarphp/pil/optimizer/analysis/PostOrderAnalysis.h"
 #include "polarphp/pil/optimizer/analysis/ProgramTerminationAnalysis.h"
@@ -1196,14 +1197,19 @@ public:
                               << " ***\n");
 
       PostOrderAnalysis *POA = PM->getAnalysis<PostOrderAnalysis>();
+      DominanceAnalysis *DA = PM->getAnalysis<DominanceAnalysis>();
+
+      // The only CFG changes of this pass are the critical edge splits below.
+      // The locked analyses apply them to their results instead of being
+      // invalidated.
+      AnalysisPreserver PreservePostOrder(POA);
+      AnalysisPreserver PreserveDominance(DA);
 
       // Split all critical edges.
       //
       // TODO: maybe we can do this lazily or maybe we should disallow PIL passes
       // to create critical edges.
       bool EdgeChanged = splitAllCriticalEdges(*F, nullptr, nullptr);
-      if (EdgeChanged)
-         POA->invalidateFunction(F);
 
       auto *PO = POA->get(F);
       auto *AA = PM->getAnalysis<AliasAnalysis>();
@@ -58,6 +58,7 @@
 
 #define DEBUG_TYPE "pil-dead-store-elim"
 
+#include "polarphp/pil/lang/BlockData.h"
 #include "polarphp/pil/lang/Projection.h"
 #include "polarphp/pil/lang/PILArgument.h"
 #include "polarphp/pil/lang/PILBuilder.h"
@@ -67,6 +68,7 @@
 #include "polarphp/pil/optimizer/passmgr/Passes.h"
 #include "polarphp/pil/optimizer/passmgr/Transforms.h"
 #include "polarphp/pil/optimizer/utils/CFGOptUtils.h"
+#include "polarphp/pil/optimizer/utils/DataflowBitSet.h"
 #include "polarphp/pil/optimizer/utils/InstOptUtils.h"
 #include "polarphp/pil/optimizer/utils/LoadStoreOptUtils.h"
 #include "llvm/ADT/BitVector.h"
@@ -222,37 +224,37 @@ public:
    /// A bit vector for which the ith bit represents the ith LSLocation in
    /// LocationVault. If the bit is set, then the location currently has an
    /// upward visible store at the end of the basic block.
-   SmallBitVector BBWriteSetOut;
+   DataflowBitSet BBWriteSetOut;
 
    /// A bit vector for which the ith bit represents the ith LSLocation in
    /// LocationVault. If the bit is set, then the location currently has an
    /// upward visible store in middle of the basic block.
-   SmallBitVector BBWriteSetMid;
+   DataflowBitSet BBWriteSetMid;
 
    /// A bit vector for which the ith bit represents the ith LSLocation in
    /// LocationVault. If a bit in the vector is set, then the location has an
    /// upward visible store at the beginning of the basic block.
-   SmallBitVector BBWriteSetIn;
+   DataflowBitSet BBWriteSetIn;
 
    /// A bit vector for which the ith bit represents the ith LSLocation in
    /// LocationVault. If the bit is set, then the current basic block
    /// generates an upward visible store.
-   SmallBitVector BBGenSet;
+   DataflowBitSet BBGenSet;
 
    /// A bit vector for which the ith bit represents the ith LSLocation in
    /// LocationVault. If the bit is set, then the current basic block
    /// kills an upward visible store.
-   SmallBitVector BBKillSet;
+   DataflowBitSet BBKillSet;
 
    /// A bit vector to keep the maximum number of stores that can reach a
    /// certain point of the basic block. If a bit is set, that means there is
    /// potentially an upward visible store to the location at the particular
    /// point of the basic block.
-   SmallBitVector BBMaxStoreSet;
+   DataflowBitSet BBMaxStoreSet;
 
    /// If a bit in the vector is set, then the location is dead at the end of
    /// this basic block.
-   SmallBitVector BBDeallocateLocation;
+   DataflowBitSet BBDeallocateLocation;
 
    /// The dead stores in the current basic block.
    llvm::SmallVector<PILInstruction *, 2> DeadStores;
@@ -278,35 +280,32 @@ public:
 
    /// Check whether the BBWriteSetIn has changed. If it does, we need to rerun
    /// the data flow on this block's predecessors to reach fixed point.
-   bool updateBBWriteSetIn(SmallBitVector &X);
+   bool updateBBWriteSetIn(DataflowBitSet &X);
 
    /// Functions to manipulate the write set.
-   void startTrackingLocation(SmallBitVector &BV, unsigned bit);
-   void stopTrackingLocation(SmallBitVector &BV, unsigned bit);
-   bool isTrackingLocation(SmallBitVector &BV, unsigned bit);
-
-   /// Set the store bit for stack slot deallocated in this basic block.
-   void initStoreSetAtEndOfBlock(DSEContext &Ctx);
+   void startTrackingLocation(DataflowBitSet &BV, unsigned bit);
+   void stopTrackingLocation(DataflowBitSet &BV, unsigned bit);
+   bool isTrackingLocation(DataflowBitSet &BV, unsigned bit);
 };
 
 } // end anonymous namespace
 
-bool BlockState::updateBBWriteSetIn(SmallBitVector &X) {
+bool BlockState::updateBBWriteSetIn(DataflowBitSet &X) {
    if (BBWriteSetIn == X)
       return false;
    BBWriteSetIn = X;
    return true;
 }
 
-void BlockState::startTrackingLocation(SmallBitVector &BV, unsigned i) {
+void BlockState::startTrackingLocation(DataflowBitSet &BV, unsigned i) {
    BV.set(i);
 }
 
-void BlockState::stopTrackingLocation(SmallBitVector &BV, unsigned i) {
+void BlockState::stopTrackingLocation(DataflowBitSet &BV, unsigned i) {
    BV.reset(i);
 }
 
-bool BlockState::isTrackingLocation(SmallBitVector &BV, unsigned i) {
+bool BlockState::isTrackingLocation(DataflowBitSet &BV, unsigned i) {
    return BV.test(i);
 }
 
@@ -347,8 +346,9 @@ private:
    /// The allocator we are using.
    llvm::SpecificBumpPtrAllocator<BlockState> &BPA;
 
-   /// Map every basic block to its location state.
-   llvm::SmallDenseMap<PILBasicBlock *, BlockState *> BBToLocState;
+   /// The location state of every basic block. DSE doesn't add blocks, so
+   /// the block numbering stays valid.
+   BlockData<BlockState *> BBToLocState;
 
    /// Keeps all the locations for the current function. The BitVector in each
    /// BlockState is then laid on top of it to keep track of which LSLocation
@@ -363,7 +363,7 @@ private:
    /// data flow iteration. For function that requires more than 1 iteration of
    /// the data flow this is populated when the first time the functions is
    /// walked, i.e. when the we generate the genset and killset.
-   llvm::DenseSet<PILBasicBlock *> BBWithStores;
+   BlockData<bool> BBWithStores;
 
    /// Contains a map between location to their index in the LocationVault.
    /// used to facilitate fast location to index lookup.
@@ -372,6 +372,11 @@ private:
    /// Keeps a map between the accessed PILValue and the location.
    LSLocationBaseMap BaseToLocIndex;
 
+   /// Keeps a map between the base of a location and the bits of all the
+   /// locations in the LocationVault sharing it, so invalidating a base does
+   /// not walk the whole vault.
+   llvm::DenseMap<PILValue, llvm::SmallVector<unsigned, 4>> BaseToLocBits;
+
    /// Return the BlockState for the basic block this basic block belongs to.
    BlockState *getBlockState(PILBasicBlock *B) { return BBToLocState[B]; }
 
@@ -444,13 +449,18 @@ private:
    /// Get the bit representing the location in the LocationVault.
    unsigned getLocationBit(const LSLocation &L);
 
+   /// Set the store bit at the end of the basic blocks in which a stack
+   /// allocated location is deallocated.
+   void initStoreSetAtEndOfBlocks();
+
 public:
    /// Constructor.
    DSEContext(PILFunction *F, PILModule *M, PILPassManager *PM,
               AliasAnalysis *AA, TypeExpansionAnalysis *TE,
               EpilogueARCFunctionInfo *EAFI,
               llvm::SpecificBumpPtrAllocator<BlockState> &BPA)
-      : Mod(M), F(F), PM(PM), AA(AA), TE(TE), EAFI(EAFI), BPA(BPA) {}
+      : Mod(M), F(F), PM(PM), AA(AA), TE(TE), EAFI(EAFI), BPA(BPA),
+        BBToLocState(F, nullptr), BBWithStores(F, false) {}
 
    void dump();
 
@@ -625,8 +635,7 @@ void DSEContext::processBasicBlockForGenKillSet(PILBasicBlock *BB) {
    for (auto I = BB->rbegin(), E = BB->rend(); I != E; ++I) {
       // Only process store insts.
       if (isa<StoreInst>(*I)) {
-         if (BBWithStores.find(BB) == BBWithStores.end())
-            BBWithStores.insert(BB);
+         BBWithStores[BB] = true;
          processStoreInst(&(*I), DSEKind::ComputeMaxStoreSet);
       }
 
@@ -661,7 +670,7 @@ void DSEContext::processBasicBlockForDSE(PILBasicBlock *BB, bool Optimistic) {
    // and this basic block does not even have StoreInsts, there is no point
    // in processing every instruction in the basic block again as no store
    // will be eliminated.
-   if (Optimistic && BBWithStores.find(BB) == BBWithStores.end())
+   if (Optimistic && !BBWithStores[BB])
       return;
 
    // Intersect in the successor WriteSetIns. A store is dead if it is not read
@@ -686,28 +695,24 @@ void DSEContext::processBasicBlockForDSE(PILBasicBlock *BB, bool Optimistic) {
    S->BBWriteSetIn = S->BBWriteSetMid;
 }
 
-void BlockState::initStoreSetAtEndOfBlock(DSEContext &Ctx) {
-   std::vector<LSLocation> &LocationVault = Ctx.getLocationVault();
+void DSEContext::initStoreSetAtEndOfBlocks() {
    // We set the store bit at the end of the basic block in which a stack
-   // allocated location is deallocated.
+   // allocated location is deallocated. Walk the vault once and go to the
+   // deallocating blocks directly instead of scanning the vault per block.
    for (unsigned i = 0; i < LocationVault.size(); ++i) {
       // Turn on the store bit at the block which the stack slot is deallocated.
       if (auto *ASI = dyn_cast<AllocStackInst>(LocationVault[i].getBase())) {
          for (auto X : findDeallocStackInst(ASI)) {
-            PILBasicBlock *DSIBB = X->getParent();
-            if (DSIBB != BB)
-               continue;
-            startTrackingLocation(BBDeallocateLocation, i);
+            BlockState *S = getBlockState(X->getParent());
+            S->startTrackingLocation(S->BBDeallocateLocation, i);
          }
       }
       if (auto *ARI = dyn_cast<AllocRefInst>(LocationVault[i].getBase())) {
          if (!ARI->isAllocatingStack())
             continue;
          for (auto X : findDeallocRefInst(ARI)) {
-            PILBasicBlock *DSIBB = X->getParent();
-            if (DSIBB != BB)
-               continue;
-            startTrackingLocation(BBDeallocateLocation, i);
+            BlockState *S = getBlockState(X->getParent());
+            S->startTrackingLocation(S->BBDeallocateLocation, i);
          }
       }
    }
@@ -752,20 +757,14 @@ void DSEContext::mergeSuccessorLiveIns(PILBasicBlock *BB) {
 }
 
 void DSEContext::invalidateBaseForGenKillSet(PILValue B, BlockState *S) {
-   for (unsigned i = 0; i < S->LocationNum; ++i) {
-      if (LocationVault[i].getBase() != B)
-         continue;
+   for (unsigned i : BaseToLocBits.find(B)->second) {
       S->startTrackingLocation(S->BBKillSet, i);
       S->stopTrackingLocation(S->BBGenSet, i);
    }
 }
 
 void DSEContext::invalidateBaseForDSE(PILValue B, BlockState *S) {
-   for (unsigned i = 0; i < S->LocationNum; ++i) {
-      if (!S->BBWriteSetMid.test(i))
-         continue;
-      if (LocationVault[i].getBase() != B)
-         continue;
+   for (unsigned i : BaseToLocBits.find(B)->second) {
       S->stopTrackingLocation(S->BBWriteSetMid, i);
    }
 }
@@ -774,6 +773,10 @@ void DSEContext::invalidateBase(PILValue B, BlockState *S, DSEKind Kind) {
    // If this instruction defines the base of a location, then we need to
    // invalidate any locations with the same base.
    //
+   // Most values are not the base of any location, bail out early for those.
+   if (BaseToLocBits.find(B) == BaseToLocBits.end())
+      return;
+   //
    // Are we building genset and killset.
    if (isBuildingGenKillSet(Kind)) {
       invalidateBaseForGenKillSet(B, S);
@@ -793,14 +796,10 @@ void DSEContext::processReadForDSE(BlockState *S, unsigned bit) {
    // Remove any may/must-aliasing stores to the LSLocation, as they can't be
    // used to kill any upward visible stores due to the interfering load.
    LSLocation &R = LocationVault[bit];
-   for (unsigned i = 0; i < S->LocationNum; ++i) {
-      if (!S->isTrackingLocation(S->BBWriteSetMid, i))
-         continue;
+   S->BBWriteSetMid.resetIf([&](unsigned i) {
       LSLocation &L = LocationVault[i];
-      if (!L.isMayAliasLSLocation(R, AA))
-         continue;
-      S->stopTrackingLocation(S->BBWriteSetMid, i);
-   }
+      return L.isMayAliasLSLocation(R, AA);
+   });
 }
 
 void DSEContext::processReadForGenKillSet(BlockState *S, unsigned bit) {
@@ -810,17 +809,15 @@ void DSEContext::processReadForGenKillSet(BlockState *S, unsigned bit) {
    // Even though, LSLocations are canonicalized, we still need to consult
    // alias analysis to determine whether 2 LSLocations are disjointed.
    LSLocation &R = LocationVault[bit];
-   for (unsigned i = 0; i < S->LocationNum; ++i) {
-      if (!S->BBMaxStoreSet.test(i))
-         continue;
+   S->BBMaxStoreSet.forEachSetBit([&](unsigned i) {
       // Do nothing if the read location NoAlias with the current location.
       LSLocation &L = LocationVault[i];
       if (!L.isMayAliasLSLocation(R, AA))
-         continue;
+         return;
       // Update the genset and kill set.
       S->startTrackingLocation(S->BBKillSet, i);
       S->stopTrackingLocation(S->BBGenSet, i);
-   }
+   });
 }
 
 void DSEContext::processRead(PILInstruction *I, PILValue Mem, DSEKind Kind) {
@@ -882,19 +879,13 @@ void DSEContext::processRead(PILInstruction *I, PILValue Mem, DSEKind Kind) {
 
 bool DSEContext::processWriteForDSE(BlockState *S, unsigned bit) {
    // If a tracked store must aliases with this store, then this store is dead.
-   bool StoreDead = false;
+   // There is no need to check further once a must alias store is found.
    LSLocation &R = LocationVault[bit];
-   for (unsigned i = 0; i < S->LocationNum; ++i) {
-      if (!S->isTrackingLocation(S->BBWriteSetMid, i))
-         continue;
+   bool StoreDead = S->BBWriteSetMid.anySetBit([&](unsigned i) {
       // If 2 locations may alias, we can still keep both stores.
       LSLocation &L = LocationVault[i];
-      if (!L.isMustAliasLSLocation(R, AA))
-         continue;
-      // There is a must alias store. No need to check further.
-      StoreDead = true;
-      break;
-   }
+      return L.isMustAliasLSLocation(R, AA);
+   });
 
    // Track this new store.
    S->startTrackingLocation(S->BBWriteSetMid, bit);
@@ -1045,26 +1036,20 @@ void DSEContext::processStoreInst(PILInstruction *I, DSEKind Kind) {
 void DSEContext::processDebugValueAddrInstForGenKillSet(PILInstruction *I) {
    BlockState *S = getBlockState(I);
    PILValue Mem = cast<DebugValueAddrInst>(I)->getOperand();
-   for (unsigned i = 0; i < S->LocationNum; ++i) {
-      if (!S->BBMaxStoreSet.test(i))
-         continue;
+   S->BBMaxStoreSet.forEachSetBit([&](unsigned i) {
       if (AA->isNoAlias(Mem, LocationVault[i].getBase()))
-         continue;
+         return;
       S->stopTrackingLocation(S->BBGenSet, i);
       S->startTrackingLocation(S->BBKillSet, i);
-   }
+   });
 }
 
 void DSEContext::processDebugValueAddrInstForDSE(PILInstruction *I) {
    BlockState *S = getBlockState(I);
    PILValue Mem = cast<DebugValueAddrInst>(I)->getOperand();
-   for (unsigned i = 0; i < S->LocationNum; ++i) {
-      if (!S->isTrackingLocation(S->BBWriteSetMid, i))
-         continue;
-      if (AA->isNoAlias(Mem, LocationVault[i].getBase()))
-         continue;
-      S->stopTrackingLocation(S->BBWriteSetMid, i);
-   }
+   S->BBWriteSetMid.resetIf([&](unsigned i) {
+      return !AA->isNoAlias(Mem, LocationVault[i].getBase());
+   });
 }
 
 void DSEContext::processDebugValueAddrInst(PILInstruction *I, DSEKind Kind) {
@@ -1085,26 +1070,20 @@ void DSEContext::processDebugValueAddrInst(PILInstruction *I, DSEKind Kind) {
 
 void DSEContext::processUnknownReadInstForGenKillSet(PILInstruction *I) {
    BlockState *S = getBlockState(I);
-   for (unsigned i = 0; i < S->LocationNum; ++i) {
-      if (!S->BBMaxStoreSet.test(i))
-         continue;
+   S->BBMaxStoreSet.forEachSetBit([&](unsigned i) {
       if (!AA->mayReadFromMemory(I, LocationVault[i].getBase()))
-         continue;
+         return;
       // Update the genset and kill set.
       S->startTrackingLocation(S->BBKillSet, i);
       S->stopTrackingLocation(S->BBGenSet, i);
-   }
+   });
 }
 
 void DSEContext::processUnknownReadInstForDSE(PILInstruction *I) {
    BlockState *S = getBlockState(I);
-   for (unsigned i = 0; i < S->LocationNum; ++i) {
-      if (!S->isTrackingLocation(S->BBWriteSetMid, i))
-         continue;
-      if (!AA->mayReadFromMemory(I, LocationVault[i].getBase()))
-         continue;
-      S->stopTrackingLocation(S->BBWriteSetMid, i);
-   }
+   S->BBWriteSetMid.resetIf([&](unsigned i) {
+      return AA->mayReadFromMemory(I, LocationVault[i].getBase());
+   });
 }
 
 void DSEContext::processUnknownReadInst(PILInstruction *I, DSEKind Kind) {
@@ -1164,27 +1143,13 @@ void DSEContext::runIterativeDSE() {
    // Process each basic block with the gen and kill set. Every time the
    // BBWriteSetIn of a basic block changes, the optimization is rerun on its
    // predecessors.
-   llvm::SmallVector<PILBasicBlock *, 16> WorkList;
-   llvm::DenseSet<PILBasicBlock *> HandledBBs;
+   //
    // Push into reverse post order so that we can pop from the back and get
    // post order.
-   for (PILBasicBlock *B : PO->getReversePostOrder()) {
-      WorkList.push_back(B);
-      HandledBBs.insert(B);
-   }
-   while (!WorkList.empty()) {
-      PILBasicBlock *BB = WorkList.pop_back_val();
-      HandledBBs.erase(BB);
-      if (processBasicBlockWithGenKillSet(BB)) {
-         for (auto X : BB->getPredecessorBlocks()) {
-            // We do not push basic block into the worklist if its already
-            // in the worklist.
-            if (HandledBBs.find(X) != HandledBBs.end())
-               continue;
-            WorkList.push_back(X);
-         }
-      }
-   }
+   solveDataflow<PILBasicBlock>(
+      PO->getReversePostOrder(),
+      [&](PILBasicBlock *BB) { return processBasicBlockWithGenKillSet(BB); },
+      [](PILBasicBlock *BB) { return BB->getPredecessorBlocks(); });
 }
 
 bool DSEContext::run() {
@@ -1211,8 +1176,11 @@ bool DSEContext::run() {
    for (auto &B : *F) {
       auto *State = new (BPA.Allocate()) BlockState(&B, LocationNum, Optimistic);
       BBToLocState[&B] = State;
-      State->initStoreSetAtEndOfBlock(*this);
    }
+   initStoreSetAtEndOfBlocks();
+
+   for (unsigned i = 0; i < LocationNum; ++i)
+      BaseToLocBits[LocationVault[i].getBase()].push_back(i);
 
    // We perform dead store elimination in the following phases.
    //
@@ -15,6 +15,7 @@
 
 #include "polarphp/pil/lang/MemoryLifetime.h"
 #include "polarphp/pil/optimizer/analysis/DominanceAnalysis.h"
+#include "polarphp/pil/optimizer/analysis/PostOrderAnalysis.h"
 #include "polarphp/pil/optimizer/passmgr/Transforms.h"
 #include "polarphp/pil/optimizer/utils/CFGOptUtils.h"
 #include "llvm/Support/Debug.h"
@@ -735,9 +736,15 @@ public:
       LLVM_DEBUG(llvm::dbgs() << "*** DestroyHoisting on function: "
                               << F->getName() << " ***\n");
 
-      bool EdgeChanged = splitAllCriticalEdges(*F, nullptr, nullptr);
-
+      // The only CFG changes of this pass are the critical edge splits. The
+      // locked analyses apply them to their results instead of being
+      // invalidated.
       DominanceAnalysis *DA = PM->getAnalysis<DominanceAnalysis>();
+      PostOrderAnalysis *POA = PM->getAnalysis<PostOrderAnalysis>();
+      AnalysisPreserver PreserveDominance(DA);
+      AnalysisPreserver PreservePostOrder(POA);
+
+      bool EdgeChanged = splitAllCriticalEdges(*F, nullptr, nullptr);
 
       DestroyHoisting CM(F, DA);
       bool InstChanged = CM.hoistDestroys();
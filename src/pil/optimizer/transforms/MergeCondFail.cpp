@@ -44,6 +44,9 @@ class MergeCondFailInsts : public PILFunctionTransform {
 public:
    MergeCondFailInsts() {}
 
+   /// Works block by block and uses no analysis.
+   bool isParallelSafe() const override { return true; }
+
    void run() override {
       bool Changed = false;
       auto *F = getFunction();
@@ -16,6 +16,7 @@
 #include "polarphp/ast/SemanticAttrs.h"
 #include "polarphp/pil/lang/MemAccessUtils.h"
 #include "polarphp/pil/lang/OptimizationRemark.h"
+#include "polarphp/pil/optimizer/analysis/InlineCostAnalysis.h"
 #include "polarphp/pil/optimizer/analysis/SideEffectAnalysis.h"
 #include "polarphp/pil/optimizer/passmgr/Transforms.h"
 #include "polarphp/pil/optimizer/utils/CFGOptUtils.h"
@@ -63,9 +64,8 @@ class PILPerformanceInliner {
    PILLoopAnalysis *LA;
    SideEffectAnalysis *SEA;
 
-   // For keys of PILFunction and PILLoop.
-   llvm::DenseMap<PILFunction *, ShortestPathAnalysis *> SPAs;
-   llvm::SpecificBumpPtrAllocator<ShortestPathAnalysis> SPAAllocator;
+   /// The cost summaries of callees, which are shared by all callers.
+   InlineCostAnalysis *ICA;
 
    ColdBlockInfo CBI;
 
@@ -134,7 +134,7 @@ class PILPerformanceInliner {
          OverallCallerBlockLimit = 400,
 
       /// The assumed execution length of a function call.
-         DefaultApplyLength = 10
+         DefaultApplyLength = ShortestPathAnalysis::DefaultApplyLength
    };
 
    OptimizationMode OptMode;
@@ -149,14 +149,6 @@ class PILPerformanceInliner {
    }
 #endif
 
-   ShortestPathAnalysis *getSPA(PILFunction *F, PILLoopInfo *LI) {
-      ShortestPathAnalysis *&SPA = SPAs[F];
-      if (!SPA) {
-         SPA = new (SPAAllocator.Allocate()) ShortestPathAnalysis(F, LI);
-      }
-      return SPA;
-   }
-
    bool profileBasedDecision(
       const FullApplySite &AI, int Benefit, PILFunction *Callee, int CalleeCost,
       int &NumCallerBlocks,
@@ -188,9 +180,10 @@ public:
    PILPerformanceInliner(PILOptFunctionBuilder &FuncBuilder,
                          InlineSelection WhatToInline, DominanceAnalysis *DA,
                          PILLoopAnalysis *LA, SideEffectAnalysis *SEA,
-                         OptimizationMode OptMode, optremark::Emitter &ORE)
+                         InlineCostAnalysis *ICA, OptimizationMode OptMode,
+                         optremark::Emitter &ORE)
       : FuncBuilder(FuncBuilder), WhatToInline(WhatToInline), DA(DA), LA(LA),
-        SEA(SEA), CBI(DA), ORE(ORE), OptMode(OptMode) {}
+        SEA(SEA), ICA(ICA), CBI(DA), ORE(ORE), OptMode(OptMode) {}
 
    bool inlineCallsIntoFunction(PILFunction *F);
 };
@@ -306,9 +299,7 @@ bool PILPerformanceInliner::isProfitableToInline(
       return false;
    }
 
-   PILLoopInfo *LI = LA->get(Callee);
-   ShortestPathAnalysis *SPA = getSPA(Callee, LI);
-   assert(SPA->isValid());
+   ShortestPathAnalysis *SPA = ICA->get(Callee)->getShortestPaths();
 
    ConstantTracker constTracker(Callee, &callerTracker, AI);
    DominanceInfo *DT = DA->get(Callee);
@@ -622,15 +613,10 @@ bool PILPerformanceInliner::decideInColdBlock(FullApplySite AI,
       return true;
    }
 
-   int CalleeCost = 0;
+   int CalleeCost = ICA->get(Callee)->getCost();
+   if (CalleeCost > TrivialFunctionThreshold)
+      return false;
 
-   for (PILBasicBlock &Block : *Callee) {
-      for (PILInstruction &I : Block) {
-         CalleeCost += int(instructionInlineCost(I));
-         if (CalleeCost > TrivialFunctionThreshold)
-            return false;
-      }
-   }
    LLVM_DEBUG(dumpCaller(AI.getFunction());
                  llvm::dbgs() << "    cold decision {" << CalleeCost << "} "
                               << Callee->getName() << '\n');
@@ -756,9 +742,10 @@ void PILPerformanceInliner::collectAppliesToInline(
 
    llvm::DenseMap<FullApplySite, int> WeightCorrections;
 
-   // Compute the shortest-path analysis for the caller.
-   ShortestPathAnalysis *SPA = getSPA(Caller, LI);
-   SPA->analyze(CBI, [&](FullApplySite FAS) -> int {
+   // Compute the shortest-path analysis for the caller. It depends on the
+   // lengths of the callees, so unlike the callee's analysis it is not cached.
+   ShortestPathAnalysis SPA(Caller, LI);
+   SPA.analyze(CBI, [&](FullApplySite FAS) -> int {
 
       // This closure returns the length of a called function.
 
@@ -766,17 +753,9 @@ void PILPerformanceInliner::collectAppliesToInline(
       addWeightCorrection(FAS, WeightCorrections);
 
       if (PILFunction *Callee = getEligibleFunction(FAS, WhatToInline)) {
-         // Compute the shortest-path analysis for the callee.
-         PILLoopInfo *CalleeLI = LA->get(Callee);
-         ShortestPathAnalysis *CalleeSPA = getSPA(Callee, CalleeLI);
-         if (!CalleeSPA->isValid()) {
-            CalleeSPA->analyze(CBI, [](FullApplySite FAS) {
-               // We don't compute SPA for another call-level. Functions called from
-               // the callee are assumed to have DefaultApplyLength.
-               return DefaultApplyLength;
-            });
-         }
-         int CalleeLength = CalleeSPA->getScopeLength(&Callee->front(), 0);
+         // The shortest-path analysis for the callee is computed once and
+         // shared by all callers.
+         int CalleeLength = ICA->get(Callee)->getLength();
          // Just in case the callee is a noreturn function.
          if (CalleeLength >= ShortestPathAnalysis::InitialDist)
             return DefaultApplyLength;
@@ -788,7 +767,7 @@ void PILPerformanceInliner::collectAppliesToInline(
 
 #ifndef NDEBUG
    if (PrintShortestPathInfo) {
-      SPA->dump();
+      SPA.dump();
    }
 #endif
 
@@ -834,7 +813,7 @@ void PILPerformanceInliner::collectAppliesToInline(
             // Otherwise, calculate our block weights and determine if we want to
             // inline this.
             if (!BlockWeight.isValid())
-               BlockWeight = SPA->getWeight(block, Weight(0, 0));
+               BlockWeight = SPA.getWeight(block, Weight(0, 0));
 
             // The actual weight including a possible weight correction.
             Weight W(BlockWeight, WeightCorrections.lookup(AI));
@@ -983,6 +962,7 @@ public:
       DominanceAnalysis *DA = PM->getAnalysis<DominanceAnalysis>();
       PILLoopAnalysis *LA = PM->getAnalysis<PILLoopAnalysis>();
       SideEffectAnalysis *SEA = PM->getAnalysis<SideEffectAnalysis>();
+      InlineCostAnalysis *ICA = PM->getAnalysis<InlineCostAnalysis>();
       optremark::Emitter ORE(DEBUG_TYPE, getFunction()->getModule());
 
       if (getOptions().InlineThreshold == 0) {
@@ -993,7 +973,7 @@ public:
 
       PILOptFunctionBuilder FuncBuilder(*this);
       PILPerformanceInliner Inliner(FuncBuilder, WhatToInline, DA, LA, SEA,
-                                    OptMode, ORE);
+                                    ICA, OptMode, ORE);
 
       assert(getFunction()->isDefinition() &&
              "Expected only functions with bodies!");
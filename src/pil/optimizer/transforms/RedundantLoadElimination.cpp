@@ -74,6 +74,7 @@
 
 #define DEBUG_TYPE "pil-redundant-load-elim"
 
+#include "polarphp/pil/lang/BlockData.h"
 #include "polarphp/pil/lang/Projection.h"
 #include "polarphp/pil/lang/PILArgument.h"
 #include "polarphp/pil/lang/PILBuilder.h"
@@ -85,10 +86,10 @@
 #include "polarphp/pil/optimizer/passmgr/Passes.h"
 #include "polarphp/pil/optimizer/passmgr/Transforms.h"
 #include "polarphp/pil/optimizer/utils/CFGOptUtils.h"
+#include "polarphp/pil/optimizer/utils/DataflowBitSet.h"
 #include "polarphp/pil/optimizer/utils/InstOptUtils.h"
 #include "polarphp/pil/optimizer/utils/LoadStoreOptUtils.h"
 #include "polarphp/pil/optimizer/utils/PILSSAUpdater.h"
-#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/Statistic.h"
@@ -208,27 +209,27 @@ private:
    /// A bit vector for which the ith bit represents the ith LSLocation in
    /// LocationVault. If the bit is set, then the location currently has an
    /// downward visible value at the beginning of the basic block.
-   SmallBitVector ForwardSetIn;
+   DataflowBitSet ForwardSetIn;
 
    /// A bit vector for which the ith bit represents the ith LSLocation in
    /// LocationVault. If the bit is set, then the location currently has an
    /// downward visible value at the end of the basic block.
-   SmallBitVector ForwardSetOut;
+   DataflowBitSet ForwardSetOut;
 
    /// A bit vector for which the ith bit represents the ith LSLocation in
    /// LocationVault. If we ignore all unknown write, what's the maximum set
    /// of available locations at the current position in the basic block.
-   SmallBitVector ForwardSetMax;
+   DataflowBitSet ForwardSetMax;
 
    /// A bit vector for which the ith bit represents the ith LSLocation in
    /// LocationVault. If the bit is set, then the basic block generates a
    /// value for the location.
-   SmallBitVector BBGenSet;
+   DataflowBitSet BBGenSet;
 
    /// A bit vector for which the ith bit represents the ith LSLocation in
    /// LocationVault. If the bit is set, then the basic block kills the
    /// value for the location.
-   SmallBitVector BBKillSet;
+   DataflowBitSet BBKillSet;
 
    /// This is map between LSLocations and their available values at the
    /// beginning of this basic block.
@@ -276,9 +277,9 @@ private:
                      PILValue Val, RLEKind Kind);
 
    /// BitVector manipulation functions.
-   void startTrackingLocation(SmallBitVector &BV, unsigned B);
-   void stopTrackingLocation(SmallBitVector &BV, unsigned B);
-   bool isTrackingLocation(SmallBitVector &BV, unsigned B);
+   void startTrackingLocation(DataflowBitSet &BV, unsigned B);
+   void stopTrackingLocation(DataflowBitSet &BV, unsigned B);
+   bool isTrackingLocation(DataflowBitSet &BV, unsigned B);
    void startTrackingValue(ValueTableMap &VM, unsigned L, unsigned V);
    void stopTrackingValue(ValueTableMap &VM, unsigned B);
 
@@ -462,6 +463,11 @@ private:
    /// Keeps a map between the accessed PILValue and the location.
    LSLocationBaseMap BaseToLocIndex;
 
+   /// Keeps a map between the base of a location and the bits of all the
+   /// locations in the LocationVault sharing it, so invalidating a base does
+   /// not walk the whole vault.
+   llvm::DenseMap<PILValue, llvm::SmallVector<unsigned, 4>> BaseToLocBits;
+
    /// Keeps all the loadstorevalues for the current function. The BitVector in
    /// each g is then laid on top of it to keep track of which LSLocation
    /// has a downward available value.
@@ -471,8 +477,9 @@ private:
    /// Use for fast lookup.
    llvm::DenseMap<LSValue, unsigned> ValToBitIndex;
 
-   /// A map from each BasicBlock to its BlockState.
-   llvm::SmallDenseMap<PILBasicBlock *, BlockState, 16> BBToLocState;
+   /// The BlockState of each BasicBlock. RLE doesn't add blocks, so the
+   /// block numbering stays valid.
+   BlockData<BlockState> BBToLocState;
 
    /// Keeps a list of basic blocks that have LoadInsts. If a basic block does
    /// not have LoadInst, we do not actually perform the last iteration where
@@ -482,7 +489,7 @@ private:
    /// data flow iteration. For function that requires more than 1 iteration of
    /// the data flow this is populated when the first time the functions is
    /// walked, i.e. when the we generate the genset and killset.
-   llvm::DenseSet<PILBasicBlock *> BBWithLoads;
+   BlockData<bool> BBWithLoads;
 
    /// If set, RLE ignores loads from that array type.
    NominalTypeDecl *ArrayType;
@@ -548,6 +555,15 @@ public:
    /// Given the bit, get the LSLocation from the LocationVault.
    LSLocation &getLocation(const unsigned index);
 
+   /// Get the bits of all the LSLocations in the LocationVault with the given
+   /// base.
+   ArrayRef<unsigned> getLocationBitsForBase(PILValue Base) const {
+      auto Iter = BaseToLocBits.find(Base);
+      if (Iter == BaseToLocBits.end())
+         return {};
+      return Iter->second;
+   }
+
    /// Get the bit representing the LSValue in the LSValueVault.
    unsigned getValueBit(const LSValue &L);
 
@@ -586,15 +602,15 @@ void BlockState::stopTrackingValue(ValueTableMap &VM, unsigned B) {
    VM.erase(B);
 }
 
-bool BlockState::isTrackingLocation(SmallBitVector &BV, unsigned B) {
+bool BlockState::isTrackingLocation(DataflowBitSet &BV, unsigned B) {
    return BV.test(B);
 }
 
-void BlockState::startTrackingLocation(SmallBitVector &BV, unsigned B) {
+void BlockState::startTrackingLocation(DataflowBitSet &BV, unsigned B) {
    BV.set(B);
 }
 
-void BlockState::stopTrackingLocation(SmallBitVector &BV, unsigned B) {
+void BlockState::stopTrackingLocation(DataflowBitSet &BV, unsigned B) {
    BV.reset(B);
 }
 
@@ -643,19 +659,19 @@ void BlockState::mergePredecessorAvailSetAndValue(RLEContext &Ctx) {
       BlockState &OtherState = Ctx.getBlockState(*Iter);
       ForwardSetIn &= OtherState.ForwardSetOut;
 
-      // Merge in the predecessor state.
-      for (unsigned i = 0; i < LocationNum; ++i) {
-         if (OtherState.ForwardSetOut[i]) {
-            // There are multiple values from multiple predecessors, set this as
-            // a covering value. We do not need to track the value itself, as we
-            // can always go to the predecessors BlockState to find it.
-            ForwardValIn[i] = Ctx.getValueBit(LSValue(true));
-            continue;
-         }
-         // If this location does have an available value, then clear it.
-         stopTrackingValue(ForwardValIn, i);
-         stopTrackingLocation(ForwardSetIn, i);
-      }
+      // Merge in the predecessor state. Every location available out of the
+      // predecessor gets a covering value, as there are multiple values from
+      // multiple predecessors. We do not need to track the value itself, as we
+      // can always go to the predecessors BlockState to find it. Locations the
+      // predecessor does not make available lose their value, so the merged
+      // table is rebuilt from the predecessor's set bits rather than by
+      // walking every location in the function.
+      ValueTableMap Merged;
+      unsigned CoveringValue = Ctx.getValueBit(LSValue(true));
+      OtherState.ForwardSetOut.forEachSetBit([&](unsigned i) {
+         startTrackingValue(Merged, i, CoveringValue);
+      });
+      ForwardValIn = std::move(Merged);
    }
 }
 
@@ -769,16 +785,14 @@ void BlockState::updateGenKillSetForWrite(RLEContext &Ctx, unsigned B) {
    // This is a store, invalidate any location that this location may alias, as
    // their values can no longer be forwarded.
    LSLocation &R = Ctx.getLocation(B);
-   for (unsigned i = 0; i < LocationNum; ++i) {
-      if (!isTrackingLocation(ForwardSetMax, i))
-         continue;
+   ForwardSetMax.forEachSetBit([&](unsigned i) {
       LSLocation &L = Ctx.getLocation(i);
       if (!L.isMayAliasLSLocation(R, Ctx.getAA()))
-         continue;
+         return;
       // MayAlias, invalidate the location.
       stopTrackingLocation(BBGenSet, i);
       startTrackingLocation(BBKillSet, i);
-   }
+   });
 
    // Start tracking this location.
    startTrackingLocation(BBGenSet, B);
@@ -797,15 +811,11 @@ void BlockState::updateForwardSetForWrite(RLEContext &Ctx, unsigned B) {
    // This is a store, invalidate any location that this location may alias, as
    // their values can no longer be forwarded.
    LSLocation &R = Ctx.getLocation(B);
-   for (unsigned i = 0; i < LocationNum; ++i) {
-      if (!isTrackingLocation(ForwardSetIn, i))
-         continue;
-      LSLocation &L = Ctx.getLocation(i);
-      if (!L.isMayAliasLSLocation(R, Ctx.getAA()))
-         continue;
+   ForwardSetIn.resetIf([&](unsigned i) {
       // MayAlias, invalidate the location.
-      stopTrackingLocation(ForwardSetIn, i);
-   }
+      LSLocation &L = Ctx.getLocation(i);
+      return L.isMayAliasLSLocation(R, Ctx.getAA());
+   });
 
    // Start tracking this location.
    startTrackingLocation(ForwardSetIn, B);
@@ -816,16 +826,14 @@ void BlockState::updateForwardSetAndValForWrite(RLEContext &Ctx, unsigned L,
    // This is a store, invalidate any location that this location may alias, as
    // their values can no longer be forwarded.
    LSLocation &R = Ctx.getLocation(L);
-   for (unsigned i = 0; i < LocationNum; ++i) {
-      if (!isTrackingLocation(ForwardSetIn, i))
-         continue;
+   ForwardSetIn.resetIf([&](unsigned i) {
       LSLocation &L = Ctx.getLocation(i);
       if (!L.isMayAliasLSLocation(R, Ctx.getAA()))
-         continue;
+         return false;
       // MayAlias, invalidate the location and value.
       stopTrackingValue(ForwardValIn, i);
-      stopTrackingLocation(ForwardSetIn, i);
-   }
+      return true;
+   });
 
    // Start tracking this location and value.
    startTrackingLocation(ForwardSetIn, L);
@@ -968,39 +976,35 @@ void BlockState::processLoadInst(RLEContext &Ctx, LoadInst *LI, RLEKind Kind) {
 void BlockState::processUnknownWriteInstForGenKillSet(RLEContext &Ctx,
                                                       PILInstruction *I) {
    auto *AA = Ctx.getAA();
-   for (unsigned i = 0; i < LocationNum; ++i) {
-      if (!isTrackingLocation(ForwardSetMax, i))
-         continue;
+   ForwardSetMax.forEachSetBit([&](unsigned i) {
       // Invalidate any location this instruction may write to.
       //
       // TODO: checking may alias with Base is overly conservative,
       // we should check may alias with base plus projection path.
       LSLocation &R = Ctx.getLocation(i);
       if (!AA->mayWriteToMemory(I, R.getBase()))
-         continue;
+         return;
       // MayAlias.
       stopTrackingLocation(BBGenSet, i);
       startTrackingLocation(BBKillSet, i);
-   }
+   });
 }
 
 void BlockState::processUnknownWriteInstForRLE(RLEContext &Ctx,
                                                PILInstruction *I) {
    auto *AA = Ctx.getAA();
-   for (unsigned i = 0; i < LocationNum; ++i) {
-      if (!isTrackingLocation(ForwardSetIn, i))
-         continue;
+   ForwardSetIn.resetIf([&](unsigned i) {
       // Invalidate any location this instruction may write to.
       //
       // TODO: checking may alias with Base is overly conservative,
       // we should check may alias with base plus projection path.
       LSLocation &R = Ctx.getLocation(i);
       if (!AA->mayWriteToMemory(I, R.getBase()))
-         continue;
+         return false;
       // MayAlias.
-      stopTrackingLocation(ForwardSetIn, i);
       stopTrackingValue(ForwardValIn, i);
-   }
+      return true;
+   });
 }
 
 void BlockState::processUnknownWriteInst(RLEContext &Ctx, PILInstruction *I,
@@ -1028,10 +1032,7 @@ void BlockState::processUnknownWriteInst(RLEContext &Ctx, PILInstruction *I,
 void BlockState::
 processDeallocStackInstForGenKillSet(RLEContext &Ctx, DeallocStackInst *I) {
    PILValue ASI = findAllocStackInst(I);
-   for (unsigned i = 0; i < LocationNum; ++i) {
-      LSLocation &R = Ctx.getLocation(i);
-      if (R.getBase() != ASI)
-         continue;
+   for (unsigned i : Ctx.getLocationBitsForBase(ASI)) {
       // MayAlias.
       stopTrackingLocation(BBGenSet, i);
       startTrackingLocation(BBKillSet, i);
@@ -1041,10 +1042,7 @@ processDeallocStackInstForGenKillSet(RLEContext &Ctx, DeallocStackInst *I) {
 void BlockState::
 processDeallocStackInstForRLE(RLEContext &Ctx, DeallocStackInst *I) {
    PILValue ASI = findAllocStackInst(I);
-   for (unsigned i = 0; i < LocationNum; ++i) {
-      LSLocation &R = Ctx.getLocation(i);
-      if (R.getBase() != ASI)
-         continue;
+   for (unsigned i : Ctx.getLocationBitsForBase(ASI)) {
       // MayAlias.
       stopTrackingLocation(ForwardSetIn, i);
       stopTrackingValue(ForwardValIn, i);
@@ -1163,10 +1161,7 @@ getProcessFunctionKind(unsigned LoadCount, unsigned StoreCount) {
 
 #ifndef NDEBUG
 void BlockState::dump(RLEContext &Ctx) {
-   for (unsigned i = 0; i < LocationNum; ++i) {
-      if (!isTrackingLocation(ForwardSetMax, i))
-         continue;
-
+   ForwardSetMax.forEachSetBit([&](unsigned i) {
       llvm::dbgs() << "Loc #" << i << ":" << (BBGenSet[i] ? " Gen" : "")
                    << (BBKillSet[i] ? " Kill" : "");
       if (!ForwardSetIn.empty() && ForwardSetIn.test(i)) {
@@ -1190,7 +1185,7 @@ void BlockState::dump(RLEContext &Ctx) {
          }
       }
       llvm::dbgs() << "\n";
-   }
+   });
 }
 #endif
 
@@ -1202,6 +1197,7 @@ RLEContext::RLEContext(PILFunction *F, PILPassManager *PM, AliasAnalysis *AA,
                        TypeExpansionAnalysis *TE, PostOrderFunctionInfo *PO,
                        EpilogueARCFunctionInfo *EAFI, bool disableArrayLoads)
    : Fn(F), PM(PM), AA(AA), TE(TE), PO(PO), EAFI(EAFI),
+     BBToLocState(F), BBWithLoads(F, false),
      ArrayType(disableArrayLoads ?
                F->getModule().getAstContext().getArrayDecl() : nullptr)
 #ifndef NDEBUG
@@ -1407,8 +1403,7 @@ void RLEContext::processBasicBlocksForGenKillSet() {
       // point in the basic block.
       for (auto I = BB->begin(), E = BB->end(); I != E; ++I) {
          if (auto *LI = dyn_cast<LoadInst>(&*I)) {
-            if (BBWithLoads.find(BB) == BBWithLoads.end())
-               BBWithLoads.insert(BB);
+            BBWithLoads[BB] = true;
             S.processLoadInst(*this, LI, RLEKind::ComputeAvailSetMax);
          }
          if (auto *SI = dyn_cast<StoreInst>(&*I)) {
@@ -1425,37 +1420,24 @@ void RLEContext::processBasicBlocksWithGenKillSet() {
    // Process each basic block with the gen and kill set. Every time the
    // ForwardSetOut of a basic block changes, the optimization is rerun on its
    // successors.
-   llvm::SmallVector<PILBasicBlock *, 16> WorkList;
-   llvm::DenseSet<PILBasicBlock *> HandledBBs;
-
+   //
    // Push into the worklist in post order so that we can pop from the back and
    // get reverse post order.
-   for (PILBasicBlock *BB : PO->getPostOrder()) {
-      WorkList.push_back(BB);
-      HandledBBs.insert(BB);
-   }
-   while (!WorkList.empty()) {
-      PILBasicBlock *BB = WorkList.pop_back_val();
-      LLVM_DEBUG(llvm::dbgs() << "PROCESS " << printCtx.getID(BB)
-                              << " with Gen/Kill.\n");
-      HandledBBs.erase(BB);
-
-      // Intersection.
-      BlockState &Forwarder = getBlockState(BB);
-      // Compute the ForwardSetIn at the beginning of the basic block.
-      Forwarder.mergePredecessorAvailSet(*this);
-
-      if (Forwarder.processBasicBlockWithGenKillSet()) {
-         for (auto &X : BB->getSuccessors()) {
-            // We do not push basic block into the worklist if its already
-            // in the worklist.
-            if (HandledBBs.find(X) != HandledBBs.end())
-               continue;
-            WorkList.push_back(X);
-         }
-      }
-      LLVM_DEBUG(Forwarder.dump(*this));
-   }
+   solveDataflow<PILBasicBlock>(
+      PO->getPostOrder(),
+      [&](PILBasicBlock *BB) {
+         LLVM_DEBUG(llvm::dbgs() << "PROCESS " << printCtx.getID(BB)
+                                 << " with Gen/Kill.\n");
+         // Intersection.
+         BlockState &Forwarder = getBlockState(BB);
+         // Compute the ForwardSetIn at the beginning of the basic block.
+         Forwarder.mergePredecessorAvailSet(*this);
+
+         bool Changed = Forwarder.processBasicBlockWithGenKillSet();
+         LLVM_DEBUG(Forwarder.dump(*this));
+         return Changed;
+      },
+      [](PILBasicBlock *BB) { return BB->getSuccessorBlocks(); });
 }
 
 void RLEContext::processBasicBlocksForAvailValue() {
@@ -1494,7 +1476,7 @@ void RLEContext::processBasicBlocksForRLE(bool Optimistic) {
       // and this basic block does not even have LoadInsts, there is no point
       // in processing every instruction in the basic block again as no store
       // will be eliminated.
-      if (Optimistic && BBWithLoads.find(BB) == BBWithLoads.end())
+      if (Optimistic && !BBWithLoads[BB])
          continue;
 
       BlockState &Forwarder = getBlockState(BB);
@@ -1563,23 +1545,25 @@ bool RLEContext::run() {
    if (Kind == ProcessKind::ProcessNone)
       return false;
 
+   for (unsigned i = 0; i < LocationVault.size(); ++i)
+      BaseToLocBits[LocationVault[i].getBase()].push_back(i);
+
    // Do we run a multi-iteration data flow ?
    bool Optimistic = Kind == ProcessKind::ProcessMultipleIterations ?
                      true : false;
 
    // These are a list of basic blocks that we actually processed.
    // We do not process unreachable block, instead we set their liveouts to nil.
-   llvm::DenseSet<PILBasicBlock *> BBToProcess;
+   BlockData<bool> BBToProcess(Fn, false);
    for (auto X : PO->getPostOrder())
-      BBToProcess.insert(X);
+      BBToProcess[X] = true;
 
    // For all basic blocks in the function, initialize a BB state. Since we
    // know all the locations accessed in this function, we can resize the bit
    // vector to the appropriate size.
    for (auto &B : *Fn) {
-      BBToLocState[&B] = BlockState();
-      BBToLocState[&B].init(&B, LocationVault.size(), Optimistic &&
-                                                      BBToProcess.find(&B) != BBToProcess.end());
+      BBToLocState[&B].init(&B, LocationVault.size(),
+                            Optimistic && BBToProcess[&B]);
    }
 
    LLVM_DEBUG(for (unsigned i = 0; i < LocationVault.size(); ++i) {
@@ -35,6 +35,9 @@ class RedundantOverflowCheckRemovalPass : public PILFunctionTransform {
 public:
    RedundantOverflowCheckRemovalPass() {}
 
+   /// The constraints are collected per function from its dominator tree.
+   bool isParallelSafe() const override { return true; }
+
    /// This enum represents a relationship between two operands.
    /// The relationship represented by arithmetic operators represents the
    /// information that the operation did not trap.
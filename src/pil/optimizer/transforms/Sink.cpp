@@ -45,6 +45,10 @@ public:
    PostOrderFunctionInfo *PO;
    PILLoopInfo *LoopInfo;
 
+   /// Sinks within the current function, the dominator tree, loop info and
+   /// post order are per function analyses.
+   bool isParallelSafe() const override { return true; }
+
    /// returns True if were able to sink the instruction \p II
    /// closer to it's users.
    bool sinkInstruction(PILInstruction *II) {
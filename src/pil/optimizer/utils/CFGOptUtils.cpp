@@ -461,19 +461,11 @@ PILBasicBlock *polar::splitBasicBlockAndBranch(PILBuilder &builder,
    builder.createBranch(splitBeforeInst->getLoc(), newBB);
 
    // Update the dominator tree.
-   if (domInfo) {
-      auto origBBDTNode = domInfo->getNode(origBB);
-      if (origBBDTNode) {
-         // Change the immediate dominators of the children of the block we
-         // splitted to the splitted block.
-         SmallVector<DominanceInfoNode *, 16> Adoptees(origBBDTNode->begin(),
-                                                       origBBDTNode->end());
-
-         auto newBBDTNode = domInfo->addNewBlock(newBB, origBB);
-         for (auto *adoptee : Adoptees)
-            domInfo->changeImmediateDominator(adoptee, newBBDTNode);
-      }
-   }
+   if (domInfo)
+      domInfo->updateForSplitBlock(origBB, newBB);
+
+   origBB->getModule().notifyCFGEditHandlers(
+      CFGEdit(CFGEdit::Kind::SplitBlock, origBB, nullptr, newBB, domInfo));
 
    // Update loop info.
    if (loopInfo)
@@ -575,17 +567,10 @@ bool polar::mergeBasicBlockWithSuccessor(PILBasicBlock *bb,
       return false;
 
    if (domInfo)
-      if (auto *succBBNode = domInfo->getNode(succBB)) {
-         // Change the immediate dominator for children of the successor to be the
-         // current block.
-         auto *bbNode = domInfo->getNode(bb);
-         SmallVector<DominanceInfoNode *, 8> Children(succBBNode->begin(),
-                                                      succBBNode->end());
-         for (auto *ChildNode : Children)
-            domInfo->changeImmediateDominator(ChildNode, bbNode);
-
-         domInfo->eraseNode(succBB);
-      }
+      domInfo->updateForMergeBlocks(bb, succBB);
+
+   bb->getModule().notifyCFGEditHandlers(
+      CFGEdit(CFGEdit::Kind::MergeBlocks, bb, succBB, nullptr, domInfo));
 
    if (loopInfo)
       loopInfo->removeBlock(succBB);
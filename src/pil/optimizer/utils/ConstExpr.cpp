@@ -23,10 +23,22 @@
 #include "polarphp/pil/lang/PILConstants.h"
 #include "polarphp/pil/optimizer/Utils/Devirtualize.h"
 #include "polarphp/serialization/SerializedPILLoader.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/PointerEmbeddedInt.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Allocator.h"
 
 using namespace polar;
 
+STATISTIC(NumMemoizedCalls, "Number of memoized constant calls");
+STATISTIC(NumMemoizedCallHits,
+          "Number of calls answered by an earlier evaluation");
+STATISTIC(NumInstructionLimitHits,
+          "Number of evaluations stopped by the instruction limit");
+STATISTIC(NumMemoryLimitHits,
+          "Number of evaluations stopped by the memory limit");
+
 static llvm::Optional<SymbolicValue>
 evaluateAndCacheCall(PILFunction &fn, SubstitutionMap substitutionMap,
                      ArrayRef<SymbolicValue> arguments, SymbolicValue &result,
@@ -1852,8 +1864,11 @@ evaluateAndCacheCall(PILFunction &fn, SubstitutionMap substitutionMap,
                                 numInstEvaluated,
       /*TopLevelEvaluation*/ false);
 
-   // TODO: implement caching.
-   // TODO: reject code that is too complex.
+   if (auto memoized = evaluator.lookupMemoizedCall(&fn, substitutionMap,
+                                                    arguments)) {
+      result = *memoized;
+      return None;
+   }
 
    unsigned nextBBArg = 0;
    const auto &argList = fn.front().getArguments();
@@ -1881,9 +1896,17 @@ evaluateAndCacheCall(PILFunction &fn, SubstitutionMap substitutionMap,
 
       // Make sure we haven't exceeded our interpreter iteration cap.
       if (++numInstEvaluated > ConstExprLimit) {
+         ++NumInstructionLimitHits;
          return getUnknown(evaluator, inst, UnknownReason::TooManyInstructions);
       }
 
+      // Evaluations which build large aggregates can stay below the
+      // instruction limit and still need a lot of memory.
+      if (evaluator.getBytesAllocatedByEvaluation() > ConstExprMemoryLimit) {
+         ++NumMemoryLimitHits;
+         return getUnknown(evaluator, inst, UnknownReason::TooMuchMemory);
+      }
+
       if (isa<ReturnInst>(inst)) {
          auto val = state.getConstantValue(inst->getOperand(0));
          if (!val.isConstant())
@@ -1892,8 +1915,7 @@ evaluateAndCacheCall(PILFunction &fn, SubstitutionMap substitutionMap,
          // If we got a constant value, then we're good. Set up the normal result
          // values as well as any indirect results.
          result = val;
-
-         // TODO: Handle caching of results.
+         evaluator.memoizeCall(&fn, substitutionMap, arguments, result);
 
          LLVM_DEBUG(llvm::dbgs() << "\n");
          return None;
@@ -1920,13 +1942,208 @@ evaluateAndCacheCall(PILFunction &fn, SubstitutionMap substitutionMap,
 
 ConstExprEvaluator::ConstExprEvaluator(SymbolicValueAllocator &alloc,
                                        unsigned assertConf, bool trackCallees)
-   : allocator(alloc), assertConfig(assertConf), trackCallees(trackCallees) {}
+   : allocator(alloc), assertConfig(assertConf), trackCallees(trackCallees),
+     evaluationStartBytes(alloc.getBytesAllocated()) {}
 
 ConstExprEvaluator::~ConstExprEvaluator() {}
 
+/// Returns true if \p value is a constant which does not refer to memory,
+/// i.e. which can't be observed or changed through another value.
+static bool isMemoizableValue(SymbolicValue value) {
+   switch (value.getKind()) {
+      case SymbolicValue::Metatype:
+      case SymbolicValue::Function:
+      case SymbolicValue::Integer:
+      case SymbolicValue::String:
+      case SymbolicValue::Enum:
+         return true;
+      case SymbolicValue::Aggregate:
+         return llvm::all_of(value.getAggregateMembers(), isMemoizableValue);
+      case SymbolicValue::EnumWithPayload:
+         return isMemoizableValue(value.getEnumPayloadValue());
+      case SymbolicValue::Unknown:
+      case SymbolicValue::Address:
+      case SymbolicValue::ArrayStorage:
+      case SymbolicValue::Array:
+      case SymbolicValue::Closure:
+      case SymbolicValue::UninitMemory:
+         return false;
+   }
+   llvm_unreachable("unknown symbolic value kind");
+}
+
+static llvm::hash_code hashMemoizableValue(SymbolicValue value) {
+   auto kind = value.getKind();
+   switch (kind) {
+      case SymbolicValue::Metatype:
+         return llvm::hash_combine(kind, value.getMetatypeValue().getPointer());
+      case SymbolicValue::Function:
+         return llvm::hash_combine(kind, value.getFunctionValue());
+      case SymbolicValue::Integer:
+         return llvm::hash_combine(kind, value.getIntegerValue());
+      case SymbolicValue::String:
+         return llvm::hash_combine(kind, value.getStringValue());
+      case SymbolicValue::Enum:
+         return llvm::hash_combine(kind, value.getEnumValue());
+      case SymbolicValue::Aggregate: {
+         llvm::hash_code hash = llvm::hash_value(kind);
+         for (SymbolicValue member : value.getAggregateMembers())
+            hash = llvm::hash_combine(hash, hashMemoizableValue(member));
+         return hash;
+      }
+      case SymbolicValue::EnumWithPayload:
+         return llvm::hash_combine(kind, value.getEnumValue(),
+                                   hashMemoizableValue(
+                                      value.getEnumPayloadValue()));
+      default:
+         llvm_unreachable("value is not memoizable");
+   }
+}
+
+static bool areEqualMemoizableValues(SymbolicValue lhs, SymbolicValue rhs) {
+   if (lhs.getKind() != rhs.getKind())
+      return false;
+   switch (lhs.getKind()) {
+      case SymbolicValue::Metatype:
+         return lhs.getMetatypeValue() == rhs.getMetatypeValue();
+      case SymbolicValue::Function:
+         return lhs.getFunctionValue() == rhs.getFunctionValue();
+      case SymbolicValue::Integer: {
+         APInt lhsValue = lhs.getIntegerValue();
+         APInt rhsValue = rhs.getIntegerValue();
+         return lhsValue.getBitWidth() == rhsValue.getBitWidth() &&
+                lhsValue == rhsValue;
+      }
+      case SymbolicValue::String:
+         return lhs.getStringValue() == rhs.getStringValue();
+      case SymbolicValue::Enum:
+         return lhs.getEnumValue() == rhs.getEnumValue();
+      case SymbolicValue::Aggregate: {
+         if (!lhs.getAggregateType()->isEqual(rhs.getAggregateType()))
+            return false;
+         auto lhsMembers = lhs.getAggregateMembers();
+         auto rhsMembers = rhs.getAggregateMembers();
+         if (lhsMembers.size() != rhsMembers.size())
+            return false;
+         for (unsigned i = 0, e = lhsMembers.size(); i != e; ++i) {
+            if (!areEqualMemoizableValues(lhsMembers[i], rhsMembers[i]))
+               return false;
+         }
+         return true;
+      }
+      case SymbolicValue::EnumWithPayload:
+         return lhs.getEnumValue() == rhs.getEnumValue() &&
+                areEqualMemoizableValues(lhs.getEnumPayloadValue(),
+                                         rhs.getEnumPayloadValue());
+      default:
+         llvm_unreachable("value is not memoizable");
+   }
+}
+
+namespace polar {
+/// A call of a function with memoizable arguments. The arguments are owned
+/// by the ConstExprCallMemo, or by the caller for a lookup.
+struct ConstExprCall {
+   PILFunction *callee;
+   const void *substitutions;
+   ArrayRef<SymbolicValue> arguments;
+};
+} // end namespace polar
+
+namespace llvm {
+template <> struct DenseMapInfo<polar::ConstExprCall> {
+   static polar::ConstExprCall getEmptyKey() {
+      return {DenseMapInfo<polar::PILFunction *>::getEmptyKey(), nullptr, {}};
+   }
+   static polar::ConstExprCall getTombstoneKey() {
+      return {DenseMapInfo<polar::PILFunction *>::getTombstoneKey(), nullptr,
+              {}};
+   }
+   static unsigned getHashValue(const polar::ConstExprCall &call) {
+      llvm::hash_code hash = llvm::hash_combine(call.callee, call.substitutions);
+      for (polar::SymbolicValue argument : call.arguments)
+         hash = llvm::hash_combine(hash, hashMemoizableValue(argument));
+      return hash;
+   }
+   static bool isEqual(const polar::ConstExprCall &lhs,
+                       const polar::ConstExprCall &rhs) {
+      if (lhs.callee != rhs.callee)
+         return false;
+      // The empty and tombstone keys have no arguments to compare.
+      if (lhs.callee == getEmptyKey().callee ||
+          lhs.callee == getTombstoneKey().callee)
+         return true;
+      if (lhs.substitutions != rhs.substitutions ||
+          lhs.arguments.size() != rhs.arguments.size())
+         return false;
+      for (unsigned i = 0, e = lhs.arguments.size(); i != e; ++i) {
+         if (!areEqualMemoizableValues(lhs.arguments[i], rhs.arguments[i]))
+            return false;
+      }
+      return true;
+   }
+};
+} // end namespace llvm
+
+namespace polar {
+/// The calls a ConstExprEvaluator evaluated to a constant.
+class ConstExprCallMemo {
+   /// Owns the arguments of the memoized calls.
+   llvm::BumpPtrAllocator argumentAllocator;
+
+public:
+   /// The result of each memoized call.
+   llvm::DenseMap<ConstExprCall, SymbolicValue> calls;
+
+   /// Returns a copy of \p arguments which lives as long as the memo.
+   ArrayRef<SymbolicValue> copyArguments(ArrayRef<SymbolicValue> arguments) {
+      if (arguments.empty())
+         return {};
+      auto *storage = argumentAllocator.Allocate<SymbolicValue>(
+         arguments.size());
+      std::uninitialized_copy(arguments.begin(), arguments.end(), storage);
+      return {storage, arguments.size()};
+   }
+};
+} // end namespace polar
+
+Optional<SymbolicValue>
+ConstExprEvaluator::lookupMemoizedCall(PILFunction *callee,
+                                       SubstitutionMap substitutions,
+                                       ArrayRef<SymbolicValue> arguments) {
+   if (!callMemo || !llvm::all_of(arguments, isMemoizableValue))
+      return None;
+
+   auto found = callMemo->calls.find(
+      {callee, substitutions.getOpaqueValue(), arguments});
+   if (found == callMemo->calls.end())
+      return None;
+   ++NumMemoizedCallHits;
+   return found->second;
+}
+
+void ConstExprEvaluator::memoizeCall(PILFunction *callee,
+                                     SubstitutionMap substitutions,
+                                     ArrayRef<SymbolicValue> arguments,
+                                     SymbolicValue result) {
+   if (!isMemoizableValue(result) ||
+       !llvm::all_of(arguments, isMemoizableValue))
+      return;
+
+   if (!callMemo)
+      callMemo = std::make_unique<ConstExprCallMemo>();
+   ConstExprCall call = {callee, substitutions.getOpaqueValue(), arguments};
+   if (callMemo->calls.count(call))
+      return;
+   call.arguments = callMemo->copyArguments(arguments);
+   callMemo->calls.insert({call, result});
+   ++NumMemoizedCalls;
+}
+
 /// An explicit copy constructor.
 ConstExprEvaluator::ConstExprEvaluator(const ConstExprEvaluator &other)
-   : allocator(other.allocator) {
+   : allocator(other.allocator),
+     evaluationStartBytes(other.evaluationStartBytes) {
    callStack = other.callStack;
 }
 
@@ -1947,6 +2164,7 @@ void ConstExprEvaluator::computeConstantValues(
                                 numInstEvaluated,
       /*enableTopLevelEvaluation*/ true);
    for (auto v : values) {
+      startEvaluation();
       auto symVal = state.getConstantValue(v);
       results.push_back(symVal);
 
@@ -1969,6 +2187,9 @@ ConstExprStepEvaluator::ConstExprStepEvaluator(SymbolicValueAllocator &alloc,
         new ConstExprFunctionState(evaluator, fun, {}, stepsEvaluated,
            /*enableTopLevelEvaluation*/ false)) {
    assert(fun);
+   // The steps of one step evaluator form a single evaluation, so their
+   // allocations all count against the memory limit.
+   evaluator.startEvaluation();
 }
 
 ConstExprStepEvaluator::~ConstExprStepEvaluator() { delete internalState; }
@@ -2070,6 +2291,7 @@ bool polar::isFailStopError(SymbolicValue errorVal) {
 
    switch (errorVal.getUnknownReason().getKind()) {
       case UnknownReason::TooManyInstructions:
+      case UnknownReason::TooMuchMemory:
       case UnknownReason::Overflow:
       case UnknownReason::Trap:
          return true;
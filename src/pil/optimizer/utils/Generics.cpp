@@ -24,6 +24,7 @@
 #include "polarphp/pil/lang/DebugUtils.h"
 #include "polarphp/pil/lang/InstructionUtils.h"
 #include "polarphp/pil/lang/OptimizationRemark.h"
+#include "polarphp/pil/optimizer/analysis/PrespecializationAnalysis.h"
 #include "polarphp/pil/optimizer/utils/PILOptFunctionBuilder.h"
 #include "polarphp/pil/optimizer/utils/GenericCloner.h"
 #include "polarphp/pil/optimizer/utils/SpecializationMangler.h"
@@ -2532,24 +2533,27 @@ void polar::checkCompletenessOfPrespecializations(PILModule &M) {
 /// Try to look up an existing specialization in the specialization cache.
 /// If it is found, it tries to link this specialization.
 ///
-/// For now, it performs a lookup only in the standard library.
-/// But in the future, one could think of maintaining a cache
-/// of optimized specializations.
+/// It performs a lookup in the standard library and, if \p PSA is given, in
+/// the imported modules which were recorded to define the specialization.
 static PILFunction *lookupExistingSpecialization(PILModule &M,
-                                                 StringRef FunctionName) {
+                                                 StringRef FunctionName,
+                                                 PrespecializationAnalysis *PSA) {
    // Try to link existing specialization only in -Onone mode.
    // All other compilation modes perform specialization themselves.
-   // TODO: Cache optimized specializations and perform lookup here?
    // Only check that this function exists, but don't read
    // its body. It can save some compile-time.
    if (isKnownPrespecialization(FunctionName))
       return M.findFunction(FunctionName, PILLinkage::PublicExternal);
 
+   if (PSA)
+      return PSA->findPrespecialization(FunctionName);
+
    return nullptr;
 }
 
 PILFunction *polar::lookupPrespecializedSymbol(PILModule &M,
-                                               StringRef FunctionName) {
+                                               StringRef FunctionName,
+                                               PrespecializationAnalysis *PSA) {
    // First check if the module contains a required specialization already.
    auto *Specialization = M.lookUpFunction(FunctionName);
    if (Specialization) {
@@ -2558,7 +2562,7 @@ PILFunction *polar::lookupPrespecializedSymbol(PILModule &M,
    }
 
    // Then check if the required specialization can be found elsewhere.
-   Specialization = lookupExistingSpecialization(M, FunctionName);
+   Specialization = lookupExistingSpecialization(M, FunctionName, PSA);
    if (!Specialization)
       return nullptr;
 
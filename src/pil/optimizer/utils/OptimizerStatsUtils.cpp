@@ -969,6 +969,10 @@ void polar::updatePILModuleStatsAfterTransform(PILModule &M,
 // This is just a hook for possible extensions in the future.
 // It could be used e.g. to detect sequences of consecutive executions
 // of the same transform.
+bool polar::isPILModuleStatsEnabled() {
+   return PILStatsModules || PILStatsFunctions;
+}
+
 void polar::updatePILModuleStatsBeforeTransform(PILModule &M,
                                                 PILTransform *Transform,
                                                 PILPassManager &PM,
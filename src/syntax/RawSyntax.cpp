@@ -12,6 +12,13 @@
 #include "polarphp/syntax/RawSyntax.h"
 #include "polarphp/basic/ColorUtils.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <vector>
+
 namespace polar::syntax {
 
 namespace {
@@ -48,13 +55,167 @@ void print_syntax_kind(SyntaxKind kind, raw_ostream &outStream,
    outStream << ">";
 }
 
+/// The node ids the current thread reserved but did not hand out yet, the
+/// half open range [next, end). \c begin and \c end are only written with
+/// the registry lock held, a reservation of an id inside [begin, end) sets
+/// \c dropped and the owning thread takes a new block.
+struct NodeIdBlock
+{
+   NodeIdBlock();
+   ~NodeIdBlock();
+
+   SyntaxNodeId begin = 0;
+   SyntaxNodeId next = 0;
+   SyntaxNodeId end = 0;
+   std::atomic<bool> dropped{false};
+};
+
+/// The id blocks of all live threads, so a reservation only has to drop
+/// the one block which contains the reserved id.
+struct NodeIdBlockRegistry
+{
+   std::mutex mutex;
+   std::vector<NodeIdBlock *> blocks;
+};
+
+NodeIdBlockRegistry &get_node_id_block_registry()
+{
+   static NodeIdBlockRegistry registry;
+   return registry;
+}
+
+NodeIdBlock::NodeIdBlock()
+{
+   NodeIdBlockRegistry &registry = get_node_id_block_registry();
+   std::lock_guard<std::mutex> guard(registry.mutex);
+   registry.blocks.push_back(this);
+}
+
+NodeIdBlock::~NodeIdBlock()
+{
+   NodeIdBlockRegistry &registry = get_node_id_block_registry();
+   std::lock_guard<std::mutex> guard(registry.mutex);
+   registry.blocks.erase(std::find(registry.blocks.begin(), registry.blocks.end(), this));
+}
+
+thread_local NodeIdBlock sg_nodeIdBlock;
+
+/// Tokens worth sharing, long string literals rarely repeat and comments or
+/// garbage text in the trivia would make the lookup as expensive as a copy.
+bool should_intern_token(TokenKindType tokenKind, StringRef text,
+                         ArrayRef<TriviaPiece> leadingTrivia,
+                         ArrayRef<TriviaPiece> trailingTrivia,
+                         SourcePresence presence)
+{
+   if (presence != SourcePresence::Present) {
+      return false;
+   }
+   if ((tokenKind == TokenKindType::T_CONSTANT_ENCAPSED_STRING ||
+        tokenKind == TokenKindType::T_ENCAPSED_AND_WHITESPACE) && text.size() > 16) {
+      return false;
+   }
+   auto hasText = [](const TriviaPiece &piece) {
+      return !piece.getText().empty();
+   };
+   return std::none_of(leadingTrivia.begin(), leadingTrivia.end(), hasText) &&
+         std::none_of(trailingTrivia.begin(), trailingTrivia.end(), hasText);
+}
+
+/// A layout node can only be shared if its whole subtree is, so all of its
+/// children must be interned nodes themselves.
+bool should_intern_layout(ArrayRef<RefCountPtr<RawSyntax>> layout, SourcePresence presence)
+{
+   if (presence != SourcePresence::Present || layout.empty()) {
+      return false;
+   }
+   return std::all_of(layout.begin(), layout.end(), [](const RefCountPtr<RawSyntax> &child) {
+      return child && child->isInterned();
+   });
+}
+
+void profile_layout(FoldingSetNodeID &id, SyntaxKind kind, ArrayRef<RefCountPtr<RawSyntax>> layout)
+{
+   id.AddInteger(unsigned(kind));
+   for (auto &child : layout) {
+      id.AddPointer(child.get());
+   }
+}
+
+void profile_layout(FoldingSetNodeID &id, SyntaxKind kind, RawSyntaxLayout layout)
+{
+   id.AddInteger(unsigned(kind));
+   for (RawSyntax *child : layout) {
+      id.AddPointer(child);
+   }
+}
+
+bool layout_equals(RawSyntaxLayout layout, ArrayRef<RefCountPtr<RawSyntax>> other)
+{
+   return layout.size() == other.size() &&
+         std::equal(layout.begin(), layout.end(), other.begin(),
+                    [](RawSyntax *child, const RefCountPtr<RawSyntax> &otherChild) {
+      return child == otherChild.get();
+   });
+}
+
+/// Children can be stored as compact references if the parent is owned by
+/// the same compact arena as all of them, a reused node of an older tree
+/// has to be kept by pointer.
+bool can_use_compact_layout(ArrayRef<RefCountPtr<RawSyntax>> layout, const SyntaxArena *arena)
+{
+   return std::all_of(layout.begin(), layout.end(), [arena](const RefCountPtr<RawSyntax> &child) {
+      return !child || (child->isArenaOwned() && child->getArena() == arena);
+   });
+}
+
 } // anonymous namespace
 
-unsigned RawSyntax::sm_nextFreeNodeId = 1;
+std::atomic<SyntaxNodeId> RawSyntax::sm_nextFreeNodeId{1};
+
+SyntaxNodeId RawSyntax::allocateNodeId()
+{
+   NodeIdBlock &block = sg_nodeIdBlock;
+   if (block.next == block.end || block.dropped.load(std::memory_order_relaxed)) {
+      // the new range is published under the registry lock, so a reservation
+      // of an id below the counter always sees the block which holds it
+      NodeIdBlockRegistry &registry = get_node_id_block_registry();
+      std::lock_guard<std::mutex> guard(registry.mutex);
+      SyntaxNodeId first = sm_nextFreeNodeId.fetch_add(NodeIdBlockSize, std::memory_order_relaxed);
+      assert(first <= std::numeric_limits<SyntaxNodeId>::max() - NodeIdBlockSize &&
+             "syntax node ids exhausted");
+      block.begin = first;
+      block.next = first;
+      block.end = first + NodeIdBlockSize;
+      block.dropped.store(false, std::memory_order_relaxed);
+   }
+   return block.next++;
+}
+
+void RawSyntax::reserveNodeId(SyntaxNodeId nodeId)
+{
+   assert(nodeId < std::numeric_limits<SyntaxNodeId>::max() && "syntax node ids exhausted");
+   SyntaxNodeId current = sm_nextFreeNodeId.load(std::memory_order_relaxed);
+   while (current <= nodeId) {
+      if (sm_nextFreeNodeId.compare_exchange_weak(current, nodeId + 1, std::memory_order_relaxed)) {
+         // no block contains ids at or above the counter
+         return;
+      }
+   }
+   // the id lies in a range which was already handed out in blocks, the
+   // thread which holds it in the unused part of its block has to drop it
+   NodeIdBlockRegistry &registry = get_node_id_block_registry();
+   std::lock_guard<std::mutex> guard(registry.mutex);
+   for (NodeIdBlock *block : registry.blocks) {
+      if (block->begin <= nodeId && nodeId < block->end) {
+         block->dropped.store(true, std::memory_order_relaxed);
+         break;
+      }
+   }
+}
 
 RawSyntax::RawSyntax(SyntaxKind kind, ArrayRef<RefCountPtr<RawSyntax>> layout,
                      SourcePresence presence, const RefCountPtr<SyntaxArena> &arena,
-                     std::optional<unsigned> nodeId)
+                     bool compactLayout, std::optional<unsigned> nodeId)
 {
    assert(kind != SyntaxKind::Token &&
          "'token' syntax node must be constructed with dedicated constructor");
@@ -63,20 +224,43 @@ RawSyntax::RawSyntax(SyntaxKind kind, ArrayRef<RefCountPtr<RawSyntax>> layout,
 
    if (nodeId.has_value()) {
       this->m_nodeId = nodeId.value();
-      sm_nextFreeNodeId = std::max(this->m_nodeId + 1, sm_nextFreeNodeId);
+      reserveNodeId(this->m_nodeId);
    } else {
-      this->m_nodeId = sm_nextFreeNodeId++;
+      this->m_nodeId = allocateNodeId();
    }
    m_bits.common.kind = unsigned(kind);
    m_bits.common.presence = unsigned(presence);
+   m_bits.common.interned = false;
+   m_bits.common.arenaOwned = arena && arena->isCompactLayoutEnabled();
+   m_bits.common.compactLayout = compactLayout;
    m_bits.layout.numChildren = layout.size();
    m_bits.layout.textLength = UINT32_MAX;
 
-   this->arena = arena;
+   this->arena = arena.get();
+   if (arena && !isArenaOwned()) {
+      arena->Retain();
+   }
 
    // Initialize layout data.
+   if (compactLayout) {
+      assert(isArenaOwned() && "only arena owned nodes can have a compact layout");
+      std::uint32_t *refs = getTrailingObjects<std::uint32_t>();
+      for (const RefCountPtr<RawSyntax> &child : layout) {
+         *refs++ = child ? child->m_arenaRef : SyntaxArena::NullCompactRef;
+      }
+      return;
+   }
    std::uninitialized_copy(layout.begin(), layout.end(),
                            getTrailingObjects<RefCountPtr<RawSyntax>>());
+   if (isArenaOwned()) {
+      // children of our own arena must not keep the arena alive through us,
+      // the arena outlives them anyway
+      for (const RefCountPtr<RawSyntax> &child : layout) {
+         if (child && child->isArenaOwned() && child->arena == this->arena) {
+            arena->Release();
+         }
+      }
+   }
 }
 
 RawSyntax::RawSyntax(TokenKindType tokenKind, OwnedString text,
@@ -89,21 +273,30 @@ RawSyntax::RawSyntax(TokenKindType tokenKind, OwnedString text,
 
    if (nodeId.has_value()) {
       this->m_nodeId = nodeId.value();
-      sm_nextFreeNodeId = std::max(this->m_nodeId + 1, sm_nextFreeNodeId);
+      reserveNodeId(this->m_nodeId);
    } else {
-      this->m_nodeId = sm_nextFreeNodeId++;
+      this->m_nodeId = allocateNodeId();
    }
    m_bits.common.kind = unsigned(SyntaxKind::Token);
    m_bits.common.presence = unsigned(presence);
+   m_bits.common.interned = false;
+   m_bits.common.arenaOwned = arena && arena->isCompactLayoutEnabled();
+   m_bits.common.compactLayout = false;
    m_bits.token.tokenKind = unsigned(tokenKind);
    m_bits.token.numLeadingTrivia = leadingTrivia.size();
    m_bits.token.numTrailingTrivia = trailingTrivia.size();
 
-   this->arena = arena;
+   this->arena = arena.get();
+   if (arena && !isArenaOwned()) {
+      arena->Retain();
+   }
 
    // Initialize token text.
    ::new (static_cast<void *>(getTrailingObjects<OwnedString>()))
          OwnedString(text);
+   // Initialize token values, they are compared when tokens get interned.
+   *getTrailingObjects<std::int64_t>() = 0;
+   *getTrailingObjects<double>() = 0;
    // Initialize leading trivia.
    std::uninitialized_copy(leadingTrivia.begin(), leadingTrivia.end(),
                            getTrailingObjects<TriviaPiece>());
@@ -113,24 +306,12 @@ RawSyntax::RawSyntax(TokenKindType tokenKind, OwnedString text,
                            m_bits.token.numLeadingTrivia);
 }
 
-RawSyntax::RawSyntax(TokenKindType tokenKind, OwnedString text, std::int64_t value, ArrayRef<TriviaPiece> leadingTrivia,
-          ArrayRef<TriviaPiece> trailingTrivia, SourcePresence presence,
-          const RefCountPtr<SyntaxArena> &arena, std::optional<SyntaxNodeId> nodeId)
-   : RawSyntax(tokenKind, text, leadingTrivia, trailingTrivia, presence, arena, nodeId)
-{
-   *getTrailingObjects<std::int64_t>() = value;
-}
-
-RawSyntax::RawSyntax(TokenKindType tokenKind, OwnedString text, double value, ArrayRef<TriviaPiece> leadingTrivia,
-          ArrayRef<TriviaPiece> trailingTrivia, SourcePresence presence,
-          const RefCountPtr<SyntaxArena> &arena, std::optional<SyntaxNodeId> nodeId)
-   : RawSyntax(tokenKind, text, leadingTrivia, trailingTrivia, presence, arena, nodeId)
-{
-   *getTrailingObjects<double>() = value;
-}
-
 RawSyntax::~RawSyntax()
 {
+   // a dying compact arena drops its interning cache as a whole
+   if (isInterned() && !(isArenaOwned() && arena->m_destroying)) {
+      forgetInterned();
+   }
    if (isToken()) {
       getTrailingObjects<OwnedString>()->~OwnedString();
       for (auto &trivia : getLeadingTrivia()) {
@@ -140,11 +321,28 @@ RawSyntax::~RawSyntax()
       for (auto &trivia : getTrailingTrivia()) {
          trivia.~TriviaPiece();
       }
-   } else {
-      for (auto &child : getLayout()) {
-         child.~RefCountPtr<RawSyntax>();
+   } else if (!hasCompactLayout()) {
+      RefCountPtr<RawSyntax> *children = getTrailingObjects<RefCountPtr<RawSyntax>>();
+      for (size_t index = 0, numChildren = getNumChildren(); index < numChildren; ++index) {
+         children[index].~RefCountPtr<RawSyntax>();
       }
    }
+   if (arena && !isArenaOwned()) {
+      // this may free the memory of the node itself, keep it last
+      arena->Release();
+   }
+}
+
+size_t RawSyntax::getAllocationSize() const
+{
+   if (isToken()) {
+      return totalSizeToAlloc<RefCountPtr<RawSyntax>, OwnedString, std::int64_t, double, TriviaPiece,
+            std::uint32_t>(0, 1, 1, 1, m_bits.token.numLeadingTrivia + m_bits.token.numTrailingTrivia, 0);
+   }
+   size_t numChildren = m_bits.layout.numChildren;
+   return totalSizeToAlloc<RefCountPtr<RawSyntax>, OwnedString, std::int64_t, double, TriviaPiece,
+         std::uint32_t>(hasCompactLayout() ? 0 : numChildren, 0, 0, 0, 0,
+                        hasCompactLayout() ? numChildren : 0);
 }
 
 RefCountPtr<RawSyntax> RawSyntax::make(SyntaxKind kind, ArrayRef<RefCountPtr<RawSyntax>> layout,
@@ -152,12 +350,79 @@ RefCountPtr<RawSyntax> RawSyntax::make(SyntaxKind kind, ArrayRef<RefCountPtr<Raw
                                        const RefCountPtr<SyntaxArena> &arena,
                                        std::optional<unsigned> nodeId)
 {
-   auto size = totalSizeToAlloc<RefCountPtr<RawSyntax>, OwnedString, std::int64_t, double, TriviaPiece>(
-            layout.size(), 0, 0, 0, 0);
-   void *data = arena ? arena->allocate(size, alignof(RawSyntax))
-                      : ::operator new(size);
-   return RefCountPtr<RawSyntax>(
-            new (data) RawSyntax(kind, layout, presence, arena, nodeId));
+   bool compactLayout = arena && arena->isCompactLayoutEnabled() &&
+         can_use_compact_layout(layout, arena.get());
+   auto size = totalSizeToAlloc<RefCountPtr<RawSyntax>, OwnedString, std::int64_t, double, TriviaPiece,
+         std::uint32_t>(compactLayout ? 0 : layout.size(), 0, 0, 0, 0,
+                        compactLayout ? layout.size() : 0);
+   bool intern = arena && arena->isInterningEnabled() && !nodeId.has_value() &&
+         should_intern_layout(layout, presence);
+   std::unique_lock<std::mutex> lock;
+   if (intern) {
+      lock = std::unique_lock<std::mutex>(arena->m_internMutex);
+      auto iter = arena->m_internedNodes.find_as(InternedLayoutKey{kind, layout});
+      if (iter != arena->m_internedNodes.end() && (*iter)->tryRetain()) {
+         RefCountPtr<RawSyntax> shared(*iter);
+         (*iter)->release();
+         ++arena->m_internStats.layoutHits;
+         arena->m_internStats.bytesSaved += size;
+         return shared;
+      }
+   }
+   std::uint32_t arenaRef = SyntaxArena::NullCompactRef;
+   void *data = allocate(size, arena, arenaRef);
+   RefCountPtr<RawSyntax> raw(new (data) RawSyntax(kind, layout, presence, arena, compactLayout,
+                                                   nodeId));
+   raw->m_arenaRef = arenaRef;
+   if (intern) {
+      raw->m_bits.common.interned = true;
+      arena->m_internedNodes.insert(raw.get());
+      ++arena->m_internStats.layoutMisses;
+   }
+   return raw;
+}
+
+RefCountPtr<RawSyntax> RawSyntax::makeToken(TokenKindType tokenKind, OwnedString text,
+                                            std::int64_t intValue, double doubleValue,
+                                            ArrayRef<TriviaPiece> leadingTrivia,
+                                            ArrayRef<TriviaPiece> trailingTrivia,
+                                            SourcePresence presence,
+                                            const RefCountPtr<SyntaxArena> &arena,
+                                            std::optional<unsigned> nodeId)
+{
+   // every token has a slot for both value kinds, the trivia are laid out
+   // after them
+   auto size = totalSizeToAlloc<RefCountPtr<RawSyntax>, OwnedString, std::int64_t, double, TriviaPiece,
+         std::uint32_t>(0, 1, 1, 1, leadingTrivia.size() + trailingTrivia.size(), 0);
+   bool intern = arena && arena->isInterningEnabled() && !nodeId.has_value() &&
+         should_intern_token(tokenKind, text.str(), leadingTrivia, trailingTrivia, presence);
+   std::unique_lock<std::mutex> lock;
+   if (intern) {
+      lock = std::unique_lock<std::mutex>(arena->m_internMutex);
+      auto iter = arena->m_internedNodes.find_as(
+               InternedTokenKey{tokenKind, text, intValue, doubleValue, leadingTrivia, trailingTrivia});
+      if (iter != arena->m_internedNodes.end() && (*iter)->tryRetain()) {
+         RefCountPtr<RawSyntax> shared(*iter);
+         (*iter)->release();
+         ++arena->m_internStats.tokenHits;
+         arena->m_internStats.bytesSaved += size;
+         return shared;
+      }
+   }
+   std::uint32_t arenaRef = SyntaxArena::NullCompactRef;
+   void *data = allocate(size, arena, arenaRef);
+   RefCountPtr<RawSyntax> raw(new (data) RawSyntax(tokenKind, text, leadingTrivia,
+                                                   trailingTrivia, presence,
+                                                   arena, nodeId));
+   raw->m_arenaRef = arenaRef;
+   *raw->getTrailingObjects<std::int64_t>() = intValue;
+   *raw->getTrailingObjects<double>() = doubleValue;
+   if (intern) {
+      raw->m_bits.common.interned = true;
+      arena->m_internedNodes.insert(raw.get());
+      ++arena->m_internStats.tokenMisses;
+   }
+   return raw;
 }
 
 RefCountPtr<RawSyntax> RawSyntax::make(TokenKindType tokenKind, OwnedString text,
@@ -167,13 +432,8 @@ RefCountPtr<RawSyntax> RawSyntax::make(TokenKindType tokenKind, OwnedString text
                                        const RefCountPtr<SyntaxArena> &arena,
                                        std::optional<unsigned> nodeId)
 {
-   auto size = totalSizeToAlloc<RefCountPtr<RawSyntax>, OwnedString, std::int64_t, double, TriviaPiece>(
-            0, 1, 0, 0, leadingTrivia.size() + trailingTrivia.size());
-   void *data = arena ? arena->allocate(size, alignof(RawSyntax))
-                      : ::operator new(size);
-   return RefCountPtr<RawSyntax>(new (data) RawSyntax(tokenKind, text, leadingTrivia,
-                                                      trailingTrivia, presence,
-                                                      arena, nodeId));
+   return makeToken(tokenKind, text, 0, 0, leadingTrivia, trailingTrivia, presence,
+                    arena, nodeId);
 }
 
 RefCountPtr<RawSyntax> RawSyntax::make(TokenKindType tokenKind, OwnedString text,
@@ -184,16 +444,10 @@ RefCountPtr<RawSyntax> RawSyntax::make(TokenKindType tokenKind, OwnedString text
                                        const RefCountPtr<SyntaxArena> &arena,
                                        std::optional<unsigned> nodeId)
 {
-   auto size = totalSizeToAlloc<RefCountPtr<RawSyntax>, OwnedString, std::int64_t, double, TriviaPiece>(
-            0, 1, 1, 0, leadingTrivia.size() + trailingTrivia.size());
-   void *data = arena ? arena->allocate(size, alignof(RawSyntax))
-                      : ::operator new(size);
-   return RefCountPtr<RawSyntax>(new (data) RawSyntax(tokenKind, text, value, leadingTrivia,
-                                                      trailingTrivia, presence,
-                                                      arena, nodeId));
+   return makeToken(tokenKind, text, value, 0, leadingTrivia, trailingTrivia, presence,
+                    arena, nodeId);
 }
 
-
 RefCountPtr<RawSyntax> RawSyntax::make(TokenKindType tokenKind, OwnedString text,
                                        double value,
                                        ArrayRef<TriviaPiece> leadingTrivia,
@@ -202,13 +456,30 @@ RefCountPtr<RawSyntax> RawSyntax::make(TokenKindType tokenKind, OwnedString text
                                        const RefCountPtr<SyntaxArena> &arena,
                                        std::optional<unsigned> nodeId)
 {
-   auto size = totalSizeToAlloc<RefCountPtr<RawSyntax>, OwnedString, std::int64_t, double, TriviaPiece>(
-            0, 1, 0, 1, leadingTrivia.size() + trailingTrivia.size());
-   void *data = arena ? arena->allocate(size, alignof(RawSyntax))
-                      : ::operator new(size);
-   return RefCountPtr<RawSyntax>(new (data) RawSyntax(tokenKind, text, value, leadingTrivia,
-                                                      trailingTrivia, presence,
-                                                      arena, nodeId));
+   return makeToken(tokenKind, text, 0, value, leadingTrivia, trailingTrivia, presence,
+                    arena, nodeId);
+}
+
+void *RawSyntax::allocate(size_t size, const RefCountPtr<SyntaxArena> &arena,
+                          std::uint32_t &arenaRef)
+{
+   if (!arena) {
+      return ::operator new(size);
+   }
+   if (arena->isCompactLayoutEnabled()) {
+      return arena->allocateCompact(size, arenaRef);
+   }
+   return arena->allocate(size, alignof(RawSyntax));
+}
+
+void RawSyntax::forgetInterned()
+{
+   std::lock_guard<std::mutex> lock(arena->m_internMutex);
+   // a dying node can be replaced by an identical new one while it waits for
+   // the lock, entries are compared by identity so only ours is removed
+   bool erased = arena->m_internedNodes.erase(this);
+   (void)erased;
+   assert(erased && "interned node is not in the cache");
 }
 
 RefCountPtr<RawSyntax> RawSyntax::append(RefCountPtr<RawSyntax> newLayoutElement) const
@@ -256,7 +527,7 @@ RawSyntax::accumulateAbsolutePosition(AbsolutePosition &pos) const
          trailer.accumulateAbsolutePosition(pos);
       }
    } else {
-      for (auto &child : getLayout()) {
+      for (RawSyntax *child : getLayout()) {
          if (!child) {
             continue;
          }
@@ -279,7 +550,7 @@ bool RawSyntax::accumulateLeadingTrivia(AbsolutePosition &pos) const
          return true;
       }
    } else {
-      for (auto &child: getLayout()) {
+      for (RawSyntax *child : getLayout()) {
          if (!child || child->isMissing()) {
             continue;
          }
@@ -311,7 +582,7 @@ void RawSyntax::print(raw_ostream &outStream, SyntaxPrintOptions opts) const
       if (printKind) {
          print_syntax_kind(kind, outStream, opts, true);
       }
-      for (const auto &layout : getLayout()) {
+      for (RawSyntax *layout : getLayout()) {
          if (layout) {
             layout->print(outStream, opts);
          }
@@ -361,7 +632,7 @@ void RawSyntax::dump(raw_ostream &outStream, unsigned indent) const
          trailer.dump(outStream, indent + 1);
       }
    } else {
-      for (auto &child : getLayout()) {
+      for (RawSyntax *child : getLayout()) {
          if (!child) {
             continue;
          }
@@ -404,6 +675,75 @@ void RawSyntax::profile(FoldingSetNodeID &id, TokenKindType tokenKind,
    }
 }
 
+/// A token makeToken is asked for, looked up in the interning cache before
+/// the node is made.
+struct InternedTokenKey
+{
+   TokenKindType tokenKind;
+   OwnedString text;
+   std::int64_t intValue;
+   double doubleValue;
+   ArrayRef<TriviaPiece> leadingTrivia;
+   ArrayRef<TriviaPiece> trailingTrivia;
+};
+
+/// A layout node make is asked for, looked up in the interning cache before
+/// the node is made.
+struct InternedLayoutKey
+{
+   SyntaxKind kind;
+   ArrayRef<RefCountPtr<RawSyntax>> layout;
+};
+
+unsigned InternedNodeInfo::getHashValue(const RawSyntax *node)
+{
+   FoldingSetNodeID id;
+   if (node->isToken()) {
+      RawSyntax::profile(id, node->getTokenKind(), node->getOwnedTokenText(),
+                         node->getLeadingTrivia(), node->getTrailingTrivia());
+   } else {
+      profile_layout(id, node->getKind(), node->getLayout());
+   }
+   return id.ComputeHash();
+}
+
+unsigned InternedNodeInfo::getHashValue(const InternedTokenKey &key)
+{
+   FoldingSetNodeID id;
+   RawSyntax::profile(id, key.tokenKind, key.text, key.leadingTrivia, key.trailingTrivia);
+   return id.ComputeHash();
+}
+
+unsigned InternedNodeInfo::getHashValue(const InternedLayoutKey &key)
+{
+   FoldingSetNodeID id;
+   profile_layout(id, key.kind, key.layout);
+   return id.ComputeHash();
+}
+
+bool InternedNodeInfo::isEqual(const InternedTokenKey &key, const RawSyntax *node)
+{
+   // find_as compares the key with empty and tombstone buckets too
+   if (node == getEmptyKey() || node == getTombstoneKey()) {
+      return false;
+   }
+   return node->isToken() && node->getTokenKind() == key.tokenKind &&
+         node->getTokenText() == key.text.str() &&
+         *node->getTrailingObjects<std::int64_t>() == key.intValue &&
+         std::memcmp(node->getTrailingObjects<double>(), &key.doubleValue, sizeof(double)) == 0 &&
+         node->getLeadingTrivia().equals(key.leadingTrivia) &&
+         node->getTrailingTrivia().equals(key.trailingTrivia);
+}
+
+bool InternedNodeInfo::isEqual(const InternedLayoutKey &key, const RawSyntax *node)
+{
+   if (node == getEmptyKey() || node == getTombstoneKey()) {
+      return false;
+   }
+   return !node->isToken() && node->getKind() == key.kind &&
+         layout_equals(node->getLayout(), key.layout);
+}
+
 } // polar::syntax
 
 namespace polar::utils {
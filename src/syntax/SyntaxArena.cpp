@@ -0,0 +1,60 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/11/18.
+
+#include "polarphp/syntax/SyntaxArena.h"
+#include "polarphp/syntax/RawSyntax.h"
+
+#include "llvm/Support/MathExtras.h"
+
+#include <algorithm>
+
+namespace polar::syntax {
+
+static_assert(alignof(RawSyntax) <= SyntaxArena::CompactUnit,
+              "compact references cannot address RawSyntax nodes");
+
+SyntaxArena::~SyntaxArena()
+{
+   m_destroying = true;
+   for (const CompactSlab &slab : m_compactSlabs) {
+      char *current = slab.begin;
+      char *end = slab.begin + slab.used;
+      while (current < end) {
+         RawSyntax *node = reinterpret_cast<RawSyntax *>(current);
+         current += llvm::alignTo(node->getAllocationSize(), CompactUnit);
+         node->~RawSyntax();
+      }
+   }
+}
+
+void *SyntaxArena::allocateCompact(size_t size, std::uint32_t &ref)
+{
+   size = llvm::alignTo(size, CompactUnit);
+   if (m_compactSlabs.empty() || m_compactSlabs.back().used + size > m_compactSlabs.back().size) {
+      // the last slab index is reserved for NullCompactRef
+      assert(m_compactSlabs.size() + 1 < (size_t(1) << (32 - CompactOffsetBits)) &&
+             "too many nodes for compact references");
+      // only the start of a node needs to be addressable, so an oversized
+      // node simply gets a slab of its own
+      size_t slabSize = std::max(size, CompactSlabSize);
+      m_compactSlabs.push_back({static_cast<char *>(m_allocator.Allocate(slabSize, CompactUnit)),
+                                0, slabSize});
+   }
+   CompactSlab &slab = m_compactSlabs.back();
+   ref = (static_cast<std::uint32_t>(m_compactSlabs.size() - 1) << CompactOffsetBits) |
+         static_cast<std::uint32_t>(slab.used / CompactUnit);
+   void *result = slab.begin + slab.used;
+   slab.used += size;
+   m_bytesUsed += size;
+   return result;
+}
+
+} // polar::syntax
@@ -0,0 +1,71 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/11/20.
+
+#include "polarphp/syntax/SyntaxCursor.h"
+
+namespace polar::syntax {
+
+bool RawSyntaxCursor::advance()
+{
+   if (!m_started) {
+      m_started = true;
+      if (!m_root) {
+         return false;
+      }
+      m_stack.push_back({m_root, 0});
+      m_entering = true;
+      return true;
+   }
+   if (m_stack.empty()) {
+      return false;
+   }
+   if (m_entering) {
+      const RawSyntax *node = m_stack.back().node;
+      if (node->isToken()) {
+         // tokens have no children, account for their text and leave them
+         node->accumulateAbsolutePosition(m_position);
+         m_entering = false;
+         return true;
+      }
+   } else {
+      m_stack.pop_back();
+      if (m_stack.empty()) {
+         return false;
+      }
+   }
+   // look for the next child of the current layout node, leave it when all
+   // children were visited
+   Frame &frame = m_stack.back();
+   size_t numChildren = frame.node->getNumChildren();
+   while (frame.nextChild < numChildren) {
+      const RawSyntax *child = frame.node->getChild(frame.nextChild++);
+      if (child) {
+         m_stack.push_back({child, 0});
+         m_entering = true;
+         return true;
+      }
+   }
+   m_entering = false;
+   return true;
+}
+
+void RawSyntaxCursor::skipChildren()
+{
+   assert(m_entering && "children can only be skipped right after entering a node");
+   Frame &frame = m_stack.back();
+   if (frame.node->isToken()) {
+      return;
+   }
+   frame.node->accumulateAbsolutePosition(m_position);
+   frame.nextChild = frame.node->getNumChildren();
+}
+
+} // polar::syntax
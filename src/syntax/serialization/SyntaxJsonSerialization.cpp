@@ -11,9 +11,24 @@
 
 #include "polarphp/syntax/serialization/SyntaxJsonSerialization.h"
 #include "polarphp/syntax/Syntax.h"
+#include "polarphp/syntax/SyntaxCursor.h"
+#include "polarphp/syntax/TokenKinds.h"
+
+#include <vector>
 
 namespace polar::syntax {
 
+namespace {
+
+void position_to_json(json &jsonObject, const AbsolutePosition &position)
+{
+   jsonObject["offset"] = position.getOffset();
+   jsonObject["line"] = position.getLine();
+   jsonObject["column"] = position.getColumn();
+}
+
+} // anonymous namespace
+
 void to_json(json &jsonObject, const Syntax &syntax)
 {
    jsonObject["kind"] = syntax.getKind();
@@ -21,5 +36,39 @@ void to_json(json &jsonObject, const Syntax &syntax)
    jsonObject["childCount"] = syntax.getNumChildren();
 }
 
-} // polar::syntax
+void syntax_tree_to_json(json &jsonObject, const Syntax &syntax)
+{
+   // serialize the whole tree straight from the raw nodes, the cursor keeps
+   // track of positions so no SyntaxData is created for the children
+   std::vector<json *> stack;
+   RawSyntaxCursor cursor(syntax.getRaw().get(), syntax.getAbsolutePositionBeforeLeadingTrivia());
+   while (cursor.advance()) {
+      if (cursor.isLeaving()) {
+         position_to_json((*stack.back())["end"], cursor.getPosition());
+         stack.pop_back();
+         continue;
+      }
+      const RawSyntax *node = cursor.getNode();
+      json &nodeJson = stack.empty()
+            ? jsonObject
+            : (*stack.back())["children"][cursor.getIndexInParent()];
+      size_t numChildren = node->getNumChildren();
+      nodeJson["kind"] = node->getKind();
+      nodeJson["presence"] = node->getPresence();
+      position_to_json(nodeJson["start"], cursor.getPosition());
+      if (node->isToken()) {
+         nodeJson["tokenKind"] = get_token_kind_str(node->getTokenKind()).str();
+         nodeJson["text"] = node->getTokenText().str();
+      }
+      nodeJson["hasChild"] = numChildren != 0;
+      nodeJson["childCount"] = numChildren;
+      if (numChildren != 0) {
+         // null children stay null, the array keeps the layout indexes
+         nodeJson["children"] = json::array();
+         nodeJson["children"].get_ref<json::array_t &>().resize(numChildren);
+      }
+      stack.push_back(&nodeJson);
+   }
+}
 
+} // polar::syntax
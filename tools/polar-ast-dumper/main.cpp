@@ -11,21 +11,35 @@
 
 #include "CLI/CLI.hpp"
 #include "polarphp/global/Global.h"
+#include "polarphp/global/Config.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
 #include "polarphp/parser/Lexer.h"
 #include "polarphp/parser/Token.h"
 #include "polarphp/kernel/LangOptions.h"
 #include "polarphp/basic/SourceMgr.h"
 #include "polarphp/parser/Parser.h"
+#include "polarphp/syntax/SyntaxArena.h"
 
 #include <memory>
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
 
 #define READ_STDIN_ERROR 1
 #define OPEN_SOURCE_FILE_ERROR 2
 #define OPEN_OUTPUT_FILE_ERROR 3
+#define READ_FILE_LIST_ERROR 4
+#define PARSE_ERROR 5
 
 using llvm::MemoryBuffer;
 using llvm::ErrorOr;
@@ -33,17 +47,236 @@ using polar::kernel::LangOptions;
 using polar::basic::SourceManager;
 using polar::parser::Parser;
 using polar::syntax::RefCountPtr;
+using polar::syntax::SyntaxArena;
+
+namespace {
+
+struct ParseResult
+{
+   std::string filePath;
+   std::size_t bytes = 0;
+   double seconds = 0;
+   bool readFailed = false;
+   bool parseFailed = false;
+   std::size_t nodeBytes = 0;
+   SyntaxArena::InternStats internStats;
+};
+
+/// Peak resident set size of this process in bytes, 0 if unknown.
+std::int64_t get_peak_rss()
+{
+#if defined(HAVE_GETRUSAGE) && defined(HAVE_SYS_RESOURCE_H)
+   struct rusage usage;
+   if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+      return 0;
+   }
+   std::int64_t rss = static_cast<std::int64_t>(usage.ru_maxrss);
+#ifndef __APPLE__
+   // Apple systems report bytes; everything else appears to report KB.
+   rss <<= 10;
+#endif
+   return rss;
+#else
+   return 0;
+#endif
+}
+
+double to_mega_bytes(std::size_t bytes)
+{
+   return static_cast<double>(bytes) / (1024 * 1024);
+}
+
+bool collect_files_from_list(const std::string &listPath, std::vector<std::string> &files)
+{
+   std::ifstream listStream(listPath);
+   if (listStream.fail()) {
+      return false;
+   }
+   std::string line;
+   while (std::getline(listStream, line)) {
+      if (!line.empty() && line.back() == '\r') {
+         line.pop_back();
+      }
+      if (!line.empty()) {
+         files.push_back(line);
+      }
+   }
+   return true;
+}
+
+bool collect_files_from_dir(const std::string &dirPath, std::vector<std::string> &files)
+{
+   std::error_code errorCode;
+   llvm::sys::fs::recursive_directory_iterator iter(dirPath, errorCode);
+   llvm::sys::fs::recursive_directory_iterator end;
+   for (; iter != end && !errorCode; iter.increment(errorCode)) {
+      if (llvm::sys::path::extension(iter->path()) == ".php" &&
+          llvm::sys::fs::is_regular_file(iter->path())) {
+         files.push_back(iter->path());
+      }
+   }
+   return !errorCode;
+}
+
+/// Parse one file with private SourceManager and Parser, the syntax nodes go
+/// into \p arena which is owned by the calling worker thread.
+void parse_file(const LangOptions &langOpts, ParseResult &result, const RefCountPtr<SyntaxArena> &arena)
+{
+   ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(result.filePath);
+   if (!buffer) {
+      result.readFailed = true;
+      return;
+   }
+   result.bytes = buffer.get()->getBufferSize();
+   auto start = std::chrono::steady_clock::now();
+   SourceManager sourceMgr;
+   unsigned bufferId = sourceMgr.addNewSourceBuffer(std::move(buffer.get()));
+   Parser parser(langOpts, bufferId, sourceMgr, nullptr);
+   parser.setSyntaxArena(arena);
+   result.parseFailed = parser.parse() != 0;
+   result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   result.internStats = arena->getInternStats();
+   result.nodeBytes = arena->getBytesUsed();
+}
+
+int parse_files_in_parallel(const LangOptions &langOpts, std::vector<std::string> &files,
+                            unsigned jobs, bool internNodes, bool compactLayout, bool printStats,
+                            std::ostream &output)
+{
+   std::vector<ParseResult> results(files.size());
+   for (size_t i = 0; i < files.size(); ++i) {
+      results[i].filePath = std::move(files[i]);
+   }
+   if (jobs == 0) {
+      jobs = std::max(1u, std::thread::hardware_concurrency());
+   }
+   jobs = std::min<unsigned>(jobs, std::max<size_t>(results.size(), 1));
+   // workers claim the next unparsed file, so one huge file does not leave the
+   // other threads idle
+   std::atomic<size_t> nextFile{0};
+   auto start = std::chrono::steady_clock::now();
+   std::vector<std::thread> workers;
+   workers.reserve(jobs);
+   for (unsigned i = 0; i < jobs; ++i) {
+      workers.emplace_back([&]() {
+         for (size_t index = nextFile.fetch_add(1); index < results.size();
+              index = nextFile.fetch_add(1)) {
+            // the tree is dropped after parsing, so every file gets a fresh
+            // arena and its memory is released right away
+            RefCountPtr<SyntaxArena> arena(new SyntaxArena());
+            arena->setInterningEnabled(internNodes);
+            arena->setCompactLayoutEnabled(compactLayout);
+            parse_file(langOpts, results[index], arena);
+         }
+      });
+   }
+   for (std::thread &worker : workers) {
+      worker.join();
+   }
+   double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   std::size_t totalBytes = 0;
+   std::size_t totalNodeBytes = 0;
+   std::size_t failedCount = 0;
+   SyntaxArena::InternStats internStats;
+   for (const ParseResult &result : results) {
+      totalBytes += result.bytes;
+      totalNodeBytes += result.nodeBytes;
+      internStats.tokenHits += result.internStats.tokenHits;
+      internStats.tokenMisses += result.internStats.tokenMisses;
+      internStats.layoutHits += result.internStats.layoutHits;
+      internStats.layoutMisses += result.internStats.layoutMisses;
+      internStats.bytesSaved += result.internStats.bytesSaved;
+      if (result.readFailed || result.parseFailed) {
+         ++failedCount;
+      }
+      if (result.readFailed) {
+         std::cerr << "read source file error: " << result.filePath << std::endl;
+      }
+      if (printStats) {
+         output << result.filePath << ": ";
+         if (result.readFailed) {
+            output << "read error\n";
+            continue;
+         }
+         output << result.bytes << " bytes, " << result.seconds << " s, "
+                << (result.seconds > 0 ? to_mega_bytes(result.bytes) / result.seconds : 0) << " MB/s"
+                << (result.parseFailed ? ", parse error" : "") << "\n";
+      }
+   }
+   if (printStats) {
+      output << "files: " << results.size() << ", failed: " << failedCount
+             << ", threads: " << jobs << "\n"
+             << "total: " << to_mega_bytes(totalBytes) << " MB in " << wallSeconds << " s\n"
+             << "throughput: " << (wallSeconds > 0 ? to_mega_bytes(totalBytes) / wallSeconds : 0) << " MB/s, "
+             << (wallSeconds > 0 ? results.size() / wallSeconds : 0) << " files/s\n"
+             << "syntax nodes: " << to_mega_bytes(totalNodeBytes) << " MB"
+             << (compactLayout ? " (compact layout)" : "") << "\n"
+             << "peak rss: " << to_mega_bytes(get_peak_rss()) << " MB\n";
+      if (internNodes) {
+         output << "interned tokens: " << internStats.tokenHits << " shared, "
+                << internStats.tokenMisses << " unique\n"
+                << "interned layouts: " << internStats.layoutHits << " shared, "
+                << internStats.layoutMisses << " unique\n"
+                << "interning saved: " << to_mega_bytes(internStats.bytesSaved) << " MB\n";
+      }
+   }
+   output.flush();
+   return failedCount == 0 ? 0 : PARSE_ERROR;
+}
+
+} // anonymous namespace
 
 int main(int argc, char * argv[])
 {
    CLI::App parserApp;
    std::string filePath;
    std::string outputFilePath;
+   std::string fileListPath;
+   std::string dirPath;
+   unsigned jobs = 0;
+   bool printStats = false;
+   bool internNodes = false;
+   bool compactLayout = false;
    parserApp.name("polar-ast-dumper");
    parserApp.footer("\nCopyright (c) 2019-2020 polar software foundation");
    parserApp.add_option("sourceFilepath", filePath, "path of file to be parser, use stdin if not specified");
    parserApp.add_option("-o,--output", outputFilePath, "process result write into file path");
+   parserApp.add_option("--file-list", fileListPath, "parse every file listed in this file, one path per line");
+   parserApp.add_option("--dir", dirPath, "parse every .php file under this directory recursively");
+   parserApp.add_option("-j,--jobs", jobs, "number of parser threads, default is the number of cores");
+   parserApp.add_flag("--stats", printStats, "report per file and aggregate throughput and peak rss");
+   parserApp.add_flag("--intern-nodes", internNodes, "share identical token and leaf syntax nodes of a file");
+   parserApp.add_flag("--compact-layout", compactLayout,
+                      "keep syntax nodes owned by their arena with 32-bit child references");
    POLAR_CLI11_PARSE(parserApp, argc, argv);
+
+   std::ostream *output = nullptr;
+   std::unique_ptr<std::ofstream> foutstream;
+   if (outputFilePath.empty()) {
+      output = &std::cout;
+   } else {
+      foutstream = std::make_unique<std::ofstream>(outputFilePath, std::ios_base::out | std::ios_base::trunc);
+      if (foutstream->fail()) {
+         std::cerr << "open output file error: " << strerror(errno) << std::endl;
+         return OPEN_OUTPUT_FILE_ERROR;
+      }
+      output = foutstream.get();
+   }
+   LangOptions langOpts{};
+   if (!fileListPath.empty() || !dirPath.empty()) {
+      std::vector<std::string> files;
+      if (!fileListPath.empty() && !collect_files_from_list(fileListPath, files)) {
+         std::cerr << "read file list error: " << fileListPath << std::endl;
+         return READ_FILE_LIST_ERROR;
+      }
+      if (!dirPath.empty() && !collect_files_from_dir(dirPath, files)) {
+         std::cerr << "read directory error: " << dirPath << std::endl;
+         return READ_FILE_LIST_ERROR;
+      }
+      return parse_files_in_parallel(langOpts, files, jobs, internNodes, compactLayout, printStats,
+                                     *output);
+   }
+
    std::unique_ptr<MemoryBuffer> sourceBuffer;
    if (filePath.empty()) {
       ErrorOr<std::unique_ptr<MemoryBuffer>> tempBuffer = MemoryBuffer::getSTDIN();
@@ -62,23 +295,15 @@ int main(int argc, char * argv[])
          return OPEN_SOURCE_FILE_ERROR;
       }
    }
-
-   std::ostream *output = nullptr;
-   std::unique_ptr<std::ofstream> foutstream;
-   if (outputFilePath.empty()) {
-      output = &std::cout;
-   } else {
-      foutstream = std::make_unique<std::ofstream>(outputFilePath, std::ios_base::out | std::ios_base::trunc);
-      if (foutstream->fail()) {
-         std::cerr << "open output file error: " << strerror(errno) << std::endl;
-         return OPEN_OUTPUT_FILE_ERROR;
-      }
-      output = foutstream.get();
-   }
-   LangOptions langOpts{};
    SourceManager sourceMgr;
    unsigned bufferId = sourceMgr.addNewSourceBuffer(std::move(sourceBuffer));
    Parser parser(langOpts, bufferId, sourceMgr, nullptr);
+   if (internNodes || compactLayout) {
+      RefCountPtr<SyntaxArena> arena(new SyntaxArena());
+      arena->setInterningEnabled(internNodes);
+      arena->setCompactLayoutEnabled(compactLayout);
+      parser.setSyntaxArena(arena);
+   }
    parser.parse();
    RefCountPtr<RawSyntax> syntaxTree = parser.getSyntaxTree();
    return 0;
@@ -20,11 +20,14 @@
 #include "polarphp/syntax/TokenKinds.h"
 #include "polarphp/syntax/serialization/TokenKindTypeSerialization.h"
 #include "polarphp/parser/serialization/TokenJsonSerialization.h"
+#include "polarphp/parser/serialization/TokenBinarySerialization.h"
 #include "nlohmann/json.hpp"
 
 #include <memory>
 #include <iostream>
 #include <fstream>
+#include <chrono>
+#include <cstring>
 
 using llvm::MemoryBuffer;
 using llvm::ErrorOr;
@@ -33,22 +36,76 @@ using polar::basic::SourceManager;
 using polar::parser::Lexer;
 using polar::parser::Token;
 using polar::parser::TokenKindType;
+using polar::parser::TokenBinaryWriter;
 using nlohmann::json;
 
 #define READ_STDIN_ERROR 1
 #define OPEN_SOURCE_FILE_ERROR 2
 #define OPEN_OUTPUT_FILE_ERROR 3
+#define UNKNOWN_FORMAT_ERROR 4
+
+namespace {
+
+struct TokenizeStats
+{
+   std::size_t tokenCount = 0;
+   std::size_t outputBytes = 0;
+};
+
+/// Write every token as soon as it is lexed, the output is a json array but
+/// no token is kept in memory after it has been written.
+void stream_json_tokens(Lexer &lexer, std::ostream &output, TokenizeStats &stats)
+{
+   Token currentToken;
+   output << "[";
+   stats.outputBytes += 1;
+   do {
+      lexer.lex(currentToken);
+      json tokenJson = currentToken;
+      std::string text = tokenJson.dump();
+      const char *separator = stats.tokenCount == 0 ? "\n   " : ",\n   ";
+      output << separator << text;
+      stats.outputBytes += std::strlen(separator) + text.size();
+      ++stats.tokenCount;
+   } while (currentToken.isNot(TokenKindType::END));
+   output << "\n]";
+   stats.outputBytes += 2;
+}
+
+void stream_binary_tokens(Lexer &lexer, const SourceManager &sourceMgr, unsigned bufferId,
+                          std::ostream &output, TokenizeStats &stats)
+{
+   TokenBinaryWriter writer(output);
+   writer.writeHeader();
+   Token currentToken;
+   do {
+      lexer.lex(currentToken);
+      writer.write(currentToken, sourceMgr.getLocOffsetInBuffer(currentToken.getLoc(), bufferId));
+      ++stats.tokenCount;
+   } while (currentToken.isNot(TokenKindType::END));
+   stats.outputBytes = writer.getBytesWritten();
+}
+
+} // anonymous namespace
 
 int main(int argc, char * argv[])
 {
    CLI::App tokenizer;
    std::string filePath;
    std::string outputFilePath;
+   std::string format = "json";
+   bool printStats = false;
    tokenizer.name("polar-tokenizer");
    tokenizer.footer("\nCopyright (c) 2019-2020 polar software foundation");
    tokenizer.add_option("sourceFilepath", filePath, "path of file to be tokenized, use stdin if not specified");
    tokenizer.add_option("-o,--output", outputFilePath, "process result write into file path");
+   tokenizer.add_option("--format", format, "output format of the token stream, json (default) or binary");
+   tokenizer.add_flag("--stats", printStats, "report token count and tokens/s to stderr");
    POLAR_CLI11_PARSE(tokenizer, argc, argv);
+   if (format != "json" && format != "binary") {
+      std::cerr << "unknown output format: " << format << std::endl;
+      return UNKNOWN_FORMAT_ERROR;
+   }
    std::unique_ptr<MemoryBuffer> sourceBuffer;
    if (filePath.empty()) {
       ErrorOr<std::unique_ptr<MemoryBuffer>> tempBuffer = MemoryBuffer::getSTDIN();
@@ -73,7 +130,11 @@ int main(int argc, char * argv[])
    if (outputFilePath.empty()) {
       output = &std::cout;
    } else {
-      foutstream = std::make_unique<std::ofstream>(outputFilePath, std::ios_base::out | std::ios_base::trunc);
+      std::ios_base::openmode mode = std::ios_base::out | std::ios_base::trunc;
+      if (format == "binary") {
+         mode |= std::ios_base::binary;
+      }
+      foutstream = std::make_unique<std::ofstream>(outputFilePath, mode);
       if (foutstream->fail()) {
          std::cerr << "open output file error: " << strerror(errno) << std::endl;
          return OPEN_OUTPUT_FILE_ERROR;
@@ -83,14 +144,24 @@ int main(int argc, char * argv[])
    LangOptions langOpts{};
    SourceManager sourceMgr;
    unsigned bufferId = sourceMgr.addNewSourceBuffer(std::move(sourceBuffer));
+   std::size_t sourceBytes = sourceMgr.getEntireTextForBuffer(bufferId).size();
    Lexer lexer(langOpts, sourceMgr, bufferId, nullptr);
-   Token currentToken;
-   json tokenJsonArray = json::array();
-   do {
-      lexer.lex(currentToken);
-      tokenJsonArray.push_back(currentToken);
-   } while (currentToken.isNot(TokenKindType::END));
-   *output << tokenJsonArray.dump(3);
+   TokenizeStats stats;
+   auto start = std::chrono::steady_clock::now();
+   if (format == "binary") {
+      stream_binary_tokens(lexer, sourceMgr, bufferId, *output, stats);
+   } else {
+      stream_json_tokens(lexer, *output, stats);
+   }
    output->flush();
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   if (printStats) {
+      std::cerr << "tokens: " << stats.tokenCount << "\n"
+                << "source bytes: " << sourceBytes << ", output bytes: " << stats.outputBytes << "\n"
+                << "time: " << seconds << " s\n"
+                << "throughput: " << (seconds > 0 ? stats.tokenCount / seconds : 0) << " tokens/s, "
+                << (seconds > 0 ? static_cast<double>(sourceBytes) / (1024 * 1024) / seconds : 0) << " MB/s"
+                << std::endl;
+   }
    return 0;
 }
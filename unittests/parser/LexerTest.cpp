@@ -16,9 +16,11 @@
 #include "polarphp/basic/SourceMgr.h"
 #include "polarphp/parser/Lexer.h"
 #include "polarphp/parser/Token.h"
+#include "polarphp/parser/internal/YYLexerExtras.h"
 #include "polarphp/ast/DiagnosticConsumer.h"
 #include "polarphp/ast/DiagnosticEngine.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Allocator.h"
 
 #include <iostream>
 #include <vector>
@@ -53,6 +55,7 @@ public:
    std::vector<Token> tokenizeAndKeepEOF(unsigned bufferId)
    {
       Lexer lexer(langOpts, sourceMgr, bufferId, /*Diags=*/nullptr);
+      lexer.setTokenValueAllocator(m_tokenValueAllocator);
       std::vector<Token> tokens;
       do {
          tokens.emplace_back();
@@ -76,6 +79,7 @@ public:
       {
          tokens.push_back(token);
       }, [&](Lexer &lexer) {
+         lexer.setTokenValueAllocator(m_tokenValueAllocator);
          lexer.setCheckHeredocIndentation(true);
          lexer.registerLexicalExceptionHandler([&](StringRef msg, int code){
             m_exceptionMsgs.push_back(msg.str());
@@ -125,6 +129,8 @@ public:
    LangOptions langOpts;
    SourceManager sourceMgr;
    std::vector<std::string> m_exceptionMsgs;
+   /// token values must outlive the lexers of the helpers above
+   llvm::BumpPtrAllocator m_tokenValueAllocator;
 };
 
 TEST_F(LexerTest, testSimpleToken)
@@ -1486,3 +1492,87 @@ TEST_F(LexerTest, testLexHereDoc)
       ASSERT_EQ(token5.getValue<std::string>(), "");
    }
 }
+
+TEST_F(LexerTest, testTriviaScanKernels)
+{
+   // put the stop byte at every offset around the 16/32 byte block boundaries
+   for (size_t length = 0; length < 80; ++length) {
+      for (size_t pos = 0; pos <= length; ++pos) {
+         std::string text(length, 'a');
+         if (pos < length) {
+            text[pos] = '\n';
+         }
+         const unsigned char *begin = reinterpret_cast<const unsigned char *>(text.data());
+         const unsigned char *end = begin + text.size();
+         ASSERT_EQ(static_cast<size_t>(polar::parser::internal::scan_to_line_end_candidate(begin, end, false) - begin), pos);
+         ASSERT_EQ(static_cast<size_t>(polar::parser::internal::scan_to_newline_candidate(text.data(), text.data() + text.size()) - text.data()), pos);
+         bool sawNewline = false;
+         ASSERT_EQ(static_cast<size_t>(polar::parser::internal::scan_to_block_comment_candidate(begin, end, false, sawNewline) - begin), length);
+         ASSERT_EQ(sawNewline, pos < length);
+         std::string spaces(length, ' ');
+         if (pos < length) {
+            spaces[pos] = '\t';
+         }
+         const unsigned char *spaceBegin = reinterpret_cast<const unsigned char *>(spaces.data());
+         ASSERT_EQ(polar::parser::internal::count_leading_byte(spaceBegin, spaceBegin + spaces.size(), ' '), pos);
+      }
+   }
+   {
+      std::string text(40, 'a');
+      text[20] = '\xE4';
+      text[30] = '*';
+      const unsigned char *begin = reinterpret_cast<const unsigned char *>(text.data());
+      const unsigned char *end = begin + text.size();
+      bool sawNewline = false;
+      ASSERT_EQ(polar::parser::internal::scan_to_block_comment_candidate(begin, end, true, sawNewline) - begin, 20);
+      ASSERT_EQ(polar::parser::internal::scan_to_block_comment_candidate(begin, end, false, sawNewline) - begin, 30);
+      ASSERT_EQ(polar::parser::internal::scan_to_line_end_candidate(begin, end, true) - begin, 20);
+      ASSERT_FALSE(sawNewline);
+   }
+}
+
+TEST_F(LexerTest, testTriviaHeavySource)
+{
+   // mostly docblocks, line comments and indentation, long enough to run the
+   // block kernels over many boundaries
+   std::string source;
+   const size_t blockCount = 2000;
+   for (size_t i = 0; i < blockCount; ++i) {
+      source += "      /**\n"
+                "       * Render the given template block and return the generated markup.\n"
+                "       * @param array $context the variables exposed to the template\n"
+                "       */\n"
+                "      // keep the output buffer small, flush after every block\n"
+                "\t\t$block = 1;\n";
+   }
+   std::vector<TokenKindType> expectedTokens;
+   for (size_t i = 0; i < blockCount; ++i) {
+      expectedTokens.push_back(TokenKindType::T_VARIABLE);
+      expectedTokens.push_back(TokenKindType::T_EQUAL);
+      expectedTokens.push_back(TokenKindType::T_LNUMBER);
+      expectedTokens.push_back(TokenKindType::T_SEMICOLON);
+   }
+   checkLex(source, expectedTokens, /*KeepComments=*/false);
+}
+
+TEST_F(LexerTest, testTokenValueStorage)
+{
+   const char *source = R"($name = 'plain text' . "escaped\ttext";)";
+   std::vector<TokenKindType> expectedTokens{
+      TokenKindType::T_VARIABLE, TokenKindType::T_EQUAL,
+            TokenKindType::T_CONSTANT_ENCAPSED_STRING, TokenKindType::T_STR_CONCAT,
+            TokenKindType::T_DOUBLE_QUOTE, TokenKindType::T_CONSTANT_ENCAPSED_STRING,
+            TokenKindType::T_DOUBLE_QUOTE, TokenKindType::T_SEMICOLON
+   };
+   std::vector<Token> tokens = checkLex(source, expectedTokens, /*KeepComments=*/false);
+   StringRef name = tokens.at(0).getValue<StringRef>();
+   StringRef plain = tokens.at(2).getValue<StringRef>();
+   StringRef escaped = tokens.at(5).getValue<StringRef>();
+   ASSERT_EQ(name, "name");
+   ASSERT_EQ(plain, "plain text");
+   ASSERT_EQ(escaped, "escaped\ttext");
+   // unescaped values are slices of the lexed buffer, only escaped values are copied
+   ASSERT_EQ(name.data(), tokens.at(0).getRawLexicalText().data() + 1);
+   ASSERT_EQ(plain.data(), tokens.at(2).getRawLexicalText().data() + 1);
+   ASSERT_NE(escaped.data(), tokens.at(5).getRawLexicalText().data());
+}
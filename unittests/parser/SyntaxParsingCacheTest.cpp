@@ -0,0 +1,119 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/06/16.
+
+#include "polarphp/parser/SyntaxParsingCache.h"
+#include "polarphp/syntax/RawSyntax.h"
+#include "polarphp/syntax/SyntaxNodes.h"
+#include "polarphp/syntax/TokenKinds.h"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using polar::parser::SyntaxParsingCache;
+using polar::parser::SourceEdit;
+using polar::syntax::RawSyntax;
+using polar::syntax::RefCountPtr;
+using polar::syntax::Syntax;
+using polar::syntax::SyntaxKind;
+using polar::syntax::SourceFileSyntax;
+using polar::syntax::TokenKindType;
+using polar::syntax::TriviaPiece;
+using polar::syntax::SourcePresence;
+using polar::basic::OwnedString;
+
+namespace {
+
+/// Every statement is `$a = 1;\n`, 8 bytes long
+constexpr size_t sg_stmtLength = 8;
+
+RefCountPtr<RawSyntax> make_token(TokenKindType kind, const char *text,
+                                  llvm::ArrayRef<TriviaPiece> trailingTrivia = {})
+{
+   return RawSyntax::make(kind, OwnedString(text), {}, trailingTrivia, SourcePresence::Present);
+}
+
+/// Build a source file of \p stmtCount statements without going through the
+/// parser so the expected offsets are known up front
+SourceFileSyntax make_source_file(size_t stmtCount)
+{
+   std::vector<RefCountPtr<RawSyntax>> stmts;
+   stmts.reserve(stmtCount);
+   for (size_t i = 0; i < stmtCount; ++i) {
+      stmts.push_back(RawSyntax::make(SyntaxKind::TopStmt, {
+                                         make_token(TokenKindType::T_VARIABLE, "$a", {TriviaPiece::getSpaces(1)}),
+                                         make_token(TokenKindType::T_EQUAL, "=", {TriviaPiece::getSpaces(1)}),
+                                         make_token(TokenKindType::T_LNUMBER, "1"),
+                                         make_token(TokenKindType::T_SEMICOLON, ";", {TriviaPiece::getNewlines(1)})
+                                      }, SourcePresence::Present));
+   }
+   auto stmtList = RawSyntax::make(SyntaxKind::TopStmtList, stmts, SourcePresence::Present);
+   auto root = RawSyntax::make(SyntaxKind::SourceFile, {stmtList, make_token(TokenKindType::END, "")},
+                               SourcePresence::Present);
+   return polar::syntax::make<SourceFileSyntax>(root);
+}
+
+} // anonymous namespace
+
+TEST(SyntaxParsingCacheTest, testTranslateToPreEditPosition)
+{
+   // (aaa, bbb) -> (c, dddd)
+   std::vector<SourceEdit> edits{{1, 4, 1}, {6, 9, 4}};
+   ASSERT_EQ(SyntaxParsingCache::translateToPreEditPosition(0, edits), 0u);
+   ASSERT_FALSE(SyntaxParsingCache::translateToPreEditPosition(1, edits).has_value());
+   ASSERT_EQ(SyntaxParsingCache::translateToPreEditPosition(2, edits), 4u);
+   ASSERT_EQ(SyntaxParsingCache::translateToPreEditPosition(3, edits), 5u);
+   ASSERT_FALSE(SyntaxParsingCache::translateToPreEditPosition(4, edits).has_value());
+   ASSERT_FALSE(SyntaxParsingCache::translateToPreEditPosition(7, edits).has_value());
+   ASSERT_EQ(SyntaxParsingCache::translateToPreEditPosition(8, edits), 9u);
+}
+
+TEST(SyntaxParsingCacheTest, testLookUpSkipsEditedNodes)
+{
+   SourceFileSyntax sourceFile = make_source_file(10);
+   SyntaxParsingCache cache(sourceFile);
+   // `$a = 1;` -> `$a = 22;` in the fourth statement
+   cache.addEdit(3 * sg_stmtLength + 5, 3 * sg_stmtLength + 6, 2);
+   // only the edited statement is lost, the edit does not reach the first
+   // token of the next statement, after the edit positions move by one byte
+   for (size_t i = 0; i < 10; ++i) {
+      size_t newPosition = i * sg_stmtLength + (i > 3 ? 1 : 0);
+      std::optional<Syntax> node = cache.lookUp(newPosition, SyntaxKind::TopStmt);
+      if (i == 3) {
+         ASSERT_FALSE(node.has_value()) << "statement " << i;
+      } else {
+         ASSERT_TRUE(node.has_value()) << "statement " << i;
+         ASSERT_EQ(node->getAbsolutePositionBeforeLeadingTrivia().getOffset(), i * sg_stmtLength);
+      }
+   }
+   // a position inserted by the edit has no node in the old tree
+   ASSERT_FALSE(cache.lookUp(3 * sg_stmtLength + 6, SyntaxKind::TopStmt).has_value());
+   ASSERT_EQ(cache.getReusedNodeIds().size(), 9u);
+}
+
+TEST(SyntaxParsingCacheTest, testLookUpWithManyEdits)
+{
+   constexpr size_t stmtCount = 2000;
+   constexpr size_t editInterval = 20;
+   SourceFileSyntax sourceFile = make_source_file(stmtCount);
+   SyntaxParsingCache cache(sourceFile);
+   size_t editCount = 0;
+   for (size_t i = 0; i < stmtCount; i += editInterval) {
+      // same length replacement of the literal, positions do not move
+      cache.addEdit(i * sg_stmtLength + 5, i * sg_stmtLength + 6, 1);
+      ++editCount;
+   }
+   // every edited statement is lost, every other one is found in place
+   for (size_t i = 0; i < stmtCount; ++i) {
+      ASSERT_EQ(cache.lookUp(i * sg_stmtLength, SyntaxKind::TopStmt).has_value(), i % editInterval != 0)
+            << "statement " << i;
+   }
+   ASSERT_EQ(cache.getReusedNodeIds().size(), stmtCount - editCount);
+}
@@ -0,0 +1,116 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/11/13.
+
+#include "polarphp/parser/serialization/TokenBinarySerialization.h"
+#include "polarphp/parser/Token.h"
+#include "polarphp/syntax/TokenKinds.h"
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+using polar::parser::Token;
+using polar::parser::TokenKindType;
+using polar::parser::TokenBinaryWriter;
+using polar::parser::TokenBinaryReader;
+using polar::parser::TokenRecord;
+using polar::parser::TokenValueTag;
+
+namespace {
+
+TEST(TokenBinarySerializationTest, testRoundTrip)
+{
+   llvm::StringRef source = "$name = 12 + 1.5;";
+   std::stringstream stream;
+   TokenBinaryWriter writer(stream);
+   writer.writeHeader();
+   {
+      Token token(TokenKindType::T_VARIABLE, source.substr(0, 5));
+      token.setValue(source.substr(1, 4));
+      token.setAtStartOfLine(true);
+      writer.write(token, 0);
+   }
+   {
+      Token token(TokenKindType::T_EQUAL, source.substr(6, 1));
+      writer.write(token, 6);
+   }
+   {
+      Token token(TokenKindType::T_LNUMBER, source.substr(8, 2));
+      token.setValue(12);
+      writer.write(token, 8);
+   }
+   {
+      Token token(TokenKindType::T_DNUMBER, source.substr(13, 3));
+      token.setValue(1.5);
+      writer.write(token, 13);
+   }
+   ASSERT_EQ(writer.getBytesWritten(), stream.str().size());
+
+   TokenBinaryReader reader(stream);
+   ASSERT_TRUE(reader.readHeader());
+   TokenRecord record;
+   ASSERT_TRUE(reader.read(record));
+   ASSERT_EQ(record.kind, TokenKindType::T_VARIABLE);
+   ASSERT_EQ(record.offset, 0u);
+   ASSERT_EQ(record.length, 5u);
+   ASSERT_NE(record.flags, 0);
+   ASSERT_EQ(record.valueTag, TokenValueTag::String);
+   ASSERT_EQ(record.stringValue, "name");
+
+   ASSERT_TRUE(reader.read(record));
+   ASSERT_EQ(record.kind, TokenKindType::T_EQUAL);
+   ASSERT_EQ(record.offset, 6u);
+   ASSERT_EQ(record.length, 1u);
+   ASSERT_EQ(record.valueTag, TokenValueTag::None);
+
+   ASSERT_TRUE(reader.read(record));
+   ASSERT_EQ(record.kind, TokenKindType::T_LNUMBER);
+   ASSERT_EQ(record.valueTag, TokenValueTag::Int);
+   ASSERT_EQ(record.intValue, 12);
+
+   ASSERT_TRUE(reader.read(record));
+   ASSERT_EQ(record.kind, TokenKindType::T_DNUMBER);
+   ASSERT_EQ(record.offset, 13u);
+   ASSERT_EQ(record.valueTag, TokenValueTag::Double);
+   ASSERT_EQ(record.doubleValue, 1.5);
+
+   ASSERT_FALSE(reader.read(record));
+}
+
+TEST(TokenBinarySerializationTest, testRejectForeignStream)
+{
+   std::stringstream stream("[{\"kind\": \"T_VARIABLE\"}]");
+   TokenBinaryReader reader(stream);
+   ASSERT_FALSE(reader.readHeader());
+}
+
+TEST(TokenBinarySerializationTest, testKindCodes)
+{
+   std::stringstream stream;
+   TokenBinaryWriter writer(stream);
+   writer.writeHeader();
+   writer.write(Token(TokenKindType::T_VARIABLE, "$a"), 0);
+   std::string bytes = stream.str();
+   unsigned kindCode = static_cast<unsigned char>(bytes[8]) |
+         (static_cast<unsigned char>(bytes[9]) << 8);
+   ASSERT_EQ(kindCode, polar::syntax::get_token_serialization_code(TokenKindType::T_VARIABLE));
+
+   // a record with a code no token has is rejected
+   bytes[8] = '\xff';
+   bytes[9] = '\xff';
+   ASSERT_FALSE(polar::syntax::get_token_kind_for_serialization_code(0xffff).has_value());
+   std::stringstream unknownStream(bytes);
+   TokenBinaryReader reader(unknownStream);
+   TokenRecord record;
+   ASSERT_TRUE(reader.readHeader());
+   ASSERT_FALSE(reader.read(record));
+}
+
+} // anonymous namespace
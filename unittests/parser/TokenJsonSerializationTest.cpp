@@ -163,6 +163,20 @@ TEST(TokenJsonSerializationTest, testToken)
       json jsonObject = token;
       ASSERT_EQ(jsonObject.at("definedText").get<std::string>(), "<=>");
    }
+   {
+      llvm::BumpPtrAllocator valueAllocator;
+      json jsonObject = {
+         {"token", TokenKindType::T_IDENTIFIER_STRING},
+         {"hasValue", true},
+         {"valueType", ValueType::String},
+         {"value", "polarphp"}
+      };
+      Token token;
+      from_json(jsonObject, token, valueAllocator);
+      ASSERT_EQ(token.getKind(), TokenKindType::T_IDENTIFIER_STRING);
+      ASSERT_EQ(token.getValue<llvm::StringRef>(), "polarphp");
+      ASSERT_GT(valueAllocator.getBytesAllocated(), 0u);
+   }
 }
 
 } // anonymous namespace
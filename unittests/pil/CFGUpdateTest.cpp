@@ -0,0 +1,270 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/12/06.
+
+#include "polarphp/ast/AstContext.h"
+#include "polarphp/ast/DiagnosticEngine.h"
+#include "polarphp/ast/Module.h"
+#include "polarphp/ast/PILOptions.h"
+#include "polarphp/ast/SearchPathOptions.h"
+#include "polarphp/basic/SourceMgr.h"
+#include "polarphp/kernel/LangOptions.h"
+#include "polarphp/pil/lang/Dominance.h"
+#include "polarphp/pil/lang/PILBuilder.h"
+#include "polarphp/pil/lang/PILModule.h"
+#include "polarphp/pil/lang/PostOrder.h"
+#include "polarphp/pil/lang/TypeLowering.h"
+#include "polarphp/pil/optimizer/analysis/DominanceAnalysis.h"
+#include "polarphp/pil/optimizer/analysis/PostOrderAnalysis.h"
+#include "polarphp/pil/optimizer/passmgr/PassManager.h"
+#include "polarphp/pil/optimizer/passmgr/Transforms.h"
+#include "polarphp/pil/optimizer/utils/CFGOptUtils.h"
+#include "polarphp/pil/optimizer/utils/PILOptFunctionBuilder.h"
+#include "llvm/Support/Host.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace polar;
+
+namespace {
+
+/// Creates a function with a loop and a diamond, which has four critical
+/// edges:
+///
+///   bb0: cond_br bb1, bb4
+///   bb1: br bb2            // loop header
+///   bb2: cond_br bb1, bb3  // loop latch
+///   bb3: br bb5
+///   bb4: cond_br bb5, bb6
+///   bb5: br bb6
+///   bb6: return
+class CreateCFGFunction : public PILModuleTransform {
+public:
+   void run() override
+   {
+      PILModule &module = *getModule();
+      AstContext &context = module.getAstContext();
+      PILType int1Type = PILType::getBuiltinIntegerType(1, context);
+      PILParameterInfo params[] = {
+         PILParameterInfo(int1Type.getAstType(), ParameterConvention::Direct_Unowned)
+      };
+      PILResultInfo results[] = {
+         PILResultInfo(int1Type.getAstType(), ResultConvention::Unowned)
+      };
+      PILFunctionType::ExtInfo extInfo;
+      extInfo = extInfo.withRepresentation(PILFunctionType::Representation::Thin);
+      CanPILFunctionType funcType =
+            PILFunctionType::get(nullptr, extInfo, PILCoroutineKind::None,
+                                 ParameterConvention::Direct_Unowned, params,
+                                 /*yields*/ {}, results, None, SubstitutionMap(),
+                                 false, context);
+
+      PILOptFunctionBuilder funcBuilder(*this);
+      RegularLocation loc = RegularLocation::getAutoGeneratedLocation();
+      m_function = funcBuilder.getOrCreateFunction(
+               loc, "cfg_update", PILLinkage::Public, funcType, IsBare,
+               IsNotTransparent, IsNotSerialized, IsNotDynamic);
+      for (unsigned i = 0; i < 7; ++i) {
+         m_blocks.push_back(m_function->createBasicBlock());
+      }
+      PILValue cond = m_blocks[0]->createFunctionArgument(int1Type);
+      PILBuilder builder(*m_function);
+      builder.setCurrentDebugScope(m_function->getDebugScope());
+      auto build = [&](unsigned idx) -> PILBuilder & {
+         builder.setInsertionPoint(m_blocks[idx]);
+         return builder;
+      };
+      build(0).createCondBranch(loc, cond, m_blocks[1], m_blocks[4]);
+      build(1).createBranch(loc, m_blocks[2]);
+      build(2).createCondBranch(loc, cond, m_blocks[1], m_blocks[3]);
+      build(3).createBranch(loc, m_blocks[5]);
+      build(4).createCondBranch(loc, cond, m_blocks[5], m_blocks[6]);
+      build(5).createBranch(loc, m_blocks[6]);
+      build(6).createReturn(loc, cond);
+   }
+
+   PILFunction *m_function = nullptr;
+   std::vector<PILBasicBlock *> m_blocks;
+};
+
+/// Edits the CFG of a function with the CFG utilities while the dominance and
+/// post order analyses are locked, like a pass which preserves them. After
+/// the edits the cached results are compared with ones computed from scratch.
+class CFGUpdateTest : public ::testing::Test
+{
+protected:
+   CFGUpdateTest()
+      : m_diags(m_sourceMgr)
+   {
+      m_langOpts.Target = llvm::Triple(llvm::sys::getProcessTriple());
+      m_context = AstContext::get(m_langOpts, m_typeCheckerOpts, m_searchPathOpts,
+                                  m_sourceMgr, m_diags);
+      m_module = ModuleDecl::create(m_context->getIdentifier("cfg_update_test"),
+                                    *m_context);
+      m_typeConverter = std::make_unique<lowering::TypeConverter>(*m_module);
+      m_pilModule = PILModule::createEmptyModule(m_module, *m_typeConverter, m_pilOpts);
+      m_passManager = std::make_unique<PILPassManager>(m_pilModule.get());
+
+      m_createFunction.injectPassManager(m_passManager.get());
+      m_createFunction.injectModule(m_pilModule.get());
+      m_createFunction.run();
+      m_function = m_createFunction.m_function;
+      m_blocks = m_createFunction.m_blocks;
+
+      m_domAnalysis = m_passManager->getAnalysis<DominanceAnalysis>();
+      m_poAnalysis = m_passManager->getAnalysis<PostOrderAnalysis>();
+      m_domAnalysis->lockInvalidation();
+      m_poAnalysis->lockInvalidation();
+      // Compute both analyses, so that the edits are applied to them.
+      m_domAnalysis->get(m_function);
+      m_poAnalysis->get(m_function);
+   }
+
+   ~CFGUpdateTest()
+   {
+      m_domAnalysis->unlockInvalidation();
+      m_poAnalysis->unlockInvalidation();
+      m_passManager.reset();
+      m_pilModule.reset();
+      m_typeConverter.reset();
+      delete m_context;
+   }
+
+   /// Checks the cached results against ones computed from scratch. The
+   /// updated post order doesn't need to be the one a new depth first search
+   /// finds, but it must be a valid one: every block comes after its
+   /// successors, except for the targets of loop back edges.
+   void check_analyses()
+   {
+      DominanceInfo *domInfo = m_domAnalysis->get(m_function);
+      DominanceInfo rebuiltDomInfo(m_function);
+      ASSERT_FALSE(domInfo->errorOccurredOnComparison(rebuiltDomInfo));
+
+      PostOrderFunctionInfo *postOrder = m_poAnalysis->get(m_function);
+      PostOrderFunctionInfo rebuiltPostOrder(m_function);
+      ASSERT_EQ(postOrder->size(), rebuiltPostOrder.size());
+      unsigned number = 0;
+      for (PILBasicBlock *block : postOrder->getPostOrder()) {
+         ASSERT_EQ(postOrder->getPONumber(block).getValue(), number);
+         ASSERT_EQ(postOrder->getRPONumber(block).getValue(),
+                   postOrder->size() - number - 1);
+         ++number;
+      }
+      for (PILBasicBlock &block : *m_function) {
+         auto blockNumber = postOrder->getPONumber(&block);
+         ASSERT_TRUE(blockNumber.hasValue());
+         for (PILBasicBlock *succ : block.getSuccessorBlocks()) {
+            if (rebuiltDomInfo.dominates(succ, &block)) {
+               continue;
+            }
+            ASSERT_LT(postOrder->getPONumber(succ).getValue(), *blockNumber);
+         }
+      }
+   }
+
+   PILBasicBlock *split_before_terminator(PILBasicBlock *block)
+   {
+      PILBuilder builder(*m_function);
+      builder.setCurrentDebugScope(m_function->getDebugScope());
+      return splitBasicBlockAndBranch(builder, block->getTerminator(),
+                                      /*domInfo*/ nullptr, /*loopInfo*/ nullptr);
+   }
+
+   SourceManager m_sourceMgr;
+   DiagnosticEngine m_diags;
+   LangOptions m_langOpts;
+   TypeCheckerOptions m_typeCheckerOpts;
+   SearchPathOptions m_searchPathOpts;
+   PILOptions m_pilOpts;
+   AstContext *m_context;
+   ModuleDecl *m_module;
+   std::unique_ptr<lowering::TypeConverter> m_typeConverter;
+   std::unique_ptr<PILModule> m_pilModule;
+   std::unique_ptr<PILPassManager> m_passManager;
+   CreateCFGFunction m_createFunction;
+   PILFunction *m_function;
+   std::vector<PILBasicBlock *> m_blocks;
+   DominanceAnalysis *m_domAnalysis;
+   PostOrderAnalysis *m_poAnalysis;
+};
+
+} // anonymous namespace
+
+TEST_F(CFGUpdateTest, testSplitCriticalEdges)
+{
+   unsigned blockCount = m_function->size();
+   ASSERT_TRUE(splitAllCriticalEdges(*m_function, /*domInfo*/ nullptr,
+                                     /*loopInfo*/ nullptr));
+   ASSERT_EQ(m_function->size(), blockCount + 4);
+   check_analyses();
+}
+
+TEST_F(CFGUpdateTest, testSplitCriticalEdgesWithUpdatedDomInfo)
+{
+   // The utility updates the tree it is passed, the notification must not
+   // apply the edit a second time.
+   ASSERT_TRUE(splitAllCriticalEdges(*m_function, m_domAnalysis->get(m_function),
+                                     /*loopInfo*/ nullptr));
+   check_analyses();
+}
+
+TEST_F(CFGUpdateTest, testSplitBlocks)
+{
+   // The loop latch and the block branching into the diamond.
+   split_before_terminator(m_blocks[2]);
+   split_before_terminator(m_blocks[4]);
+   check_analyses();
+}
+
+TEST_F(CFGUpdateTest, testMergeBlocks)
+{
+   // The loop header into the latch.
+   ASSERT_TRUE(mergeBasicBlockWithSuccessor(m_blocks[1], /*domInfo*/ nullptr,
+                                            /*loopInfo*/ nullptr));
+   check_analyses();
+}
+
+TEST_F(CFGUpdateTest, testEditsWithoutQueries)
+{
+   // All edits since the last query are applied by the next one in a single
+   // renumbering, including the merge of a block which was only split off.
+   split_before_terminator(m_blocks[2]);
+   ASSERT_TRUE(splitAllCriticalEdges(*m_function, /*domInfo*/ nullptr,
+                                     /*loopInfo*/ nullptr));
+   ASSERT_TRUE(mergeBasicBlockWithSuccessor(m_blocks[2], /*domInfo*/ nullptr,
+                                            /*loopInfo*/ nullptr));
+   ASSERT_TRUE(mergeBasicBlockWithSuccessor(m_blocks[1], /*domInfo*/ nullptr,
+                                            /*loopInfo*/ nullptr));
+   check_analyses();
+}
+
+TEST_F(CFGUpdateTest, testReusedBlockMemory)
+{
+   // A block which was merged away and a block split off before the next
+   // query may share their memory. The allocator gives no guarantee, so the
+   // edits are repeated a few times.
+   bool reused = false;
+   for (unsigned round = 0; round < 8; ++round) {
+      PILBasicBlock *tail = split_before_terminator(m_blocks[4]);
+      ASSERT_TRUE(mergeBasicBlockWithSuccessor(m_blocks[4], /*domInfo*/ nullptr,
+                                               /*loopInfo*/ nullptr));
+      reused |= split_before_terminator(m_blocks[4]) == tail;
+      check_analyses();
+      ASSERT_TRUE(mergeBasicBlockWithSuccessor(m_blocks[4], /*domInfo*/ nullptr,
+                                               /*loopInfo*/ nullptr));
+   }
+   check_analyses();
+   if (!reused) {
+      GTEST_LOG_(INFO) << "no block memory was reused, only the edits were checked";
+   }
+}
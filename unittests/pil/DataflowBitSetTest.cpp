@@ -0,0 +1,237 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/12/06.
+
+#include "polarphp/pil/optimizer/utils/DataflowBitSet.h"
+#include "gtest/gtest.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using polar::DataflowBitSet;
+
+namespace {
+
+using DenseSet = std::vector<bool>;
+
+/// Checks every random operation on DataflowBitSets against the same
+/// operation on dense sets. The sets are filled both from empty and from
+/// full, so that all combinations of plain and complemented sets are hit.
+class DataflowBitSetTest : public ::testing::Test
+{
+protected:
+   static constexpr unsigned sm_setCount = 4;
+
+   void reset_sets(unsigned size)
+   {
+      m_size = size;
+      m_sets.clear();
+      m_dense.clear();
+      for (unsigned i = 0; i < sm_setCount; ++i) {
+         bool value = m_random() % 2;
+         m_sets.emplace_back(size, value);
+         m_dense.emplace_back(size, value);
+      }
+   }
+
+   unsigned random_index()
+   {
+      return m_random() % m_size;
+   }
+
+   unsigned random_set()
+   {
+      return m_random() % sm_setCount;
+   }
+
+   void check_equal(unsigned idx)
+   {
+      const DataflowBitSet &set = m_sets[idx];
+      const DenseSet &dense = m_dense[idx];
+      ASSERT_EQ(set.size(), dense.size());
+      unsigned count = 0;
+      for (unsigned i = 0; i < m_size; ++i) {
+         ASSERT_EQ(set.test(i), dense[i]) << "index " << i;
+         count += dense[i];
+      }
+      ASSERT_EQ(set.count(), count);
+      ASSERT_EQ(set.any(), count != 0);
+      ASSERT_EQ(set.none(), count == 0);
+
+      std::vector<unsigned> walked;
+      set.forEachSetBit([&](unsigned i) { walked.push_back(i); });
+      std::vector<unsigned> expected;
+      for (unsigned i = 0; i < m_size; ++i) {
+         if (dense[i]) {
+            expected.push_back(i);
+         }
+      }
+      ASSERT_EQ(walked, expected);
+   }
+
+   void apply_random_operation()
+   {
+      unsigned lhs = random_set();
+      unsigned rhs = random_set();
+      DataflowBitSet &set = m_sets[lhs];
+      DenseSet &dense = m_dense[lhs];
+      switch (m_random() % 9) {
+      case 0:
+      case 1: {
+         unsigned i = random_index();
+         set.set(i);
+         dense[i] = true;
+         break;
+      }
+      case 2:
+      case 3: {
+         unsigned i = random_index();
+         set.reset(i);
+         dense[i] = false;
+         break;
+      }
+      case 4: {
+         // Rarely clear or fill, the sets would lose their content too often.
+         if (m_random() % 8 == 0) {
+            bool value = m_random() % 2;
+            value ? set.set() : set.reset();
+            dense.assign(m_size, value);
+         }
+         break;
+      }
+      case 5: {
+         set &= m_sets[rhs];
+         for (unsigned i = 0; i < m_size; ++i) {
+            dense[i] = dense[i] && m_dense[rhs][i];
+         }
+         break;
+      }
+      case 6: {
+         set |= m_sets[rhs];
+         for (unsigned i = 0; i < m_size; ++i) {
+            dense[i] = dense[i] || m_dense[rhs][i];
+         }
+         break;
+      }
+      case 7: {
+         set.reset(m_sets[rhs]);
+         for (unsigned i = 0; i < m_size; ++i) {
+            dense[i] = dense[i] && !m_dense[rhs][i];
+         }
+         break;
+      }
+      case 8: {
+         unsigned modulus = 2 + m_random() % 5;
+         std::vector<unsigned> visited;
+         set.resetIf([&](unsigned i) {
+            visited.push_back(i);
+            return i % modulus == 0;
+         });
+         std::vector<unsigned> expected;
+         for (unsigned i = 0; i < m_size; ++i) {
+            if (dense[i]) {
+               expected.push_back(i);
+               dense[i] = i % modulus != 0;
+            }
+         }
+         ASSERT_EQ(visited, expected);
+         break;
+      }
+      }
+      check_equal(lhs);
+   }
+
+   void check_comparisons()
+   {
+      for (unsigned lhs = 0; lhs < sm_setCount; ++lhs) {
+         for (unsigned rhs = 0; rhs < sm_setCount; ++rhs) {
+            bool expected = m_dense[lhs] == m_dense[rhs];
+            ASSERT_EQ(m_sets[lhs] == m_sets[rhs], expected)
+                  << "sets " << lhs << " and " << rhs;
+            ASSERT_EQ(m_sets[lhs] != m_sets[rhs], !expected);
+         }
+      }
+   }
+
+   std::mt19937 m_random{20191206};
+   unsigned m_size = 0;
+   std::vector<DataflowBitSet> m_sets;
+   std::vector<DenseSet> m_dense;
+};
+
+} // anonymous namespace
+
+TEST_F(DataflowBitSetTest, testFilledSets)
+{
+   DataflowBitSet empty(100, false);
+   DataflowBitSet full(100, true);
+   ASSERT_EQ(empty.count(), 0u);
+   ASSERT_EQ(full.count(), 100u);
+   ASSERT_TRUE(empty.none());
+   ASSERT_TRUE(full.any());
+   ASSERT_NE(empty, full);
+
+   // A full set stays equal to one which was filled bit by bit.
+   DataflowBitSet filled(100, false);
+   for (unsigned i = 0; i < 100; ++i) {
+      filled.set(i);
+   }
+   ASSERT_EQ(filled, full);
+   ASSERT_EQ(full, filled);
+
+   full.resize(10);
+   ASSERT_EQ(full.size(), 10u);
+   ASSERT_TRUE(full.none());
+}
+
+TEST_F(DataflowBitSetTest, testAnySetBitStopsEarly)
+{
+   DataflowBitSet set(64, true);
+   set.reset(0);
+   unsigned calls = 0;
+   ASSERT_TRUE(set.anySetBit([&](unsigned i) {
+      ++calls;
+      return i == 3;
+   }));
+   ASSERT_EQ(calls, 3u);
+   ASSERT_FALSE(set.anySetBit([](unsigned i) { return i == 0; }));
+}
+
+TEST_F(DataflowBitSetTest, testPrint)
+{
+   DataflowBitSet set(6, true);
+   set.reset(1).reset(4);
+   std::string text;
+   llvm::raw_string_ostream stream(text);
+   stream << set;
+   ASSERT_EQ(stream.str(), "{0,2,3,5}");
+}
+
+TEST_F(DataflowBitSetTest, testRandomOperations)
+{
+   // The sizes cover single and partial sparse bit vector elements as well
+   // as several of them.
+   for (unsigned size : {1u, 7u, 128u, 129u, 300u, 1000u}) {
+      for (unsigned round = 0; round < 20; ++round) {
+         reset_sets(size);
+         for (unsigned step = 0; step < 200; ++step) {
+            apply_random_operation();
+            if (HasFatalFailure()) {
+               FAIL() << "size " << size << ", round " << round << ", step " << step;
+            }
+         }
+         check_comparisons();
+         if (HasFatalFailure()) {
+            FAIL() << "size " << size << ", round " << round;
+         }
+      }
+   }
+}
@@ -0,0 +1,207 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/12/06.
+
+#include "polarphp/pil/lang/FunctionSummaryCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+#include <string>
+
+using polar::FunctionSummaryCache;
+
+namespace {
+
+class FunctionSummaryCacheTest : public ::testing::Test
+{
+protected:
+   void SetUp() override
+   {
+      ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("summary-cache-test", m_dir));
+      m_path = m_dir;
+      llvm::sys::path::append(m_path, "summaries");
+   }
+
+   void TearDown() override
+   {
+      llvm::sys::fs::remove_directories(m_dir);
+   }
+
+   std::string readFile()
+   {
+      auto buffer = llvm::MemoryBuffer::getFile(m_path);
+      if (!buffer) {
+         return std::string();
+      }
+      return (*buffer)->getBuffer().str();
+   }
+
+   void writeFile(llvm::StringRef content)
+   {
+      std::error_code errorCode;
+      llvm::raw_fd_ostream stream(m_path, errorCode);
+      ASSERT_FALSE(errorCode);
+      stream << content;
+   }
+
+   /// Loads the file into a new cache, marks the entries for \p usedKeys as
+   /// used and saves it again, like a compilation which reuses them.
+   void compile(llvm::ArrayRef<llvm::StringRef> usedKeys, unsigned maxAge)
+   {
+      FunctionSummaryCache cache;
+      cache.load(m_path);
+      for (llvm::StringRef key : usedKeys) {
+         ASSERT_TRUE(cache.lookup("effects", key).hasValue());
+         cache.markUsed("effects", key);
+      }
+      ASSERT_TRUE(cache.save(m_path, maxAge));
+   }
+
+   llvm::SmallString<128> m_dir;
+   llvm::SmallString<128> m_path;
+};
+
+} // anonymous namespace
+
+TEST_F(FunctionSummaryCacheTest, testMissingFile)
+{
+   FunctionSummaryCache cache;
+   ASSERT_FALSE(cache.load(m_path));
+   ASSERT_EQ(cache.size(), 0u);
+   ASSERT_FALSE(cache.lookup("effects", "key").hasValue());
+   ASSERT_EQ(cache.getNumMisses(), 1u);
+}
+
+TEST_F(FunctionSummaryCacheTest, testSaveAndLoad)
+{
+   {
+      FunctionSummaryCache cache;
+      cache.insert("effects", "b", "payload-b");
+      cache.insert("effects", "a", "payload-a");
+      cache.insert("prespecialization", "a", "payload-c");
+      ASSERT_TRUE(cache.save(m_path, 8));
+   }
+   // The entries are written sorted, so the file doesn't depend on the order
+   // of the insertions.
+   ASSERT_EQ(readFile(), "polarphp-pil-summaries 1\n"
+                         "effects a 0 payload-a\n"
+                         "effects b 0 payload-b\n"
+                         "prespecialization a 0 payload-c\n");
+
+   FunctionSummaryCache cache;
+   ASSERT_TRUE(cache.load(m_path));
+   ASSERT_EQ(cache.size(), 3u);
+   auto payload = cache.lookup("effects", "a");
+   ASSERT_TRUE(payload.hasValue());
+   ASSERT_EQ(*payload, "payload-a");
+   ASSERT_EQ(*cache.lookup("prespecialization", "a"), "payload-c");
+   ASSERT_FALSE(cache.lookup("prespecialization", "b").hasValue());
+   ASSERT_EQ(cache.getNumHits(), 2u);
+   ASSERT_EQ(cache.getNumMisses(), 1u);
+}
+
+TEST_F(FunctionSummaryCacheTest, testInsertReplaces)
+{
+   FunctionSummaryCache cache;
+   cache.insert("effects", "a", "old");
+   cache.insert("effects", "a", "new");
+   ASSERT_EQ(cache.size(), 1u);
+   ASSERT_EQ(*cache.lookup("effects", "a"), "new");
+}
+
+TEST_F(FunctionSummaryCacheTest, testMalformedFile)
+{
+   writeFile("polarphp-pil-summaries 1\n"
+             "effects a 0 payload-a\n"
+             "effects b not-an-age payload-b\n");
+   FunctionSummaryCache cache;
+   ASSERT_FALSE(cache.load(m_path));
+   ASSERT_EQ(cache.size(), 0u);
+
+   writeFile("polarphp-pil-summaries 2\n"
+             "effects a 0 payload-a\n");
+   ASSERT_FALSE(cache.load(m_path));
+   ASSERT_EQ(cache.size(), 0u);
+}
+
+TEST_F(FunctionSummaryCacheTest, testUnusedEntriesAge)
+{
+   {
+      FunctionSummaryCache cache;
+      cache.insert("effects", "used", "1");
+      cache.insert("effects", "unused", "2");
+      ASSERT_TRUE(cache.save(m_path, 2));
+   }
+   // Every compilation which doesn't use an entry makes it one older.
+   compile({"used"}, 2);
+   ASSERT_EQ(readFile(), "polarphp-pil-summaries 1\n"
+                         "effects unused 1 2\n"
+                         "effects used 0 1\n");
+   compile({"used"}, 2);
+   ASSERT_EQ(readFile(), "polarphp-pil-summaries 1\n"
+                         "effects unused 2 2\n"
+                         "effects used 0 1\n");
+   // Older than the limit, it is dropped.
+   compile({"used"}, 2);
+   ASSERT_EQ(readFile(), "polarphp-pil-summaries 1\n"
+                         "effects used 0 1\n");
+}
+
+TEST_F(FunctionSummaryCacheTest, testMarkUsedMakesEntryYoung)
+{
+   writeFile("polarphp-pil-summaries 1\n"
+             "effects a 5 payload-a\n");
+   compile({"a"}, 8);
+   ASSERT_EQ(readFile(), "polarphp-pil-summaries 1\n"
+                         "effects a 0 payload-a\n");
+}
+
+TEST_F(FunctionSummaryCacheTest, testLookupKeepsAge)
+{
+   writeFile("polarphp-pil-summaries 1\n"
+             "effects a 5 payload-a\n");
+   FunctionSummaryCache cache;
+   ASSERT_TRUE(cache.load(m_path));
+   // A payload which the caller didn't accept doesn't keep the entry alive.
+   ASSERT_TRUE(cache.lookup("effects", "a").hasValue());
+   ASSERT_TRUE(cache.save(m_path, 8));
+   ASSERT_EQ(readFile(), "polarphp-pil-summaries 1\n"
+                         "effects a 6 payload-a\n");
+}
+
+TEST_F(FunctionSummaryCacheTest, testConcurrentCompilationsMerge)
+{
+   {
+      FunctionSummaryCache cache;
+      cache.insert("effects", "shared", "0");
+      ASSERT_TRUE(cache.save(m_path, 8));
+   }
+   // Two compilations of a build load the same file.
+   FunctionSummaryCache first;
+   FunctionSummaryCache second;
+   ASSERT_TRUE(first.load(m_path));
+   ASSERT_TRUE(second.load(m_path));
+   first.insert("effects", "first", "1");
+   first.markUsed("effects", "shared");
+   second.insert("effects", "second", "2");
+   ASSERT_TRUE(first.save(m_path, 8));
+   ASSERT_TRUE(second.save(m_path, 8));
+
+   // The entries of both are kept. The shared entry is only as old as the
+   // one compilation which didn't use it, although that one saved last.
+   ASSERT_EQ(readFile(), "polarphp-pil-summaries 1\n"
+                         "effects first 0 1\n"
+                         "effects second 0 2\n"
+                         "effects shared 1 0\n");
+}
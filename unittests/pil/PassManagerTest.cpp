@@ -0,0 +1,214 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/12/02.
+
+#include "polarphp/ast/AstContext.h"
+#include "polarphp/ast/DiagnosticEngine.h"
+#include "polarphp/ast/Module.h"
+#include "polarphp/ast/PILOptions.h"
+#include "polarphp/ast/SearchPathOptions.h"
+#include "polarphp/basic/SourceMgr.h"
+#include "polarphp/kernel/LangOptions.h"
+#include "polarphp/pil/lang/PILBuilder.h"
+#include "polarphp/pil/lang/PILModule.h"
+#include "polarphp/pil/lang/TypeLowering.h"
+#include "polarphp/pil/optimizer/passmgr/PassManager.h"
+#include "polarphp/pil/optimizer/passmgr/PassPipeline.h"
+#include "polarphp/pil/optimizer/passmgr/Transforms.h"
+#include "polarphp/pil/optimizer/utils/PILOptFunctionBuilder.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+extern llvm::cl::opt<unsigned> PILFunctionPassThreads;
+
+using namespace polar;
+
+namespace {
+
+/// Fills the module with functions which contain two consecutive cond_fails,
+/// so that the parallel safe passes have something to change.
+class CreateCondFailFunctions : public PILModuleTransform {
+public:
+   explicit CreateCondFailFunctions(unsigned count)
+      : m_count(count)
+   {}
+
+   void run() override
+   {
+      PILModule &module = *getModule();
+      AstContext &context = module.getAstContext();
+      PILType int1Type = PILType::getBuiltinIntegerType(1, context);
+      PILParameterInfo params[] = {
+         PILParameterInfo(int1Type.getAstType(), ParameterConvention::Direct_Unowned),
+         PILParameterInfo(int1Type.getAstType(), ParameterConvention::Direct_Unowned)
+      };
+      PILResultInfo results[] = {
+         PILResultInfo(int1Type.getAstType(), ResultConvention::Unowned)
+      };
+      PILFunctionType::ExtInfo extInfo;
+      extInfo = extInfo.withRepresentation(PILFunctionType::Representation::Thin);
+      CanPILFunctionType funcType =
+            PILFunctionType::get(nullptr, extInfo, PILCoroutineKind::None,
+                                 ParameterConvention::Direct_Unowned, params,
+                                 /*yields*/ {}, results, None, SubstitutionMap(),
+                                 false, context);
+
+      PILOptFunctionBuilder funcBuilder(*this);
+      RegularLocation loc = RegularLocation::getAutoGeneratedLocation();
+      for (unsigned i = 0; i < m_count; ++i) {
+         PILFunction *func = funcBuilder.getOrCreateFunction(
+                  loc, "cond_fails_" + std::to_string(i), PILLinkage::Public,
+                  funcType, IsBare, IsNotTransparent, IsNotSerialized, IsNotDynamic);
+         PILBasicBlock *entry = func->createBasicBlock();
+         PILValue lhs = entry->createFunctionArgument(int1Type);
+         PILValue rhs = entry->createFunctionArgument(int1Type);
+         PILBuilder builder(entry);
+         builder.setCurrentDebugScope(func->getDebugScope());
+         builder.createCondFail(loc, lhs, "lhs");
+         builder.createCondFail(loc, rhs, "rhs");
+         builder.createReturn(loc, lhs);
+      }
+   }
+
+private:
+   unsigned m_count;
+};
+
+class PassManagerTest : public ::testing::Test
+{
+protected:
+   PassManagerTest()
+      : m_diags(m_sourceMgr)
+   {
+      m_langOpts.Target = llvm::Triple(llvm::sys::getProcessTriple());
+      m_context = AstContext::get(m_langOpts, m_typeCheckerOpts, m_searchPathOpts,
+                                  m_sourceMgr, m_diags);
+      m_module = ModuleDecl::create(m_context->getIdentifier("pass_manager_test"),
+                                    *m_context);
+      m_pilOpts.OptMode = OptimizationMode::ForSpeed;
+   }
+
+   ~PassManagerTest()
+   {
+      delete m_context;
+   }
+
+   /// Runs the parallel safe passes on \p threadCount threads on a new module
+   /// with \p functionCount functions and returns the printed result.
+   std::string runPipeline(unsigned threadCount, unsigned functionCount = 64)
+   {
+      unsigned savedThreadCount = PILFunctionPassThreads;
+      PILFunctionPassThreads = threadCount;
+
+      lowering::TypeConverter typeConverter(*m_module);
+      std::unique_ptr<PILModule> pilModule =
+            PILModule::createEmptyModule(m_module, typeConverter, m_pilOpts);
+      PILPassManager passManager(pilModule.get());
+
+      CreateCondFailFunctions createFunctions(functionCount);
+      createFunctions.injectPassManager(&passManager);
+      createFunctions.injectModule(pilModule.get());
+      createFunctions.run();
+
+      passManager.executePassPipelinePlan(
+               PILPassPipelinePlan::getPassPipelineForKinds(
+                  m_pilOpts, {PassKind::MergeCondFails,
+                              PassKind::RedundantOverflowCheckRemoval,
+                              PassKind::CodeSinking}));
+      PILFunctionPassThreads = savedThreadCount;
+
+      std::string result;
+      llvm::raw_string_ostream stream(result);
+      pilModule->print(stream);
+      return stream.str();
+   }
+
+   SourceManager m_sourceMgr;
+   DiagnosticEngine m_diags;
+   LangOptions m_langOpts;
+   TypeCheckerOptions m_typeCheckerOpts;
+   SearchPathOptions m_searchPathOpts;
+   PILOptions m_pilOpts;
+   AstContext *m_context;
+   ModuleDecl *m_module;
+};
+
+} // anonymous namespace
+
+TEST_F(PassManagerTest, testParallelPipelineMatchesSerialPipeline)
+{
+   std::string serial = runPipeline(1);
+   std::string parallel = runPipeline(4);
+   // The cond_fails were merged, so the passes actually ran.
+   ASSERT_NE(serial.find("or_Int1"), std::string::npos);
+   ASSERT_EQ(serial, parallel);
+}
+
+// Meant to be run in a build configured with -DPOLAR_USE_SANITIZER=Thread,
+// where races between the workers are reported even if the output matches.
+TEST_F(PassManagerTest, testParallelPipelineStress)
+{
+   std::string serial = runPipeline(1, 512);
+   for (unsigned run = 0; run < 4; ++run) {
+      ASSERT_EQ(serial, runPipeline(8, 512));
+   }
+}
+
+TEST_F(PassManagerTest, testConcurrentTypeLoweringAndAllocation)
+{
+   lowering::TypeConverter typeConverter(*m_module);
+   std::unique_ptr<PILModule> pilModule =
+         PILModule::createEmptyModule(m_module, typeConverter, m_pilOpts);
+   // The AST types are created up front, the workers only lower them.
+   std::vector<CanType> types;
+   for (unsigned width = 1; width <= 64; ++width) {
+      CanType intType = PILType::getBuiltinIntegerType(width, *m_context).getAstType();
+      types.push_back(intType);
+      types.push_back(CanType(TupleType::get({intType, m_context->TheRawPointerType},
+                                             *m_context)));
+   }
+
+   constexpr unsigned threadCount = 8;
+   std::vector<std::vector<const lowering::TypeLowering *>> lowerings(threadCount);
+   pilModule->setConcurrentFunctionPasses(true);
+   std::vector<std::thread> workers;
+   for (unsigned i = 0; i < threadCount; ++i) {
+      workers.emplace_back([&, i]() {
+         pilModule->enterConcurrentWorker();
+         for (CanType type : types) {
+            lowerings[i].push_back(&typeConverter.getTypeLowering(
+                                      type, TypeExpansionContext::minimal()));
+            // Allocations from the worker's own allocator stay usable.
+            StringRef copy = pilModule->allocateCopy(StringRef("worker"));
+            EXPECT_EQ(copy, "worker");
+         }
+         pilModule->leaveConcurrentWorker();
+      });
+   }
+   for (std::thread &worker : workers) {
+      worker.join();
+   }
+   pilModule->setConcurrentFunctionPasses(false);
+
+   // Every thread got the one lowering the converter caches for a type.
+   for (unsigned i = 0; i < types.size(); ++i) {
+      const lowering::TypeLowering *expected =
+            &typeConverter.getTypeLowering(types[i], TypeExpansionContext::minimal());
+      for (unsigned thread = 0; thread < threadCount; ++thread) {
+         ASSERT_EQ(lowerings[thread][i], expected);
+      }
+   }
+}
@@ -0,0 +1,115 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/11/22.
+
+#include "polarphp/syntax/RawSyntax.h"
+#include "polarphp/syntax/TokenKinds.h"
+#include "gtest/gtest.h"
+
+#include <future>
+#include <set>
+#include <thread>
+#include <vector>
+
+using polar::syntax::RawSyntax;
+using polar::syntax::TokenKindType;
+using polar::syntax::SourcePresence;
+using polar::basic::OwnedString;
+using polar::syntax::SyntaxNodeId;
+using polar::syntax::SyntaxKind;
+
+TEST(RawSyntaxTest, testNodeIdsAreUniqueAcrossThreads)
+{
+   const size_t threadCount = 4;
+   const size_t nodesPerThread = 3 * RawSyntax::NodeIdBlockSize + 7;
+   std::vector<std::vector<SyntaxNodeId>> ids(threadCount);
+   std::vector<std::thread> threads;
+   for (size_t i = 0; i < threadCount; ++i) {
+      threads.emplace_back([&ids, i, nodesPerThread]() {
+         for (size_t j = 0; j < nodesPerThread; ++j) {
+            auto token = RawSyntax::make(TokenKindType::T_SEMICOLON, OwnedString(";"), {}, {},
+                                         SourcePresence::Present);
+            ids[i].push_back(token->getId());
+         }
+      });
+   }
+   for (std::thread &thread : threads) {
+      thread.join();
+   }
+   std::set<SyntaxNodeId> uniqueIds;
+   for (auto &threadIds : ids) {
+      uniqueIds.insert(threadIds.begin(), threadIds.end());
+   }
+   ASSERT_EQ(uniqueIds.size(), threadCount * nodesPerThread);
+}
+
+TEST(RawSyntaxTest, testManuallySpecifiedNodeIdIsNotReused)
+{
+   auto first = RawSyntax::make(SyntaxKind::Unknown, {}, SourcePresence::Present);
+   // an id from outside, e.g. a deserialized tree, inside our current block
+   SyntaxNodeId foreignId = first->getId() + 1;
+   auto foreign = RawSyntax::make(SyntaxKind::Unknown, {}, SourcePresence::Present, foreignId);
+   ASSERT_EQ(foreign->getId(), foreignId);
+   for (size_t i = 0; i < 2 * RawSyntax::NodeIdBlockSize; ++i) {
+      auto node = RawSyntax::make(SyntaxKind::Unknown, {}, SourcePresence::Present);
+      ASSERT_NE(node->getId(), foreignId);
+   }
+}
+
+TEST(RawSyntaxTest, testManuallySpecifiedNodeIdInOtherThreadBlock)
+{
+   std::promise<SyntaxNodeId> workerFirstId;
+   std::promise<void> reserved;
+   SyntaxNodeId foreignId = 0;
+   bool handedOutForeignId = false;
+   std::thread worker([&]() {
+      workerFirstId.set_value(RawSyntax::make(SyntaxKind::Unknown, {}, SourcePresence::Present)->getId());
+      reserved.get_future().wait();
+      for (size_t i = 0; i < 2 * RawSyntax::NodeIdBlockSize; ++i) {
+         auto node = RawSyntax::make(SyntaxKind::Unknown, {}, SourcePresence::Present);
+         handedOutForeignId |= node->getId() == foreignId;
+      }
+   });
+   // an id inside the block the worker holds
+   foreignId = workerFirstId.get_future().get() + 1;
+   auto foreign = RawSyntax::make(SyntaxKind::Unknown, {}, SourcePresence::Present, foreignId);
+   reserved.set_value();
+   worker.join();
+   ASSERT_EQ(foreign->getId(), foreignId);
+   ASSERT_FALSE(handedOutForeignId);
+}
+
+TEST(RawSyntaxTest, testManuallySpecifiedNodeIdKeepsOtherBlocks)
+{
+   // both threads start with a fresh block, the reservation inside the block
+   // of the second one must not make the first one drop its block
+   std::promise<SyntaxNodeId> firstIds[2];
+   std::promise<void> reserved;
+   std::shared_future<void> reservedFuture = reserved.get_future().share();
+   SyntaxNodeId nextIds[2] = {0, 0};
+   std::vector<std::thread> threads;
+   for (size_t i = 0; i < 2; ++i) {
+      threads.emplace_back([&, i]() {
+         firstIds[i].set_value(RawSyntax::make(SyntaxKind::Unknown, {}, SourcePresence::Present)->getId());
+         reservedFuture.wait();
+         nextIds[i] = RawSyntax::make(SyntaxKind::Unknown, {}, SourcePresence::Present)->getId();
+      });
+   }
+   SyntaxNodeId keptFirstId = firstIds[0].get_future().get();
+   SyntaxNodeId droppedFirstId = firstIds[1].get_future().get();
+   auto foreign = RawSyntax::make(SyntaxKind::Unknown, {}, SourcePresence::Present, droppedFirstId + 1);
+   reserved.set_value();
+   for (std::thread &thread : threads) {
+      thread.join();
+   }
+   ASSERT_EQ(foreign->getId(), droppedFirstId + 1);
+   ASSERT_EQ(nextIds[0], keptFirstId + 1);
+   ASSERT_NE(nextIds[1], droppedFirstId + 1);
+}
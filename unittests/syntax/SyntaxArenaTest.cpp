@@ -0,0 +1,202 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/11/22.
+
+#include "polarphp/syntax/RawSyntax.h"
+#include "polarphp/syntax/SyntaxArena.h"
+#include "polarphp/syntax/TokenKinds.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+using polar::syntax::RawSyntax;
+using polar::syntax::TokenKindType;
+using polar::syntax::TriviaPiece;
+using polar::syntax::SourcePresence;
+using polar::syntax::AbsolutePosition;
+using polar::basic::OwnedString;
+using polar::syntax::SyntaxKind;
+using polar::syntax::SyntaxArena;
+using polar::syntax::RefCountPtr;
+
+TEST(SyntaxArenaTest, testInternedNodesAreShared)
+{
+   RefCountPtr<SyntaxArena> arena(new SyntaxArena());
+   arena->setInterningEnabled(true);
+   auto makeSemicolon = [&]() {
+      return RawSyntax::make(TokenKindType::T_SEMICOLON, OwnedString::makeUnowned(";"), {},
+      {TriviaPiece::getNewlines(1)}, SourcePresence::Present, arena);
+   };
+   auto first = makeSemicolon();
+   auto second = makeSemicolon();
+   ASSERT_EQ(first.get(), second.get());
+   ASSERT_TRUE(first->isInterned());
+   // different trivia or trivia with text are never shared
+   auto spaced = RawSyntax::make(TokenKindType::T_SEMICOLON, OwnedString::makeUnowned(";"), {},
+   {TriviaPiece::getSpaces(1)}, SourcePresence::Present, arena);
+   ASSERT_NE(first.get(), spaced.get());
+   auto commented = RawSyntax::make(TokenKindType::T_SEMICOLON, OwnedString::makeUnowned(";"),
+   {TriviaPiece::getBlockComment("/* x */")}, {}, SourcePresence::Present, arena);
+   auto commentedAgain = RawSyntax::make(TokenKindType::T_SEMICOLON, OwnedString::makeUnowned(";"),
+   {TriviaPiece::getBlockComment("/* x */")}, {}, SourcePresence::Present, arena);
+   ASSERT_NE(commented.get(), commentedAgain.get());
+   ASSERT_FALSE(commented->isInterned());
+   // layout nodes made of shared nodes only are shared too
+   auto firstLayout = RawSyntax::make(SyntaxKind::TopStmt, {first, spaced}, SourcePresence::Present, arena);
+   auto secondLayout = RawSyntax::make(SyntaxKind::TopStmt, {second, spaced}, SourcePresence::Present, arena);
+   ASSERT_EQ(firstLayout.get(), secondLayout.get());
+   auto mixedLayout = RawSyntax::make(SyntaxKind::TopStmt, {first, commented}, SourcePresence::Present, arena);
+   ASSERT_FALSE(mixedLayout->isInterned());
+
+   SyntaxArena::InternStats stats = arena->getInternStats();
+   ASSERT_EQ(stats.tokenHits, 1u);
+   ASSERT_EQ(stats.tokenMisses, 2u);
+   ASSERT_EQ(stats.layoutHits, 1u);
+   ASSERT_EQ(stats.layoutMisses, 1u);
+   ASSERT_GT(stats.bytesSaved, 0u);
+
+   // once every reference is gone the node leaves the cache
+   first.reset();
+   second.reset();
+   firstLayout.reset();
+   secondLayout.reset();
+   mixedLayout.reset();
+   auto third = makeSemicolon();
+   ASSERT_EQ(arena->getInternStats().tokenMisses, 3u);
+}
+
+TEST(SyntaxArenaTest, testManyInternedNodes)
+{
+   // enough distinct tokens to grow the cache several times and hit every
+   // kind of hash value, the cache must not mistake any of them for an empty
+   // or removed entry
+   RefCountPtr<SyntaxArena> arena(new SyntaxArena());
+   arena->setInterningEnabled(true);
+   const size_t tokenCount = 5000;
+   std::vector<std::string> texts;
+   for (size_t i = 0; i < tokenCount; ++i) {
+      texts.push_back("name" + std::to_string(i));
+   }
+   auto makeIdentifier = [&](size_t i) {
+      return RawSyntax::make(TokenKindType::T_IDENTIFIER_STRING, OwnedString::makeUnowned(texts[i]), {}, {},
+      SourcePresence::Present, arena);
+   };
+   std::vector<RefCountPtr<RawSyntax>> tokens;
+   for (size_t i = 0; i < tokenCount; ++i) {
+      tokens.push_back(makeIdentifier(i));
+   }
+   for (size_t i = 0; i < tokenCount; ++i) {
+      ASSERT_EQ(makeIdentifier(i).get(), tokens[i].get()) << texts[i];
+   }
+   // drop every other token, they leave the cache and are made again
+   for (size_t i = 0; i < tokenCount; i += 2) {
+      tokens[i].reset();
+   }
+   for (size_t i = 0; i < tokenCount; ++i) {
+      auto token = makeIdentifier(i);
+      if (i % 2 == 0) {
+         tokens[i] = token;
+      } else {
+         ASSERT_EQ(token.get(), tokens[i].get()) << texts[i];
+      }
+   }
+   SyntaxArena::InternStats stats = arena->getInternStats();
+   ASSERT_EQ(stats.tokenMisses, tokenCount + tokenCount / 2);
+   ASSERT_EQ(stats.tokenHits, tokenCount + tokenCount / 2);
+}
+
+TEST(SyntaxArenaTest, testInterningIsOptIn)
+{
+   RefCountPtr<SyntaxArena> arena(new SyntaxArena());
+   auto first = RawSyntax::make(TokenKindType::T_SEMICOLON, OwnedString::makeUnowned(";"), {}, {},
+                                SourcePresence::Present, arena);
+   auto second = RawSyntax::make(TokenKindType::T_SEMICOLON, OwnedString::makeUnowned(";"), {}, {},
+                                 SourcePresence::Present, arena);
+   ASSERT_NE(first.get(), second.get());
+   ASSERT_EQ(arena->getInternStats().tokenMisses, 0u);
+}
+
+namespace {
+
+/// Build \p stmtCount statements `$a;` with a missing middle child in
+/// \p arena and return the statement list.
+RefCountPtr<RawSyntax> make_stmt_list(size_t stmtCount, const RefCountPtr<SyntaxArena> &arena)
+{
+   std::vector<RefCountPtr<RawSyntax>> stmts;
+   stmts.reserve(stmtCount);
+   for (size_t i = 0; i < stmtCount; ++i) {
+      auto variable = RawSyntax::make(TokenKindType::T_VARIABLE, OwnedString::makeUnowned("$a"), {},
+      {TriviaPiece::getSpaces(1)}, SourcePresence::Present, arena);
+      auto semicolon = RawSyntax::make(TokenKindType::T_SEMICOLON, OwnedString::makeUnowned(";"), {},
+      {TriviaPiece::getNewlines(1)}, SourcePresence::Present, arena);
+      stmts.push_back(RawSyntax::make(SyntaxKind::TopStmt, {variable, nullptr, semicolon},
+                                      SourcePresence::Present, arena));
+   }
+   return RawSyntax::make(SyntaxKind::TopStmtList, stmts, SourcePresence::Present, arena);
+}
+
+} // anonymous namespace
+
+TEST(SyntaxArenaTest, testCompactLayout)
+{
+   RefCountPtr<RawSyntax> stmtList;
+   {
+      RefCountPtr<SyntaxArena> arena(new SyntaxArena());
+      arena->setCompactLayoutEnabled(true);
+      stmtList = make_stmt_list(3, arena);
+   }
+   // the tree keeps the arena alive on its own
+   ASSERT_TRUE(stmtList->isArenaOwned());
+   ASSERT_TRUE(stmtList->hasCompactLayout());
+   ASSERT_EQ(stmtList->getNumChildren(), 3u);
+   RawSyntax *stmt = stmtList->getChild(1);
+   ASSERT_TRUE(stmt->hasCompactLayout());
+   ASSERT_EQ(stmt->getChild(0)->getTokenText(), "$a");
+   ASSERT_EQ(stmt->getChild(1), nullptr);
+   ASSERT_EQ(stmt->getChild(2)->getTokenKind(), TokenKindType::T_SEMICOLON);
+   ASSERT_EQ(stmtList->getTextLength(), 3 * 5u);
+
+   // nodes outside of the arena are referenced by pointer
+   auto foreign = RawSyntax::make(TokenKindType::T_SEMICOLON, OwnedString::makeUnowned(";"), {}, {},
+                                  SourcePresence::Present);
+   auto appended = stmtList->append(foreign);
+   ASSERT_FALSE(appended->isArenaOwned());
+   ASSERT_EQ(appended->getNumChildren(), 4u);
+   ASSERT_EQ(appended->getChild(0), stmtList->getChild(0));
+   RefCountPtr<SyntaxArena> arena(new SyntaxArena());
+   arena->setCompactLayoutEnabled(true);
+   auto own = RawSyntax::make(TokenKindType::T_SEMICOLON, OwnedString::makeUnowned(";"), {}, {},
+                              SourcePresence::Present, arena);
+   auto mixed = RawSyntax::make(SyntaxKind::TopStmt, {own, foreign}, SourcePresence::Present, arena);
+   ASSERT_TRUE(mixed->isArenaOwned());
+   ASSERT_FALSE(mixed->hasCompactLayout());
+   ASSERT_EQ(mixed->getChild(1), foreign.get());
+}
+
+TEST(SyntaxArenaTest, testCompactLayoutFootprint)
+{
+   constexpr size_t stmtCount = 10000;
+   size_t pointerBytes = 0;
+   for (bool compactLayout : {false, true}) {
+      RefCountPtr<SyntaxArena> arena(new SyntaxArena());
+      arena->setCompactLayoutEnabled(compactLayout);
+      RefCountPtr<RawSyntax> stmtList = make_stmt_list(stmtCount, arena);
+      AbsolutePosition pos;
+      stmtList->accumulateAbsolutePosition(pos);
+      ASSERT_EQ(pos.getOffset(), stmtCount * 5);
+      if (compactLayout) {
+         // the child arrays hold 32-bit references instead of pointers
+         ASSERT_LT(arena->getBytesUsed(), pointerBytes);
+      } else {
+         pointerBytes = arena->getBytesUsed();
+      }
+   }
+}
@@ -0,0 +1,163 @@
+// This source file is part of the polarphp.org open source project
+//
+// Copyright (c) 2017 - 2019 polarphp software foundation
+// Copyright (c) 2017 - 2019 zzu_softboy <zzu_softboy@163.com>
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See https://polarphp.org/LICENSE.txt for license information
+// See https://polarphp.org/CONTRIBUTORS.txt for the list of polarphp project authors
+//
+// Created by polarboy on 2019/11/20.
+
+#include "polarphp/syntax/SyntaxCursor.h"
+#include "polarphp/syntax/TokenKinds.h"
+#include "gtest/gtest.h"
+
+#include <functional>
+#include <vector>
+
+using polar::syntax::RawSyntax;
+using polar::syntax::RawSyntaxCursor;
+using polar::syntax::TokenKindType;
+using polar::syntax::TriviaPiece;
+using polar::syntax::SourcePresence;
+using polar::syntax::AbsolutePosition;
+using polar::basic::OwnedString;
+using polar::syntax::SyntaxKind;
+using polar::syntax::RefCountPtr;
+
+namespace {
+
+/// Build \p stmtCount statements `$a = 1;` where the middle child of every
+/// statement is null and the literal is missing.
+RefCountPtr<RawSyntax> make_stmt_list(size_t stmtCount)
+{
+   std::vector<RefCountPtr<RawSyntax>> stmts;
+   stmts.reserve(stmtCount);
+   for (size_t i = 0; i < stmtCount; ++i) {
+      auto variable = RawSyntax::make(TokenKindType::T_VARIABLE, OwnedString::makeUnowned("$a"),
+      {TriviaPiece::getSpaces(2)}, {TriviaPiece::getSpaces(1)}, SourcePresence::Present);
+      auto equal = RawSyntax::make(TokenKindType::T_EQUAL, OwnedString::makeUnowned("="), {},
+      {TriviaPiece::getSpaces(1)}, SourcePresence::Present);
+      auto number = RawSyntax::missing(TokenKindType::T_LNUMBER, OwnedString::makeUnowned("1"));
+      auto semicolon = RawSyntax::make(TokenKindType::T_SEMICOLON, OwnedString::makeUnowned(";"), {},
+      {TriviaPiece::getNewlines(1)}, SourcePresence::Present);
+      stmts.push_back(RawSyntax::make(SyntaxKind::TopStmt, {variable, nullptr, equal, number, semicolon},
+                                      SourcePresence::Present));
+   }
+   return RawSyntax::make(SyntaxKind::TopStmtList, stmts, SourcePresence::Present);
+}
+
+} // anonymous namespace
+
+TEST(RawSyntaxCursorTest, testEventOrder)
+{
+   auto stmtList = make_stmt_list(2);
+   RawSyntaxCursor cursor(stmtList.get());
+   std::vector<std::pair<bool, const RawSyntax *>> events;
+   while (cursor.advance()) {
+      events.emplace_back(cursor.isEntering(), cursor.getNode());
+   }
+   // list + 2 * (stmt + 4 tokens), every node entered and left once
+   ASSERT_EQ(events.size(), 2 * (1 + 2 * 5u));
+   ASSERT_EQ(events.front(), std::make_pair(true, static_cast<const RawSyntax *>(stmtList.get())));
+   ASSERT_EQ(events.back(), std::make_pair(false, static_cast<const RawSyntax *>(stmtList.get())));
+   const RawSyntax *stmt = stmtList->getChild(0);
+   ASSERT_EQ(events[1], std::make_pair(true, stmt));
+   ASSERT_EQ(events[2], std::make_pair(true, static_cast<const RawSyntax *>(stmt->getChild(0))));
+   ASSERT_EQ(events[3], std::make_pair(false, static_cast<const RawSyntax *>(stmt->getChild(0))));
+   // the null child is skipped, the missing one is visited
+   ASSERT_EQ(events[4], std::make_pair(true, static_cast<const RawSyntax *>(stmt->getChild(2))));
+   ASSERT_EQ(events[6], std::make_pair(true, static_cast<const RawSyntax *>(stmt->getChild(3))));
+   ASSERT_EQ(events[10], std::make_pair(false, stmt));
+   ASSERT_FALSE(cursor.advance());
+}
+
+TEST(RawSyntaxCursorTest, testParentAndPositions)
+{
+   auto stmtList = make_stmt_list(3);
+   RawSyntaxCursor cursor(stmtList.get());
+   while (cursor.advance()) {
+      const RawSyntax *node = cursor.getNode();
+      const RawSyntax *parent = cursor.getParent();
+      if (!parent) {
+         ASSERT_EQ(node, stmtList.get());
+         ASSERT_EQ(cursor.getDepth(), 0u);
+         continue;
+      }
+      ASSERT_EQ(parent->getChild(cursor.getIndexInParent()), node);
+      // compare with a walk from the root that stops at the node
+      AbsolutePosition expected;
+      bool found = false;
+      std::function<void(const RawSyntax *)> accumulate = [&](const RawSyntax *current) {
+         if (found) {
+            return;
+         }
+         if (current == node && cursor.isEntering()) {
+            found = true;
+            return;
+         }
+         if (current->isToken()) {
+            current->accumulateAbsolutePosition(expected);
+         } else {
+            for (RawSyntax *child : current->getLayout()) {
+               if (child) {
+                  accumulate(child);
+               }
+            }
+         }
+         if (current == node) {
+            found = true;
+         }
+      };
+      accumulate(stmtList.get());
+      ASSERT_TRUE(found);
+      ASSERT_EQ(cursor.getPosition().getOffset(), expected.getOffset());
+      ASSERT_EQ(cursor.getPosition().getLine(), expected.getLine());
+      ASSERT_EQ(cursor.getPosition().getColumn(), expected.getColumn());
+   }
+   // `  $a = ;\n` is 9 bytes long
+   ASSERT_EQ(cursor.getPosition().getOffset(), 3 * 9u);
+   ASSERT_EQ(cursor.getPosition().getLine(), 4u);
+}
+
+TEST(RawSyntaxCursorTest, testSkipChildren)
+{
+   auto stmtList = make_stmt_list(4);
+   RawSyntaxCursor cursor(stmtList.get());
+   size_t tokenCount = 0;
+   size_t stmtIndex = 0;
+   while (cursor.advance()) {
+      const RawSyntax *node = cursor.getNode();
+      if (node->getKind() == SyntaxKind::TopStmt) {
+         if (cursor.isEntering()) {
+            ASSERT_EQ(cursor.getPosition().getOffset(), stmtIndex * 9);
+            if (stmtIndex % 2 == 0) {
+               cursor.skipChildren();
+            }
+         } else {
+            ASSERT_EQ(cursor.getPosition().getOffset(), (stmtIndex + 1) * 9);
+            ++stmtIndex;
+         }
+      } else if (node->isToken() && cursor.isEntering()) {
+         ++tokenCount;
+      }
+   }
+   ASSERT_EQ(stmtIndex, 4u);
+   ASSERT_EQ(tokenCount, 2 * 4u);
+}
+
+TEST(RawSyntaxCursorTest, testWalkLargeTree)
+{
+   constexpr size_t stmtCount = 20000;
+   auto stmtList = make_stmt_list(stmtCount);
+   size_t nodeCount = 0;
+   RawSyntaxCursor cursor(stmtList.get());
+   while (cursor.advance()) {
+      if (cursor.isEntering()) {
+         ++nodeCount;
+      }
+   }
+   ASSERT_EQ(nodeCount, 1 + stmtCount * 5);
+   ASSERT_EQ(cursor.getPosition().getOffset(), stmtCount * 9);
+}
@@ -25,6 +25,10 @@ using polar::syntax::Trivia;
 using nlohmann::json;
 using polar::syntax::SyntaxNodeFactory;
 using polar::syntax::EmptyStmtSyntax;
+using polar::syntax::SyntaxKind;
+using polar::syntax::SourcePresence;
+using polar::syntax::get_token_kind_str;
+using polar::syntax::syntax_tree_to_json;
 
 namespace {
 
@@ -36,6 +40,38 @@ TEST(SyntaxJsonSerializationTest, testSyntaxNode)
    EmptyStmtSyntax emptyStmt = SyntaxNodeFactory::makeEmptyStmt(semicolon);
    json emptyStmtJson = emptyStmt;
    std::cout << emptyStmtJson.dump(3) << std::endl;
+   // only the root is written
+   ASSERT_EQ(emptyStmtJson["kind"], json(SyntaxKind::EmptyStmt));
+   ASSERT_EQ(emptyStmtJson["hasChild"], true);
+   ASSERT_EQ(emptyStmtJson["childCount"], 1);
+   ASSERT_FALSE(emptyStmtJson.contains("children"));
+}
+
+TEST(SyntaxJsonSerializationTest, testSyntaxTree)
+{
+   Trivia leftTrivia;
+   Trivia rightTrivia = Trivia::getSpaces(2);
+   TokenSyntax semicolon = SyntaxNodeFactory::makeSemicolonToken(leftTrivia, rightTrivia);
+   EmptyStmtSyntax emptyStmt = SyntaxNodeFactory::makeEmptyStmt(semicolon);
+   json treeJson;
+   syntax_tree_to_json(treeJson, emptyStmt);
+   ASSERT_EQ(treeJson["kind"], json(SyntaxKind::EmptyStmt));
+   ASSERT_EQ(treeJson["presence"], json(SourcePresence::Present));
+   ASSERT_EQ(treeJson["childCount"], 1);
+   ASSERT_EQ(treeJson["start"]["offset"], 0);
+   ASSERT_EQ(treeJson["end"]["offset"], 3);
+   ASSERT_EQ(treeJson["children"].size(), 1u);
+   const json &tokenJson = treeJson["children"][0];
+   ASSERT_EQ(tokenJson["kind"], json(SyntaxKind::Token));
+   ASSERT_EQ(tokenJson["tokenKind"], get_token_kind_str(TokenKindType::T_SEMICOLON).str());
+   ASSERT_EQ(tokenJson["text"], ";");
+   ASSERT_EQ(tokenJson["hasChild"], false);
+   ASSERT_EQ(tokenJson["start"]["offset"], 0);
+   ASSERT_EQ(tokenJson["start"]["line"], 1);
+   ASSERT_EQ(tokenJson["start"]["column"], 1);
+   // the end includes the trailing trivia
+   ASSERT_EQ(tokenJson["end"]["offset"], 3);
+   ASSERT_FALSE(tokenJson.contains("children"));
 }
 
 }